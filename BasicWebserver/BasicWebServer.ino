@@ -52,6 +52,7 @@
   const char* sversion = "22Jan21";                      // version of this sketch
 
   const bool serialDebug = 1;                            // provide extended debug info on serial port
+  #define DEBUG_LEVEL 3                                  // debug info sent: 1 = errors, 2 = + warnings, 3 = + info, 4 = + verbose (see debug.h)
 
   #define ENABLE_OLED 0                                  // Enable OLED display  
 
@@ -59,8 +60,25 @@
 
   #define ENABLE_EMAIL 0                                 // Enable E-mail  
   
+  #define ENABLE_STALLS 0                                // Enable loop stall detector (see http://x.x.x.x/stalls)
+                                                         //   Note: on the esp8266 this takes timer1 which analogWrite(), tone() and servos also use
+  const uint16_t stallThreshold = 500;                   // a pass of loop taking longer than this is a stall (ms)
+
+  #define ENABLE_PROFILER 0                              // Enable sampling profiler (see http://x.x.x.x/profile?seconds=10)
+
+  #define ENABLE_TRACE 0                                 // Enable request tracing (see http://x.x.x.x/trace.json)
+
+  #define ENABLE_METRICS 0                               // Enable statistics at http://x.x.x.x/metrics (Prometheus format)
+
+  #define ENABLE_DUALCORE 0                              // esp32 only - run the web server on one core and loop on the other (see dualcore.h)
+
+  #define ENABLE_COROUTINES 0                            // web pages which can wait for slow things without holding up the sketch (see coro.h) - needs C++20 e.g. esp32 core 3.x
+
   #define ENABLE_OTA 1                                   // Enable Over The Air updates (OTA)
   const String OTAPassword = "12345678";                 // Password to enable OTA service (supplied as - http://<ip address>?pwd=xxxx )
+  const char OTAServer[] = "";                           // local update server to pull new firmware from e.g. "192.168.1.166" (blank = disabled)
+  const uint16_t OTAServerPort = 80;                     // port of the update server
+  const char OTAManifest[] = "/BasicWebServer.txt";      // manifest on update server describing latest firmware (see ota.h)
 
   const char HomeLink[] = "/";                           // Where home button on web pages links to (usually "/")
 
@@ -68,9 +86,24 @@
   const char JavaRefreshTime[] = "500";                  // time delay when loading url in web pages (Javascript)
   
   const byte LogNumber = 40;                             // number of entries to store in the system log
+  const byte LogLength = 100;                            // max length of each log entry
+  const byte LogLevel = 1;                               // lowest level of message stored in the log (0 = debug, 1 = info, 2 = warning, 3 = error)
 
   const uint16_t ServerPort = 80;                        // ip port to serve web pages on
 
+  const uint16_t taskMax = 24;                           // most routine tasks there can be (see scheduler.h and http://x.x.x.x/tasks)
+
+  const uint16_t routeMax = 32;                          // most web pages there can be in the table (see routes.h)
+
+  #define ENABLE_ADMISSION 0                             // limit how often each client can request pages, too often get "429 Too Many Requests" (see admission.h)
+
+  #define ENABLE_ACCESS 0                                // count requests for each client / page instead of logging them (see http://x.x.x.x/access)
+
+  #define ENABLE_GUARD 0                                 // close connections which are too slow sending their request (see guard.h)
+
+  #define ENABLE_HTTPS 0                                 // esp8266 only - serve the web pages with https, http requests are redirected to it (see https.h)
+  const uint16_t HttpsPort = 443;                        // ip port to serve https web pages on
+
   const byte led = 2;                                    // indicator LED pin - D0/D4 on esp8266 nodemcu, 3 on esp8266-01, 2 on ESP32
 
   const uint16_t ledBlinkRate = 1500;                    // Speed to blink the status LED (milliseconds)
@@ -79,6 +112,23 @@
   const boolean ledOFF = HIGH;
 
   const int serialSpeed = 115200;                        // Serial data speed to use
+
+  #if ENABLE_DUALCORE && !defined ESP32
+    #undef ENABLE_DUALCORE                               // the esp8266 only has one core
+    #define ENABLE_DUALCORE 0
+  #endif
+  #if ENABLE_HTTPS && !defined ESP8266
+    #undef ENABLE_HTTPS                                  // the esp32 Arduino core has no https web server
+    #define ENABLE_HTTPS 0
+  #endif
+  #if ENABLE_GUARD && ENABLE_HTTPS
+    #undef ENABLE_GUARD                                  // (the request can not be checked before it is decrypted)
+    #define ENABLE_GUARD 0
+  #endif
+  #if ENABLE_COROUTINES && !defined __cpp_impl_coroutine
+    #undef ENABLE_COROUTINES                             // the compiler does not support coroutines
+    #define ENABLE_COROUTINES 0
+  #endif
   
 
 // ---------------------------------------------------------------
@@ -97,12 +147,56 @@ bool OTAEnabled = 0;                    // flag if OTA has been enabled (via sup
 bool GSMconnected = 0;                  // flag if the gsm module is connected ok
 bool wifiok = 0;                        // flag if wifi connection is ok
 
-uint32_t LEDtimer = millis();           // used for flashing the LED
-  
+#include "scope.h"                      // Tagged scopes (used to find what is running when loop stalls)
+
+#include "debug.h"                      // Debug info sent to the serial port without waiting
+
+#include "gzip.h"                       // Sending the web pages gzipped
+
+#include "rendercache.h"                // Copies of generated web pages
+
+#include "arena.h"                      // Memory used while handling a web page request
+
 #include "wifi.h"                       // Load the Wifi / NTP stuff
 
+#if ENABLE_HTTPS
+  #include "https.h"                    // Https (certificate, session cache)
+#endif
+
+#include "coro.h"                       // Web pages which can wait without holding up the sketch (coroutines)
+
+#include "trace.h"                      // Request tracing
+
+#include "dualcore.h"                   // Web server and loop on separate cores (esp32)
+
+#include "status.h"                     // Status shown on the web pages
+
+#include "admission.h"                  // Limit how often each client can request pages
+
+#include "metrics.h"                    // Statistics (web page timings etc.)
+
+#include "routes.h"                     // Table of web pages
+
+#include "reqctx.h"                     // Request details (arguments, client ip)
+
+#include "pages.h"                      // Web page templates (created from the templates folder by misc/templates.py)
+
 #include "standard.h"                   // Some standard procedures
 
+#include "assets.h"                     // Static files (css / javascript)
+
+#include "scheduler.h"                  // Runs the routine tasks from loop (see http://x.x.x.x/tasks)
+
+#include "access.h"                     // Requests from each client (see http://x.x.x.x/access)
+
+#if ENABLE_STALLS
+  #include "stall.h"                    // Loop stall detector
+#endif
+
+#if ENABLE_PROFILER
+  #include "profiler.h"                 // Sampling profiler
+#endif
+
 #if ENABLE_OTA
   #include "ota.h"                      // Over The Air updates (OTA)
 #endif
@@ -127,6 +221,49 @@ uint32_t LEDtimer = millis();           // used for flashing the LED
       bool sendEmail(char*, char* , char*);
 #endif
 
+
+
+// ---------------------------------------------------------------
+//    -web pages (see routes.h)
+// ---------------------------------------------------------------
+// {name} in a path matches any text which the page can get with routeParam("name")
+
+  // forward declarations
+    void handleRoot();
+    void handleData();
+    void handlePing();
+    void handleHealthz();
+    void handleTest();
+    void handleFetch();
+
+  constexpr RouteDef webPages[] = {
+    ROUTE(HTTP_ANY, HomeLink, handleRoot),               // root page
+    ROUTE_POLL(HTTP_ANY, "/data", handleData),           // This displays information which updates every few seconds (used by root web page)
+    ROUTE_POLL(HTTP_ANY, "/ping", handlePing),           // ping requested
+    ROUTE_POLL(HTTP_GET, "/healthz", handleHealthz),     // health check for a monitor / load balancer (see status.h)
+    ROUTE(HTTP_ANY, "/log", handleLogpage),              // system log
+    ROUTE(HTTP_ANY, "/log/{lines}", handleLogpage),      // system log, most recent entries only
+    ROUTE(HTTP_ANY, "/test", handleTest),                // testing page
+    ROUTE(HTTP_ANY, "/reboot", handleReboot),            // reboot the esp
+    ROUTE(HTTP_ANY, "/tasks", handleTasks),              // task scheduler statistics
+    ROUTE_POLL(HTTP_GET, "/a/{name}", handleAsset),      // static files (css / javascript)
+    #if ENABLE_ACCESS
+      ROUTE(HTTP_ANY, "/access", handleAccess),          // requests from each client
+    #endif
+    #if ENABLE_METRICS
+      ROUTE(HTTP_ANY, "/metrics", handleMetrics),        // statistics in Prometheus format
+    #endif
+    #if ENABLE_STALLS
+      ROUTE(HTTP_ANY, "/stalls", handleStalls),          // loop stall report
+    #endif
+    #if ENABLE_PROFILER
+      ROUTE(HTTP_ANY, "/profile", handleProfile),        // run the sampling profiler
+    #endif
+    #if ENABLE_COROUTINES
+      ROUTE(HTTP_ANY, "/fetch", handleFetch),            // demo of a coroutine web page
+    #endif
+  };
+
   
 // ---------------------------------------------------------------
 //    -SETUP     SETUP     SETUP     SETUP     SETUP     SETUP
@@ -192,18 +329,62 @@ void setup() {
     #endif
     
   // set up web page request handling
-    server.on(HomeLink, handleRoot);         // root page
-    server.on("/data", handleData);          // This displays information which updates every few seconds (used by root web page)
-    server.on("/ping", handlePing);          // ping requested
-    server.on("/log", handleLogpage);        // system log
-    server.on("/test", handleTest);          // testing page
-    server.on("/reboot", handleReboot);      // reboot the esp
-    server.onNotFound(handleNotFound);       // invalid page requested
+    routesSetup(webPages);                   // the pages listed in 'webPages' above
+    assetsSetup();                           // request headers used when sending static files
+    #if ENABLE_TRACE
+      server.on("/trace.json", handleTrace); // request trace (not traced itself)
+    #endif
+    routeNotFound(handleNotFound);           // invalid page requested
   
   // start web server
     if (serialDebug) Serial.println("Starting web server");
+    statusUpdate();                          // status shown on the web pages
+    #if ENABLE_HTTPS
+      httpsSetup();                          // certificate, session cache and http redirect
+    #endif
     server.begin();
 
+  // routine tasks which are run from loop (see scheduler.h),  period in ms (0 = every time round loop)
+    #if ENABLE_DUALCORE
+      taskAdd("commands", commandsLoop, 0);                        // commands from the web pages (see webCommand())
+    #else
+      #if ENABLE_HTTPS
+        taskAdd("web server", []() { TRACE_SCOPE(trHandleClient); httpsHandleClient(); arenaReset(); }, 0);    // service any web page requests (https.h)
+      #else
+        taskAdd("web server", []() { TRACE_SCOPE(trHandleClient); server.handleClient(); arenaReset(); }, 0);     // service any web page requests
+      #endif
+    #endif
+    #if ENABLE_COROUTINES && !ENABLE_DUALCORE
+      taskAdd("coroutines", coroLoop, 0);                          // resume any web pages which have finished waiting (see coro.h)
+    #endif
+    if (serialDebug) taskAdd("debug output", debugLoop, 0);        // send the debug info to the serial port (see debug.h)
+    taskAdd("status", statusUpdate, 1000);                         // status shown on the web pages (see status.h)
+    #if ENABLE_OLED
+      taskAdd("oled", oledLoop, 0);                                // handle oled menu system
+    #endif
+    #if ENABLE_PROFILER
+      taskAdd("profiler", profileLoop, 0);                         // send profiler samples
+    #endif
+    #if ENABLE_OTA
+      taskAdd("ota pull", otaPullLoop, 0);                         // check update server for new firmware
+    #endif
+    taskAdd("led", []() { digitalWrite(led, !digitalRead(led)); }, ledBlinkRate);   // flash the LED
+    taskAdd("wifi check", WIFIcheck, ledBlinkRate);                // check if wifi connection is ok
+    taskAdd("ntp", []() { now(); }, ledBlinkRate);                 // read current time to ensure NTP auto refresh keeps triggering (otherwise only triggers when time is required causing a delay in response)
+    // (GSM tasks are added in setupGSM)
+
+           // YOUR TASKS HERE !    e.g.  taskAdd("my task", myFunction, 1000);
+
+  // start watching for loop stalls
+    #if ENABLE_STALLS
+      stallSetup();
+    #endif
+
+  // start the web server task on the other core
+    #if ENABLE_DUALCORE
+      dualcoreStart();
+    #endif
+
   // Finished connecting to network
     digitalWrite(led, ledOFF);
     log_system_message("Started");
@@ -220,123 +401,103 @@ void loop(void){
         yield();                      // allow esp8266 to carry out wifi tasks (may restart randomly without this command)
     #endif
     
-    server.handleClient();            // service any web page requests (may not be needed for esp32?)
-
-    #if ENABLE_OLED
-        oledLoop();                   // handle oled menu system
+    metricsLoop();                    // record time taken for each pass of loop
+    #if ENABLE_STALLS
+        stallLoop();                  // tell stall detector loop is still running
     #endif
+    schedulerLoop();                  // run the routine tasks which are due (see setup for the list)
 
-    #if ENABLE_GSM
-        GSMloop();                    // handle GSM board
-    #endif
 
 
+           // YOUR CODE HERE !     (anything periodic is better added as a task in setup so it shows on /tasks)
 
 
-           // YOUR CODE HERE !
 
+} 
 
 
 
-    // every 1.5 seconds change the LED status, check Wifi is connected and update time
-    //          explanation of timing here: https://www.baldengineer.com/arduino-millis-plus-addition-does-not-add-up.html
-    if ((unsigned long)(millis() - LEDtimer) >= ledBlinkRate ) {   
-        digitalWrite(led, !digitalRead(led));        // invert led status
-        WIFIcheck();                                 // check if wifi connection is ok
-        LEDtimer = millis();                         // reset timer
-        time_t t=now();                              // read current time to ensure NTP auto refresh keeps triggering (otherwise only triggers when time is required causing a delay in response)
-    }
+// ----------------------------------------------------------------
+//            -act on the buttons pressed on the web pages
+// ----------------------------------------------------------------
+// the web pages send these with sendCommand(), with ENABLE_DUALCORE they are run from loop
+// (otherwise straight away) so it is safe to do anything here
 
-} 
+  enum webCommands {cmdRadio1, cmdRadio2, cmdDemoButton};
+
+void webCommand(byte cmd) {
+
+  switch (cmd) {
 
+    case cmdRadio1:          // radio button 1 selected
+      log_system_message("radio button 1 selected");       
+      // <code here for radio buttons action>
+      break;
+
+    case cmdRadio2:          // radio button 2 selected
+      log_system_message("radio button 2 selected");       
+      // <code here for radio buttons action>
+      break;
+
+    case cmdDemoButton:      // demo button was pressed 
+      log_system_message("demo button was pressed");     
+      break;
+  }
+}
 
 
 // ----------------------------------------------------------------
 //       -root web page requested    i.e. http://x.x.x.x/
 // ----------------------------------------------------------------
+// Note: the status line at the bottom (memory, wifi etc.) is only updated once a minute as the page is cached
 
-void handleRoot() {  
-
-  WiFiClient client = server.client();             // open link with client
-  String tstr;                                     // temp store for building line of html
-  webheader(client);             // html page header  (with extra formatting)
+  // copies of the root and data pages (see rendercache.h)
+    char rootCacheBuffer[1536];                 // (a page too big for its buffer is just sent directly)
+    RenderCache rootCache(HomeLink, rootCacheBuffer, sizeof(rootCacheBuffer));
+    char dataCacheBuffer[320];
+    RenderCache dataCache("/data", dataCacheBuffer, sizeof(dataCacheBuffer));
 
-  // log page request including clients IP address
-    IPAddress cip = client.remoteIP();
-    log_system_message("Root page requested from: " + String(cip[0]) +"." + String(cip[1]) + "." + String(cip[2]) + "." + String(cip[3]));
+void handleRoot() {  
 
+  MeteredClient client = server.client();             // open link with client
+  RequestContext &req = requestBegin(client);      // arguments and client ip
 
   // action any button presses etc.
 
   #if ENABLE_OTA
   // enable OTA if password supplied in url parameters   (?pass=xxx)
-    if (server.hasArg("pwd")) {
-        String Tvalue = server.arg("pwd");   // read value
-          if (Tvalue == OTAPassword) {
+    if (req.has("pwd")) {
+          if (req.arg("pwd").equals(OTAPassword.c_str())) {
             otaSetup();    // Over The Air updates (OTA)
             log_system_message("OTA enabled");
             OTAEnabled = 1;
+            pageChanged();     // shown on the data page
           }
     }
   #endif
 
     // if demo radio button "RADIO1" was selected 
-      if (server.hasArg("RADIO1")) {
-        String RADIOvalue = server.arg("RADIO1");   // read value of the "RADIO" argument 
-        //if radio button 1 selected
-        if (RADIOvalue == "1") {
-          log_system_message("radio button 1 selected");       
-          // <code here for radio buttons action>
-        }
-        //if radio button 2 selected
-        if (RADIOvalue == "2") {
-          log_system_message("radio button 2 selected");       
-          // <code here for radio buttons action>
-        }      
+      if (req.has("RADIO1")) {
+        StrView RADIOvalue = req.arg("RADIO1");   // read value of the "RADIO" argument 
+        if (RADIOvalue.equals("1")) sendCommand(cmdRadio1);
+        if (RADIOvalue.equals("2")) sendCommand(cmdRadio2);
       }
   
     // if button "demobutton" was pressed  
-      if (server.hasArg("demobutton")) {
-        // demo button was pressed 
-          log_system_message("demo button was pressed");     
-      }
-
-
-  // build the HTML code 
+      if (req.has("demobutton")) sendCommand(cmdDemoButton);
 
-    client.printf("<FORM action='%s' method='post'>\n", HomeLink);     // used by the buttons (action = the page send it to)
-    client.write("<P>");                                               // start of section
 
-    client.print("Welcome to the BasicWebServer, running on a " + String(ARDUINO_BOARD) + "\n");
+  // send the HTML code (from the cache if nothing has changed this minute)
 
-    // insert an iframe containing the changing data (updates every few seconds using javascript)
-      client.write("<br><iframe id='dataframe' height=150 width=600 frameborder='0'></iframe>\n");
-      // javascript to refresh data display
-        client.write("<script>\n");
-        client.printf("setTimeout(function() {document.getElementById('dataframe').src='/data';}, %s );\n", JavaRefreshTime);
-        client.printf("window.setInterval(function() {document.getElementById('dataframe').src='/data';}, %s );\n", datarefresh);
-        client.write("</script>\n"); 
+    // the form is used by the buttons (action = the page send it to), the iframe shows the changing
+    // data (updated every few seconds using javascript) - see templates/root.html
+      cachedRender(client, rootCache, statusRead().minute, acceptsGzip(), [](Print &out) {
+        webheader(out);                                                      // html page header
+        render_root(out, HomeLink, ARDUINO_BOARD, JavaRefreshTime, datarefresh);
+        webfooter(out);                                                      // html page footer
+      });
 
-    // demo radio buttons - "RADIO1"
-      client.write("<br>Demo radio buttons\n");
-      client.write("<br>Radio1 button1\n");                                  // radio button 1
-      client.write("<INPUT type='radio' name='RADIO1' value='1'>\n");
-      client.write("<br>Radio1 button2\n");                                  // radio button 2
-      client.write("<INPUT type='radio' name='RADIO1' value='2'>\n");
-      client.write("<br><INPUT type='reset'>\n");                            // reset radio button 
-      client.write("<INPUT type='submit' value='Action'>\n");                // action button
-
-    // demo standard button 
-    //    'name' is what is tested for above to detect when button is pressed, 'value' is the text displayed on the button
-      client.write("<br><br><input style='"); 
-      // if ( x == 1 ) client.write("background-color:red; ");      // to change button color depending on state
-      client.write("height: 30px;' name='demobutton' value='Demonstration Button' type='submit'>\n");
-
-  
     // close page
-      client.write("</P>");    // end of section    
-      client.write("</form>\n");                                             // end form section (used by buttons etc.)
-      webfooter(client);                                                     // html page footer
       delay(3);        
       client.stop();
 
@@ -351,23 +512,16 @@ void handleRoot() {
 
 void handleData(){
 
-  WiFiClient client = server.client();          // open link with client
-  String tstr;                                  // temp store for building lines of html;
-
-  client.write("<!DOCTYPE HTML>\n");
-  client.write("<html lang='en'><head><title>data</title></head><body>\n"); 
+  MeteredClient client = server.client();          // open link with client
 
-  client.write("<br>Auto refreshing information goes here\n");
-  tstr = "<br>" + currentTime() + "\n";   
-  client.print(tstr);         
+  // the time is only shown to the minute so the page only needs creating once a minute (see templates/data.html)
+    StatusSnapshot status = statusRead();
+    cachedRender(client, dataCache, status.minute, acceptsGzip(), [&status](Print &out) {
+      render_data(out, status.time, OTAEnabled);
+    });
 
-  // OTA enabled status
-    if (OTAEnabled) client.printf("%s <br>OTA ENABLED! %s", colRed, colEnd);
-    
-  // close html page
-    client.write("</body></html>\n");
-    delay(3);
-    client.stop();
+  delay(3);
+  client.stop();
 }
 
 
@@ -375,12 +529,27 @@ void handleData(){
 //      -ping web page requested     i.e. http://x.x.x.x/ping
 // ----------------------------------------------------------------
 
+  const char pingReply[] = "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: 2\r\nConnection: close\r\n\r\nok";
+
 void handlePing(){
 
-  log_system_message("ping web page requested");      
-  String message = "ok";
-  server.send(404, "text/plain", message);   // send reply as plain text
-  
+  MeteredClient client = server.client();
+  client.write((const uint8_t*)pingReply, sizeof(pingReply) - 1);      // (ready made so nothing needs working out)
+  client.stop();
+}
+
+
+// ----------------------------------------------------------------
+//     -health check     i.e. http://x.x.x.x/healthz
+// ----------------------------------------------------------------
+// status as json, the reply is made once a second by statusUpdate() (see status.h)
+
+void handleHealthz(){
+
+  MeteredClient client = server.client();
+  StatusReply reply = statusHealthzRead();
+  client.write((const uint8_t*)reply.text, reply.len);
+  client.stop();
 }
 
 
@@ -390,11 +559,7 @@ void handlePing(){
 
 void handleTest(){
 
-  WiFiClient client = server.client();          // open link with client
-
-  // log page request including clients IP address
-      IPAddress cip = client.remoteIP();
-      log_system_message("Test page requested from: " + String(cip[0]) +"." + String(cip[1]) + "." + String(cip[2]) + "." + String(cip[3]));
+  MeteredClient client = server.client();          // open link with client
   
   webheader(client);                 // add the standard html header
   client.write("<br>TEST PAGE<br><br>\n");
@@ -417,7 +582,7 @@ void handleTest(){
   
 
 
-//  // demo of how to request a web page
+//  // demo of how to request a web page (this holds up the sketch until the reply arrives, see handleFetch() for a way which does not)
 //      String webpage = requestWebPage("192.168.1.166","/log",80,800,"<html>");
 //      if (serialDebug) Serial.println(webpage);
     
@@ -433,4 +598,49 @@ void handleTest(){
 }
 
 
+#if ENABLE_COROUTINES
+
+// ----------------------------------------------------------------
+//   -coroutine demo     i.e. http://x.x.x.x/fetch?host=192.168.1.166&page=/log
+// ----------------------------------------------------------------
+// shows the start of a page from another device, while waiting for it the sketch carries on (see coro.h)
+
+Async fetchPage(ServerClient client) {
+
+  RequestContext &req = requestBegin(client);
+
+  // copy the arguments as 'request' is replaced by the next request while this is waiting
+    char host[40], page[60];
+    snprintf(host, sizeof(host), "%.*s", req.arg("host").len, req.arg("host").ptr);
+    snprintf(page, sizeof(page), "%.*s", req.arg("page").len, req.arg("page").ptr);
+    if (!page[0]) strcpy(page, "/");
+
+  char reply[400];
+  uint32_t started = millis();
+  int len = co_await coroFetch(host, page, 80, reply, sizeof(reply));
+
+  webheader(client);
+  client.printf("<br>Fetched http://%s%s in %ums<br><br>\n", host, page, (unsigned)(millis() - started));
+  if (len < 0) client.write("Failed<br>\n");
+  else {
+    client.write("<pre>");
+    for (int i=0; i < len; i++) {                        // (escape the html)
+      if (reply[i] == '<') client.write("&lt;");
+      else if (reply[i] == '&') client.write("&amp;");
+      else client.write(reply[i]);
+    }
+    client.write("</pre>\n");
+  }
+  webfooter(client);
+  delay(3);
+  client.stop();
+}
+
+void handleFetch() {
+  if (!fetchPage(server.client()).started) server.send(503, "text/plain", "Too many pages waiting, try again later");
+}
+
+#endif
+
+
 // --------------------------- E N D -----------------------------
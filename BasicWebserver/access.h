@@ -0,0 +1,151 @@
+/**************************************************************************************************
+ *
+ *      Access statistics - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Instead of adding a line to the system log every time a page is requested (which soon pushes
+ *      out the useful entries and takes far longer than the page itself) each request is counted in
+ *      a table of client ip address and page, shown at http://x.x.x.x/access
+ *
+ *      For each client / page:  number of requests, bytes sent, when it was last requested and the
+ *                               average time taken to handle it
+ *
+ *      The table is a fixed size (accessSlots entries) searched from the slot the client / page
+ *      hashes to so recording a request takes the same short time however busy the server is.  When
+ *      it is full the entry which has not been requested for the longest is replaced.
+ *
+ *      Only the pages in the route table (see routes.h) and invalid pages are recorded, not pages
+ *      registered with server.on() or requests turned away by admission control (see admission.h).
+ *      Bytes are only counted for pages which use MeteredClient (see metrics.h).
+ *
+ **************************************************************************************************/
+
+
+#if ENABLE_ACCESS
+
+// forward declarations (i.e. details of all functions in this file)
+  void accessBegin();
+  void accessEnd(const char*);
+  void handleAccess();
+
+
+// ----------------------------------------------------------------
+//                              -Startup
+// ----------------------------------------------------------------
+
+  const byte accessBits = 5;
+  const byte accessSlots = 1 << accessBits; // number of client / page entries
+
+  struct AccessEntry {
+    uint32_t ip;                            // client ip address
+    const char* page;                       // path from the route table (nullptr = not used)
+    uint32_t hits;                          // number of requests
+    uint32_t bytes;                         // bytes sent
+    uint32_t lastSeen;                      // millis() of the last request
+    uint64_t totalUs;                       // total time taken to handle the requests (microseconds)
+  };
+  AccessEntry accessTable[accessSlots];
+
+  uint32_t accessReplaced = 0;              // entries replaced as the table was full
+  uint32_t accessStatsStart = 0;            // millis() when the statistics were last reset
+
+  // the request currently being handled
+    uint32_t accessIp = 0;
+    uint32_t accessStartUs = 0;
+    uint32_t accessStartBytes = 0;
+
+
+// ----------------------------------------------------------------
+//                -find the entry for a client / page
+// ----------------------------------------------------------------
+// the table is searched from the slot they hash to, if it is full the least recently used entry is reused
+
+AccessEntry& accessFind(uint32_t ip, const char* page) {
+
+  byte slot = ((ip ^ (uint32_t)(uintptr_t)page) * 2654435761u) >> (32 - accessBits);
+  AccessEntry* oldest = nullptr;
+  for (byte n=0; n < accessSlots; n++, slot = (slot + 1) & (accessSlots - 1)) {
+    AccessEntry &e = accessTable[slot];
+    if (e.ip == ip && e.page == page) return e;
+    if (!e.page) {                          // (entries are never removed so it is not further on)
+      oldest = &e;
+      break;
+    }
+    if (!oldest || (int32_t)(e.lastSeen - oldest->lastSeen) < 0) oldest = &e;
+  }
+  if (oldest->page) accessReplaced++;
+
+  *oldest = AccessEntry();
+  oldest->ip = ip;
+  oldest->page = page;
+  return *oldest;
+}
+
+
+// ----------------------------------------------------------------
+//                      -record a request
+// ----------------------------------------------------------------
+// called either side of the page handler (from routes.h and handleNotFound)
+
+void accessBegin() {
+  accessIp = (uint32_t)server.client().remoteIP();          // (not available once the page has closed the connection)
+  accessStartBytes = metricsBytesSent;
+  accessStartUs = micros();
+}
+
+void accessEnd(const char* page) {
+  uint32_t us = micros() - accessStartUs;
+  AccessEntry &e = accessFind(accessIp, page);
+  e.hits++;
+  e.bytes += metricsBytesSent - accessStartBytes;
+  e.lastSeen = millis();
+  e.totalUs += us;
+}
+
+
+// ----------------------------------------------------------------
+//      -access statistics web page     i.e. http://x.x.x.x/access
+// ----------------------------------------------------------------
+
+void handleAccess() {
+
+  MeteredClient client = server.client();                     // open link with client
+
+  webheader(client);                                       // send html page header
+
+  uint32_t t = millis();
+
+  client.print("<P>\n");
+  client.print("<br>ACCESS<br><br>\n");
+  client.print("<table style='margin: auto;' border='1' cellpadding='4'>\n");
+  client.print("<tr><th>Client</th><th>Page</th><th>Requests</th><th>Bytes</th><th>Average (ms)</th><th>Last request (s ago)</th></tr>\n");
+  for (byte i=0; i < accessSlots; i++) {
+    AccessEntry &e = accessTable[i];
+    if (!e.page) continue;
+    client.printf("<tr><td>%s</td><td>%s</td><td>%u</td><td>%u</td><td>%.1f</td><td>%u</td></tr>\n",
+                  IPAddress(e.ip).toString().c_str(), e.page, e.hits, e.bytes,
+                  e.hits ? e.totalUs / (e.hits * 1000.0) : 0.0, (t - e.lastSeen) / 1000);
+  }
+  client.print("</table>\n");
+  client.printf("<br>Since %u minutes ago, %u entries replaced as the table was full<br>\n",
+                (t - accessStatsStart) / 60000, accessReplaced);
+
+  // reset statistics if requested
+    if (requestBegin(client).has("reset")) {
+      memset(accessTable, 0, sizeof(accessTable));
+      accessReplaced = 0;
+      accessStatsStart = t;
+    }
+  client.print("<br><a href='/access?reset=1'>reset statistics</a><br>\n");
+
+  client.print("</P>\n");
+  webfooter(client);                                       // send html page footer
+  delay(3);
+  client.stop();
+}
+
+#endif    // ENABLE_ACCESS
+
+
+// --------------------------- E N D -----------------------------
@@ -0,0 +1,146 @@
+/**************************************************************************************************
+ *
+ *      Admission control - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Stops one client (e.g. a script stuck in a loop, or a scanner trying hundreds of pages which
+ *      do not exist) taking up all the web server's time.  Each client ip address gets a 'bucket'
+ *      of tokens for each class of page (see admitLimits below), a request uses one token and they
+ *      are topped up at a steady rate.  When a bucket is empty the request is answered with
+ *      "429 Too Many Requests" straight away, without running the page or logging anything.
+ *
+ *      The last admitSlots clients are remembered, if they have all made a request in the last
+ *      admitIdle ms a new client gets "503 Service Unavailable" instead.
+ *
+ *      The class of a page is set in the route table:
+ *               ROUTE(HTTP_ANY, "/log", handleLogpage)       a normal page ('page')
+ *               ROUTE_POLL(HTTP_ANY, "/data", handleData)    a page which browsers request often ('poll')
+ *               handleNotFound()                             pages which do not exist ('bogus')
+ *      Pages registered with server.on() or routeOn() are not limited.
+ *
+ *      The number admitted / turned away is shown on http://x.x.x.x/metrics
+ *
+ **************************************************************************************************/
+
+
+// forward declarations (i.e. details of all functions in this file)
+  bool admitRequest(byte);
+
+
+// classes of page (set in the route table, see routes.h)
+  enum routeClasses { routePage, routePoll, routeBogus, routeClassCount };
+
+
+#if ENABLE_ADMISSION
+
+// ----------------------------------------------------------------
+//                              -Startup
+// ----------------------------------------------------------------
+
+  struct AdmitLimit {
+    const char* name;
+    uint16_t perMinute;                     // rate the tokens are topped up
+    uint16_t burst;                         // most tokens a client can have (i.e. requests in a row)
+  };
+
+  const AdmitLimit admitLimits[routeClassCount] = {
+    { "page", 60, 10 },                     // normal pages
+    { "poll", 300, 20 },                    // /data, css etc. (the root page requests /data every few seconds)
+    { "bogus", 20, 5 },                     // pages which do not exist
+  };
+
+  const byte admitBits = 4;
+  const byte admitSlots = 1 << admitBits;   // number of clients remembered
+  const uint32_t admitIdle = 60000;         // a client not seen for this long can be forgotten (ms)
+
+  // ready made replies (so turning a request away takes as little time as possible)
+  const char admit429[] = "HTTP/1.1 429 Too Many Requests\r\nRetry-After: 2\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+  const char admit503[] = "HTTP/1.1 503 Service Unavailable\r\nRetry-After: 10\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+  // tokens are in 1/60000ths so topping them up is just (ms since last request) x perMinute
+  struct AdmitEntry {
+    uint32_t ip;                            // 0 = not used
+    uint32_t last;                          // millis() of the last request
+    uint32_t tokens[routeClassCount];
+  };
+  AdmitEntry admitTable[admitSlots];
+
+  // statistics
+  uint32_t admitCount[routeClassCount];     // requests let through
+  uint32_t admitLimited[routeClassCount];   // requests turned away with 429
+  uint32_t admitFull = 0;                   // requests turned away with 503
+
+
+// ----------------------------------------------------------------
+//                   -find the entry for a client
+// ----------------------------------------------------------------
+// the table is searched from the slot the ip address hashes to, returns nullptr if it is full
+
+AdmitEntry* admitFind(uint32_t ip, uint32_t t) {
+
+  AdmitEntry* spare = nullptr;
+  byte slot = (ip * 2654435761u) >> (32 - admitBits);
+  for (byte n=0; n < admitSlots; n++, slot = (slot + 1) & (admitSlots - 1)) {
+    AdmitEntry &e = admitTable[slot];
+    if (e.ip == ip) return &e;
+    if (!e.ip) {                            // (entries are never removed so the client is not further on)
+      if (!spare) spare = &e;
+      break;
+    }
+    if (!spare && (uint32_t)(t - e.last) > admitIdle) spare = &e;
+  }
+  if (!spare) return nullptr;
+
+  // a new client starts with full buckets
+    spare->ip = ip;
+    spare->last = t;
+    for (byte c=0; c < routeClassCount; c++) spare->tokens[c] = admitLimits[c].burst * 60000UL;
+    return spare;
+}
+
+
+// ----------------------------------------------------------------
+//           -check if the current request can be handled
+// ----------------------------------------------------------------
+// if not it is answered here and 0 returned (the page should not be run)
+
+bool admitRequest(byte cls) {
+
+  ServerClient client = server.client();
+  uint32_t t = millis();
+  AdmitEntry* e = admitFind((uint32_t)client.remoteIP(), t);
+
+  if (!e) {
+    admitFull++;
+    client.write((const uint8_t*)admit503, sizeof(admit503) - 1);
+    client.stop();
+    return 0;
+  }
+
+  // top up the buckets
+    uint32_t elapsed = t - e->last;
+    if (elapsed > 60000) elapsed = 60000;
+    e->last = t;
+    for (byte c=0; c < routeClassCount; c++) {
+      uint32_t full = admitLimits[c].burst * 60000UL;
+      e->tokens[c] += elapsed * admitLimits[c].perMinute;
+      if (e->tokens[c] > full) e->tokens[c] = full;
+    }
+
+  if (e->tokens[cls] < 60000) {
+    admitLimited[cls]++;
+    client.write((const uint8_t*)admit429, sizeof(admit429) - 1);
+    client.stop();
+    return 0;
+  }
+
+  e->tokens[cls] -= 60000;
+  admitCount[cls]++;
+  return 1;
+}
+
+#endif    // ENABLE_ADMISSION
+
+
+// --------------------------- E N D -----------------------------
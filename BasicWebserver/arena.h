@@ -0,0 +1,120 @@
+/**************************************************************************************************
+ *
+ *      Request memory - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Memory for things which are only needed while a web page request is being handled (e.g.
+ *      building a line of text), it is taken from a fixed buffer and all given back in one go
+ *      when the request has finished so it can not break up (fragment) the heap the way lots of
+ *      short lived Strings do.
+ *
+ *      Usage:   ArenaString msg;                           (instead of String)
+ *               msg.printf("Page requested from: %s", req.ip);
+ *               msg.print(123);
+ *               msg.c_str()                                 the text
+ *
+ *               char* p = (char*)arenaAlloc(100);           a block of memory (nullptr if full)
+ *
+ *      Anything which is needed after the request has finished must be copied somewhere else
+ *      (e.g. the system log keeps its own copy of each message).
+ *      The most used by each web page is shown on http://x.x.x.x/metrics
+ *
+ **************************************************************************************************/
+
+
+// forward declarations (i.e. details of all functions in this file)
+  void* arenaAlloc(size_t);
+  void arenaReset();
+
+
+// ----------------------------------------------------------------
+//                              -Startup
+// ----------------------------------------------------------------
+
+  const uint16_t arenaSize = 2048;          // bytes available to each request
+
+  char arenaBuffer[arenaSize];
+  uint16_t arenaUsed = 0;                   // bytes used by the current request
+  uint16_t arenaPeak = 0;                   // most used by any request
+  uint32_t arenaFails = 0;                  // number of times there was not enough room
+
+
+// ----------------------------------------------------------------
+//                       -get some memory
+// ----------------------------------------------------------------
+// returns nullptr if there is not enough room
+
+void* arenaAlloc(size_t n) {
+  uint16_t start = (arenaUsed + 3) & ~3;    // keep blocks 4 byte aligned
+  if (start + n > arenaSize) {
+    arenaFails++;
+    return nullptr;
+  }
+  arenaUsed = start + n;
+  if (arenaUsed > arenaPeak) arenaPeak = arenaUsed;
+  return arenaBuffer + start;
+}
+
+// make the last block bigger if nothing has been taken since (returns 0 if it can not)
+bool arenaExtend(void* block, size_t oldSize, size_t newSize) {
+  if ((char*)block + oldSize != arenaBuffer + arenaUsed) return 0;
+  if ((char*)block - arenaBuffer + newSize > arenaSize) return 0;
+  arenaUsed = (char*)block - arenaBuffer + newSize;
+  if (arenaUsed > arenaPeak) arenaPeak = arenaUsed;
+  return 1;
+}
+
+// give back all the memory (called when a request has finished)
+void arenaReset() {
+  arenaUsed = 0;
+}
+
+
+// ----------------------------------------------------------------
+//              -text built up in the request memory
+// ----------------------------------------------------------------
+// a Print so print(), printf() etc. can be used, if there is not enough room the text is cut short
+
+class ArenaString : public Print {
+  public:
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *data, size_t n) override {
+      if (!reserve(len + n)) {
+        truncated = 1;
+        if (!buf) return 0;
+        n = cap - len;
+      }
+      memcpy(buf + len, data, n);
+      len += n;
+      buf[len] = 0;
+      return n;
+    }
+    const char* c_str() const { return buf ? buf : ""; }
+    uint16_t length() const { return len; }
+    bool truncated = 0;                     // flag if text did not all fit
+
+  private:
+    char* buf = nullptr;
+    uint16_t len = 0;
+    uint16_t cap = 0;                       // room for text (not including the terminating zero)
+
+    bool reserve(size_t want) {
+      if (want <= cap) return 1;
+      size_t newCap = (cap * 2 > want) ? cap * 2 : want;
+      if (newCap < 32) newCap = 32;
+      if (buf && arenaExtend(buf, cap + 1, newCap + 1)) { cap = newCap; return 1; }
+      if (buf && arenaExtend(buf, cap + 1, want + 1)) { cap = want; return 1; }
+      char* b = (char*)arenaAlloc(newCap + 1);
+      if (!b && want < newCap) b = (char*)arenaAlloc((newCap = want) + 1);
+      if (!b) return 0;
+      if (buf) memcpy(b, buf, len + 1);
+      else b[0] = 0;
+      buf = b;
+      cap = newCap;
+      return 1;
+    }
+};
+
+
+// --------------------------- E N D -----------------------------
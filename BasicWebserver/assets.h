@@ -0,0 +1,104 @@
+/**************************************************************************************************
+ *
+ *      Static files (css / javascript) - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Sends the files from the assets folder (stored in flash in pages.h by misc/templates.py)
+ *      e.g. http://x.x.x.x/a/style.css
+ *
+ *      They are sent gzipped if the browser accepts it and with an ETag (a hash of the contents) so
+ *      the browser can keep a copy, when it asks again with "If-None-Match" and the file has not
+ *      changed only a short "304 Not Modified" reply is sent.  The pages link to the files with
+ *      the hash in the url so after the sketch is updated the browser fetches the new version.
+ *      If-None-Match can list several ETags and weak ones (W/"...") are accepted too, as the
+ *      browser only uses them to ask whether its copy is still the same.
+ *
+ **************************************************************************************************/
+
+
+// forward declarations (i.e. details of all functions in this file)
+  void assetsSetup();
+  bool acceptsGzip();
+  bool assetEtagMatch(const char*, const char*);
+  void handleAsset();
+
+
+// ----------------------------------------------------------------
+//                              -Startup
+// ----------------------------------------------------------------
+
+  const uint32_t assetMaxAge = 86400;       // seconds browser can use its copy before checking with the server
+
+
+// ----------------------------------------------------------------
+//                            -setup
+// ----------------------------------------------------------------
+// called from setup - the request headers needed are only stored if they are asked for
+//   (note: collectHeaders replaces any list given before so add any other headers needed here)
+
+void assetsSetup() {
+  const char* headers[] = { "If-None-Match", "Accept-Encoding" };
+  server.collectHeaders(headers, sizeof(headers) / sizeof(headers[0]));
+}
+
+// true if the browser accepts gzipped replies (also used for the web pages, see rendercache.h)
+bool acceptsGzip() {
+  return server.header("Accept-Encoding").indexOf("gzip") >= 0;
+}
+
+// true if an If-None-Match header (e.g.  "1a2b3c4d", W/"5e6f7a8b"  or  * ) includes the ETag
+bool assetEtagMatch(const char* header, const char* etag) {
+  size_t etagLen = strlen(etag);
+  const char* p = header;
+  while (*p) {
+    while (*p == ' ' || *p == '\t' || *p == ',') p++;
+    if (*p == '*') return 1;
+    if (p[0] == 'W' && p[1] == '/') p += 2;
+    const char* start = p;
+    if (*p == '"') {
+      const char* close = strchr(p + 1, '"');
+      p = close ? close + 1 : p + strlen(p);
+    }
+    if ((size_t)(p - start) == etagLen && strncmp(start, etag, etagLen) == 0) return 1;
+    while (*p && *p != ',') p++;
+  }
+  return 0;
+}
+
+
+// ----------------------------------------------------------------
+//       -static file requested    i.e. http://x.x.x.x/a/style.css
+// ----------------------------------------------------------------
+
+void handleAsset() {
+
+  StrView name = routeParam("name");
+  const AssetFile* file = nullptr;
+  for (const AssetFile &a : assetFiles) if (name.equals(a.name)) file = &a;
+  if (!file) {
+    handleNotFound();
+    return;
+  }
+
+  MeteredClient client = server.client();
+
+  // browser already has this version
+    if (assetEtagMatch(server.header("If-None-Match").c_str(), file->etag)) {
+      client.printf("HTTP/1.1 304 Not Modified\r\nETag: %s\r\nCache-Control: max-age=%u\r\nConnection: close\r\n\r\n", file->etag, (unsigned)assetMaxAge);
+      client.stop();
+      return;
+    }
+
+  bool gz = (file->gz && acceptsGzip());
+  size_t len = gz ? file->gzLen : file->len;
+
+  client.printf("HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %u\r\n", file->type, (unsigned)len);
+  if (gz) client.print("Content-Encoding: gzip\r\n");
+  client.printf("ETag: %s\r\nCache-Control: max-age=%u\r\nVary: Accept-Encoding\r\nConnection: close\r\n\r\n", file->etag, (unsigned)assetMaxAge);
+  pageWrite_P(client, gz ? (PGM_P)file->gz : file->data, len);
+  client.stop();
+}
+
+
+// --------------------------- E N D -----------------------------
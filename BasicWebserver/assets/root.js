@@ -0,0 +1,5 @@
+// refresh the data display on the root page (see templates/root.html)
+//   data-first = ms before first update, data-every = ms between updates
+var frame = document.getElementById('dataframe');
+setTimeout(function() {frame.src='/data';}, frame.dataset.first);
+window.setInterval(function() {frame.src='/data';}, frame.dataset.every);
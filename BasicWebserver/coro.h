@@ -0,0 +1,245 @@
+/**************************************************************************************************
+ *
+ *      Coroutine web pages - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      A web page which has to wait for something slow (another web server, the GSM module, an
+ *      NTP reply) would normally hold up the whole sketch until it arrives.  Written as a C++20
+ *      coroutine it can 'co_await' it instead, the page is put to one side and the sketch carries
+ *      on, then coroLoop() (a task run from loop) picks the page up again once it is ready.
+ *
+ *      Usage:   Async fetchDemo(ServerClient client) {        the page (copy anything it needs from
+ *                 ...                                          'request' before the first co_await as
+ *                 int len = co_await coroFetch(host, "/log", 80, buf, sizeof(buf));    the next request
+ *                 co_await coroSleep(1000);                    will replace it)
+ *                 client.stop();
+ *               }
+ *
+ *               void handleFetch() {                          the normal handler which starts it
+ *                 if (!fetchDemo(server.client()).started) server.send(503, "text/plain", "Busy");
+ *               }
+ *
+ *      Things which can be waited for:
+ *          coroSleep(ms)                                      a timer
+ *          coroFetch(host, page, port, buf, size)             a web page from another device
+ *          coroNtpSync()                                      setting the time from NTP
+ *          coroGSM(command, buf, size)                        a reply from the GSM module (see gsm.h)
+ *
+ *      Each page's local variables etc. are kept in one of a fixed number of blocks of memory (not
+ *      the heap), if none are free or it needs more than coroFrameSize it does not start.
+ *      The number running and the largest size needed are shown on http://x.x.x.x/metrics
+ *
+ *      Needs a compiler with C++20 coroutines (e.g. esp32 Arduino core 3.x), ENABLE_COROUTINES is
+ *      turned off if it is not available.
+ *      Note: the web server library waits (up to 2 seconds) for the browser to close a connection
+ *            before it starts on the next one, so without ENABLE_GUARD (see guard.h) other pages are
+ *            still delayed a little while one is waiting - but loop and the rest of the sketch are not.
+ *
+ **************************************************************************************************/
+
+
+#if ENABLE_COROUTINES
+
+#include <coroutine>
+
+
+// forward declarations (i.e. details of all functions in this file)
+  void* coroAlloc(size_t);
+  void coroFree(void*);
+  void coroLoop();
+
+
+// ----------------------------------------------------------------
+//                              -Startup
+// ----------------------------------------------------------------
+
+  const byte coroMax = 8;                   // number of coroutines which can run at once
+  const uint16_t coroFrameSize = 1024;      // memory for each one (local variables etc.)
+
+  alignas(8) uint8_t coroFrames[coroMax][coroFrameSize];
+  bool coroFrameUsed[coroMax];
+  byte coroRunning = 0;                     // number running now
+  byte coroPeak = 0;                        // most running at once
+  uint16_t coroLargest = 0;                 // largest memory asked for (to help set coroFrameSize)
+  uint32_t coroStarted = 0;                 // counters
+  uint32_t coroRefused = 0;                 // could not start as no memory was free
+
+  // something a coroutine is waiting for
+  struct CoroWaiting {
+    std::coroutine_handle<> handle;         // coroutine to resume (blank = not in use)
+    void* awaiter;
+    bool (*ready)(void*);                   // true once it has finished waiting
+  };
+  CoroWaiting coroWaiting[coroMax];         // (each coroutine only waits for one thing at a time)
+
+
+// ----------------------------------------------------------------
+//                  -memory for the coroutines
+// ----------------------------------------------------------------
+// returns nullptr if there is none free, the coroutine then does not start
+
+void* coroAlloc(size_t n) {
+  if (n > coroLargest) coroLargest = n;
+  if (n <= coroFrameSize) {
+    for (byte i=0; i < coroMax; i++) {
+      if (coroFrameUsed[i]) continue;
+      coroFrameUsed[i] = 1;
+      coroStarted++;
+      if (++coroRunning > coroPeak) coroPeak = coroRunning;
+      return coroFrames[i];
+    }
+  }
+  coroRefused++;
+  DEBUG_WARN("Coroutine refused (%u bytes, %u running)", (unsigned)n, coroRunning);
+  return nullptr;
+}
+
+void coroFree(void* p) {
+  coroFrameUsed[((uint8_t*)p - coroFrames[0]) / coroFrameSize] = 0;
+  coroRunning--;
+}
+
+
+// ----------------------------------------------------------------
+//                     -the coroutine type
+// ----------------------------------------------------------------
+// the coroutine runs straight away until it first waits, 'started' is 0 if there was no memory for it
+
+struct Async {
+  bool started;
+
+  struct promise_type {
+    Async get_return_object() { return {1}; }
+    static Async get_return_object_on_allocation_failure() { return {0}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }      // memory is given back when it finishes
+    void return_void() {}
+    void unhandled_exception() {}
+    static void* operator new(size_t n) noexcept { return coroAlloc(n); }
+    static void operator delete(void* p) { coroFree(p); }
+  };
+};
+
+
+// ----------------------------------------------------------------
+//                  -things which can be waited for
+// ----------------------------------------------------------------
+// each one has a poll() which is called from coroLoop() until it returns true
+
+template<typename A> struct CoroAwait {
+  bool await_ready() { return static_cast<A*>(this)->poll(); }
+  bool await_suspend(std::coroutine_handle<> h) {
+    for (byte i=0; i < coroMax; i++) {
+      if (coroWaiting[i].handle) continue;
+      coroWaiting[i] = { h, this, [](void* a) { return static_cast<A*>(a)->poll(); } };
+      return 1;
+    }
+    return 0;                               // (can not happen) carry on without waiting
+  }
+};
+
+
+// a timer    e.g. co_await coroSleep(500);
+
+struct coroSleep : CoroAwait<coroSleep> {
+  uint32_t start = millis();
+  uint32_t ms;
+  coroSleep(uint32_t t) : ms(t) {}
+  bool poll() { return (uint32_t)(millis() - start) >= ms; }
+  void await_resume() {}
+};
+
+
+// a web page from another device (including the reply headers)
+//    returns the number of characters received (reply cut short if it does not fit in buf) or -1 if it failed
+//    e.g. int len = co_await coroFetch("192.168.1.166", "/log", 80, buf, sizeof(buf));
+// Note: connecting still waits (briefly on a local network), it is the reply which is not waited for
+
+struct coroFetch : CoroAwait<coroFetch> {
+  WiFiClient client;
+  char* buf;
+  uint16_t size;
+  uint16_t len = 0;
+  uint32_t start = millis();
+  uint32_t timeout;
+  bool done = 0;
+  bool ok = 0;
+
+  coroFetch(const char* host, const char* page, uint16_t port, char* b, uint16_t s, uint32_t t = 3000) : buf(b), size(s), timeout(t) {
+    buf[0] = 0;
+    if (!client.connect(host, port)) {
+      DEBUG_WARN("coroFetch: connection to %s failed", host);
+      done = 1;
+      return;
+    }
+    client.printf("GET %s HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n\r\n", page, host);
+  }
+
+  bool poll() {
+    if (done) return 1;
+    int n = client.available();
+    if (n > size - 1 - len) n = size - 1 - len;
+    if (n > 0) {
+      len += client.read((uint8_t*)buf + len, n);
+      buf[len] = 0;
+    }
+    if (len >= size - 1 || !client.connected()) ok = done = 1;          // full or finished
+    else if ((uint32_t)(millis() - start) >= timeout) {
+      DEBUG_WARN("coroFetch: timed out");
+      done = 1;
+    }
+    return done;
+  }
+
+  int await_resume() {
+    client.stop();
+    return ok ? len : -1;
+  }
+};
+
+
+// set the time from NTP    e.g. bool ok = co_await coroNtpSync();
+// Note: if the TimeLib regular sync happens at the same moment one of them may take the other's reply
+
+struct coroNtpSync : CoroAwait<coroNtpSync> {
+  uint32_t start = millis();
+  uint32_t timeout;
+  bool ok = 0;
+  coroNtpSync(uint32_t t = 3000) : timeout(t) {
+    while (NTPUdp.parsePacket() > 0) NTPUdp.flush();                    // discard any old replies
+    sendNTPpacket(timeServer);
+  }
+  bool poll() {
+    if (NTPUdp.parsePacket() > 0) {
+      setTime(ntpReadReply());
+      return ok = 1;
+    }
+    return (uint32_t)(millis() - start) >= timeout;
+  }
+  bool await_resume() {
+    if (!ok) ntpSyncFail++;
+    return ok;
+  }
+};
+
+
+// ----------------------------------------------------------------
+//       -resume any coroutines which have finished waiting
+// ----------------------------------------------------------------
+// a task run from loop (with ENABLE_DUALCORE it is run by the web server task)
+
+void coroLoop() {
+  for (byte i=0; i < coroMax; i++) {
+    CoroWaiting &w = coroWaiting[i];
+    if (!w.handle || !w.ready(w.awaiter)) continue;
+    std::coroutine_handle<> h = w.handle;
+    w.handle = nullptr;
+    h.resume();
+  }
+}
+
+#endif    // ENABLE_COROUTINES
+
+
+// --------------------------- E N D -----------------------------
@@ -0,0 +1,183 @@
+/**************************************************************************************************
+ *
+ *      Debug output - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Sending debug text with Serial.print() holds up the sketch until there is room for it in
+ *      the serial port's small transmit buffer - at 115200 baud a page of text takes about 100ms.
+ *      These put the text in a buffer instead and a task run from loop sends it on a little at a
+ *      time (only as much as the serial port can take without waiting).
+ *
+ *      Usage:   DEBUG_ERROR("GSM module is not responding");          printf style, a new line is added
+ *               DEBUG_WARN("Web client connection failed");
+ *               DEBUG_INFO("connected to wifi. Local IP: %s", WiFi.localIP().toString().c_str());
+ *               DEBUG_VERBOSE("%s", received);
+ *
+ *      DEBUG_LEVEL in the settings sets which are used, the others are removed when the sketch is
+ *      compiled (including their text) so they take no time or memory.  Nothing is sent if
+ *      serialDebug is not set.
+ *
+ *      If the buffer is full the message is dropped (not waited for), the number dropped is shown
+ *      on http://x.x.x.x/metrics - increase debugBufferSize if it is often more than zero.
+ *      Until the task starts (i.e. during setup) the text is sent straight away as before.
+ *      Note: the text is sent from loop rather than the serial interrupt as the Arduino cores have no
+ *            way to add to the transmit interrupt, so a long blocking loop still delays it.
+ *
+ **************************************************************************************************/
+
+
+// forward declarations (i.e. details of all functions in this file)
+  void debugPrintf(const char*, ...);
+  void debugLoop();
+  uint32_t debugDropped();
+
+
+// the debug macros (levels not wanted are replaced with nothing)
+
+  #define DEBUG_PRINT(...) do { if (serialDebug) debugPrintf(__VA_ARGS__); } while (0)
+
+  #if DEBUG_LEVEL >= 1
+    #define DEBUG_ERROR(...) DEBUG_PRINT(__VA_ARGS__)
+  #else
+    #define DEBUG_ERROR(...) do { } while (0)
+  #endif
+  #if DEBUG_LEVEL >= 2
+    #define DEBUG_WARN(...) DEBUG_PRINT(__VA_ARGS__)
+  #else
+    #define DEBUG_WARN(...) do { } while (0)
+  #endif
+  #if DEBUG_LEVEL >= 3
+    #define DEBUG_INFO(...) DEBUG_PRINT(__VA_ARGS__)
+  #else
+    #define DEBUG_INFO(...) do { } while (0)
+  #endif
+  #if DEBUG_LEVEL >= 4
+    #define DEBUG_VERBOSE(...) DEBUG_PRINT(__VA_ARGS__)
+  #else
+    #define DEBUG_VERBOSE(...) do { } while (0)
+  #endif
+
+
+#include <atomic>
+
+
+// ----------------------------------------------------------------
+//                              -Startup
+// ----------------------------------------------------------------
+
+  const uint16_t debugBufferSize = 1024;    // bytes of text waiting to be sent (must be a power of 2)
+
+  // a ring buffer which one task adds to and loop takes from, so it needs no locking
+  // (with ENABLE_DUALCORE each core has its own so there is still only one task adding to each)
+  struct DebugRing {
+    char buf[debugBufferSize];              // messages are kept in one piece, a 0 is padding to skip
+    std::atomic<uint32_t> head{0};          // total bytes added
+    std::atomic<uint32_t> tail{0};          // total bytes sent
+    uint32_t dropped = 0;                   // messages lost as the buffer was full
+  };
+
+  #if ENABLE_DUALCORE
+    DebugRing debugRings[2];                // one for each core
+  #else
+    DebugRing debugRings[1];
+  #endif
+
+  std::atomic<bool> debugBuffered{0};       // set once debugLoop() is running (read by both cores)
+
+
+// ----------------------------------------------------------------
+//                   -add a message to the buffer
+// ----------------------------------------------------------------
+
+void debugPrintf(const char* fmt, ...) {
+
+  va_list args;
+  va_start(args, fmt);
+
+  // before the task is running send it straight away
+    if (!debugBuffered.load(std::memory_order_relaxed)) {
+      char line[200];
+      vsnprintf(line, sizeof(line), fmt, args);
+      va_end(args);
+      Serial.println(line);
+      return;
+    }
+
+  #if ENABLE_DUALCORE
+    DebugRing &r = debugRings[xPortGetCoreID() & 1];
+  #else
+    DebugRing &r = debugRings[0];
+  #endif
+
+  va_list count;
+  va_copy(count, args);
+  int len = vsnprintf(nullptr, 0, fmt, count);
+  va_end(count);
+
+  // find room for it in one piece (if it does not fit before the end of the buffer the end is padded and it starts at the beginning)
+    uint32_t head = r.head.load(std::memory_order_relaxed);
+    uint32_t used = head - r.tail.load(std::memory_order_acquire);
+    uint32_t pos = head & (debugBufferSize - 1);
+    uint32_t need = (len < 0) ? 0 : len + 1;                                  // (+ the new line)
+    uint32_t pad = (pos + need > debugBufferSize) ? debugBufferSize - pos : 0;
+    if (!need || need + pad > debugBufferSize - used) {
+      r.dropped++;
+      va_end(args);
+      return;
+    }
+    if (pad) {
+      memset(r.buf + pos, 0, pad);
+      head += pad;
+      pos = 0;
+    }
+
+  vsnprintf(r.buf + pos, need, fmt, args);                                    // (its 0 on the end is replaced with the new line)
+  va_end(args);
+  r.buf[pos + len] = '\n';
+  r.head.store(head + need, std::memory_order_release);
+}
+
+
+// ----------------------------------------------------------------
+//            -send waiting text to the serial port
+// ----------------------------------------------------------------
+// a task run from loop, only sends what the serial port can take without waiting
+
+void debugLoop() {
+
+  debugBuffered.store(1, std::memory_order_relaxed);
+
+  for (DebugRing &r : debugRings) {
+    uint32_t tail = r.tail.load(std::memory_order_relaxed);
+    uint32_t head = r.head.load(std::memory_order_acquire);
+    while (tail != head) {
+      uint32_t pos = tail & (debugBufferSize - 1);
+      if (!r.buf[pos]) {                                                      // padding
+        tail++;
+        continue;
+      }
+      size_t room = Serial.availableForWrite();
+      if (!room) break;
+      size_t n = head - tail;
+      if (n > debugBufferSize - pos) n = debugBufferSize - pos;
+      if (n > room) n = room;
+      const char* end = (const char*)memchr(r.buf + pos, 0, n);               // (stop at any padding)
+      if (end) n = end - (r.buf + pos);
+      Serial.write((const uint8_t*)r.buf + pos, n);
+      tail += n;
+    }
+    r.tail.store(tail, std::memory_order_release);
+  }
+}
+
+
+// total messages dropped (for metrics.h)
+uint32_t debugDropped() {
+  uint32_t n = 0;
+  for (DebugRing &r : debugRings) n += r.dropped;
+  return n;
+}
+
+
+// --------------------------- E N D -----------------------------
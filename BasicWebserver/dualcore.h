@@ -0,0 +1,232 @@
+/**************************************************************************************************
+ *
+ *      Dual core (esp32) - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      If ENABLE_DUALCORE is set (esp32 only) the web server runs in its own task on core 0 (along
+ *      with the wifi) and loop() runs the rest of the sketch on core 1, so a slow web page does not
+ *      hold up the sketch and the sketch does not hold up the web pages.
+ *
+ *      The two sides do not share Strings or anything else which could be changed part way through
+ *      being read, instead:
+ *          log messages from loop are passed to the web server task through a queue (the system
+ *            log belongs to the web server task as that is where it is shown), they are checked
+ *            against the log level and rate limits on core 1 first so those which are not stored
+ *            are never formatted or queued
+ *          button presses etc. on the web pages are passed to loop through a queue, see sendCommand()
+ *            and webCommand() in the main sketch
+ *          the status shown on the web pages is published by loop once a second (see status.h)
+ *
+ *      The queues are lock free (they never wait or turn off interrupts), if one is full the
+ *      message is dropped and counted (shown on http://x.x.x.x/metrics).
+ *
+ *      Without ENABLE_DUALCORE sendCommand() just runs the command straight away.
+ *
+ **************************************************************************************************/
+
+
+// forward declarations (i.e. details of all functions in this file)
+  void sendCommand(byte);
+  void webCommand(byte);                    // (in the main sketch)
+  void logAdd(const char*, byte, bool);     // (in standard.h)
+
+
+#if ENABLE_DUALCORE
+
+#include <atomic>
+
+
+// ----------------------------------------------------------------
+//                              -Startup
+// ----------------------------------------------------------------
+
+  const uint32_t webTaskStack = 8192;       // stack size for the web server task
+  const byte webTaskCore = 0;               // core to run the web server on (loop runs on core 1)
+  const byte logQueueSize = 16;             // log messages waiting to be stored (must be a power of 2)
+  const byte commandQueueSize = 16;         // commands waiting for loop (must be a power of 2)
+
+  TaskHandle_t webTaskHandle = nullptr;
+
+
+// ----------------------------------------------------------------
+//                     -lock free message queue
+// ----------------------------------------------------------------
+// any number of tasks can add and take messages at the same time (a bounded MPMC queue by Dmitry Vyukov)
+// each slot has a sequence number which says whether it is ready to be written or read, the
+// positions are only claimed with compare-exchange so nothing ever waits for another task
+
+template<typename T, size_t N> class MsgQueue {
+  public:
+    MsgQueue() { for (size_t i=0; i < N; i++) slots[i].seq.store(i, std::memory_order_relaxed); }
+
+    // returns 0 if the queue is full
+    bool push(const T &item) {
+      uint32_t pos = tail.load(std::memory_order_relaxed);
+      for (;;) {
+        Slot &s = slots[pos & (N - 1)];
+        int32_t dif = (int32_t)(s.seq.load(std::memory_order_acquire) - pos);
+        if (dif == 0) {
+          if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+            s.item = item;
+            s.seq.store(pos + 1, std::memory_order_release);
+            return 1;
+          }
+        } else if (dif < 0) {
+          dropped.fetch_add(1, std::memory_order_relaxed);
+          return 0;
+        } else {
+          pos = tail.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+    // returns 0 if the queue is empty
+    bool pop(T &item) {
+      uint32_t pos = head.load(std::memory_order_relaxed);
+      for (;;) {
+        Slot &s = slots[pos & (N - 1)];
+        int32_t dif = (int32_t)(s.seq.load(std::memory_order_acquire) - (pos + 1));
+        if (dif == 0) {
+          if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+            item = s.item;
+            s.seq.store(pos + N, std::memory_order_release);
+            return 1;
+          }
+        } else if (dif < 0) {
+          return 0;
+        } else {
+          pos = head.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+    std::atomic<uint32_t> dropped{0};       // messages lost because the queue was full
+
+  private:
+    static_assert((N & (N - 1)) == 0, "queue size must be a power of 2");
+    struct Slot {
+      std::atomic<uint32_t> seq;
+      T item;
+    };
+    Slot slots[N];
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+};
+
+
+// ----------------------------------------------------------------
+//                 -data written by one task, read by others
+// ----------------------------------------------------------------
+// a 'seqlock': the writer never waits, a reader which overlaps a write just reads again
+// (the data is copied a word at a time as atomics so it is never read half written without being noticed)
+
+template<typename T> class SeqLock {
+  public:
+    void write(const T &value) {
+      uint32_t w[words];
+      memcpy(w, &value, sizeof(T));
+      uint32_t s = seq.load(std::memory_order_relaxed);
+      seq.store(s + 1, std::memory_order_relaxed);            // odd = being written
+      std::atomic_thread_fence(std::memory_order_release);
+      for (size_t i=0; i < words; i++) data[i].store(w[i], std::memory_order_relaxed);
+      seq.store(s + 2, std::memory_order_release);
+    }
+
+    T read() const {
+      uint32_t w[words];
+      uint32_t s1, s2;
+      do {
+        s1 = seq.load(std::memory_order_acquire);
+        for (size_t i=0; i < words; i++) w[i] = data[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        s2 = seq.load(std::memory_order_relaxed);
+      } while ((s1 & 1) || s1 != s2);
+      T value;
+      memcpy(&value, w, sizeof(T));
+      return value;
+    }
+
+  private:
+    static const size_t words = (sizeof(T) + 3) / 4;
+    std::atomic<uint32_t> seq{0};
+    std::atomic<uint32_t> data[words] = {};
+};
+
+
+// ----------------------------------------------------------------
+//                          -the queues
+// ----------------------------------------------------------------
+
+  struct LogMsg {
+    char text[LogLength];                   // complete log entry (time and message)
+    byte from;                              // who logged it (see logCaller() in standard.h)
+    bool repeat;                            // the same as the last message they logged
+  };
+
+  MsgQueue<LogMsg, logQueueSize> logQueue;          // loop -> web server task
+  MsgQueue<byte, commandQueueSize> commandQueue;    // web server task -> loop
+
+
+// true if running in the web server task
+bool onWebTask() {
+  return webTaskHandle && xTaskGetCurrentTaskHandle() == webTaskHandle;
+}
+
+// pass a log entry to the web server task (it has already been checked, see logMessageV() in standard.h)
+// returns 0 if the queue is full
+bool logQueueAdd(const char* entry, byte from, bool repeat) {
+  LogMsg m;
+  strncpy(m.text, entry, sizeof(m.text) - 1);
+  m.text[sizeof(m.text) - 1] = 0;
+  m.from = from;
+  m.repeat = repeat;
+  return logQueue.push(m);
+}
+
+// pass a command from a web page to loop
+void sendCommand(byte cmd) {
+  if (!commandQueue.push(cmd)) DEBUG_WARN("Command queue full");
+}
+
+// run any commands waiting (a task run from loop)
+void commandsLoop() {
+  byte cmd;
+  while (commandQueue.pop(cmd)) webCommand(cmd);
+}
+
+
+// ----------------------------------------------------------------
+//                      -the web server task
+// ----------------------------------------------------------------
+
+void webTask(void*) {
+  for (;;) {
+    LogMsg m;
+    while (logQueue.pop(m)) logAdd(m.text, m.from, m.repeat);
+    {
+      TRACE_SCOPE(trHandleClient);
+      server.handleClient();
+    }
+    #if ENABLE_COROUTINES
+      coroLoop();                           // (the coroutine web pages are resumed here so they stay on this core)
+    #endif
+    arenaReset();
+    vTaskDelay(1);                          // let the other tasks on this core run (e.g. wifi)
+  }
+}
+
+// called from setup once the web server has started
+void dualcoreStart() {
+  xTaskCreatePinnedToCore(webTask, "web server", webTaskStack, nullptr, 1, &webTaskHandle, webTaskCore);
+  DEBUG_INFO("Web server running on core %d, loop on core %d", webTaskCore, xPortGetCoreID());
+}
+
+#else
+
+  void sendCommand(byte cmd) { webCommand(cmd); }
+
+#endif    // ENABLE_DUALCORE
+
+
+// --------------------------- E N D -----------------------------
@@ -81,6 +81,8 @@
 
 
 bool sendEmail(char* emailTo, char* emailSubject, char* emailBody) {
+
+  LOOP_SCOPE("sendEmail");
  
   if (serialDebug) Serial.println("----- sending an email -------");
 
@@ -120,10 +122,10 @@ bool sendEmail(char* emailTo, char* emailSubject, char* emailBody) {
   
   // Start sending Email and close the session
     if (!MailClient.sendMail(&smtp, &message)) {
-      log_system_message("Sending email '" + String(_subject) +"' failed, reason=" + String(smtp.errorReason()));
+      logMessage(logError, "Sending email '%s' failed, reason=%s", _subject, smtp.errorReason().c_str());
       return 0;
     } else {
-      log_system_message("Email '" + String(_subject) +"' sent ok  ");
+      log_system_message("Email '%s' sent ok  ", _subject);
       return 1;
     }
     
@@ -140,13 +140,12 @@ const int GSMbuffer = 512;                         // buffer size for incoming d
   void setupGSM();
   void requestWebPageGSM(String);
   void dataReceivedFromGSM();
+  void GSMcheckTask();
+  void GSMdataTask();
 
 
 #include <SoftwareSerial.h>    // Note: the esp32 has a second hardware serial port you can use instead of SoftwareSerial
 
-uint32_t checkGSMmoduleTimer = millis();    // timer for periodic gsm module check
-uint32_t checkGSMdataTimer = millis();      // timer for periodic check for incoming data from GSM module
-
 //Create software serial object to communicate with GSM module
   SoftwareSerial GSMserial(TxPin, RxPin);     
   
@@ -155,7 +154,7 @@ uint32_t checkGSMdataTimer = millis();      // timer for periodic check for inco
 // ----------------------------------------------------------------
 //                     -act on any incoming data
 // ----------------------------------------------------------------
-// periodic check for any incoming data from gms module - called from GSMloop()
+// periodic check for any incoming data from gms module - called from GSMdataTask()
   
 void dataReceivedFromGSM() {
 
@@ -169,11 +168,8 @@ void dataReceivedFromGSM() {
             if (pos >= 0) {
               // a sms has been received
                 String smsMessage = reply.substring(pos + 6);
-                if (serialDebug) {
-                  Serial.println("SMS message received:");
-                  Serial.println(smsMessage);
-                }
-            } else if (serialDebug) Serial.println("Error in received SMS message");
+                DEBUG_INFO("SMS message received:\n%s", smsMessage.c_str());
+            } else DEBUG_WARN("Error in received SMS message");
       }
 
 
@@ -209,40 +205,36 @@ void setupGSM() {
 
   if (GSMconnected) {
     contactGSMmodule("ATI");             // Get the module name and revision
-    if (serialDebug) Serial.println("GSM setup completed OK");
+    DEBUG_INFO("GSM setup completed OK");
   } else {
-    if (serialDebug) Serial.println("ERROR: GSM module is not responding");
+    DEBUG_ERROR("ERROR: GSM module is not responding");
   }
+
+  // routine checks (see GSMcheckTask and GSMdataTask)
+    taskAdd("gsm check", GSMcheckTask, checkGSMmodulePeriod);
+    taskAdd("gsm data", GSMdataTask, checkGSMdataPeriod);
     
 }   // setupGSM
 
 
 // ----------------------------------------------------------------
-//              -loop, routine activites for GSM module
+//              -routine activites for GSM module
 // ----------------------------------------------------------------
-// called from 'Loop'
+// run by the scheduler (see setupGSM)
 
-void GSMloop() {
-
-  if (GSMconnected) {
-
-    // periodic check that GSM module is still responding
-      if ((unsigned long)(millis() - checkGSMmoduleTimer) >= checkGSMmodulePeriod ) {
-          checkGSMmoduleTimer = millis();
-          if (!checkGSMmodule(2)) {
-            if (serialDebug) Serial.println("ERROR: GSM module has stopped responding");
-          }
-      }    
-
-    // periodic check for any incoming data on serial or from gsm module
-      if ((unsigned long)(millis() - checkGSMdataTimer) >= checkGSMdataPeriod ) {
-        checkGSMdataTimer = millis();
-        dataReceivedFromGSM();
-      } 
-      
-  }  // GSMconnected
+// periodic check that GSM module is still responding
+void GSMcheckTask() {
+  if (!GSMconnected) return;
+  if (!checkGSMmodule(2)) {
+    DEBUG_ERROR("ERROR: GSM module has stopped responding");
+  }
+}
 
-}  // GSMloop
+// periodic check for any incoming data on serial or from gsm module
+void GSMdataTask() {
+  if (!GSMconnected) return;
+  dataReceivedFromGSM();
+}
 
 
 // ----------------------------------------------------------------
@@ -252,11 +244,11 @@ void GSMloop() {
 bool resetGSM(int GSMcheckRetries) {
     
   if (GSMresetPin == -1) {
-    if (serialDebug) Serial.println("Unable to reset GSM device as no reset pin defined");
+    DEBUG_WARN("Unable to reset GSM device as no reset pin defined");
     return 0;
   }
   
-  if (serialDebug) Serial.println("Resetting GSM device");
+  DEBUG_INFO("Resetting GSM device");
 
   digitalWrite(GSMresetPin, GSMresetPinActive);    // reset active
   delay(1000);
@@ -275,7 +267,7 @@ bool resetGSM(int GSMcheckRetries) {
 
 bool checkGSMmodule(int maxTries) {
 
-  if (serialDebug) Serial.println("Checking GSM module is responding");   
+  DEBUG_VERBOSE("Checking GSM module is responding");
   bool GSMconnectedCurrent = GSMconnected;    // store current GSM status
 
   String reply;
@@ -286,15 +278,15 @@ bool checkGSMmodule(int maxTries) {
     maxTries--;
   }
   
-  if (serialDebug){
-    if (!GSMconnected) Serial.println("No response received from GSM device");
-    else Serial.println("GSM device responding ok");
-  }
+  if (GSMconnected != GSMconnectedCurrent) pageChanged();     // status is shown on the web pages
+
+  if (!GSMconnected) DEBUG_WARN("No response received from GSM device");
+  else DEBUG_VERBOSE("GSM device responding ok");
 
   // if GSM wasn't connected but now is send some configuration
   //   see:  https://oldlight.wordpress.com/2009/06/16/tutorial-using-at-commands-to-send-and-receive-sms/
   if (GSMconnected && !GSMconnectedCurrent) {
-    if (serialDebug) Serial.println("Configuring incoming SMS");
+    DEBUG_INFO("Configuring incoming SMS");
     contactGSMmodule("AT+CNMI=1,2,0,0,0");           // Set module to send SMS data to serial upon receipt 
     contactGSMmodule("AT+CMGF=1");                   // format sms as text
   }
@@ -312,9 +304,7 @@ void sendSMS(String SMSnumber, String SMSmessage) {
 
   int sdel = 1000;            // delay between commands
     
-  if (serialDebug) Serial.println("Sending SMS to '" + SMSnumber + "', message = '" + SMSmessage + "'");
-
-  if (serialDebug) Serial.println("Sending SMS to '" + SMSnumber + "', message = '" + SMSmessage + "'");
+  DEBUG_INFO("Sending SMS to '%s', message = '%s'", SMSnumber.c_str(), SMSmessage.c_str());
 
   contactGSMmodule("AT+CMGF=1");                         // put in to sms mode
   delay(sdel);
@@ -346,7 +336,7 @@ void requestWebPageGSM(String URL) {
 
     int sdel = 1000;            // delay between commands
 
-    if (serialDebug) Serial.println("Requesting web page via GSM '" + URL + "', message = '");
+    DEBUG_INFO("Requesting web page via GSM '%s'", URL.c_str());
     
     // Sim800:
     
@@ -424,13 +414,15 @@ void requestWebPageGSM(String URL) {
 
 String contactGSMmodule(String GSMcommand) {
 
+  LOOP_SCOPE("contactGSMmodule");
+
   int delayTime = 500;                        // length of delays
   char replyStore[GSMbuffer + 1];             // store for reply from GSM module
   int received_counter = 0;                   // number of characters which have been received
 
   // if a command was supplied send it to GSM module
     if (GSMcommand != "") {
-      if (serialDebug) Serial.println("Sending command to GSM module: '" + GSMcommand +"'");
+      DEBUG_VERBOSE("Sending command to GSM module: '%s'", GSMcommand.c_str());
       GSMserial.println(GSMcommand);
       delay(delayTime);
     }
@@ -450,11 +442,8 @@ String contactGSMmodule(String GSMcommand) {
     }
     replyStore[received_counter] = 0;               // end of string marker
 
-  if (received_counter > 0 && serialDebug) {
-    Serial.println("--------------- Data received from gsm module --------------");
-    Serial.print(replyStore);
-    Serial.println("------------------------------------------------------------");
-  }
+  if (received_counter > 0) DEBUG_VERBOSE("--------------- Data received from gsm module --------------\n%s"
+                                           "------------------------------------------------------------", replyStore);
 
 //  if (!strstr(replyStore, "OK")) {
 //    // No valid reply received
@@ -465,6 +454,46 @@ String contactGSMmodule(String GSMcommand) {
 }
 
 
+// --------------------------------------------------------------------------
+
+
+#if ENABLE_COROUTINES
+
+// ----------------------------------------------------------------
+//       exchange data with GSM module from a coroutine (see coro.h)
+// ----------------------------------------------------------------
+// the same as contactGSMmodule() but the coroutine waits for the reply instead of the sketch
+// returns 1 if the reply ended with "OK", it is stored in buf (cut short if it does not fit)
+//    e.g. bool ok = co_await coroGSM("AT+CSQ", reply, sizeof(reply));
+// Note: GSMdataTask() may take the reply if it checks for incoming data first
+
+struct coroGSM : CoroAwait<coroGSM> {
+  char* buf;
+  uint16_t size;
+  uint16_t len = 0;
+  uint32_t start = millis();
+  uint32_t timeout;
+  bool ok = 0;
+
+  coroGSM(const char* command, char* b, uint16_t s, uint32_t t = 5000) : buf(b), size(s), timeout(t) {
+    buf[0] = 0;
+    DEBUG_VERBOSE("Sending command to GSM module: '%s'", command);
+    GSMserial.println(command);
+  }
+
+  bool poll() {
+    while (GSMserial.available() && len < size - 1) buf[len++] = GSMserial.read();
+    buf[len] = 0;
+    if (strstr(buf, "OK\r\n")) return ok = 1;
+    return strstr(buf, "ERROR") || len >= size - 1 || (uint32_t)(millis() - start) >= timeout;
+  }
+
+  bool await_resume() { return ok; }
+};
+
+#endif
+
+
 // --------------------------------------------------------------------------
 
 // end
@@ -0,0 +1,211 @@
+/**************************************************************************************************
+ *
+ *      Connection guard - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      The web server library deals with one connection at a time and waits (up to several seconds
+ *      for each line) while a request arrives, so a client which sends its request very slowly, or
+ *      opens a connection and sends nothing, holds up all the other web pages (a 'slowloris' attack).
+ *
+ *      With ENABLE_GUARD new connections are accepted here instead and only passed on to the web
+ *      server library once the whole request has arrived (checked without reading it so the library
+ *      still sees all of it), so it never has to wait.  A connection is closed if:
+ *          the header has not all arrived within guardHeaderMs                  (408 Request Timeout)
+ *          the body has not all arrived within guardBodyMs of the header        (408 Request Timeout)
+ *          the request has not all arrived within guardTotalMs                  (408 Request Timeout)
+ *          the header is larger than guardHeaderMax                             (431 Request Header Fields Too Large)
+ *          guardMax connections are already waiting and another one arrives    (the oldest is closed)
+ *      Bodies larger than guardBodyMax (e.g. OTA uploads) are left for the web server library to read.
+ *
+ *      The library is also not left waiting for a browser to close a finished connection if there
+ *      is another request ready.
+ *
+ *      The number of connections closed for each reason is shown on http://x.x.x.x/metrics
+ *      Note: not used with ENABLE_HTTPS as the request can not be checked until it has been decrypted.
+ *
+ **************************************************************************************************/
+
+
+#if ENABLE_GUARD
+
+#if defined ESP32
+  #include <lwip/sockets.h>
+#endif
+
+
+// ----------------------------------------------------------------
+//                              -Startup
+// ----------------------------------------------------------------
+
+  const byte guardMax = 4;                  // max connections waiting for their request to arrive
+  const uint16_t guardHeaderMax = 1024;     // largest request header allowed (bytes)
+  const uint16_t guardBodyMax = 1024;       // bodies up to this size must arrive before the page is run (bytes)
+  const uint32_t guardHeaderMs = 2000;      // time allowed for the header to arrive (ms)
+  const uint32_t guardBodyMs = 3000;        // time allowed for the body to arrive after the header (ms)
+  const uint32_t guardTotalMs = 4000;       // time allowed for the whole request to arrive (ms)
+
+  enum guardResults { guardHandled, guardHeaderTimeout, guardBodyTimeout, guardTotalTimeout, guardTooBig, guardEvicted, guardResultCount };
+  const char* const guardResultNames[guardResultCount] = { "handled", "header_timeout", "body_timeout", "total_timeout", "too_big", "evicted" };
+  uint32_t guardCount[guardResultCount];    // number of connections with each result
+
+  // ready made replies
+  const char guard408[] = "HTTP/1.1 408 Request Timeout\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+  const char guard431[] = "HTTP/1.1 431 Request Header Fields Too Large\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+  // newer esp8266 cores renamed available() to accept()
+    #if defined ESP8266 && defined ARDUINO_ESP8266_MAJOR && ARDUINO_ESP8266_MAJOR >= 3
+      #define GUARD_ACCEPT accept
+    #else
+      #define GUARD_ACCEPT available
+    #endif
+
+
+// ----------------------------------------------------------------
+//       -look at what a client has sent (without reading it)
+// ----------------------------------------------------------------
+
+int guardPeek(ServerClient &client, char* buf, int n) {
+  #if defined ESP32
+    int r = recv(client.fd(), buf, n, MSG_PEEK | MSG_DONTWAIT);
+    return (r < 0) ? 0 : r;
+  #else
+    return client.peekBytes((uint8_t*)buf, n);          // (only ask for what is available or it waits for more)
+  #endif
+}
+
+// value of the Content-Length header line (0 if there is not one)
+uint32_t guardContentLength(const char* header, const char* end) {
+  for (const char* line = strstr(header, "\r\n"); line && line < end; line = strstr(line + 2, "\r\n")) {
+    if (strncasecmp(line + 2, "Content-Length:", 15) == 0) return atol(line + 17);
+  }
+  return 0;
+}
+
+
+// ----------------------------------------------------------------
+//         -the web server with the connection guard added
+// ----------------------------------------------------------------
+// S is the web server library's class
+
+template<typename S> class ClientGuard : public S {
+  public:
+    ClientGuard(int port) : S(port) {}
+
+    // used instead of the library's handleClient()
+    void handleClient() {
+      uint32_t t = millis();
+      guardAccept(t);
+      int ready = guardCheck(t);
+      if (ready >= 0 && guardLibraryFree()) {
+        this->_currentClient = pending[ready].client;
+        this->_currentStatus = HC_WAIT_READ;
+        this->_statusChange = t;
+        pending[ready].client = ServerClient();
+        pending[ready].used = 0;
+        guardCount[guardHandled]++;
+      }
+      if (this->_currentStatus != HC_NONE) S::handleClient();      // (the library would accept connections itself if it had none)
+    }
+
+  private:
+    struct Pending {
+      ServerClient client;
+      bool used = 0;
+      uint32_t accepted = 0;                // millis() when it connected
+      uint32_t headerDone = 0;              // millis() when the header had all arrived (0 = not yet)
+      int seen = 0;                         // bytes which had arrived when last checked
+      uint32_t need = 0;                    // bytes needed before it can be handled (0 = not known yet)
+    };
+    Pending pending[guardMax];
+
+    void guardClose(Pending &p, byte result, const char* reply) {
+      if (reply) p.client.write((const uint8_t*)reply, strlen(reply));
+      p.client.stop();
+      p.client = ServerClient();
+      p.used = 0;
+      guardCount[result]++;
+    }
+
+    // accept any new connections, if there is no room the oldest one still waiting for its request is closed
+    void guardAccept(uint32_t t) {
+      for (byte n=0; n < guardMax && this->_server.hasClient(); n++) {
+        int slot = -1;
+        for (byte i=0; i < guardMax && slot < 0; i++) if (!pending[i].used) slot = i;
+        if (slot < 0) {
+          for (byte i=0; i < guardMax; i++) {
+            Pending &p = pending[i];
+            if (p.need && p.seen >= (int)p.need) continue;            // (request has arrived)
+            if (slot < 0 || (int32_t)(p.accepted - pending[slot].accepted) < 0) slot = i;
+          }
+          if (slot < 0) return;                                         // all waiting for the library
+          guardClose(pending[slot], guardEvicted, nullptr);
+        }
+        Pending &p = pending[slot];
+        p.client = this->_server.GUARD_ACCEPT();
+        if (!p.client) return;
+        p.used = 1;
+        p.accepted = t;
+        p.headerDone = 0;
+        p.seen = 0;
+        p.need = 0;
+      }
+    }
+
+    // check the waiting connections, closes any which have run out of time
+    // returns the oldest one whose request has all arrived (-1 = none)
+    int guardCheck(uint32_t t) {
+      int ready = -1;
+      for (byte i=0; i < guardMax; i++) {
+        Pending &p = pending[i];
+        if (!p.used) continue;
+        int avail = p.client.available();
+        if (!avail && !p.client.connected()) {                          // browser gave up
+          p.client = ServerClient();
+          p.used = 0;
+          continue;
+        }
+        if (!p.need && avail != p.seen && !guardScan(p, avail, t)) {
+          guardClose(p, guardTooBig, guard431);
+          continue;
+        }
+        p.seen = avail;
+        if (p.need && avail >= (int)p.need) {
+          if (ready < 0 || (int32_t)(p.accepted - pending[ready].accepted) < 0) ready = i;
+        }
+        else if (!p.headerDone && (uint32_t)(t - p.accepted) > guardHeaderMs) guardClose(p, guardHeaderTimeout, guard408);
+        else if (p.headerDone && (uint32_t)(t - p.headerDone) > guardBodyMs) guardClose(p, guardBodyTimeout, guard408);
+        else if ((uint32_t)(t - p.accepted) > guardTotalMs) guardClose(p, guardTotalTimeout, guard408);
+      }
+      return ready;
+    }
+
+    // see if the header has all arrived and how much body follows it, returns 0 if the header is too big
+    bool guardScan(Pending &p, int avail, uint32_t t) {
+      char buf[guardHeaderMax + 1];
+      int n = guardPeek(p.client, buf, (avail < guardHeaderMax) ? avail : guardHeaderMax);
+      buf[n] = 0;
+      char* end = strstr(buf, "\r\n\r\n");
+      if (!end) return (avail < guardHeaderMax);
+      uint32_t headerLen = end + 4 - buf;
+      uint32_t body = guardContentLength(buf, end);
+      p.headerDone = t;
+      p.need = headerLen + ((body <= guardBodyMax) ? body : 0);         // (a large body is read by the library as it arrives)
+      return 1;
+    }
+
+    // if the library is only waiting for the browser (to close the connection or send another request) let it go
+    bool guardLibraryFree() {
+      if (this->_currentStatus == HC_NONE) return 1;
+      if (this->_currentClient.available()) return 0;
+      if (this->_currentStatus == HC_WAIT_READ) this->_currentClient.stop();
+      this->_currentClient = ServerClient();                            // (anything still using the connection keeps it open)
+      this->_currentStatus = HC_NONE;
+      return 1;
+    }
+};
+
+#endif    // ENABLE_GUARD
+
+
+// --------------------------- E N D -----------------------------
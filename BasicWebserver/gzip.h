@@ -0,0 +1,116 @@
+/**************************************************************************************************
+ *
+ *      Gzipped web pages - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Sends a page made from the templates (pages.h) gzipped without compressing anything on the
+ *      esp: misc/templates.py stores each piece of fixed text in a template already compressed as
+ *      well as plain, those pieces are sent as they are and the values filled in are sent as they
+ *      are (as uncompressed 'stored' blocks), the result is a normal gzip file.
+ *
+ *      Usage:   GzipWriter gz(client);
+ *               render_data(gz, ...);                 (or anything else which prints to gz)
+ *               gz.finish();
+ *
+ *      Used by cachedRender() (see rendercache.h) when the browser accepts gzip.
+ *
+ **************************************************************************************************/
+
+
+// ----------------------------------------------------------------
+//                              -Startup
+// ----------------------------------------------------------------
+
+  class GzipWriter;
+  GzipWriter* pageGzip = nullptr;           // the GzipWriter a page is being sent to (see pageText() in pages.h)
+
+  // crc32 (4 bits at a time so the table is small)
+    const uint32_t gzipCrcTable[16] = {
+      0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+      0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+
+
+// ----------------------------------------------------------------
+//                        -the gzip writer
+// ----------------------------------------------------------------
+
+class GzipWriter : public Print {
+  public:
+    GzipWriter(Print &o) : out(o), previous(pageGzip) {
+      static const uint8_t header[10] = { 0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF };      // (no name or time)
+      out.write(header, sizeof(header));
+      pageGzip = this;
+    }
+    ~GzipWriter() { pageGzip = previous; }
+
+    // text filled in to the page (kept until there is a block of it)
+    using Print::write;
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* data, size_t n) override {
+      for (size_t i=0; i < n; i++) {
+        if (len == sizeof(buf)) storedBlock();
+        buf[len++] = data[i];
+      }
+      crcAdd(data, n);
+      size += n;
+      return n;
+    }
+
+    // fixed text from flash along with the same text compressed by misc/templates.py
+    void writeDeflated(PGM_P text, size_t textLen, const uint8_t* z, size_t zLen) {
+      storedBlock();
+      uint8_t chunk[64];
+      for (size_t i=0; i < zLen; i += sizeof(chunk)) {
+        size_t n = (zLen - i > sizeof(chunk)) ? sizeof(chunk) : zLen - i;
+        memcpy_P(chunk, z + i, n);
+        out.write(chunk, n);
+      }
+      for (size_t i=0; i < textLen; i += sizeof(chunk)) {
+        size_t n = (textLen - i > sizeof(chunk)) ? sizeof(chunk) : textLen - i;
+        memcpy_P(chunk, text + i, n);
+        crcAdd(chunk, n);
+      }
+      size += textLen;
+    }
+
+    // end of the page (last block, crc and length)
+    void finish() {
+      storedBlock();
+      uint32_t c = ~crc;
+      uint8_t end[13] = { 1, 0, 0, 0xFF, 0xFF,
+                          (uint8_t)c, (uint8_t)(c >> 8), (uint8_t)(c >> 16), (uint8_t)(c >> 24),
+                          (uint8_t)size, (uint8_t)(size >> 8), (uint8_t)(size >> 16), (uint8_t)(size >> 24) };
+      out.write(end, sizeof(end));
+    }
+
+  private:
+    Print &out;
+    GzipWriter* previous;
+    uint32_t crc = 0xFFFFFFFF;
+    uint32_t size = 0;                      // length of the page before it was gzipped
+    uint8_t buf[128];                       // text waiting to be sent
+    uint16_t len = 0;
+
+    // send the text waiting as an uncompressed block
+    void storedBlock() {
+      if (len == 0) return;
+      uint16_t nlen = ~len;
+      uint8_t head[5] = { 0, (uint8_t)len, (uint8_t)(len >> 8), (uint8_t)nlen, (uint8_t)(nlen >> 8) };
+      out.write(head, sizeof(head));
+      out.write(buf, len);
+      len = 0;
+    }
+
+    void crcAdd(const uint8_t* data, size_t n) {
+      for (size_t i=0; i < n; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ gzipCrcTable[crc & 15];
+        crc = (crc >> 4) ^ gzipCrcTable[crc & 15];
+      }
+    }
+};
+
+
+// --------------------------- E N D -----------------------------
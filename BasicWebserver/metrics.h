@@ -0,0 +1,367 @@
+/**************************************************************************************************
+ *
+ *      Metrics - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Keeps statistics on how the device is running and serves them at http://x.x.x.x/metrics
+ *      in Prometheus text format so they can be collected by a Prometheus server (or anything
+ *      else which can read it).
+ *
+ *      Recorded:  time taken for each web page (histogram per route), requests and bytes sent,
+ *                 most request memory used by each web page (see arena.h),
+ *                 time taken for each pass of loop(), free heap / lowest free heap / largest free
+ *                 block, wifi reconnects and NTP results
+ *
+ *      Web pages are registered with routeOn() instead of server.on() so they can be timed, and
+ *      use 'MeteredClient client = server.client();' so the bytes they send are counted.
+ *      Note: replies sent with server.send() are timed but their bytes are not counted.
+ *
+ *      The route timing and MeteredClient are also used for tracing (see trace.h) and the bytes
+ *      sent by the access statistics (see access.h), if none of ENABLE_METRICS, ENABLE_TRACE or
+ *      ENABLE_ACCESS are set routeOn() and MeteredClient are just the normal server ones.
+ *
+ **************************************************************************************************/
+
+
+// forward declarations (i.e. details of all functions in this file)
+  void routeOn(const char*, std::function<void(void)>);
+  void routeNotFound(std::function<void(void)>);
+  void metricsLoop();
+  void handleMetrics();
+
+
+#if !ENABLE_METRICS && !ENABLE_TRACE && !ENABLE_ACCESS
+
+  typedef ServerClient MeteredClient;
+
+  void routeOn(const char* path, std::function<void(void)> handler) { server.on(path, handler); }
+
+  void routeNotFound(std::function<void(void)> handler) { server.onNotFound(handler); }
+
+  int8_t metricsRouteAdd(const char*) { return -1; }
+
+  template<typename F> void metricsRun(int8_t, F &handler) {
+    #if ENABLE_HTTPS
+      httpsRequestStart();
+    #endif
+    handler();
+  }
+
+#else
+
+
+// ----------------------------------------------------------------
+//                              -Startup
+// ----------------------------------------------------------------
+
+  const byte metricsMaxRoutes = 20;         // max number of web pages which can be recorded
+
+  // histogram buckets (upper limits in microseconds and as text in seconds for the output)
+    const byte metricsBuckets = 11;
+    const uint32_t metricsBucketUs[metricsBuckets] = {1000, 2000, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000};
+    const char* const metricsBucketText[metricsBuckets] = {"0.001", "0.002", "0.005", "0.01", "0.025", "0.05", "0.1", "0.25", "0.5", "1", "2.5"};
+
+  struct Histogram {
+    uint32_t bucket[metricsBuckets + 1] = {0};        // counts in each bucket (last one is over the top limit)
+    uint32_t count = 0;
+    uint64_t sumUs = 0;
+  };
+
+  struct RouteMetrics {
+    const char* path = "";
+    uint16_t traceTag = 0;                  // tag used for tracing the handler (see trace.h)
+    Histogram time;                         // time taken to handle the request
+    uint32_t bytes = 0;                     // bytes sent
+    uint16_t arenaPeak = 0;                 // most request memory used (see arena.h)
+  };
+
+  RouteMetrics metricsRoutes[metricsMaxRoutes + 1];   // last one is used for 'not found' pages
+  byte metricsRouteCount = 0;
+  int8_t metricsCurrentRoute = -1;          // route currently being handled (-1 = none)
+  uint32_t metricsBytesSent = 0;            // total bytes sent by web pages
+  Histogram metricsLoopTime;                // time taken for each pass of loop()
+  uint32_t metricsLoopTimer = 0;            // micros() at the start of this pass of loop
+  uint32_t metricsHeapMin = 0xFFFFFFFF;     // lowest free heap seen
+
+
+// ----------------------------------------------------------------
+//                   -record a value in a histogram
+// ----------------------------------------------------------------
+
+void histogramAdd(Histogram &h, uint32_t us) {
+  byte b = 0;
+  while (b < metricsBuckets && us > metricsBucketUs[b]) b++;
+  h.bucket[b]++;
+  h.count++;
+  h.sumUs += us;
+}
+
+
+// ----------------------------------------------------------------
+//     -WiFiClient which counts bytes sent and traces closing
+// ----------------------------------------------------------------
+
+class MeteredClient : public ServerClient {
+  public:
+    MeteredClient(const ServerClient &c) : ServerClient(c) { }
+    using ServerClient::write;
+    size_t write(uint8_t b) override { return counted(ServerClient::write(b)); }
+    size_t write(const uint8_t *buf, size_t size) override { return counted(ServerClient::write(buf, size)); }
+    // hides WiFiClient::stop() so closing can be traced (it is 'final' on esp8266 so can not be overridden)
+    void stop(bool = 1) {
+      TRACE_BEGIN(trFlush);
+      ServerClient::flush();
+      TRACE_END(trFlush);
+      TRACE_SCOPE(trStop);
+      ServerClient::stop();
+    }
+  private:
+    size_t counted(size_t sent) {
+      metricsBytesSent += sent;
+      #if ENABLE_METRICS
+        if (metricsCurrentRoute >= 0) metricsRoutes[metricsCurrentRoute].bytes += sent;
+      #endif
+      return sent;
+    }
+};
+
+
+// ----------------------------------------------------------------
+//           -run a web page handler and record the time taken
+// ----------------------------------------------------------------
+// route = number from metricsRouteAdd() (-1 = not recorded)
+
+template<typename F> void metricsRun(int8_t route, F &handler) {
+  #if ENABLE_HTTPS
+    httpsRequestStart();                    // (so the https handshake time does not include the page)
+  #endif
+  if (route < 0) {
+    handler();
+    return;
+  }
+  LOOP_SCOPE(metricsRoutes[route].path);
+  TRACE_SCOPE(metricsRoutes[route].traceTag);
+  metricsCurrentRoute = route;
+  uint16_t arenaStart = arenaUsed;
+  uint32_t startUs = micros();
+  handler();
+  histogramAdd(metricsRoutes[route].time, micros() - startUs);
+  uint16_t arena = arenaUsed - arenaStart;
+  if (arena > metricsRoutes[route].arenaPeak) metricsRoutes[route].arenaPeak = arena;
+  metricsCurrentRoute = -1;
+}
+
+
+// ----------------------------------------------------------------
+//            -add a web page to the routes recorded
+// ----------------------------------------------------------------
+// returns the number to pass to metricsRun() (-1 if there is no room)
+
+int8_t metricsRouteAdd(const char* path) {
+  if (metricsRouteCount >= metricsMaxRoutes) {
+    if (serialDebug) Serial.printf("Metrics: no room to record '%s'\n", path);
+    return -1;
+  }
+  int8_t route = metricsRouteCount++;
+  metricsRoutes[route].path = path;
+  metricsRoutes[route].traceTag = traceTag(path);
+  return route;
+}
+
+
+// ----------------------------------------------------------------
+//            -register a web page (instead of server.on)
+// ----------------------------------------------------------------
+
+void routeOn(const char* path, std::function<void(void)> handler) {
+  int8_t route = metricsRouteAdd(path);
+  server.on(path, [route, handler]() mutable { metricsRun(route, handler); });
+}
+
+// invalid page requested (instead of server.onNotFound)
+void routeNotFound(std::function<void(void)> handler) {
+  metricsRoutes[metricsMaxRoutes].path = "notfound";
+  metricsRoutes[metricsMaxRoutes].traceTag = traceTag("notfound");
+  server.onNotFound([handler]() mutable { metricsRun(metricsMaxRoutes, handler); });
+}
+
+#endif    // ENABLE_METRICS || ENABLE_TRACE || ENABLE_ACCESS
+
+
+#if !ENABLE_METRICS
+
+  void metricsLoop() { }
+
+#else
+
+
+// ----------------------------------------------------------------
+//           -time each pass of loop() and check the heap
+// ----------------------------------------------------------------
+// called at the start of loop()
+
+void metricsLoop() {
+
+  uint32_t t = micros();
+  if (metricsLoopTimer != 0) histogramAdd(metricsLoopTime, t - metricsLoopTimer);
+  metricsLoopTimer = t;
+
+  uint32_t freeHeap = ESP.getFreeHeap();
+  if (freeHeap < metricsHeapMin) metricsHeapMin = freeHeap;
+}
+
+
+// ----------------------------------------------------------------
+//             -send a histogram in Prometheus format
+// ----------------------------------------------------------------
+// route = web page the histogram is for (nullptr if none)
+
+void metricsSendHistogram(WiFiClient &client, const char* name, const char* route, Histogram &h) {
+
+  const char* labelStart = (route) ? "route=\"" : "";
+  const char* labelEnd = (route) ? "\"," : "";
+  if (!route) route = "";
+
+  uint32_t total = 0;
+  for (byte b=0; b <= metricsBuckets; b++) {
+    total += h.bucket[b];
+    client.printf("%s_bucket{%s%s%sle=\"%s\"} %u\n", name, labelStart, route, labelEnd, (b < metricsBuckets) ? metricsBucketText[b] : "+Inf", total);
+  }
+  if (route[0]) {
+    client.printf("%s_sum{route=\"%s\"} %.6f\n", name, route, h.sumUs / 1000000.0);
+    client.printf("%s_count{route=\"%s\"} %u\n", name, route, h.count);
+  } else {
+    client.printf("%s_sum %.6f\n", name, h.sumUs / 1000000.0);
+    client.printf("%s_count %u\n", name, h.count);
+  }
+}
+
+
+// ----------------------------------------------------------------
+//         -metrics web page requested    i.e. http://x.x.x.x/metrics
+// ----------------------------------------------------------------
+
+void handleMetrics() {
+
+  MeteredClient client = server.client();                  // open link with client
+
+  client.print("HTTP/1.1 200 OK\r\n");
+  client.print("Content-Type: text/plain; version=0.0.4\r\n");
+  client.print("Connection: close\r\n\r\n");
+
+  // web pages
+    client.print("# HELP http_request_duration_seconds Time taken to handle web page requests\n");
+    client.print("# TYPE http_request_duration_seconds histogram\n");
+    for (byte r=0; r <= metricsMaxRoutes; r++) {
+      if (r >= metricsRouteCount && r != metricsMaxRoutes) continue;
+      metricsSendHistogram(client, "http_request_duration_seconds", metricsRoutes[r].path, metricsRoutes[r].time);
+    }
+    client.print("# HELP http_response_bytes_total Bytes sent in reply to web page requests\n");
+    client.print("# TYPE http_response_bytes_total counter\n");
+    for (byte r=0; r <= metricsMaxRoutes; r++) {
+      if (r >= metricsRouteCount && r != metricsMaxRoutes) continue;
+      client.printf("http_response_bytes_total{route=\"%s\"} %u\n", metricsRoutes[r].path, metricsRoutes[r].bytes);
+    }
+    client.printf("# TYPE http_sent_bytes_total counter\nhttp_sent_bytes_total %u\n", metricsBytesSent);
+    client.print("# HELP http_request_arena_peak_bytes Most request memory used by a web page (see arena.h)\n");
+    client.print("# TYPE http_request_arena_peak_bytes gauge\n");
+    for (byte r=0; r <= metricsMaxRoutes; r++) {
+      if (r >= metricsRouteCount && r != metricsMaxRoutes) continue;
+      client.printf("http_request_arena_peak_bytes{route=\"%s\"} %u\n", metricsRoutes[r].path, metricsRoutes[r].arenaPeak);
+    }
+    client.printf("# TYPE arena_size_bytes gauge\narena_size_bytes %u\n", arenaSize);
+    client.printf("# TYPE arena_peak_bytes gauge\narena_peak_bytes %u\n", arenaPeak);
+    client.printf("# TYPE arena_full_total counter\narena_full_total %u\n", arenaFails);
+
+  // render cache (see rendercache.h)
+    client.print("# HELP render_cache_total Pages sent from the render cache (hit) or created (miss / toobig)\n");
+    client.print("# TYPE render_cache_total counter\n");
+    for (RenderCache* c = renderCacheList; c; c = c->next) {
+      client.printf("render_cache_total{page=\"%s\",result=\"hit\"} %u\n", c->page, c->hits);
+      client.printf("render_cache_total{page=\"%s\",result=\"miss\"} %u\n", c->page, c->misses);
+      client.printf("render_cache_total{page=\"%s\",result=\"toobig\"} %u\n", c->page, c->tooBig);
+    }
+
+  // loop
+    client.print("# HELP loop_duration_seconds Time taken for each pass of loop()\n");
+    client.print("# TYPE loop_duration_seconds histogram\n");
+    metricsSendHistogram(client, "loop_duration_seconds", nullptr, metricsLoopTime);
+
+  // memory
+    uint32_t freeHeap = ESP.getFreeHeap();
+    if (freeHeap < metricsHeapMin) metricsHeapMin = freeHeap;
+    #if defined ESP32
+      uint32_t largestBlock = ESP.getMaxAllocHeap();
+    #else
+      uint32_t largestBlock = ESP.getMaxFreeBlockSize();
+    #endif
+    client.printf("# TYPE heap_free_bytes gauge\nheap_free_bytes %u\n", freeHeap);
+    client.printf("# TYPE heap_min_free_bytes gauge\nheap_min_free_bytes %u\n", metricsHeapMin);
+    client.printf("# TYPE heap_largest_free_block_bytes gauge\nheap_largest_free_block_bytes %u\n", largestBlock);
+
+  // wifi / ntp
+    client.printf("# TYPE wifi_connected gauge\nwifi_connected %d\n", wifiok ? 1 : 0);
+    client.printf("# TYPE wifi_rssi_dbm gauge\nwifi_rssi_dbm %d\n", WiFi.RSSI());
+    client.printf("# TYPE wifi_reconnects_total counter\nwifi_reconnects_total %u\n", wifiReconnects);
+    client.print("# TYPE ntp_sync_total counter\n");
+    client.printf("ntp_sync_total{result=\"ok\"} %u\n", ntpSyncOk);
+    client.printf("ntp_sync_total{result=\"fail\"} %u\n", ntpSyncFail);
+
+  #if ENABLE_GUARD
+    // connections passed to the web server / closed for being too slow (see guard.h)
+      client.print("# TYPE guard_connections_total counter\n");
+      for (byte r=0; r < guardResultCount; r++) client.printf("guard_connections_total{result=\"%s\"} %u\n", guardResultNames[r], guardCount[r]);
+  #endif
+
+  #if ENABLE_ADMISSION
+    // requests let through / turned away (see admission.h)
+      client.print("# TYPE admission_total counter\n");
+      for (byte c=0; c < routeClassCount; c++) {
+        client.printf("admission_total{class=\"%s\",result=\"admitted\"} %u\n", admitLimits[c].name, admitCount[c]);
+        client.printf("admission_total{class=\"%s\",result=\"limited\"} %u\n", admitLimits[c].name, admitLimited[c]);
+      }
+      client.printf("# TYPE admission_full_total counter\nadmission_full_total %u\n", admitFull);
+  #endif
+
+  #if ENABLE_HTTPS
+    // https handshakes (see https.h)
+      client.print("# TYPE https_handshakes_total counter\n");
+      client.printf("https_handshakes_total{type=\"full\"} %u\n", httpsFull);
+      client.printf("https_handshakes_total{type=\"resumed\"} %u\n", httpsResumed);
+      client.printf("# TYPE https_session_cache_misses_total counter\nhttps_session_cache_misses_total %u\n", httpsCacheMiss);
+      client.print("# TYPE https_handshake_seconds_total counter\n");
+      client.printf("https_handshake_seconds_total{type=\"full\"} %u.%06u\n", httpsFullUs / 1000000, httpsFullUs % 1000000);
+      client.printf("https_handshake_seconds_total{type=\"resumed\"} %u.%06u\n", httpsResumedUs / 1000000, httpsResumedUs % 1000000);
+  #endif
+
+  #if ENABLE_COROUTINES
+    // coroutine web pages (see coro.h)
+      client.printf("# TYPE coroutines_running gauge\ncoroutines_running %u\n", coroRunning);
+      client.printf("# TYPE coroutines_peak gauge\ncoroutines_peak %u\n", coroPeak);
+      client.printf("# TYPE coroutine_frame_largest_bytes gauge\ncoroutine_frame_largest_bytes %u\n", coroLargest);
+      client.print("# TYPE coroutines_total counter\n");
+      client.printf("coroutines_total{result=\"started\"} %u\n", coroStarted);
+      client.printf("coroutines_total{result=\"refused\"} %u\n", coroRefused);
+  #endif
+
+  #if ENABLE_DUALCORE
+    // messages between the cores lost because a queue was full (see dualcore.h)
+      client.print("# TYPE queue_dropped_total counter\n");
+      client.printf("queue_dropped_total{queue=\"log\"} %u\n", logQueue.dropped.load());
+      client.printf("queue_dropped_total{queue=\"command\"} %u\n", commandQueue.dropped.load());
+  #endif
+
+  // debug messages lost because the buffer was full (see debug.h)
+    client.printf("# TYPE debug_dropped_total counter\ndebug_dropped_total %u\n", debugDropped());
+
+  client.printf("# TYPE uptime_seconds counter\nuptime_seconds %u\n", millis() / 1000);
+
+  delay(3);
+  client.stop();
+}
+
+#endif    // ENABLE_METRICS
+
+
+// --------------------------- E N D -----------------------------
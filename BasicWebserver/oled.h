@@ -20,6 +20,9 @@
  The sketch displays a menu on the oled and when an item is selected it sets a 
  flag and waits until the event is acted upon.  Max menu items on a 128x64 oled 
  is four.
+
+ Use oledRefresh() rather than display.display() to update the screen, it only sends the parts of 
+ the display which have changed since last time (the full screen takes around 25ms to send over i2c).
  
 See the section "customise the menus below" for how to create custom menus inclusing selecting a value, 
 choose from a list or display a message.
@@ -36,7 +39,11 @@ choose from a list or display a message.
  
   const bool oledDebug = 1;                   // debug enable on serial for oled.h
 
-  int itemTrigger = 1;                        // no of counts on rotary encoder per step (1 or 2 usually depending on encoder)
+  int itemTrigger = 4;                        // no of counts on rotary encoder per step (4 or 2 usually depending on encoder, a count is a change on either pin)
+
+  const uint16_t reDebounceTime = 30;         // rotary encoder button debounce time (ms)
+
+  const uint16_t reLongPressTime = 1000;      // rotary encoder button held for this long is a long press (ms)
 
   const int topLine = 18;                     // y position of second bank of menu display (specially used on two colour displays)
 
@@ -79,35 +86,54 @@ choose from a list or display a message.
 
 
   // forward declarations (i.e. details of all functions in this file)
+    typedef void (*widgetCallback)(int);      // procedure called with the result when a widget finishes
     void setMenu(byte, String);
-    int enterValue(String, int, int, int, int);
-    void menuItemSelection();
-    bool menuCheck();
+    void enterValue(String, int, int, int, int, widgetCallback);
+    void menuEvent(byte);
+    void widgetEvent(byte);
+    byte reGetEvent();
+    void rePressReported(bool);
     void staticMenu();
-    int chooseFromList(byte, String, String[]);
-    void reWaitKeypress(int);
+    void chooseFromList(byte, String, String[], widgetCallback);
+    void reWaitKeypress(int, widgetCallback = nullptr);
     void displayTimeOLED();
-    bool confirmActionRequired();
+    void confirmActionRequired(widgetCallback);
+    void oledRefresh();
+    bool widgetLoop();
+    void widgetStart(byte, uint32_t, widgetCallback);
     #if defined ESP32
-      void IRAM_ATTR doEncoder();
+      #define RE_IRAM IRAM_ATTR                 // interrupt routines need to be in ram
     #else    // ESP8266
-      void ICACHE_RAM_ATTR doEncoder();
+      #define RE_IRAM ICACHE_RAM_ATTR
     #endif    
+    void RE_IRAM doEncoder();
+    void RE_IRAM doButton();
+    void RE_IRAM reQueueEvent(byte);
 
 
   #include <Adafruit_GFX.h>
   #include <Adafruit_SSD1306.h>
+  #include <atomic>
   
   // rotary encoder
+  //   the interrupt routines decode the encoder and button and queue events which are read with reGetEvent()
+    enum reEvents { reNone, reStepUp, reStepDown, rePress, reRelease, reLongPress };
+    const byte reQueueSize = 16;              // size of event queue (must be a power of 2)
+    const int8_t reTable[16] = { 0, 1,-1, 0,  -1, 0, 0, 1,   1, 0, 0,-1,   0,-1, 1, 0 };   // direction from previous/new pin states
     struct REncoder {
-      volatile int encoder0Pos = 0;           // current value selected with rotary encoder (updated in interrupt routine)
-      volatile bool encoderPrevA = 0;         // previous reading from rotary encoder
-      volatile bool encoderPrevB = 0;      
+      volatile uint8_t state = 0;             // last pin readings (A << 1 | B)
+      volatile int8_t count = 0;              // counts since last step event
+      volatile bool buttonPressed = 0;        // debounced state of the button as the interrupt last saw it
+      volatile uint32_t buttonTimer = 0;      // time the interrupt last saw it change
+      bool pressed = 0;                       // state of the button as last reported by reGetEvent() (only used from loop)
+      uint32_t pressedTimer = 0;              // time it was reported
+      bool longPressSent = 0;                 // long press has been reported for the current press
+      volatile byte queue[reQueueSize];       // events waiting to be read
+      std::atomic<uint8_t> head{0};           // next free space in queue (only changed by reQueueEvent)
+      std::atomic<uint8_t> tail{0};           // next event to read (only changed by reGetEvent)
+      volatile uint32_t dropped = 0;          // events lost because the queue was full
     };
-    REncoder encoderA;                        // create the rotary encode variables from the structure (encoderA.encoder0Pos etc.)
-    bool reButtonState = 0;                   // current debounced state of the button
-    uint32_t reButtonTimer = millis();        // time button state last changed
-    int reButtonMinTime = 500;                // minimum milliseconds between allowed button status changes 
+    REncoder encoderA;                        // create the rotary encode variables from the structure (encoderA.pressed etc.)
   
   // oled SSD1306 display connected to I2C (SDA, SCL pins)
     #define OLED_ADDR 0x3C                    // OLED i2c address
@@ -116,14 +142,46 @@ choose from a list or display a message.
     #define OLED_RESET -1                     // Reset pin # (or -1 if sharing Arduino reset pin)
     Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
 
+  // partial display refresh
+    const uint16_t oledBufSize = SCREEN_WIDTH * SCREEN_HEIGHT / 8;   // display memory (each byte is 8 pixels high, one 'page' per 8 rows)
+    const byte oledI2CChunk = 31;             // max data bytes per i2c transmission (i2c buffer is 32 bytes on some boards)
+    uint8_t oledShadow[oledBufSize];          // what is currently showing on the display
+    bool oledShadowValid = 0;                 // 0 = display contents unknown so send everything
+    uint32_t oledRefreshCount = 0;            // number of times oledRefresh() has been called
+    uint32_t oledFrames = 0;                  // number of refreshes which sent data to the display
+    uint32_t oledBytes = 0;                   // total bytes sent to the display over i2c
+    uint32_t oledStatsTimer = millis();       // used for reporting frames/bytes per second
+    bool menuChanged = 1;                     // flag that the menu needs redrawing
+
+  // widgets (enter a value, choose from a list etc.) - these run from oledLoop() without waiting so 
+  //   web pages etc. are still serviced whilst they are in use
+    enum widgetTypes { widgetNone, widgetValue, widgetList, widgetConfirm, widgetWait };
+    const byte widgetListMax = 10;            // max number of items in a list
+    struct Widget {
+      byte type = widgetNone;                 // widget currently active
+      bool waitRelease = 0;                   // waiting for button to be released before starting
+      bool redraw = 0;                        // display needs updating
+      uint32_t timer = 0;                     // time of last activity
+      uint32_t timeout = 0;                   // give up after this long with no activity (ms)
+      int value = 0;                          // value being entered or item highlighted in list
+      int stepSize = 1, low = 0, high = 0;    // value entry settings
+      byte noOfElements = 0;                  // list items
+      String list[widgetListMax];
+      widgetCallback done = nullptr;          // procedure to call with the result
+    };
+    Widget widget;
+
 
-/* -------------------------------------------------------------------------------------------------
+// -------------------------------------------------------------------------------------------------
 //                                        customise the menus below
 // -------------------------------------------------------------------------------------------------
 // Useful commands:
-//      void reWaitKeypress(20000);         = wait for the button to be pressed on the rotary encoder (timeout in 20 seconds if not)
-//      chooseFromList(8, "TestList", q);   = choose from the list of 8 items in a string array 'q'
-//      enterValue("Testval", 15, 0, 30);   = enter a value between 0 and 30 (with a starting value of 15)
+//      reWaitKeypress(20000);                    = wait for the button to be pressed on the rotary encoder (timeout in 20 seconds if not)
+//      chooseFromList(8, "TestList", q, done);   = choose from the list of 8 items in a string array 'q'
+//      enterValue("Testval", 15, 1, 0, 30, done);= enter a value between 0 and 30 (with a starting value of 15 and step size 1)
+//      confirmActionRequired(done);              = confirm an action with a long press of the button
+//   These return straight away, 'done' is a procedure which is called with the result when finished 
+//   (e.g. void myDone(int result) {...}  or  [](int result) {...} )
 
 
 /*      Usage Examples
@@ -199,21 +257,25 @@ void menuItemActions() {
     if (menuTitle == "Main Menu" && menuItemClicked==0) {
       menuItemClicked=100;                                            // flag that the button press has been actioned (the menu stops and waits until this)             
       String q[] = {"Confirm","item1","item2","item3","item4","item5","item6","CANCEL"};
-      int tres=chooseFromList(8, "TestList", q);
-      if (tres==0 && confirmActionRequired()) {
-        log_system_message("long press confirmed on item0");
-      }
-      if (tres==1) {
-        log_system_message("item1 selected");
-      }      
-      log_system_message("Menu: item " + String(tres) + " chosen from list");
+      chooseFromList(8, "TestList", q, [](int tres) {
+        log_system_message("Menu: item %d chosen from list", tres);
+        if (tres==0) {
+          confirmActionRequired([](int confirmed) {
+            if (confirmed) log_system_message("long press confirmed on item0");
+          });
+        }
+        if (tres==1) {
+          log_system_message("item1 selected");
+        }      
+      });
     }
 
     // enter a value
     if (menuTitle == "Main Menu" && menuItemClicked==1) {
       menuItemClicked=100;    
-      int tres=enterValue("Testval", 15, 1, 0, 30);                      // enter a value (title, start value, step size, low limit, high limit)
-      log_system_message("Menu: Value set = " + String(tres));
+      enterValue("Testval", 15, 1, 0, 30, [](int tres) {                 // enter a value (title, start value, step size, low limit, high limit)
+        log_system_message("Menu: Value set = %d", tres);
+      });
     }
 
     // display a message
@@ -226,7 +288,7 @@ void menuItemActions() {
         display.setTextColor(WHITE);
         display.setCursor(20, 20);
         display.print("Hello");
-        display.display();
+        oledRefresh();
       reWaitKeypress(20000);                                          // wait for key press on rotary encoder
     }
 
@@ -255,7 +317,7 @@ void menuItemActions() {
       log_system_message("Menu: menu off");
       menuTitle = "";                                                 // turn menu off
       display.clearDisplay();
-      display.display(); 
+      oledRefresh(); 
     }
 
     // switch to main menu
@@ -286,6 +348,7 @@ void oledSetup() {
     if(!display.begin(SSD1306_SWITCHCAPVCC, OLED_ADDR)) {
       if (oledDebug) Serial.println(("\nError initialising the oled display"));
     }
+    oledShadowValid = 0;                    // display memory content is unknown at this point
 
   // Display splash screen on OLED
     display.clearDisplay();
@@ -299,11 +362,16 @@ void oledSetup() {
     display.print(boardType);
     display.setCursor(0, lineSpace1 * 5);
     //display.print(freeMemory());
-    display.display();
+    oledRefresh();
     delay(1000);
 
-  // Interrupt for reading the rotary encoder position
+  // Interrupts for reading the rotary encoder position and button
+    encoderA.state = (digitalRead(encoder0PinA) << 1) | digitalRead(encoder0PinB);
+    encoderA.buttonPressed = (digitalRead(encoder0Press) == LOW);
+    encoderA.pressed = encoderA.buttonPressed;
     attachInterrupt(digitalPinToInterrupt(encoder0PinA), doEncoder, CHANGE); 
+    attachInterrupt(digitalPinToInterrupt(encoder0PinB), doEncoder, CHANGE); 
+    attachInterrupt(digitalPinToInterrupt(encoder0Press), doButton, CHANGE); 
 
   Main_Menu();    // start the menu displaying - see menuItemActions() to alter the menus
 
@@ -316,14 +384,87 @@ void oledSetup() {
 
 void oledLoop() {
 
+    // pass any rotary encoder events to the active widget (e.g. entering a value) or the menu
+    byte event;
+    while ((event = reGetEvent()) != reNone) {
+      if (widget.type != widgetNone) widgetEvent(event);
+      else if (menuTitle != "") menuEvent(event);
+    }
+
+    bool widgetActive = widgetLoop();                       // service any active widget 
+
     // if a oled menu is active service it 
-    if (menuTitle != "") {                                  // if a menu is active
-      menuCheck();                                          // check if encoder selection button is pressed
-      menuItemSelection();                                  // check for change in menu item highlighted
+    if (!widgetActive && menuTitle != "") {                 // if a menu is active (and not replaced by a widget)
       staticMenu();                                         // display the menu 
       menuItemActions();                                    // act if a menu item has been clicked
     } 
 
+    // report display update rate
+    if (oledDebug && (unsigned long)(millis() - oledStatsTimer) >= 10000) {
+      float secs = (millis() - oledStatsTimer) / 1000.0;
+      Serial.printf("oled: %.1f frames/s, %.0f bytes/s sent\n", oledFrames / secs, oledBytes / secs);
+      oledFrames = 0;
+      oledBytes = 0;
+      oledStatsTimer = millis();
+    }
+
+}
+
+
+// -------------------------------------------------------------------------------------------------
+
+// send the display buffer to the oled, only the pages (8 pixel high rows) which have changed 
+//   are sent and within these only the columns from the first to the last change
+
+void oledRefresh() {
+
+  LOOP_SCOPE("oledRefresh");
+
+  uint8_t* buf = display.getBuffer();
+  bool sent = 0;
+  oledRefreshCount++;
+  Wire.setClock(400000);
+
+  for (byte page=0; page < SCREEN_HEIGHT / 8; page++) {
+    uint8_t* row = &buf[page * SCREEN_WIDTH];
+    uint8_t* shadow = &oledShadow[page * SCREEN_WIDTH];
+
+    // find changed columns
+      int first = 0, last = SCREEN_WIDTH - 1;
+      if (oledShadowValid) {
+        while (first < SCREEN_WIDTH && row[first] == shadow[first]) first++;
+        if (first == SCREEN_WIDTH) continue;                              // page unchanged
+        while (row[last] == shadow[last]) last--;
+      }
+
+    // set the area of the display to write to 
+      Wire.beginTransmission(OLED_ADDR);
+      Wire.write((uint8_t)0x00);                                          // commands follow
+      Wire.write((uint8_t)0x21);                                          // column address
+      Wire.write((uint8_t)first);
+      Wire.write((uint8_t)last);
+      Wire.write((uint8_t)0x22);                                          // page address
+      Wire.write((uint8_t)page);
+      Wire.write((uint8_t)page);
+      Wire.endTransmission();
+      oledBytes += 8;                                                     // including i2c address
+
+    // send the changed data
+      for (int col=first; col <= last; col += oledI2CChunk) {
+        byte n = (last + 1 - col > oledI2CChunk) ? oledI2CChunk : last + 1 - col;
+        Wire.beginTransmission(OLED_ADDR);
+        Wire.write((uint8_t)0x40);                                        // data follows
+        Wire.write(&row[col], n);
+        Wire.endTransmission();
+        oledBytes += n + 2;
+      }
+
+    memcpy(&shadow[first], &row[first], last + 1 - first);
+    sent = 1;
+  }
+
+  oledShadowValid = 1;
+  if (sent) oledFrames++;
 }
 
     
@@ -333,9 +474,11 @@ void oledLoop() {
 
 
 // confirm that a requested action is not a mistake with a long press of the button
-//   returns 1 if confirmed
+//   'done' is called with 1 if confirmed (as soon as the button has been held for reLongPressTime, or
+//   if it is still held when the time is up)
 
-bool confirmActionRequired() {
+void confirmActionRequired(widgetCallback done) {
+  widgetStart(widgetConfirm, 2000, done);
   display.clearDisplay();  
   display.setTextSize(2);
   display.setTextColor(WHITE,BLACK);
@@ -345,14 +488,7 @@ bool confirmActionRequired() {
   display.print("BUTTON TO");  
   display.setCursor(0, lineSpace2 * 2);
   display.print("CONFIRM!");
-  display.display();
-  
-  delay(2000);
-  display.clearDisplay();  
-  display.display();
-
-  if (digitalRead(encoder0Press) == LOW) return 1;        // if button still pressed
-  return 0;
+  oledRefresh();
 }
 
 
@@ -364,8 +500,9 @@ bool confirmActionRequired() {
 
 void setMenu(byte inum, String iname) {
   if (inum >= menuMax) return;    // invalid number
+  menuChanged = 1;                // menu needs redrawing
   if (iname == "") {              // clear all menu items
-    for (int i; i < menuMax; i++)  menuOption[i] = "";
+    for (int i=0; i < menuMax; i++)  menuOption[i] = "";
     menuCount = 0;                // move highlight to top menu item
   } else {
     menuOption[inum] = iname;
@@ -378,7 +515,15 @@ void setMenu(byte inum, String iname) {
 
 
 // display menu on oled
+//   only redrawn if something has changed since last time
+
 void staticMenu() {
+  static String drawnTitle;                          // what was on the display last time
+  static byte drawnCount, drawnClicked;
+  static uint32_t drawnRefresh = 0;
+  if (!menuChanged && drawnRefresh == oledRefreshCount && drawnTitle == menuTitle 
+      && drawnCount == menuCount && drawnClicked == menuItemClicked) return;    // nothing has changed and nothing else has been displayed since
+  
   display.clearDisplay(); 
   // title
     display.setTextSize(1);
@@ -403,7 +548,13 @@ void staticMenu() {
       display.print(">");
     }
   
-  display.display();          // update display
+  oledRefresh();              // update display
+
+  menuChanged = 0;
+  drawnRefresh = oledRefreshCount;
+  drawnTitle = menuTitle;
+  drawnCount = menuCount;
+  drawnClicked = menuItemClicked;
 }
 
 
@@ -444,36 +595,35 @@ void displayTimeOLED() {
     display.setTextSize(1);
     display.setCursor(20, display.height() - lineSpace1);
     display.print(WiFi.localIP());
-    display.display();
+    oledRefresh();
 }
 
 
 //  --------------------------------------
 
 
-// rotary encoder button
-//    returns 1 if the button status has changed since last time
-
-bool menuCheck() {
+// act on a rotary encoder event when the menu is displayed
 
-  if (digitalRead(encoder0Press) == reButtonState) return 0;    // no change
-  delay(40);
-  if (digitalRead(encoder0Press) == reButtonState) return 0;    // debounce
-  if (millis() - reButtonTimer  < reButtonMinTime) return 0;    // if too soon since last change
+void menuEvent(byte event) {
 
-  // button status has changed
-  reButtonState = !reButtonState;   
-  reButtonTimer = millis();                                     // update timer
+  if (event == reStepUp) {
+    lastREActivity = millis();                                  // log time last activity seen
+    if (menuCount+1 < menuMax) menuCount++;                     // if not past max menu items move
+    if (menuOption[menuCount] == "") menuCount--;               // if menu item is blank move back
+  }
+  
+  else if (event == reStepDown) {
+    lastREActivity = millis();
+    if (menuCount > 0) menuCount--;
+  }
 
   // oled menu action on button press 
-  if (reButtonState==LOW) {                                     // if button is now pressed      
+  else if (event == rePress) {
     lastREActivity = millis();                                  // log time last activity seen (don't count button release as activity)
-    if (menuItemClicked != 100 || menuTitle == "") return 1;    // menu item already selected or there is no live menu
+    if (menuItemClicked != 100) return;                         // menu item already selected
     if (serialDebug) Serial.println("menu '" + menuTitle + "' item " + String(menuCount) + " selected");
     menuItemClicked = menuCount;                                // set item selected flag
   }
-
-  return 1;
 }
 
 
@@ -481,47 +631,11 @@ bool menuCheck() {
 
 
 // wait for key press or turn on rotary encoder
-//    pass timeout in ms
-void reWaitKeypress(int timeout) {          
-        uint32_t tTimer = millis();   // log time
-        // wait for button to be released
-          while ( (digitalRead(encoder0Press) == LOW) && (millis() - tTimer < timeout) ) {        // wait for button release
-            yield();                  // service any web page requests
-            delay(20);
-          }
-        // clear rotary encoder position counter
-          noInterrupts();
-            encoderA.encoder0Pos = 0;       
-          interrupts();
-        // wait for button to be pressed or encoder to be turned
-          while ( (digitalRead(encoder0Press) == HIGH) && (encoderA.encoder0Pos == 0) && (millis() - tTimer < timeout) ) {
-            yield();                  // service any web page requests
-            delay(20);
-          }
-}
-
-
-//  --------------------------------------
-
-// handle menu item selection
+//    pass timeout in ms, 'done' is called when finished (optional)
 
-void menuItemSelection() {
-    if (encoderA.encoder0Pos >= itemTrigger) {
-      noInterrupts();
-        encoderA.encoder0Pos -= itemTrigger;
-      interrupts();
-      lastREActivity = millis();                            // log time last activity seen
-      if (menuCount+1 < menuMax) menuCount++;               // if not past max menu items move
-      if (menuOption[menuCount] == "") menuCount--;         // if menu item is blank move back
-    }
-    else if (encoderA.encoder0Pos <= -itemTrigger) {
-      noInterrupts();
-        encoderA.encoder0Pos += itemTrigger;
-      interrupts();
-      lastREActivity = millis();                            // log time last activity seen
-      if (menuCount > 0) menuCount--;
-    }
-}    
+void reWaitKeypress(int timeout, widgetCallback done) {
+  widgetStart(widgetWait, timeout, done);
+}
 
 
 //  -------------------------------------------------
@@ -529,9 +643,14 @@ void menuItemSelection() {
 
 // enter a value using the rotary encoder
 //   pass Value title, starting value, step size, low limit , high limit
-//   returns the chosen value
-int enterValue(String title, int start, int stepSize, int low, int high) {
-  uint32_t tTimer = millis();                          // log time of start of function
+//   'done' is called with the chosen value
+
+void enterValue(String title, int start, int stepSize, int low, int high, widgetCallback done) {
+  widgetStart(widgetValue, OLEDDisplayTimeout * 1000, done);
+  widget.value = start;
+  widget.stepSize = stepSize;
+  widget.low = low;
+  widget.high = high;
   // display title
     display.clearDisplay();  
     if (title.length() > 8) display.setTextSize(1);  // if title is longer than 8 chars make text smaller
@@ -539,55 +658,22 @@ int enterValue(String title, int start, int stepSize, int low, int high) {
     display.setTextColor(WHITE);
     display.setCursor(0, 0);
     display.print(title);
-    display.display();                                  // update display
-  int tvalue = start;
-  while ( (digitalRead(encoder0Press) == LOW) && (millis() - tTimer < (OLEDDisplayTimeout * 1000)) ) delay(5);    // wait for button release
-  tTimer = millis();
-  while ( (digitalRead(encoder0Press) == HIGH) && (millis() - tTimer < (OLEDDisplayTimeout * 1000)) ) {   // while button is not pressed and still within time limit
-    if (encoderA.encoder0Pos >= itemTrigger) {                    // encoderA.encoder0Pos is updated via the interrupt procedure
-      tvalue -= stepSize;
-      noInterrupts();                                   // stop interrupt changing the value whilst it is changed here
-        encoderA.encoder0Pos -= itemTrigger;
-      interrupts();
-      tTimer = millis(); 
-    } 
-    else if (encoderA.encoder0Pos <= -itemTrigger) {
-      tvalue += stepSize;
-      noInterrupts();
-        encoderA.encoder0Pos += itemTrigger;
-      interrupts();
-      tTimer = millis();
-    }  
-    // value limits
-      if (tvalue > high) tvalue=high;              
-      if (tvalue < low) tvalue=low;
-    display.setTextSize(3);
-    const int textPos = 27;                             // height of number on display
-    display.fillRect(0, textPos, SCREEN_WIDTH, SCREEN_HEIGHT - textPos, BLACK);   // clear bottom half of display (128x64)
-    display.setCursor(0, textPos);
-    display.print(tvalue);
-    // bar graph at bottom of display
-      int tmag=map(tvalue, low, high, 0 ,SCREEN_WIDTH);
-      display.fillRect(0, SCREEN_HEIGHT - 10, tmag, 10, WHITE);  
-    display.display();                                  // update display
-    yield();                                            // service any web page requests
-  }
-  return tvalue;
+    oledRefresh();                                      // update display
 }
 
 //  --------------------------------------
         
         
 // choose from list using rotary encoder
-//  pass the number of items in list (max 8), list title, list of options in a string array
-
-int chooseFromList(byte noOfElements, String listTitle, String list[]) {
-
-  const byte noList = 10;                                // max number of items to list
-  uint32_t tTimer = millis();                            // log time of start of function
-  int highlightedItem = 0;                               // which item in list is highlighted
-  int xpos, ypos;
-  
+//  pass the number of items in list (max 10), list title, list of options in a string array
+//  'done' is called with the chosen item (0 if it timed out)
+
+void chooseFromList(byte noOfElements, String listTitle, String list[], widgetCallback done) {
+  widgetStart(widgetList, OLEDDisplayTimeout * 1000, done);
+  if (noOfElements > widgetListMax) noOfElements = widgetListMax;
+  widget.noOfElements = noOfElements;
+  for (int i=0; i < noOfElements; i++) widget.list[i] = list[i];     // keep a copy as the list may not exist after this returns
+  widget.value = 0;                                                     // which item in list is highlighted
   // display title
     display.clearDisplay();  
     display.setTextSize(1);
@@ -595,95 +681,244 @@ int chooseFromList(byte noOfElements, String listTitle, String list[]) {
     display.setCursor(10, 0);
     display.print(listTitle);
     display.drawLine(0, lineSpace1, display.width(), lineSpace1, WHITE);
+    oledRefresh();
+}
 
-  // scroll through list
-    while ( (digitalRead(encoder0Press) == LOW) && (millis() - tTimer < (OLEDDisplayTimeout * 1000)) ) delay(5);    // wait for button release
-    tTimer = millis();
-    while ( (digitalRead(encoder0Press) == HIGH) && (millis() - tTimer < (OLEDDisplayTimeout * 1000)) ) {   // while button is not pressed and still within time limit
-      if (encoderA.encoder0Pos >= itemTrigger) {                    // encoderA.encoder0Pos is updated via the interrupt procedure
-        noInterrupts();
-          encoderA.encoder0Pos = 0;
-        interrupts();
-        highlightedItem++;
-        tTimer = millis(); 
-      }
-      if (encoderA.encoder0Pos <= -itemTrigger) {
-        noInterrupts();
-          encoderA.encoder0Pos = 0;
-        interrupts();
-        highlightedItem--;
-        tTimer = millis();
-      }  
-      // value limits
-        if (highlightedItem > noOfElements - 1) highlightedItem = noOfElements - 1;        
-        if (highlightedItem < 0) highlightedItem = 0;
-      // display the list
-        for (int i=0; i < noOfElements; i++) {
-            if (i < (noList/2)) {
-              xpos = 0; 
-              ypos = (lineSpace1 * i+1) + topLine;
-            } else {
-              xpos = display.width() / 2;
-              ypos = lineSpace1 * (i-(noList/2)) + topLine;
-            }
-            display.setCursor(xpos, ypos);
-            if (i == highlightedItem) display.setTextColor(BLACK,WHITE);
-            else display.setTextColor(WHITE,BLACK);
-            display.print(list[i]);
-        }
-      display.display();                                    // update display
-      yield();                                              // service any web page requests
+
+//  --------------------------------------
+
+
+// start a widget (value entry, list, confirm or wait) - it takes over the display until it finishes
+
+void widgetStart(byte type, uint32_t timeout, widgetCallback done) {
+  widget.type = type;
+  widget.waitRelease = encoderA.pressed;          // ignore the rotary encoder until the button has been released
+  widget.timer = millis();
+  widget.timeout = timeout;
+  widget.done = done;
+  widget.redraw = 1;
+}
+
+
+// widget has finished - return to the menu and pass on the result
+
+void widgetFinish(int result) {
+  widgetCallback done = widget.done;
+  widget.type = widgetNone;
+  widget.done = nullptr;
+  menuChanged = 1;                                      // menu needs to be redrawn
+  if (done) done(result);                               // this may start another widget
+}
+
+
+// act on a rotary encoder event when a widget is active
+
+void widgetEvent(byte event) {
+
+  if (event == reRelease) {
+    widget.waitRelease = 0;                             // (before finishing as 'done' may start another widget)
+    if (widget.type == widgetConfirm) widgetFinish(0);  // button released before time was up
+    return;
+  }
+  if (event == reLongPress) {
+    if (widget.type == widgetConfirm) widgetFinish(1);  // button held long enough (even if it was pressed before the widget started)
+    return;
+  }
+  if (widget.waitRelease) return;                       // button not yet released since widget started
+
+  int step = 0;
+  if (event == reStepUp) step = 1;
+  if (event == reStepDown) step = -1;
+  if (step != 0) {
+    widget.timer = millis();
+    widget.redraw = 1;
+  }
+
+  switch (widget.type) {
+
+    // wait for key press or turn
+      case widgetWait:
+        if (event == rePress || step != 0) widgetFinish(0);
+        break;
+
+    // enter a value
+      case widgetValue:
+        widget.value -= step * widget.stepSize;
+        if (widget.value > widget.high) widget.value = widget.high;              
+        if (widget.value < widget.low) widget.value = widget.low;
+        if (event == rePress) widgetFinish(widget.value);
+        break;
+
+    // choose from list
+      case widgetList:
+        widget.value += step;
+        if (widget.value > widget.noOfElements - 1) widget.value = widget.noOfElements - 1;        
+        if (widget.value < 0) widget.value = 0;
+        if (event == rePress) widgetFinish(widget.value);
+        break;
+  }
+}
+
+
+// service the active widget (timeouts and display) - called from oledLoop(), never waits
+//   returns 1 if a widget is active
+
+bool widgetLoop() {
+
+  if (widget.type == widgetNone) return 0;
+
+  if ((uint32_t)(millis() - widget.timer) >= widget.timeout) {
+    if (widget.type == widgetConfirm) {                 // confirmed if the button is still held when the time is up
+      display.clearDisplay();  
+      oledRefresh();
+      widgetFinish(encoderA.pressed);
+    } 
+    else if (widget.type == widgetValue) widgetFinish(widget.value);
+    else widgetFinish(0);                               // list is set to cancel (i.e. item 0) if it timed out
+    return 1;
+  }
+
+  if (!widget.redraw) return 1;
+  widget.redraw = 0;
+
+  // enter a value
+    if (widget.type == widgetValue) {
+      display.setTextSize(3);
+      const int textPos = 27;                             // height of number on display
+      display.fillRect(0, textPos, SCREEN_WIDTH, SCREEN_HEIGHT - textPos, BLACK);   // clear bottom half of display (128x64)
+      display.setCursor(0, textPos);
+      display.print(widget.value);
+      // bar graph at bottom of display
+        int tmag=map(widget.value, widget.low, widget.high, 0 ,SCREEN_WIDTH);
+        display.fillRect(0, SCREEN_HEIGHT - 10, tmag, 10, WHITE);  
+      oledRefresh();                                      // update display
     }
-  
-  // if it timed out set selection to cancel (i.e. item 0)
-    if (millis() - tTimer >= (OLEDDisplayTimeout * 1000)) highlightedItem=0;      
 
-//  // wait for button to be released (up to 1 second)
-//    tTimer = millis();                         // log time
-//    while ( (digitalRead(encoder0Press) == LOW) && (millis() - tTimer < 1000) ) {
-//      yield();        // service any web page requests
-//      delay(20);
-//    }
+  // choose from list
+    if (widget.type == widgetList) {
+      int xpos, ypos;
+      for (int i=0; i < widget.noOfElements; i++) {
+          if (i < (widgetListMax/2)) {
+            xpos = 0; 
+            ypos = (lineSpace1 * i+1) + topLine;
+          } else {
+            xpos = display.width() / 2;
+            ypos = lineSpace1 * (i-(widgetListMax/2)) + topLine;
+          }
+          display.setCursor(xpos, ypos);
+          if (i == widget.value) display.setTextColor(BLACK,WHITE);
+          else display.setTextColor(WHITE,BLACK);
+          display.print(widget.list[i]);
+      }
+      oledRefresh();                                      // update display
+    }
 
-    return highlightedItem;
+  return 1;
 }
 
 
 // ----------------------------------------------
 
 
-// rotary encoder interrupt routine to update position counter when turned
+// rotary encoder interrupt routines
 //        interrupt info: https://www.gammon.com.au/forum/bbshowpost.php?id=11488
+//
+//   Events are only added to the queue by these and only taken from it by reGetEvent(), so the queue needs
+//   no locking (just the atomic head/tail positions) even when loop and the interrupts are on different cores.
 
-#if defined ESP32
-  void IRAM_ATTR doEncoder() {
-#else    // ESP8266
-  void ICACHE_RAM_ATTR doEncoder() {
-#endif
-     
-  bool pinA = digitalRead(encoder0PinA);
-  bool pinB = digitalRead(encoder0PinB);
-
-  if ( (encoderA.encoderPrevA == pinA && encoderA.encoderPrevB == pinB) ) return;  // no change since last time (i.e. reject bounce)
-
-  // same direction (alternating between 0,1 and 1,0 in one direction or 1,1 and 0,0 in the other direction)
-         if (encoderA.encoderPrevA == 1 && encoderA.encoderPrevB == 0 && pinA == 0 && pinB == 1) encoderA.encoder0Pos -= 1;
-    else if (encoderA.encoderPrevA == 0 && encoderA.encoderPrevB == 1 && pinA == 1 && pinB == 0) encoderA.encoder0Pos -= 1;
-    else if (encoderA.encoderPrevA == 0 && encoderA.encoderPrevB == 0 && pinA == 1 && pinB == 1) encoderA.encoder0Pos += 1;
-    else if (encoderA.encoderPrevA == 1 && encoderA.encoderPrevB == 1 && pinA == 0 && pinB == 0) encoderA.encoder0Pos += 1;
-    
-  // change of direction
-    else if (encoderA.encoderPrevA == 1 && encoderA.encoderPrevB == 0 && pinA == 0 && pinB == 0) encoderA.encoder0Pos += 1;   
-    else if (encoderA.encoderPrevA == 0 && encoderA.encoderPrevB == 1 && pinA == 1 && pinB == 1) encoderA.encoder0Pos += 1;
-    else if (encoderA.encoderPrevA == 0 && encoderA.encoderPrevB == 0 && pinA == 1 && pinB == 0) encoderA.encoder0Pos -= 1;
-    else if (encoderA.encoderPrevA == 1 && encoderA.encoderPrevB == 1 && pinA == 0 && pinB == 1) encoderA.encoder0Pos -= 1;
-
-    else if (serialDebug) Serial.println("Error: invalid rotary encoder pin state - prev=" + String(encoderA.encoderPrevA) + "," 
-                                          + String(encoderA.encoderPrevB) + " new=" + String(pinA) + "," + String(pinB));
-    
-  // update previous readings
-    encoderA.encoderPrevA = pinA;
-    encoderA.encoderPrevB = pinB;
+
+// add an event to the queue (if it is full the event is dropped and counted)
+
+void RE_IRAM reQueueEvent(byte event) {
+  uint8_t head = encoderA.head.load(std::memory_order_relaxed);
+  uint8_t next = (head + 1) & (reQueueSize - 1);
+  if (next == encoderA.tail.load(std::memory_order_acquire)) {
+    encoderA.dropped = encoderA.dropped + 1;
+    return;
+  }
+  encoderA.queue[head] = event;
+  encoderA.head.store(next, std::memory_order_release);
+}
+
+
+// either encoder pin has changed
+//   the previous and new pin states are looked up in 'reTable' which gives the direction moved
+//   (0 if no movement or if a state was skipped i.e. bounce/noise)
+
+void RE_IRAM doEncoder() {
+  uint8_t state = (digitalRead(encoder0PinA) << 1) | digitalRead(encoder0PinB);
+  int8_t change = reTable[(encoderA.state << 2) | state];
+  encoderA.state = state;
+  if (change == 0) return;
+  int8_t count = encoderA.count + change;
+  if (count >= itemTrigger) {
+    count -= itemTrigger;
+    reQueueEvent(reStepUp);
+  } else if (count <= -itemTrigger) {
+    count += itemTrigger;
+    reQueueEvent(reStepDown);
+  }
+  encoderA.count = count;
+}
+
+
+// button pin has changed
+//   a change is ignored if it is too soon after the last one (i.e. switch bounce)
+
+void RE_IRAM doButton() {
+  bool pressed = (digitalRead(encoder0Press) == LOW);
+  if (pressed == encoderA.buttonPressed) return;
+  uint32_t now = millis();
+  if ((uint32_t)(now - encoderA.buttonTimer) < reDebounceTime) return;
+  encoderA.buttonPressed = pressed;
+  encoderA.buttonTimer = now;
+  reQueueEvent(pressed ? rePress : reRelease);
+}
+
+
+// the button state has been reported
+
+void rePressReported(bool pressed) {
+  encoderA.pressed = pressed;
+  encoderA.pressedTimer = millis();
+  encoderA.longPressSent = 0;
+}
+
+
+// get the next rotary encoder event (reNone if there are none waiting)
+
+byte reGetEvent() {
+
+  // next event in queue (a press or release which does not change what has been reported is skipped)
+    uint8_t tail = encoderA.tail.load(std::memory_order_relaxed);
+    while (tail != encoderA.head.load(std::memory_order_acquire)) {
+      byte event = encoderA.queue[tail];
+      tail = (tail + 1) & (reQueueSize - 1);
+      encoderA.tail.store(tail, std::memory_order_release);
+      if (event == rePress || event == reRelease) {
+        if ((event == rePress) == encoderA.pressed) continue;
+        rePressReported(event == rePress);
+      }
+      return event;
+    }
+
+  // a button change the interrupt ignored (e.g. released again within the debounce time)
+  //   returned from here rather than queued as only the interrupts add to the queue
+    bool pressed = (digitalRead(encoder0Press) == LOW);
+    uint32_t now = millis();
+    if (pressed != encoderA.pressed && (uint32_t)(now - encoderA.buttonTimer) >= reDebounceTime
+                                    && (uint32_t)(now - encoderA.pressedTimer) >= reDebounceTime) {
+      rePressReported(pressed);
+      return pressed ? rePress : reRelease;
+    }
+
+  // button has been held down for a while
+    if (encoderA.pressed && !encoderA.longPressSent && (uint32_t)(now - encoderA.pressedTimer) >= reLongPressTime) {
+      encoderA.longPressSent = 1;
+      return reLongPress;
+    }
+
+  return reNone;
 }
 
 
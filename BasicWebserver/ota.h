@@ -18,18 +18,113 @@
     Activate OTA with   http://<esp ip address>?pwd=12345678
     Then access with    http://<esp ip address>/ota
 
+    Delta updates:  rather than the full firmware a patch can be uploaded which only contains the differences 
+                    between the currently running firmware and the new one (see misc/otadelta.py to create them).
+                    The patch is applied as it arrives, reading the old firmware from flash and writing the new one
+                    through the Update library, so only a small fixed buffer is used.  If the patch was not made
+                    from the firmware which is running it is rejected and the full image needs to be uploaded instead.
+                    (misc/hosttest/delta_test.cpp applies patches made by otadelta.py, in pieces of every size)
+
+    Patch format (all numbers little endian):
+        header:   "BWSDELT1", old image size (4 bytes), new image size (4), md5 of old image (16), md5 of new image (16)
+        then a list of operations, each an opcode byte followed by a length (varint):
+            1 = COPY    copy <length> bytes from the old image
+            2 = ADD     <length> data bytes follow, each is added to the next byte of the old image
+            3 = INSERT  <length> data bytes follow which are written as they are
+            4 = SEEK    move position in old image by <length> (zigzag encoded so it can be negative)
+            0 = END     (no length)
+
+    Pull updates:   if 'OTAServer' is set in the main sketch the device checks a manifest on that server 
+                    every few hours (or when /otapull is requested) and if it lists a different version
+                    downloads the firmware in chunks using http range requests.  If the connection drops
+                    the download carries on from the last data written once the server can be reached again.
+                    Any web server which supports range requests will do (e.g. python3 -m http.server).
+                    The reply is read from loop as it arrives so the sketch carries on while downloading.
+                    (misc/hosttest/otapull_test.cpp tries this against a server which keeps dropping the connection)
+    
+    Manifest format (text file):
+            version=23Jan21
+            size=412345
+            md5=<md5 of the .bin file>
+            image=/BasicWebServer.bin
+
  
  **************************************************************************************************/
 
 
 #if defined ESP32
   #include <Update.h>
+  #include <esp_ota_ops.h>
 #endif
  
 
 // forward declarations (i.e. details of all functions in this file)
   void otaSetup();
   void handleOTA();
+  void deltaBegin();
+  void deltaWrite(uint8_t*, size_t);
+  void deltaEnd();
+  void deltaFail(const char*);
+  void otaDiscard();
+  void otaPullLoop();
+  void handleOTAPull();
+
+
+// delta update
+  const char deltaMagic[] = "BWSDELT1";
+  const uint16_t deltaHeaderSize = 48;        // size of patch header
+  const uint16_t deltaBufSize = 256;          // size of buffer used when reading old firmware from flash
+  enum deltaStages { deltaHeader, deltaOpcode, deltaLength, deltaData, deltaFinished, deltaFailed };
+  enum deltaOpcodes { deltaEND, deltaCOPY, deltaADD, deltaINSERT, deltaSEEK };
+
+  struct DeltaPatch {
+    byte stage = deltaFailed;                 // what is expected next in the patch
+    byte opcode = deltaEND;                   // operation being processed
+    uint8_t header[deltaHeaderSize];          // patch header as it arrives
+    uint16_t headerCount = 0;                 // bytes of header received so far
+    uint32_t value = 0;                       // length being decoded (varint)
+    byte shift = 0;
+    uint32_t remaining = 0;                   // data bytes left in current ADD/INSERT operation
+    uint32_t oldPos = 0;                      // current read position in the running firmware
+    uint32_t oldSize = 0;                     // size of the running firmware
+    uint32_t newPos = 0;                      // bytes written to the update so far
+    uint32_t newSize = 0;                     // size of the new firmware
+    const char* error = "";                   // reason the update failed
+  };
+  DeltaPatch delta;
+  uint8_t deltaBuf[deltaBufSize];             // old firmware data
+
+
+// pull updates
+  const uint32_t OTAPullCheckPeriod = 6UL * 60 * 60 * 1000;   // how often to check the update server for new firmware (ms)
+  const uint16_t OTAPullChunkSize = 8192;                     // bytes requested at a time
+  const byte OTAPullMaxRetries = 20;                          // give up on the download after this many failed attempts in a row
+  const uint16_t OTAPullTimeout = 3000;                       // max time to wait for data from the update server (ms)
+  enum pullStages { pullIdle, pullChecking, pullDownloading };
+  enum pullReplyParts { pullStatus, pullHeaders, pullBody };
+
+  struct OtaPull {
+    byte stage = pullIdle;
+    bool checkNow = 1;                        // check for new firmware at the next opportunity
+    uint32_t timer = millis();                // time of last check / attempt
+    uint32_t retryDelay = 0;                  // wait before next attempt (ms)
+    byte retries = 0;                         // failed attempts in a row
+    uint32_t size = 0;                        // size of new firmware
+    String version;                           // version being downloaded
+    String image;                             // path of new firmware on update server
+    String md5;                               // md5 of new firmware
+    // request in progress
+    WiFiClient client;
+    bool active = 0;                          // a reply is being received
+    byte part = pullStatus;                   // which part of the reply is expected next
+    int status = 0;                           // http status code of the reply
+    uint32_t to = 0;                          // last byte of the firmware requested
+    uint32_t skip = 0;                        // bytes to discard (server ignored the range requested)
+    uint32_t lastData = 0;                    // millis() when data last arrived
+    char line[96];                            // status / header / manifest line being received
+    byte lineLen = 0;
+  };
+  OtaPull otaPull;
 
 
 // ----------------------------------------------------------------
@@ -40,7 +135,8 @@
 
 void otaSetup() {
 
-    server.on("/ota", handleOTA);
+    routeOn("/ota", handleOTA);
+    routeOn("/otapull", handleOTAPull);
 
     // esp32 version (using webserver.h)
     #if defined ESP32
@@ -107,6 +203,32 @@ void otaSetup() {
         });
     #endif
 
+    // delta (patch) update - same for both boards
+    server.on("/delta", HTTP_POST, []() {
+      server.sendHeader("Connection", "close");
+      if (delta.stage == deltaFinished && !Update.hasError()) {
+        server.send(200, "text/plain", "Delta update complete, device is rebooting...");
+        delay(500);
+        ESP.restart();
+        delay(2000);
+      } else {
+        server.send(200, "text/plain", "Delta update failed: " + String(delta.error) + "\nUpload the full firmware image via /ota instead");
+      }
+    }, []() {
+      HTTPUpload& upload = server.upload();
+      if (upload.status == UPLOAD_FILE_START) {
+        if (serialDebug) Serial.printf("Delta update: %s\n", upload.filename.c_str());
+        deltaBegin();
+      } else if (upload.status == UPLOAD_FILE_WRITE) {
+        deltaWrite(upload.buf, upload.currentSize);
+      } else if (upload.status == UPLOAD_FILE_END) {
+        deltaEnd();
+      } else {
+        deltaFail("upload aborted");
+      }
+      yield();
+    });
+
 }
 
 
@@ -114,12 +236,7 @@ void otaSetup() {
 
 void handleOTA(){
 
-  WiFiClient client = server.client();          // open link with client
-
-  // log page request including clients IP address
-      IPAddress cip = client.remoteIP();
-      //log_system_message("OTA web page requested from: " + String(cip[0]) + "." + String(cip[1]) + "." + String(cip[2]) + "." + String(cip[3]));
-
+  MeteredClient client = server.client();          // open link with client
 
   // Send page html
 
@@ -132,6 +249,18 @@ void handleOTA(){
     client.write("<input type='file' style='width: 300px' name='update'>\n");
     client.write("<br><br><input type='submit' value='Update'></form><br>\n");
   
+    client.write("<br><br><H1>Delta update</H1><br>\n");
+    client.printf("Running firmware md5 =  %s \n\n", ESP.getSketchMD5().c_str());
+    client.write("<form method='POST' action='/delta' enctype='multipart/form-data'>\n");
+    client.write("<input type='file' style='width: 300px' name='delta'>\n");
+    client.write("<br><br><input type='submit' value='Apply patch'></form><br>\n");
+
+    if (OTAServer[0] != 0) {
+      client.write("<br><br><H1>Pull update</H1><br>\n");
+      if (otaPull.stage == pullDownloading) client.printf("Downloading %s: %u of %u bytes<br>\n", otaPull.version.c_str(), Update.progress(), otaPull.size);
+      client.printf("<a href='/otapull'>Check update server %s now</a><br>\n", OTAServer);
+    }
+
     client.write("<br><br>Device will reboot when upload complete");
     client.printf("%s <br>To disable OTA restart device<br> %s \n", colRed, colEnd);
 
@@ -145,4 +274,505 @@ void handleOTA(){
 }
 
 
+// ----------------------------------------------------------------
+//                  -Delta (patch) update procedures
+// ----------------------------------------------------------------
+
+// read bytes from the currently running firmware
+
+bool deltaReadOld(uint32_t pos, uint8_t* buf, size_t len) {
+
+  if (pos + len > delta.oldSize) return 0;                       // past end of old firmware
+
+  #if defined ESP32
+    return esp_partition_read(esp_ota_get_running_partition(), pos, buf, len) == ESP_OK;
+  #else    // ESP8266 - sketch starts at flash address 0 and flashRead() needs 4 byte alignment
+    static uint32_t words[deltaBufSize / 4 + 2];
+    uint32_t start = pos & ~3UL;
+    uint32_t bytes = ((pos + len + 3) & ~3UL) - start;
+    if (!ESP.flashRead(start, words, bytes)) return 0;
+    memcpy(buf, (uint8_t*)words + (pos - start), len);
+    return 1;
+  #endif
+}
+
+
+// pass new firmware data to the Update library
+
+bool deltaOutput(uint8_t* buf, size_t len) {
+  if (delta.newPos + len > delta.newSize) {
+    deltaFail("patch produces more data than expected");
+    return 0;
+  }
+  if (Update.write(buf, len) != len) {
+    if (serialDebug) Update.printError(Serial);
+    deltaFail("error writing to flash");
+    return 0;
+  }
+  delta.newPos += len;
+  return 1;
+}
+
+
+// upload of patch has started
+
+void deltaBegin() {
+  delta = DeltaPatch();
+  delta.stage = deltaHeader;
+  #if defined ESP8266
+    WiFiUDP::stopAll();
+  #endif
+}
+
+
+// header has been received - check it matches the running firmware and start the update
+
+void deltaStart() {
+
+  uint8_t* h = delta.header;
+  if (memcmp(h, deltaMagic, 8) != 0) {
+    deltaFail("not a delta patch file");
+    return;
+  }
+  delta.oldSize = h[8] | (h[9] << 8) | (h[10] << 16) | ((uint32_t)h[11] << 24);
+  delta.newSize = h[12] | (h[13] << 8) | (h[14] << 16) | ((uint32_t)h[15] << 24);
+
+  // convert the md5 checksums to text
+    char oldMD5[33], newMD5[33];
+    for (int i=0; i < 16; i++) {
+      sprintf(&oldMD5[i * 2], "%02x", h[16 + i]);
+      sprintf(&newMD5[i * 2], "%02x", h[32 + i]);
+    }
+
+  // patch must have been created from the firmware which is running
+    if (delta.oldSize != ESP.getSketchSize() || ESP.getSketchMD5() != oldMD5) {
+      deltaFail("patch was not made from the running firmware");
+      return;
+    }
+
+  if (!Update.begin(delta.newSize)) {
+    if (serialDebug) Update.printError(Serial);
+    deltaFail("not enough space for new firmware");
+    return;
+  }
+  Update.setMD5(newMD5);                     // new firmware is checked against this when complete
+  if (serialDebug) Serial.printf("Delta update: %u -> %u bytes\n", delta.oldSize, delta.newSize);
+  delta.stage = deltaOpcode;
+}
+
+
+// an operation and its length have been received
+
+void deltaOperation() {
+
+  uint32_t len = delta.value;
+
+  if (delta.opcode == deltaSEEK) {
+    int32_t offset = (len >> 1) ^ -(int32_t)(len & 1);         // zigzag decode
+    if ((int32_t)delta.oldPos + offset < 0 || delta.oldPos + offset > delta.oldSize) {
+      deltaFail("seek outside old firmware");
+      return;
+    }
+    delta.oldPos += offset;
+    delta.stage = deltaOpcode;
+    return;
+  }
+
+  if (delta.opcode == deltaCOPY) {
+    while (len > 0) {
+      uint16_t n = (len > deltaBufSize) ? deltaBufSize : len;
+      if (!deltaReadOld(delta.oldPos, deltaBuf, n)) {
+        deltaFail("copy outside old firmware");
+        return;
+      }
+      if (!deltaOutput(deltaBuf, n)) return;
+      delta.oldPos += n;
+      len -= n;
+      yield();
+    }
+    delta.stage = deltaOpcode;
+    return;
+  }
+
+  // ADD or INSERT - data follows
+    delta.remaining = len;
+    delta.stage = (len > 0) ? deltaData : deltaOpcode;
+}
+
+
+// a block of the patch has been received
+
+void deltaWrite(uint8_t* data, size_t len) {
+
+  size_t i = 0;
+  while (i < len) {
+    switch (delta.stage) {
+
+      case deltaHeader:
+        delta.header[delta.headerCount++] = data[i++];
+        if (delta.headerCount == deltaHeaderSize) deltaStart();
+        break;
+
+      case deltaOpcode:
+        delta.opcode = data[i++];
+        delta.value = 0;
+        delta.shift = 0;
+        if (delta.opcode == deltaEND) delta.stage = deltaFinished;
+        else if (delta.opcode <= deltaSEEK) delta.stage = deltaLength;
+        else deltaFail("invalid operation in patch");
+        break;
+
+      case deltaLength: {
+        uint8_t b = data[i++];
+        delta.value |= (uint32_t)(b & 0x7F) << delta.shift;
+        delta.shift += 7;
+        if (!(b & 0x80)) deltaOperation();
+        else if (delta.shift > 28) deltaFail("invalid length in patch");
+        break;
+      }
+
+      case deltaData: {
+        uint16_t n = deltaBufSize;
+        if (n > delta.remaining) n = delta.remaining;
+        if (n > len - i) n = len - i;
+        if (delta.opcode == deltaADD) {
+          if (!deltaReadOld(delta.oldPos, deltaBuf, n)) {
+            deltaFail("add outside old firmware");
+            return;
+          }
+          for (int j=0; j < n; j++) deltaBuf[j] += data[i + j];
+          delta.oldPos += n;
+        } else {
+          memcpy(deltaBuf, &data[i], n);
+        }
+        if (!deltaOutput(deltaBuf, n)) return;
+        i += n;
+        delta.remaining -= n;
+        if (delta.remaining == 0) delta.stage = deltaOpcode;
+        break;
+      }
+
+      default:        // finished or failed - ignore anything else
+        return;
+    }
+  }
+}
+
+
+// upload of patch has finished
+
+void deltaEnd() {
+  if (delta.stage == deltaFailed) return;
+  if (delta.stage != deltaFinished || delta.newPos != delta.newSize) {
+    deltaFail("patch is incomplete");
+    return;
+  }
+  if (!Update.end()) {
+    if (serialDebug) Update.printError(Serial);
+    deltaFail("new firmware failed verification");
+    return;
+  }
+  log_system_message("Delta update applied: %u bytes", delta.newSize);
+}
+
+
+// delta update has failed - cancel update
+
+void deltaFail(const char* reason) {
+  if (delta.stage == deltaFailed) return;
+  delta.stage = deltaFailed;
+  delta.error = reason;
+  otaDiscard();
+  logMessage(logError, "Delta update failed: %s", reason);
+}
+
+
+// cancel an update which has been started (the partial firmware is discarded)
+
+void otaDiscard() {
+  #if defined ESP32
+    Update.abort();
+  #else
+    Update.end();                // (fails as the update is incomplete, which discards it)
+  #endif
+}
+
+
+// ----------------------------------------------------------------
+//                     -Pull update procedures
+// ----------------------------------------------------------------
+
+// only one request to the update server is in progress at a time and its reply is read from loop
+// as it arrives (only what is already waiting each time) so the sketch is not held up waiting for it
+// Note: connecting still waits (briefly on a local network) as with coroFetch (coro.h)
+
+// send a request to the update server, optionally for only part of the file (from - to)
+//    returns 0 if unable to connect
+
+bool otaPullRequest(const String &path, bool range, uint32_t from, uint32_t to) {
+
+  WiFiClient &client = otaPull.client;
+  if (!client.connect(OTAServer, OTAServerPort)) return 0;
+
+  client.print("GET " + path + " HTTP/1.1\r\nHost: " + String(OTAServer) + "\r\n");
+  if (range) client.printf("Range: bytes=%u-%u\r\n", from, to);
+  client.print("Connection: close\r\n\r\n");
+
+  otaPull.active = 1;
+  otaPull.part = pullStatus;
+  otaPull.status = 0;
+  otaPull.to = to;
+  otaPull.skip = 0;
+  otaPull.lineLen = 0;
+  otaPull.lastData = millis();
+  return 1;
+}
+
+
+// add a character of the reply to the line being received, returns 1 when the line is complete
+
+bool otaPullLine(char c) {
+  if (c == '\n') {
+    otaPull.line[otaPull.lineLen] = 0;
+    otaPull.lineLen = 0;
+    return 1;
+  }
+  if (c != '\r' && otaPull.lineLen < sizeof(otaPull.line) - 1) otaPull.line[otaPull.lineLen++] = c;
+  return 0;
+}
+
+
+// download attempt failed - wait and try again unless it keeps failing
+
+void otaPullRetry(const char* reason) {
+  otaPull.retries++;
+  otaPull.timer = millis();
+  if (serialDebug) Serial.printf("OTA pull: %s at %u bytes (attempt %d)\n", reason, Update.progress(), otaPull.retries);
+  if (otaPull.retries >= OTAPullMaxRetries) {
+    Update.end();                                     // discard partial update
+    otaPull.stage = pullIdle;
+    logMessage(logError, "OTA pull: download of %s abandoned - %s", otaPull.version.c_str(), reason);
+    return;
+  }
+  otaPull.retryDelay = 2000UL * otaPull.retries;      // back off a bit more each time
+}
+
+
+// the request failed (no reply, unexpected reply or the connection was lost)
+
+void otaPullFailed(const char* reason) {
+  otaPull.client.stop();
+  otaPull.active = 0;
+  if (otaPull.stage == pullDownloading) {
+    otaPullRetry(reason);
+    return;
+  }
+  otaPull.stage = pullIdle;
+  if (serialDebug) Serial.printf("OTA pull: unable to read manifest from update server - %s\n", reason);
+}
+
+
+// a line of the status / headers has arrived, returns 0 if the reply is not what was wanted
+
+bool otaPullHeader() {
+
+  // status line e.g. "HTTP/1.1 206 Partial Content"
+    if (otaPull.part == pullStatus) {
+      if (strncmp(otaPull.line, "HTTP/", 5) == 0 && strlen(otaPull.line) >= 12) otaPull.status = atoi(otaPull.line + 9);
+      otaPull.part = pullHeaders;
+      return 1;
+    }
+
+  if (otaPull.line[0] != 0) return 1;                 // (none of the headers are needed)
+
+  // blank line = end of headers
+    otaPull.part = pullBody;
+    if (otaPull.stage == pullChecking && otaPull.status == 200) return 1;
+    if (otaPull.stage == pullDownloading && otaPull.status == 206) return 1;
+    if (otaPull.stage == pullDownloading && otaPull.status == 200) {
+      otaPull.skip = Update.progress();               // server ignored the range so skip what we already have
+      return 1;
+    }
+    otaPullFailed(otaPull.status ? "unexpected reply from server" : "no reply from server");
+    return 0;
+}
+
+
+// start reading the manifest on the update server
+
+void otaPullCheck() {
+  otaPull.version = "";
+  otaPull.image = "";
+  otaPull.md5 = "";
+  otaPull.size = 0;
+  otaPull.stage = pullChecking;
+  if (!otaPullRequest(OTAManifest, 0, 0, 0)) otaPullFailed("unable to connect");
+}
+
+
+// a line of the manifest has arrived
+
+void otaPullManifestLine() {
+  const char* line = otaPull.line;
+  if (strncmp(line, "version=", 8) == 0) otaPull.version = line + 8;
+  if (strncmp(line, "size=", 5) == 0) otaPull.size = strtoul(line + 5, nullptr, 10);
+  if (strncmp(line, "md5=", 4) == 0) otaPull.md5 = line + 4;
+  if (strncmp(line, "image=", 6) == 0) otaPull.image = line + 6;
+}
+
+
+// the whole manifest has arrived, start downloading if it is a different version
+
+void otaPullManifestEnd() {
+
+  if (otaPull.lineLen > 0) {                          // last line had no new line on the end
+    otaPull.line[otaPull.lineLen] = 0;
+    otaPullManifestLine();
+  }
+  otaPull.client.stop();
+  otaPull.active = 0;
+  otaPull.stage = pullIdle;
+
+  otaPull.version.trim();
+  otaPull.image.trim();
+  otaPull.md5.trim();
+  if (otaPull.version == "" || otaPull.version == sversion || otaPull.size == 0 || otaPull.image == "") return;     // nothing new
+
+  if (!Update.begin(otaPull.size)) {
+    if (serialDebug) Update.printError(Serial);
+    logMessage(logError, "OTA pull: not enough space for version %s", otaPull.version.c_str());
+    return;
+  }
+  if (otaPull.md5.length() == 32) Update.setMD5(otaPull.md5.c_str());
+
+  otaPull.stage = pullDownloading;
+  otaPull.retries = 0;
+  otaPull.retryDelay = 0;
+  log_system_message("OTA pull: downloading version %s", otaPull.version.c_str());
+}
+
+
+// request the next chunk of the new firmware
+//   data is written to the update as it arrives so after a dropped connection the 
+//   next request carries on from Update.progress()
+
+void otaPullChunk() {
+  uint32_t from = Update.progress();
+  uint32_t to = from + OTAPullChunkSize - 1;
+  if (to >= otaPull.size) to = otaPull.size - 1;
+  if (!otaPullRequest(otaPull.image, 1, from, to)) otaPullRetry("unable to connect");
+}
+
+
+// the chunk requested has all arrived
+
+void otaPullChunkEnd() {
+
+  otaPull.client.stop();
+  otaPull.active = 0;
+  otaPull.retries = 0;
+  otaPull.retryDelay = 0;
+
+  // download complete
+    if (Update.progress() >= otaPull.size) {
+      otaPull.stage = pullIdle;
+      if (!Update.end()) {
+        if (serialDebug) Update.printError(Serial);
+        logMessage(logError, "OTA pull: new firmware failed verification");
+        return;
+      }
+      log_system_message("OTA pull: version %s installed, rebooting", otaPull.version.c_str());
+      delay(500);
+      ESP.restart();
+      delay(2000);
+    }
+}
+
+
+// read what has arrived of the reply (called from loop)
+
+void otaPullReceive() {
+
+  WiFiClient &client = otaPull.client;
+  int avail = client.available();
+  if (avail <= 0) {
+    bool closed = !client.connected();
+    if (!closed && (uint32_t)(millis() - otaPull.lastData) < OTAPullTimeout) return;       // still waiting
+    if (closed && otaPull.stage == pullChecking && otaPull.part == pullBody) otaPullManifestEnd();
+    else otaPullFailed(closed ? "connection lost" : "timed out");
+    return;
+  }
+  otaPull.lastData = millis();
+
+  // status line and headers
+    while (otaPull.part != pullBody && avail > 0) {
+      avail--;
+      if (otaPullLine(client.read()) && !otaPullHeader()) return;
+    }
+
+  // manifest (ends when the server closes the connection)
+    if (otaPull.stage == pullChecking) {
+      for (; avail > 0; avail--) {
+        if (otaPullLine(client.read())) otaPullManifestLine();
+      }
+      return;
+    }
+
+  // firmware (a buffer full each time so loop is not held up for long)
+    if (avail <= 0) return;
+    uint8_t buf[512];
+    uint32_t want = (otaPull.skip > 0) ? otaPull.skip : otaPull.to + 1 - Update.progress();
+    if (want > sizeof(buf)) want = sizeof(buf);
+    if ((uint32_t)avail < want) want = avail;
+    int n = client.read(buf, want);
+    if (n <= 0) return;
+    if (otaPull.skip > 0) {
+      otaPull.skip -= n;
+      return;
+    }
+    if (Update.write(buf, n) != (size_t)n) {
+      if (serialDebug) Update.printError(Serial);
+      otaPullFailed("error writing to flash");
+      return;
+    }
+    if (Update.progress() > otaPull.to) otaPullChunkEnd();
+}
+
+
+// called from loop - check for new firmware and continue any download in progress
+
+void otaPullLoop() {
+
+  if (otaPull.active) {
+    otaPullReceive();
+    return;
+  }
+
+  if (OTAServer[0] == 0 || !wifiok) return;                  // pull updates disabled or no network
+
+  if (otaPull.stage == pullIdle) {
+    if (Update.isRunning()) return;                          // an uploaded update is in progress
+    if (!otaPull.checkNow && (unsigned long)(millis() - otaPull.timer) < OTAPullCheckPeriod) return;
+    otaPull.checkNow = 0;
+    otaPull.timer = millis();
+    otaPullCheck();
+    return;
+  }
+
+  if ((unsigned long)(millis() - otaPull.timer) < otaPull.retryDelay) return;
+  otaPull.timer = millis();
+  otaPullChunk();
+}
+
+
+// -----------------------------------------------------------------------
+
+// request to check the update server now     i.e. http://x.x.x.x/otapull
+
+void handleOTAPull() {
+  otaPull.checkNow = 1;
+  server.send(200, "text/plain", (otaPull.stage == pullDownloading) ? "Download already in progress" : "Checking update server for new firmware");
+}
+
+
 // ---------------------------------------------- end ----------------------------------------------
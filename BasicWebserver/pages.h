@@ -0,0 +1,243 @@
+/**************************************************************************************************
+ *
+ *      Web page templates and static files - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Created by misc/templates.py from the files in the templates and assets folders - do not
+ *      edit this file, change those files and run  python3 misc/templates.py  instead.
+ *
+ **************************************************************************************************/
+
+
+// forward declarations (i.e. details of all functions in this file)
+  void render_data(Print &out, const char* timeNow, bool ota);
+  void render_footer(Print &out, const char* title, const char* version, int memory, int rssi, const char* ntp, const char* gsm);
+  void render_header(Print &out, bool autoRefresh, int refresh, const char* title, const char* style, const char* home);
+  void render_root(Print &out, const char* home, const char* board, const char* javaRefresh, const char* dataRefresh);
+
+
+// ----------------------------------------------------------------
+//                 -static files (see assets.h)
+// ----------------------------------------------------------------
+
+  struct AssetFile {
+    const char* name;
+    const char* type;                       // content type
+    const char* etag;                       // hash of the contents (in quotes)
+    PGM_P data;                             // minified file
+    size_t len;
+    const uint8_t* gz;                      // gzipped (nullptr if it would not be any smaller)
+    size_t gzLen;
+  };
+
+  const char asset_root_js[] PROGMEM = "var frame = document.getElementById('dataframe');\nsetTimeout(function() {frame.src='/data';}, frame.dataset.first);\nwindow.setInterval(function() {frame.src='/data';}, frame.dataset.every);";
+  const uint8_t asset_root_js_gz[] PROGMEM = {
+    0x1f,0x8b,0x08,0x00,0x00,0x00,0x00,0x00,0x02,0x03,0x95,0x8c,0x3b,0x0a,0x03,0x21,0x10,0x86,0xfb,0x9c,
+    0xc2,0x4e,0x85,0x60,0x0e,0x20,0xdb,0x04,0x52,0x6c,0x9f,0x0b,0x0c,0x3a,0x06,0x61,0x55,0x18,0x47,0x97,
+    0x25,0xe4,0xee,0xd1,0xcd,0x09,0xd2,0xfd,0xcf,0xaf,0x03,0x89,0x40,0x90,0x50,0x2c,0xc2,0x17,0xd7,0x12,
+    0x66,0x36,0x2f,0xe4,0xc7,0x86,0x53,0xde,0x8f,0xd5,0x2b,0xe9,0x81,0xe1,0x1c,0x49,0x6d,0x2f,0x15,0xf9,
+    0x19,0x13,0x96,0xc6,0x2a,0xb4,0xec,0x38,0x96,0xac,0xb4,0x78,0x9f,0xbd,0xa9,0xe4,0x16,0x79,0x9b,0x7b,
+    0x69,0x3f,0xd7,0x1f,0xd9,0x4c,0x3b,0x5e,0x26,0x44,0xaa,0x3c,0x08,0x7b,0xcc,0xbe,0xec,0x66,0x44,0x6b,
+    0x66,0xa4,0x0e,0xdb,0xbf,0x24,0xec,0x48,0x87,0xb6,0x5f,0x24,0x9f,0x26,0x57,0xbd,0x00,0x00,0x00,
+  };
+  const char asset_style_css[] PROGMEM = "ul{list-style-type:none;margin:0;padding:0;overflow:hidden;background-color:rgb(128,64,0)}li{float:left}li a{display:inline-block;color:white;text-align:center;padding:30px 20px;text-decoration:none}li a:hover{background-color:rgb(100,0,0)}";
+  const uint8_t asset_style_css_gz[] PROGMEM = {
+    0x1f,0x8b,0x08,0x00,0x00,0x00,0x00,0x00,0x02,0x03,0x6d,0x8e,0x51,0x0b,0xc2,0x30,0x0c,0x84,0xff,0x8a,
+    0x8f,0x0a,0x2b,0xd4,0x29,0x22,0xed,0xaf,0xe9,0xda,0xd8,0x05,0x63,0x32,0xba,0xcc,0x39,0x86,0xff,0xdd,
+    0x6d,0x82,0x4f,0xbe,0x1c,0x77,0x70,0x97,0x7c,0x03,0xcd,0x84,0xbd,0x9a,0x5e,0x27,0x02,0xa3,0x53,0x07,
+    0x8e,0x85,0xc1,0x3f,0x42,0xc9,0xc8,0xce,0xfa,0x2e,0xa4,0x84,0x9c,0x17,0x27,0x4f,0x28,0x37,0x92,0xd1,
+    0xb5,0x98,0x12,0xb0,0x6f,0x42,0xbc,0xe7,0x22,0x03,0x27,0x13,0x85,0xa4,0xb8,0x92,0x9b,0xfd,0xb1,0xbe,
+    0x56,0x97,0x73,0x65,0x0f,0x6f,0xc2,0x79,0x69,0x07,0x75,0x04,0x37,0x5d,0xd2,0x2e,0xcc,0x09,0xfb,0x8e,
+    0xc2,0xe4,0x90,0x09,0x19,0x4c,0x43,0x12,0xef,0xfe,0xbb,0x1d,0x5b,0x54,0xf0,0x0a,0x2f,0x35,0x81,0x30,
+    0xb3,0x8b,0xc0,0x0a,0xe5,0xf7,0xfe,0x64,0xbb,0xd7,0xae,0x5e,0xe4,0xdb,0x49,0x10,0xa5,0x04,0x45,0xe1,
+    0x0d,0x77,0x3b,0xef,0xda,0x95,0x70,0xfe,0x8f,0x65,0x6d,0x65,0x57,0xaa,0x0f,0x40,0xb6,0x2e,0x40,0xf0,
+    0x00,0x00,0x00,
+  };
+
+  const AssetFile assetFiles[] = {
+    { "root.js", "application/javascript", "\"3ccad8ce\"", asset_root_js, sizeof(asset_root_js) - 1, asset_root_js_gz, sizeof(asset_root_js_gz) },       // 189 bytes, 139 gzipped
+    { "style.css", "text/css", "\"52210849\"", asset_style_css, sizeof(asset_style_css) - 1, asset_style_css_gz, sizeof(asset_style_css_gz) },       // 240 bytes, 183 gzipped
+  };
+
+
+// ----------------------------------------------------------------
+//          -send text stored in flash in small pieces
+// ----------------------------------------------------------------
+
+void pageWrite_P(Print &out, PGM_P text, size_t len) {
+  char buf[128];
+  while (len > 0) {
+    size_t n = (len > sizeof(buf)) ? sizeof(buf) : len;
+    memcpy_P(buf, text, n);
+    out.write((const uint8_t*)buf, n);
+    text += n;
+    len -= n;
+  }
+}
+
+// fixed text of a page, the compressed copy is sent if the page is being gzipped (see gzip.h)
+void pageText(Print &out, PGM_P text, size_t len, const uint8_t* z, size_t zLen) {
+  if (&out == pageGzip) pageGzip->writeDeflated(text, len, z, zLen);
+  else pageWrite_P(out, text, len);
+}
+
+
+// ----------------------------------------------------------------
+//                          -data.html
+// ----------------------------------------------------------------
+
+  const char page_data_0[] PROGMEM = "<!DOCTYPE HTML>\n<html lang='en'><head><title>data</title></head><body>\n<br>Auto refreshing information goes here\n<br>";
+  const uint8_t page_data_0_z[] PROGMEM = {
+    0xb2,0x51,0x74,0xf1,0x77,0x0e,0x89,0x0c,0x70,0x55,0xf0,0x08,0xf1,0xf5,0xb1,0xe3,0xb2,0xc9,0x28,0xc9,
+    0xcd,0x51,0xc8,0x49,0xcc,0x4b,0xb7,0x55,0x4f,0xcd,0x53,0xb7,0xb3,0xc9,0x48,0x4d,0x4c,0xb1,0xb3,0x29,
+    0xc9,0x2c,0xc9,0x49,0xb5,0x4b,0x49,0x2c,0x49,0xb4,0xd1,0x87,0xb0,0x6d,0xf4,0x21,0x32,0x49,0xf9,0x29,
+    0x95,0x40,0x6d,0x49,0x45,0x76,0x8e,0xa5,0x25,0xf9,0x0a,0x45,0xa9,0x69,0x45,0xa9,0xc5,0x19,0x99,0x79,
+    0xe9,0x0a,0x99,0x79,0x69,0xf9,0x45,0xb9,0x89,0x25,0x99,0xf9,0x79,0x0a,0xe9,0xf9,0xa9,0xc5,0x0a,0x19,
+    0xa9,0x45,0xa9,0x60,0x95,0x00,0x00,0x00,0x00,0xff,0xff,
+  };        // 111 bytes compressed
+  const char page_data_1[] PROGMEM = "\n";
+  const char page_data_2[] PROGMEM = "<font color='#FF0000'> <br>OTA ENABLED! </font>";
+  const char page_data_3[] PROGMEM = "</body></html>\n";
+
+void render_data(Print &out, const char* timeNow, bool ota) {
+  pageText(out, page_data_0, sizeof(page_data_0) - 1, page_data_0_z, sizeof(page_data_0_z));
+  out.print(timeNow);
+  pageWrite_P(out, page_data_1, sizeof(page_data_1) - 1);
+  if (ota) {
+    pageWrite_P(out, page_data_2, sizeof(page_data_2) - 1);
+  }
+  pageWrite_P(out, page_data_3, sizeof(page_data_3) - 1);
+}
+
+
+// ----------------------------------------------------------------
+//                         -footer.html
+// ----------------------------------------------------------------
+
+  const char page_footer_0[] PROGMEM = "<br>\n<div style='text-align: center;background-color:rgb(128, 64, 0)'>\n<small> <font color='#FF0000'>";
+  const char page_footer_1[] PROGMEM = " ";
+  const char page_footer_2[] PROGMEM = " | Memory: ";
+  const char page_footer_3[] PROGMEM = "K | Wifi: ";
+  const char page_footer_4[] PROGMEM = "dBm";
+  const char page_footer_5[] PROGMEM = "</font> </small>\n</div>\n</body>\n</html>\n";
+
+void render_footer(Print &out, const char* title, const char* version, int memory, int rssi, const char* ntp, const char* gsm) {
+  pageWrite_P(out, page_footer_0, sizeof(page_footer_0) - 1);
+  out.print(title);
+  pageWrite_P(out, page_footer_1, sizeof(page_footer_1) - 1);
+  out.print(version);
+  pageWrite_P(out, page_footer_2, sizeof(page_footer_2) - 1);
+  out.print(memory);
+  pageWrite_P(out, page_footer_3, sizeof(page_footer_3) - 1);
+  out.print(rssi);
+  pageWrite_P(out, page_footer_4, sizeof(page_footer_4) - 1);
+  out.print(ntp);
+  out.print(gsm);
+  pageWrite_P(out, page_footer_5, sizeof(page_footer_5) - 1);
+}
+
+
+// ----------------------------------------------------------------
+//                         -header.html
+// ----------------------------------------------------------------
+
+  const char page_header_0[] PROGMEM = "\n    <!DOCTYPE html>\n    <html lang='en'>\n    <head>\n      <meta name='viewport' content='width=device-width, initial-scale=1.0'>\n  ";
+  const uint8_t page_header_0_z[] PROGMEM = {
+    0x34,0x8c,0x31,0x0e,0xc2,0x40,0x0c,0x04,0xfb,0xbc,0xc2,0x54,0x6e,0x08,0x82,0x1e,0xd3,0x00,0x35,0x14,
+    0x34,0x94,0xd6,0xdd,0x8a,0x58,0xba,0x73,0x10,0x58,0xc9,0xf7,0x09,0x87,0xd8,0x6a,0x66,0x8a,0xed,0x68,
+    0xd9,0x7e,0x75,0xba,0x1c,0x6f,0xf7,0xeb,0x99,0x86,0xa8,0xe5,0xd0,0xb5,0xf6,0x45,0x2a,0xea,0x0f,0x61,
+    0x38,0xff,0x23,0x34,0xff,0x70,0x91,0x8a,0x50,0x72,0xad,0x10,0x9e,0x0c,0xf3,0x73,0x7c,0x05,0x53,0x1a,
+    0x3d,0xe0,0x21,0x3c,0x5b,0x8e,0x41,0x32,0x26,0x4b,0xe8,0x9b,0xac,0xc9,0xdc,0xc2,0xb4,0xf4,0xef,0xa4,
+    0x05,0xb2,0xdb,0x6c,0xdb,0xef,0x07,0x00,0x00,0xff,0xff,
+  };        // 111 bytes compressed
+  const char page_header_1[] PROGMEM = "<meta http-equiv='refresh' content='";
+  const char page_header_2[] PROGMEM = "'>\n";
+  const char page_header_3[] PROGMEM = "<title> ";
+  const char page_header_4[] PROGMEM = " </title>\n\n    <link rel='stylesheet' href='/a/style.css?v=52210849'>\n    <style>";
+  const uint8_t page_header_4_z[] PROGMEM = {
+    0x52,0xb0,0xd1,0x2f,0xc9,0x2c,0xc9,0x49,0xb5,0xe3,0xe2,0x52,0x00,0x02,0x9b,0x9c,0xcc,0xbc,0x6c,0x85,
+    0xa2,0xd4,0x1c,0x5b,0xf5,0xe2,0x92,0xca,0x9c,0xd4,0xe2,0x8c,0xd4,0xd4,0x12,0x75,0x85,0x8c,0xa2,0xd4,
+    0x34,0x5b,0x75,0xfd,0x44,0x7d,0xb0,0xa0,0x5e,0x72,0x71,0xb1,0x7d,0x99,0xad,0xa9,0x91,0x91,0xa1,0x81,
+    0x85,0x89,0xa5,0xba,0x1d,0x44,0x2b,0x58,0xce,0x0e,0x00,0x00,0x00,0xff,0xff,
+  };        // 75 bytes compressed
+  const char page_header_5[] PROGMEM = "</style>\n    </head>\n      <body style='color: rgb(0, 0, 0); background-color: yellow; text-align: center;'>\n      <ul>\n  <li><a href='";
+  const uint8_t page_header_5_z[] PROGMEM = {
+    0x3c,0x8c,0x4b,0x0a,0x84,0x30,0x10,0x44,0xf7,0x73,0x8a,0xde,0x65,0x04,0xc5,0x59,0x9b,0xe8,0x5d,0xf2,
+    0x69,0xa3,0xd8,0xa4,0xa1,0x27,0xa2,0xb9,0xbd,0x9f,0x19,0x2c,0x6a,0xf1,0x8a,0x07,0x65,0xda,0x6f,0x2e,
+    0x84,0xc3,0x0b,0xce,0x98,0x76,0x42,0x1b,0x7e,0x7c,0x2e,0xc7,0xa1,0xc0,0xad,0x7b,0xe5,0x99,0x58,0x3a,
+    0x90,0xe8,0xde,0x9f,0x1a,0xae,0x56,0x1a,0x9c,0xf5,0x4b,0x14,0x5e,0x53,0x68,0xfe,0xbe,0x20,0x11,0x6f,
+    0x1a,0x32,0xee,0xb9,0xb1,0x34,0xc7,0xd4,0x81,0xc7,0x94,0x51,0xb4,0x7a,0x7e,0x57,0xba,0xd0,0xd0,0x3c,
+    0x18,0x0b,0x93,0xe0,0xd8,0xab,0x03,0x00,0x00,0xff,0xff,
+  };        // 111 bytes compressed
+  const char page_header_6[] PROGMEM = "'>Home</a></li><li><a href='/log'>Log</a></li><h1> <font color='#FF0000'>";
+  const uint8_t page_header_6_z[] PROGMEM = {
+    0x52,0xb7,0xf3,0xc8,0xcf,0x4d,0xb5,0xd1,0x4f,0xb4,0xb3,0xd1,0xcf,0xc9,0xb4,0xb3,0x01,0xe1,0x44,0x85,
+    0x8c,0xa2,0xd4,0x34,0x5b,0x75,0xfd,0x9c,0xfc,0x74,0x75,0x3b,0x9f,0xfc,0x74,0x84,0x74,0x86,0xa1,0x9d,
+    0x82,0x4d,0x5a,0x7e,0x5e,0x89,0x42,0x72,0x7e,0x4e,0x7e,0x91,0xad,0xba,0xb2,0x9b,0x9b,0x01,0x10,0xa8,
+    0xdb,0x01,0x00,0x00,0x00,0xff,0xff,
+  };        // 67 bytes compressed
+  const char page_header_7[] PROGMEM = "</h1></font></ul>";
+
+void render_header(Print &out, bool autoRefresh, int refresh, const char* title, const char* style, const char* home) {
+  pageText(out, page_header_0, sizeof(page_header_0) - 1, page_header_0_z, sizeof(page_header_0_z));
+  if (autoRefresh) {
+    pageWrite_P(out, page_header_1, sizeof(page_header_1) - 1);
+    out.print(refresh);
+    pageWrite_P(out, page_header_2, sizeof(page_header_2) - 1);
+  }
+  pageWrite_P(out, page_header_3, sizeof(page_header_3) - 1);
+  out.print(title);
+  pageText(out, page_header_4, sizeof(page_header_4) - 1, page_header_4_z, sizeof(page_header_4_z));
+  out.print(style);
+  pageText(out, page_header_5, sizeof(page_header_5) - 1, page_header_5_z, sizeof(page_header_5_z));
+  out.print(home);
+  pageText(out, page_header_6, sizeof(page_header_6) - 1, page_header_6_z, sizeof(page_header_6_z));
+  out.print(title);
+  pageWrite_P(out, page_header_7, sizeof(page_header_7) - 1);
+}
+
+
+// ----------------------------------------------------------------
+//                          -root.html
+// ----------------------------------------------------------------
+
+  const char page_root_0[] PROGMEM = "<FORM action='";
+  const char page_root_1[] PROGMEM = "' method='post'>\n<P>Welcome to the BasicWebServer, running on a ";
+  const char page_root_2[] PROGMEM = "\n<br><iframe id='dataframe' height=150 width=600 frameborder='0' data-first='";
+  const uint8_t page_root_2_z[] PROGMEM = {
+    0xe2,0xb2,0x49,0x2a,0xb2,0xb3,0xc9,0x4c,0x2b,0x4a,0xcc,0x4d,0x55,0xc8,0x4c,0xb1,0x55,0x4f,0x49,0x2c,
+    0x49,0x04,0xf3,0xd4,0x15,0x32,0x52,0x33,0xd3,0x33,0x4a,0x6c,0x0d,0x4d,0x0d,0x14,0xca,0x33,0x53,0x4a,
+    0x32,0x6c,0xcd,0x0c,0x0c,0x14,0xc0,0x72,0x49,0xf9,0x45,0x29,0xa9,0x45,0xb6,0xea,0x06,0xea,0x0a,0x20,
+    0xf5,0xba,0x69,0x99,0x45,0xc5,0x25,0xb6,0xea,0x00,0x00,0x00,0x00,0xff,0xff,
+  };        // 75 bytes compressed
+  const char page_root_3[] PROGMEM = "' data-every='";
+  const char page_root_4[] PROGMEM = "'></iframe>\n<script src='/a/root.js?v=3ccad8ce'></script>\n<br>Demo radio buttons\n<br>Radio1 button1\n<INPUT type='radio' name='RADIO1' value='1'>\n<br>Radio1 button2\n<INPUT type='radio' name='RADIO1' value='2'>\n<br><INPUT type='reset'>\n<INPUT type='submit' value='Action'>\n<br><br><input style='height: 30px;' name='demobutton' value='Demonstration Button' type='submit'>\n</P></form>\n";
+  const uint8_t page_root_4_z[] PROGMEM = {
+    0x8c,0x90,0xb1,0x0e,0x82,0x30,0x14,0x45,0x77,0xbe,0xa2,0x5b,0x37,0x11,0x5d,0x8c,0x42,0x8d,0x86,0xc5,
+    0x45,0x89,0xd1,0x0f,0x28,0xa5,0x68,0x0d,0xb4,0xa4,0x7d,0x18,0xf9,0x7b,0x5f,0x05,0x8c,0xc6,0xc5,0xa1,
+    0x43,0xef,0xbd,0xe7,0xdd,0xf6,0x51,0x16,0x87,0xaa,0xb4,0xbc,0x96,0x2c,0x88,0x9d,0xb0,0xaa,0x01,0xe2,
+    0xac,0x48,0x68,0xc8,0x43,0x6b,0x0c,0x4c,0x6e,0x6e,0x7d,0x4f,0xe6,0x42,0xf0,0x62,0x21,0x24,0xc5,0x74,
+    0x1f,0xc2,0x74,0x6e,0x59,0x2a,0x6b,0x43,0x2c,0x2f,0x94,0x21,0x79,0x0b,0x60,0xb4,0x7b,0xc9,0x47,0xaf,
+    0x44,0x83,0x14,0x05,0xf1,0x6e,0x9f,0x9d,0x4f,0x04,0xba,0x46,0x26,0xf4,0x95,0xa6,0x44,0x63,0x63,0x42,
+    0x8f,0x9b,0x74,0x77,0x88,0x28,0xb9,0xf3,0xaa,0xc5,0x6b,0x44,0xd9,0x2f,0x3f,0xfb,0x9f,0x9f,0x0d,0xfc,
+    0x37,0x20,0x9d,0x04,0x6f,0x7c,0x8a,0xae,0xcd,0x6b,0x05,0x6f,0x70,0x23,0x40,0x19,0x3d,0xd2,0xfe,0x28,
+    0xdd,0xb4,0xb8,0x09,0xe8,0x2a,0xb4,0xaf,0x52,0x5d,0xae,0xb0,0x24,0xf3,0x69,0xf3,0x58,0x8d,0xdd,0x05,
+    0xfe,0xbd,0x7f,0xe1,0x7b,0x8c,0x5f,0x87,0x76,0x60,0xb9,0x9f,0x46,0xb6,0x83,0xf9,0xd5,0x88,0x15,0x61,
+    0x86,0x5b,0x2c,0x8d,0xad,0x59,0xf0,0x04,0x00,0x00,0xff,0xff,
+  };        // 212 bytes compressed
+
+void render_root(Print &out, const char* home, const char* board, const char* javaRefresh, const char* dataRefresh) {
+  pageWrite_P(out, page_root_0, sizeof(page_root_0) - 1);
+  out.print(home);
+  pageWrite_P(out, page_root_1, sizeof(page_root_1) - 1);
+  out.print(board);
+  pageText(out, page_root_2, sizeof(page_root_2) - 1, page_root_2_z, sizeof(page_root_2_z));
+  out.print(javaRefresh);
+  pageWrite_P(out, page_root_3, sizeof(page_root_3) - 1);
+  out.print(dataRefresh);
+  pageText(out, page_root_4, sizeof(page_root_4) - 1, page_root_4_z, sizeof(page_root_4_z));
+}
+
+
+// --------------------------- E N D -----------------------------
@@ -0,0 +1,234 @@
+/**************************************************************************************************
+ *
+ *      Sampling profiler - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Shows where the processor is spending its time.  A timer interrupt takes a sample 'rate'
+ *      times a second recording the address of the code which was running (program counter)
+ *      plus the tagged scopes (see scope.h) which were active at the time.
+ *
+ *      http://x.x.x.x/profile?seconds=10&rate=500   runs the profiler and sends the samples in
+ *      'folded stack' format (one line per sample e.g. "web server;/data;0x40201234 1"), the
+ *      addresses can be converted to function names with misc/profile.py and then turned in to
+ *      a flamegraph with flamegraph.pl (https://github.com/brendangregg/FlameGraph)
+ *
+ *      Uses timer0 on the esp8266 (timer1 is used by the stall detector) and timer 2 on the esp32
+ *      (any free timer with esp32 core 3.x).
+ *      The samples are passed from the interrupt to loop through a lock free ring buffer and
+ *      are sent to the browser while profiling (so sending them shows up in the profile as well).
+ *
+ *      Note: only the interrupted address is recorded, walking the stack frames from inside an
+ *            interrupt is not reliable with the Xtensa register windows so the tagged scopes
+ *            are used for the rest of the stack.
+ *            The address is only recorded on the esp8266.  On the esp32 the timer interrupt is
+ *            called through the FreeRTOS interrupt dispatcher, by which time EPC1 may no longer hold
+ *            the interrupted address, so only the tagged scopes are recorded there.
+ *
+ **************************************************************************************************/
+
+
+// forward declarations (i.e. details of all functions in this file)
+  void profileLoop();
+  void handleProfile();
+
+
+// ----------------------------------------------------------------
+//                              -Startup
+// ----------------------------------------------------------------
+
+  const uint16_t profileRateDefault = 500;  // samples per second if not specified
+  const uint16_t profileRateMax = 2000;     // max samples per second
+  const uint16_t profileMaxSeconds = 60;    // longest time profiler can run for
+  const byte profileDepth = 4;              // number of scopes recorded in each sample
+  const uint16_t profileBufferSize = 128;   // number of samples which can be waiting to be sent (must be a power of 2)
+
+  #if defined ESP32
+    #define PROFILE_IRAM IRAM_ATTR              // interrupt routines need to be in ram
+  #else
+    #define PROFILE_IRAM ICACHE_RAM_ATTR
+  #endif
+
+  struct ProfileSample {
+    uint32_t pc;                            // address of code which was running
+    byte depth;                             // number of scopes recorded
+    const char* scope[profileDepth];        // innermost first
+  };
+
+  // ring buffer between the interrupt (writes at head) and loop (reads from tail)
+    ProfileSample profileBuffer[profileBufferSize];
+    volatile uint16_t profileHead = 0;
+    volatile uint16_t profileTail = 0;
+    volatile uint32_t profileDropped = 0;   // samples lost because the buffer was full
+
+  bool profileRunning = 0;
+  uint32_t profileTimer = 0;                // millis() when profiling started
+  uint32_t profileLength = 0;               // how long to profile for (ms)
+  uint32_t profileSamples = 0;              // samples sent
+  ServerClient profileClient;               // connection the samples are sent to
+
+  #if defined ESP32
+    hw_timer_t* profileHwTimer = nullptr;
+  #else
+    uint32_t profileCycles = 0;             // cpu cycles between samples
+  #endif
+
+
+// ----------------------------------------------------------------
+//                   -timer interrupt - take a sample
+// ----------------------------------------------------------------
+
+void PROFILE_IRAM profileISR() {
+
+  #if !defined ESP32
+    timer0_write(ESP.getCycleCount() + profileCycles);      // time of next sample
+  #endif
+
+  uint16_t head = profileHead;
+  uint16_t next = (head + 1) & (profileBufferSize - 1);
+  if (next == profileTail) {
+    profileDropped = profileDropped + 1;
+    return;
+  }
+
+  ProfileSample &s = profileBuffer[head];
+  #if defined ESP32
+    s.pc = 0;                                               // (see note at top)
+  #else
+    uint32_t pc;
+    asm volatile ("rsr %0, epc1" : "=r" (pc));             // address the interrupt happened at
+    s.pc = pc;
+  #endif
+  s.depth = 0;
+  for (LoopScope* sc = scopeCurrent; sc && s.depth < profileDepth; sc = sc->prev) s.scope[s.depth++] = sc->name;
+
+  profileHead = next;
+}
+
+
+// ----------------------------------------------------------------
+//                   -start / stop the sample timer
+// ----------------------------------------------------------------
+
+void profileStart(uint16_t rate) {
+
+  profileHead = 0;
+  profileTail = 0;
+  profileDropped = 0;
+  profileSamples = 0;
+
+  #if defined ESP32 && ESP_ARDUINO_VERSION_MAJOR >= 3
+    profileHwTimer = timerBegin(1000000);                      // 1MHz (esp32 core 3.x picks a free timer)
+    timerAttachInterrupt(profileHwTimer, &profileISR);
+    timerAlarm(profileHwTimer, 1000000UL / rate, true, 0);
+  #elif defined ESP32
+    profileHwTimer = timerBegin(2, 80, true);                  // timer 2, 1MHz
+    timerAttachInterrupt(profileHwTimer, &profileISR, true);
+    timerAlarmWrite(profileHwTimer, 1000000UL / rate, true);
+    timerAlarmEnable(profileHwTimer);
+  #else
+    profileCycles = ESP.getCpuFreqMHz() * 1000000UL / rate;
+    noInterrupts();
+    timer0_isr_init();
+    timer0_attachInterrupt(profileISR);
+    timer0_write(ESP.getCycleCount() + profileCycles);
+    interrupts();
+  #endif
+
+  profileRunning = 1;
+}
+
+void profileStop() {
+
+  #if defined ESP32 && ESP_ARDUINO_VERSION_MAJOR >= 3
+    timerStop(profileHwTimer);
+    timerEnd(profileHwTimer);
+    profileHwTimer = nullptr;
+  #elif defined ESP32
+    timerAlarmDisable(profileHwTimer);
+    timerEnd(profileHwTimer);
+    profileHwTimer = nullptr;
+  #else
+    timer0_detachInterrupt();
+  #endif
+
+  profileRunning = 0;
+}
+
+
+// ----------------------------------------------------------------
+//             -send waiting samples (called from loop)
+// ----------------------------------------------------------------
+// each sample is sent as a line of the form   outer scope;inner scope;0xaddress 1   (no address on the esp32)
+
+void profileLoop() {
+
+  if (!profileRunning) return;
+  LOOP_SCOPE("profileLoop");
+
+  bool finished = ((unsigned long)(millis() - profileTimer) >= profileLength || !profileClient.connected());
+  if (finished) profileStop();
+
+  char line[160];
+  while (profileTail != profileHead) {
+    ProfileSample &s = profileBuffer[profileTail];
+    int len = 0;
+    if (s.depth == 0) len += snprintf(line + len, sizeof(line) - len, "loop;");
+    for (int i = s.depth - 1; i >= 0 && len < (int)sizeof(line); i--) {
+      len += snprintf(line + len, sizeof(line) - len, "%s;", s.scope[i]);
+    }
+    if (len < (int)sizeof(line)) {
+      if (s.pc) len += snprintf(line + len, sizeof(line) - len, "0x%08x 1\n", s.pc);
+      else {
+        len--;                                                // no address (esp32) so replace the last ';'
+        len += snprintf(line + len, sizeof(line) - len, " 1\n");
+      }
+    }
+    if (len > (int)sizeof(line) - 1) len = sizeof(line) - 1;
+    profileTail = (profileTail + 1) & (profileBufferSize - 1);
+    profileClient.write((const uint8_t*)line, len);
+    profileSamples++;
+  }
+
+  if (finished) {
+    if (serialDebug) Serial.printf("Profiler: sent %u samples, %u dropped\n", profileSamples, profileDropped);
+    profileClient.stop();
+    profileClient = ServerClient();
+  }
+}
+
+
+// ----------------------------------------------------------------
+//  -profile requested    i.e. http://x.x.x.x/profile?seconds=10&rate=500
+// ----------------------------------------------------------------
+// the connection is kept open and the samples are sent from profileLoop()
+
+void handleProfile() {
+
+  if (profileRunning) {
+    server.send(409, "text/plain", "The profiler is already running");
+    return;
+  }
+
+  profileClient = server.client();
+  RequestContext &req = requestBegin(profileClient);
+  uint32_t seconds = req.has("seconds") ? req.arg("seconds").toInt() : 10;
+  uint32_t rate = req.has("rate") ? req.arg("rate").toInt() : profileRateDefault;
+  if (seconds < 1) seconds = 1;
+  if (seconds > profileMaxSeconds) seconds = profileMaxSeconds;
+  if (rate < 1) rate = 1;
+  if (rate > profileRateMax) rate = profileRateMax;
+
+  log_system_message("Profiler started for %u seconds at %u samples per second", seconds, rate);
+
+  profileClient.print("HTTP/1.1 200 OK\r\n");
+  profileClient.print("Content-Type: text/plain\r\n");
+  profileClient.print("Connection: close\r\n\r\n");
+
+  profileTimer = millis();
+  profileLength = seconds * 1000;
+  profileStart(rate);
+}
+
+
+// --------------------------- E N D -----------------------------
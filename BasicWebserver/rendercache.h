@@ -0,0 +1,156 @@
+/**************************************************************************************************
+ *
+ *      Render cache - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Keeps a copy of a generated web page so that when several browsers are showing the same
+ *      page (e.g. all polling /data) it is only created once and then sent again from the copy.
+ *
+ *      A copy is used again as long as both
+ *          pageVersion  - which is increased by calling pageChanged() whenever something shown on
+ *                         the cached pages changes (e.g. OTA enabled, GSM status, NTP sync)
+ *          stamp        - supplied by the page, e.g. the current minute for a page showing the time
+ *      are the same as when it was created.
+ *
+ *      Usage:   char dataCacheBuffer[320];
+ *               RenderCache dataCache("/data", dataCacheBuffer, sizeof(dataCacheBuffer));
+ *
+ *               cachedRender(client, dataCache, now() / 60, acceptsGzip(), [](Print &out) {
+ *                 ...send the page to 'out'...
+ *               });
+ *
+ *      If the browser accepts gzip the page is sent gzipped (see gzip.h) with the http headers
+ *      needed for that, unless that would be no smaller (e.g. a short page which is mostly values
+ *      filled in).  The copy kept is for whichever sort of browser asked last.
+ *      If a page will not fit in its buffer it is just sent directly (and counted as 'too big').
+ *      The hit counts are shown on http://x.x.x.x/metrics
+ *
+ **************************************************************************************************/
+
+
+// forward declarations (i.e. details of all functions in this file)
+  void pageChanged();
+
+
+// ----------------------------------------------------------------
+//                              -Startup
+// ----------------------------------------------------------------
+
+  uint32_t pageVersion = 1;                 // increased whenever something shown on the cached pages changes
+
+  struct RenderCache;
+  RenderCache* renderCacheList = nullptr;   // all the caches (for the statistics)
+
+  struct RenderCache {
+    const char* page;
+    char* buf;                              // copy of the page
+    uint16_t size;
+    uint16_t len = 0;
+    bool valid = 0;
+    bool forGz = 0;                         // the copy is for a browser which accepts gzip
+    bool gz = 0;                            // the copy is gzipped
+    uint32_t version = 0;                   // pageVersion when the copy was made
+    uint32_t stamp = 0;                     // stamp when the copy was made
+    uint32_t hits = 0;                      // counters
+    uint32_t misses = 0;
+    uint32_t tooBig = 0;
+    RenderCache* next;
+
+    RenderCache(const char* p, char* b, uint16_t s) : page(p), buf(b), size(s), next(renderCacheList) { renderCacheList = this; }
+  };
+
+
+// something shown on the cached pages has changed
+
+void pageChanged() {
+  #if ENABLE_DUALCORE
+    __atomic_add_fetch(&pageVersion, 1, __ATOMIC_RELAXED);        // can be called from either core
+  #else
+    pageVersion++;
+  #endif
+}
+
+
+// ----------------------------------------------------------------
+//                -storing a page as it is created
+// ----------------------------------------------------------------
+
+class CacheWriter : public Print {
+  public:
+    char* buf;
+    uint16_t size;
+    uint16_t len = 0;
+    bool overflow = 0;                      // flag if the page did not fit
+
+    CacheWriter(char* b, uint16_t s) : buf(b), size(s) {}          // (no buffer to just see if a page fits in size)
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *data, size_t n) override {
+      if (overflow || len + n > size) {
+        overflow = 1;
+        return 0;
+      }
+      if (buf) memcpy(buf + len, data, n);
+      len += n;
+      return n;
+    }
+};
+
+
+// ----------------------------------------------------------------
+//          -send a page, from the cache if it is up to date
+// ----------------------------------------------------------------
+// 'render' is called with a Print& to send the page to if it needs creating
+// gz = the browser accepts gzip (the page is only kept gzipped if that makes it smaller)
+
+  const char gzipPageHeaders[] = "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Encoding: gzip\r\nVary: Accept-Encoding\r\nConnection: close\r\n";
+
+template<typename F> void cachedRender(WiFiClient &client, RenderCache &c, uint32_t stamp, bool gz, F render) {
+
+  // create the page, gzipped or not
+    auto create = [&](Print &out, bool zip) {
+      if (!zip) return render(out);
+      GzipWriter g(out);
+      render(g);
+      g.finish();
+    };
+
+  uint32_t version = __atomic_load_n(&pageVersion, __ATOMIC_RELAXED);
+  if (!(c.valid && c.forGz == gz && c.version == version && c.stamp == stamp)) {
+    c.misses++;
+    c.valid = 0;
+    CacheWriter w(c.buf, c.size);
+    bool zipped = gz;
+    create(w, zipped);
+    if (zipped && !w.overflow) {            // not kept gzipped if that is no smaller
+      CacheWriter plain(nullptr, w.len);
+      render(plain);
+      if (!plain.overflow) {
+        zipped = 0;
+        w.len = 0;
+        create(w, zipped);
+      }
+    }
+    if (w.overflow) {                       // too big for the buffer so send it directly
+      c.tooBig++;
+      if (zipped) client.printf("%s\r\n", gzipPageHeaders);
+      create(client, zipped);
+      return;
+    }
+    c.len = w.len;
+    c.gz = zipped;
+    c.forGz = gz;
+    c.version = version;
+    c.stamp = stamp;
+    c.valid = 1;
+  } else {
+    c.hits++;
+  }
+
+  if (c.gz) client.printf("%sContent-Length: %u\r\n\r\n", gzipPageHeaders, c.len);
+  client.write((const uint8_t*)c.buf, c.len);
+}
+
+
+// --------------------------- E N D -----------------------------
@@ -0,0 +1,116 @@
+/**************************************************************************************************
+ *
+ *      Request context - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Gathers the details of the current web page request in one place without using Strings:
+ *      the arguments (from the url ?name=value or a submitted form) and the client's ip address.
+ *
+ *      Usage:   RequestContext &req = requestBegin(client);      at the start of a page handler
+ *               if (req.has("RADIO1")) ...
+ *               if (req.arg("RADIO1").equals("1")) ...
+ *               req.ip                                           e.g. "192.168.1.10"
+ *
+ *      Looking the arguments up does not use any memory allocation (server.arg(name) makes a new
+ *      String every time it is called).  Where the web server library gives its own copies of the
+ *      arguments by reference (esp8266 core 3 on) they point in to those, which stay the same until
+ *      the request has been handled, otherwise (e.g. esp32) they are copied once in to the request
+ *      memory (see arena.h) and any which do not fit are left out (flagged by 'truncated').
+ *      Note: the web server library has already decoded any %xx in the arguments.
+ *
+ **************************************************************************************************/
+
+
+#include <type_traits>
+
+
+// ----------------------------------------------------------------
+//                              -Startup
+// ----------------------------------------------------------------
+
+  const byte reqMaxArgs = 16;               // max number of arguments stored
+
+  struct RequestContext {
+    byte count = 0;                         // number of arguments
+    StrView names[reqMaxArgs];
+    StrView values[reqMaxArgs];             // (both are also zero terminated so can be used as C strings)
+    char ip[16] = "";                       // client ip address
+    bool truncated = 0;                     // flag if some arguments did not fit
+
+    // find an argument (returns -1 if not found)
+      int find(const char* name) const {
+        for (byte i=0; i < count; i++) if (names[i].equals(name)) return i;
+        return -1;
+      }
+
+    bool has(const char* name) const { return find(name) >= 0; }
+
+    // value of an argument (blank if not found)
+      StrView arg(const char* name) const {
+        int i = find(name);
+        return (i >= 0) ? values[i] : StrView();
+      }
+  };
+
+  RequestContext request;
+
+
+// ----------------------------------------------------------------
+//               -keep an argument name or value
+// ----------------------------------------------------------------
+// which is used depends on whether server.arg() returns a reference (see requestBegin())
+
+// the library's copy (only changes when the next request arrives)
+bool reqStore(const String &text, StrView &view, std::true_type) {
+  view.ptr = text.c_str();
+  view.len = text.length();
+  return 1;
+}
+
+// a copy in the request memory (returns 0 if there is no room)
+bool reqStore(const String &text, StrView &view, std::false_type) {
+  uint16_t len = text.length();
+  char* p = (char*)arenaAlloc(len + 1);
+  if (!p) return 0;
+  memcpy(p, text.c_str(), len + 1);
+  view.ptr = p;
+  view.len = len;
+  return 1;
+}
+
+
+// ----------------------------------------------------------------
+//              -gather the details of the current request
+// ----------------------------------------------------------------
+
+RequestContext& requestBegin(WiFiClient &client) {
+
+  request.count = 0;
+  request.truncated = 0;
+
+  IPAddress cip = client.remoteIP();
+  char* p = request.ip;                   // (written out directly, snprintf takes longer than the rest of this)
+  for (byte i=0; i < 4; i++) {
+    byte b = cip[i];
+    if (b >= 100) *p++ = '0' + b / 100;
+    if (b >= 10) *p++ = '0' + b / 10 % 10;
+    *p++ = '0' + b % 10;
+    *p++ = (i < 3) ? '.' : 0;
+  }
+
+  std::is_reference<decltype(server.arg(0))> byReference;     // (worked out when compiling)
+  int args = server.args();
+  for (int i=0; i < args; i++) {
+    if (request.count >= reqMaxArgs) { request.truncated = 1; break; }
+    StrView &name = request.names[request.count];
+    StrView &value = request.values[request.count];
+    if (!reqStore(server.argName(i), name, byReference) || !reqStore(server.arg(i), value, byReference)) { request.truncated = 1; break; }
+    request.count++;
+  }
+
+  return request;
+}
+
+
+// --------------------------- E N D -----------------------------
@@ -0,0 +1,382 @@
+/**************************************************************************************************
+ *
+ *      Route table - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      The web pages are listed in a table (see 'webPages' in the main sketch) instead of each
+ *      being registered with server.on().  The hash of each method and path is worked out when the
+ *      sketch is compiled and at startup the table is placed in an index with no collisions (a
+ *      perfect hash) so finding the page for a request takes the same time however many pages
+ *      there are, rather than the web server library comparing the path with every page in turn.
+ *
+ *      Paths can contain parameters e.g. "/log/{lines}" matches /log/10 and the handler can get
+ *      the value with routeParam("lines") (or routeParam(0) for the first parameter).
+ *      Parameters must be a whole part of the path (between /'s).
+ *
+ *      Usage:   constexpr RouteDef webPages[] = {
+ *                 ROUTE(HTTP_ANY, "/", handleRoot),
+ *                 ROUTE(HTTP_GET, "/log/{lines}", handleLogpage),
+ *               };
+ *               routesSetup(webPages);        (in setup before any server.on())
+ *
+ *      Pages registered with server.on() or routeOn() still work as before.
+ *
+ *      The table holds up to routeMax pages (set in the main sketch), the index is sized to suit.
+ *      The same path can be listed more than once with different methods, a page listed for the
+ *      method of the request is found before one listed for HTTP_ANY.
+ *      If no arrangement without collisions can be found (e.g. the same method and path listed
+ *      twice) it is reported in the log and pages are placed in the next free slot instead.
+ *
+ **************************************************************************************************/
+
+
+// ----------------------------------------------------------------
+//                              -Startup
+// ----------------------------------------------------------------
+
+  // routeMax (the most pages there can be in the table) is set in the main sketch
+  const uint16_t routeNone = 0xFFFF;        // (empty slot in the index)
+  const byte routeMaxParams = 4;            // max number of parameters in a path
+  const byte routeMaxMasks = 4;             // max number of different arrangements of parameters
+
+  // newer esp8266 and esp32 cores pass the uri by reference
+    #if defined ESP8266 && defined ARDUINO_ESP8266_MAJOR && ARDUINO_ESP8266_MAJOR >= 3
+      #define ROUTE_URI const String&
+    #elif defined ESP32 && defined ESP_ARDUINO_VERSION_MAJOR && ESP_ARDUINO_VERSION_MAJOR >= 3
+      #define ROUTE_URI const String&
+    #else
+      #define ROUTE_URI String
+    #endif
+
+  #if defined ESP32
+    typedef WebServer WebServerType;
+    typedef RequestHandler WebRequestHandler;
+  #elif ENABLE_HTTPS
+    typedef BearSSL::ESP8266WebServerSecure WebServerType;
+    typedef BearSSL::RequestHandlerSecure WebRequestHandler;
+  #else
+    typedef ESP8266WebServer WebServerType;
+    typedef RequestHandler WebRequestHandler;
+  #endif
+
+  void log_system_message(const char*, ...);     // see standard.h
+  #if ENABLE_ACCESS
+    void accessBegin();                     // record each request (see access.h)
+    void accessEnd(const char*);
+  #endif
+
+
+// ----------------------------------------------------------------
+//                    -text which is part of a string
+// ----------------------------------------------------------------
+// used for the parameters so they don't need copying, only valid while the request is being handled
+
+struct StrView {
+  const char* ptr = "";
+  uint16_t len = 0;
+
+  bool equals(const char* text) const { return strncmp(ptr, text, len) == 0 && text[len] == 0; }
+  long toInt() const {
+    long value = 0;
+    bool negative = (len > 0 && ptr[0] == '-');
+    for (uint16_t i = negative; i < len && ptr[i] >= '0' && ptr[i] <= '9'; i++) value = value * 10 + (ptr[i] - '0');
+    return negative ? -value : value;
+  }
+  String toString() const {
+    String s;
+    s.reserve(len);
+    for (uint16_t i=0; i < len; i++) s += ptr[i];
+    return s;
+  }
+};
+
+
+// ----------------------------------------------------------------
+//              -path hashing (worked out when compiling)
+// ----------------------------------------------------------------
+// FNV-1a hash of the path with any {parameter} replaced by "{}"
+// (written as single return statements so they still work with the older compiler in the esp8266 core)
+
+constexpr uint32_t routeHashStep(uint32_t h, char c) { return (h ^ (uint8_t)c) * 16777619UL; }
+
+constexpr const char* routeSkipParam(const char* p) { return (*p == 0 || *p == '/') ? p : routeSkipParam(p + 1); }
+
+constexpr uint32_t routeHashFrom(const char* p, uint32_t h) {
+  return (*p == 0) ? h
+       : (*p == '{') ? routeHashFrom(routeSkipParam(p), routeHashStep(routeHashStep(h, '{'), '}'))
+       : routeHashFrom(p + 1, routeHashStep(h, *p));
+}
+
+constexpr uint32_t routeHash(const char* path) { return routeHashFrom(path, 2166136261UL); }
+
+// bit for each part of the path which is a parameter (first part after the leading / is bit 1)
+constexpr uint16_t routeMaskFrom(const char* p, byte part, uint16_t mask) {
+  return (*p == 0) ? mask
+       : (*p == '/') ? routeMaskFrom(p + 1, part + 1, mask)
+       : (*p == '{') ? routeMaskFrom(routeSkipParam(p), part, mask | (1 << part))
+       : routeMaskFrom(p + 1, part, mask);
+}
+
+constexpr uint16_t routeParamMask(const char* path) { return routeMaskFrom(path, 0, 0); }
+
+// the method is added to the hash of the path so the same path can have a slot for each method
+constexpr uint32_t routeKey(uint32_t pathHash, HTTPMethod method) { return (pathHash ^ ((uint32_t)method & 0xFF)) * 16777619UL; }
+
+
+struct RouteDef {
+  HTTPMethod method;
+  const char* path;
+  void (*handler)();
+  uint32_t hash;                            // hash of method and path
+  uint16_t paramMask;                       // which parts of the path are parameters
+  byte cls;                                 // class of page
+};
+
+#define ROUTE(method, path, handler) { method, path, handler, routeKey(routeHash(path), method), routeParamMask(path), routePage }
+#define ROUTE_POLL(method, path, handler) { method, path, handler, routeKey(routeHash(path), method), routeParamMask(path), routePoll }     // a page browsers request often
+
+
+// ----------------------------------------------------------------
+//                          -route index
+// ----------------------------------------------------------------
+
+  // smallest power of 2 which is at least twice routeMax
+  constexpr uint32_t routeSlotsFor(uint32_t slots) { return (slots >= 2UL * routeMax) ? slots : routeSlotsFor(slots * 2); }
+  const uint32_t routeSlotsMax = routeSlotsFor(8);    // max size of the index
+  static_assert(routeSlotsMax <= 32768, "routeMax is too large");
+
+  const RouteDef* routeTable = nullptr;
+  uint16_t routeCount = 0;
+  int8_t routeMetric[routeMax];             // route number for metrics (see metrics.h)
+  uint16_t routeIndex[routeSlotsMax];       // route in each slot (routeNone = empty)
+  uint16_t routeSlots = 0;                  // size of index in use
+  uint32_t routeSeed = 0;                   // seed which gives no collisions
+  uint16_t routeMasks[routeMaxMasks];       // the different parameter arrangements in use
+  byte routeMaskCount = 0;
+
+  // the request currently being handled
+    const RouteDef* routeCurrent = nullptr;
+    StrView routeParams[routeMaxParams];
+    byte routeParamCount = 0;
+
+
+// slot in index for a hash
+inline uint16_t routeSlot(uint32_t hash, uint32_t seed) {
+  return ((uint32_t)((hash ^ seed) * 2654435761UL) >> 16) & (routeSlots - 1);
+}
+
+
+// ----------------------------------------------------------------
+//              -hash of a requested path (at run time)
+// ----------------------------------------------------------------
+// same as routeHash() but the parts in 'mask' are treated as parameters
+
+uint32_t routeHashPath(const char* p, uint16_t mask) {
+  uint32_t h = 2166136261UL;
+  byte part = 0;
+  while (*p) {
+    if (*p == '/') {
+      h = routeHashStep(h, '/');
+      p++;
+      part++;
+      if (part < 16 && (mask & (1 << part))) {
+        h = routeHashStep(routeHashStep(h, '{'), '}');
+        while (*p && *p != '/') p++;
+      }
+      continue;
+    }
+    h = routeHashStep(h, *p++);
+  }
+  return h;
+}
+
+
+// ----------------------------------------------------------------
+//         -check a path matches a route and find parameters
+// ----------------------------------------------------------------
+
+bool routeMatch(const RouteDef &r, const char* path) {
+
+  const char* pat = r.path;
+  byte params = 0;
+  while (*pat && *path) {
+    if (*pat == '{') {
+      const char* start = path;
+      while (*path && *path != '/') path++;
+      if (path == start || params >= routeMaxParams) return 0;     // parameter can not be blank
+      routeParams[params].ptr = start;
+      routeParams[params].len = path - start;
+      params++;
+      pat = routeSkipParam(pat);
+      continue;
+    }
+    if (*pat++ != *path++) return 0;
+  }
+  if (*pat || *path) return 0;
+  routeParamCount = params;
+  return 1;
+}
+
+
+// ----------------------------------------------------------------
+//                   -find the route for a request
+// ----------------------------------------------------------------
+// returns route number or -1 if none
+
+// look in the index for a page with this method, path hash and arrangement of parameters
+int routeLookup(HTTPMethod method, uint32_t pathHash, uint16_t mask, const char* path) {
+  uint32_t key = routeKey(pathHash, method);
+  for (uint16_t slot = routeSlot(key, routeSeed); routeIndex[slot] != routeNone; slot = (slot + 1) & (routeSlots - 1)) {
+    const RouteDef &r = routeTable[routeIndex[slot]];
+    if (r.hash == key && r.method == method && r.paramMask == mask && routeMatch(r, path)) return routeIndex[slot];
+  }
+  return -1;
+}
+
+int routeFind(HTTPMethod method, const char* path) {
+
+  if (routeSlots == 0) return -1;
+  for (byte m=0; m < routeMaskCount; m++) {
+    uint32_t h = routeHashPath(path, routeMasks[m]);
+    int r = routeLookup(method, h, routeMasks[m], path);
+    if (r < 0 && method != HTTP_ANY) r = routeLookup(HTTP_ANY, h, routeMasks[m], path);
+    if (r >= 0) return r;
+  }
+  return -1;
+}
+
+
+// ----------------------------------------------------------------
+//                 -parameters for page handlers
+// ----------------------------------------------------------------
+// e.g. for "/log/{lines}"   routeParam("lines") or routeParam(0)    (blank if not found)
+
+StrView routeParam(int n) {
+  return (n >= 0 && n < routeParamCount) ? routeParams[n] : StrView();
+}
+
+StrView routeParam(const char* name) {
+  if (!routeCurrent) return StrView();
+  byte n = 0;
+  for (const char* p = routeCurrent->path; *p; p++) {
+    if (*p != '{') continue;
+    const char* end = strchr(p, '}');
+    if (end && (size_t)(end - p - 1) == strlen(name) && strncmp(p + 1, name, end - p - 1) == 0) return routeParam(n);
+    n++;
+  }
+  return StrView();
+}
+
+
+// ----------------------------------------------------------------
+//           -request handler which uses the route table
+// ----------------------------------------------------------------
+
+class RouteTableHandler : public WebRequestHandler {
+  public:
+    bool canHandle(HTTPMethod method, ROUTE_URI uri) override {
+      return routeFind(method, uri.c_str()) >= 0;
+    }
+    bool canUpload(ROUTE_URI) override { return 0; }
+    bool handle(WebServerType &, HTTPMethod method, ROUTE_URI uri) override {      // (the server is the sketch's 'server')
+      int r = routeFind(method, uri.c_str());              // sets routeParams to point in to uri
+      if (r < 0) return 0;
+      #if ENABLE_ADMISSION
+        if (!admitRequest(routeTable[r].cls)) {           // (client is sending too many requests)
+          routeParamCount = 0;
+          return 1;
+        }
+      #endif
+      routeCurrent = &routeTable[r];
+      #if ENABLE_ACCESS
+        accessBegin();
+      #else
+        if (routeTable[r].cls == routePage) log_system_message("%s page requested from: %s", routeTable[r].path, server.client().remoteIP().toString().c_str());
+      #endif
+      metricsRun(routeMetric[r], routeTable[r].handler);
+      #if ENABLE_ACCESS
+        accessEnd(routeTable[r].path);
+      #endif
+      routeCurrent = nullptr;
+      routeParamCount = 0;
+      return 1;
+    }
+};
+
+RouteTableHandler routeHandler;
+
+
+// ----------------------------------------------------------------
+//                     -set up the route index
+// ----------------------------------------------------------------
+
+// place the routes in the index using routeSeed, returns 0 if two routes want the same slot
+// (unless probe is set when it uses the next free slot instead)
+bool routeIndexBuild(const RouteDef* table, bool probe) {
+  for (uint16_t s=0; s < routeSlots; s++) routeIndex[s] = routeNone;
+  for (uint16_t i=0; i < routeCount; i++) {
+    uint16_t slot = routeSlot(table[i].hash, routeSeed);
+    while (routeIndex[slot] != routeNone) {
+      if (!probe) return 0;
+      slot = (slot + 1) & (routeSlots - 1);
+    }
+    routeIndex[slot] = i;
+  }
+  return 1;
+}
+
+// called from setup before any server.on()
+
+void routesSetup(const RouteDef* table, size_t count) {
+
+  routeTable = table;
+  routeCount = (count > routeMax) ? routeMax : count;
+  if (count > routeMax && serialDebug) Serial.println("Error: too many routes in table (see routeMax)");
+
+  // the different arrangements of parameters (no parameters is always checked first)
+    routeMasks[0] = 0;
+    routeMaskCount = 1;
+    for (uint16_t i=0; i < routeCount; i++) {
+      bool found = 0;
+      for (byte m=0; m < routeMaskCount; m++) if (routeMasks[m] == table[i].paramMask) found = 1;
+      if (found) continue;
+      if (routeMaskCount < routeMaxMasks) routeMasks[routeMaskCount++] = table[i].paramMask;
+      else if (serialDebug) Serial.printf("Error: too many different parameter arrangements for '%s'\n", table[i].path);
+    }
+
+  // find a seed which puts every route in a different slot (start with index twice the size of the table)
+    routeSlots = 8;
+    while (routeSlots < routeCount * 2 && routeSlots < routeSlotsMax) routeSlots *= 2;
+    bool perfect = 0;
+    while (!perfect) {
+      for (routeSeed = 0; routeSeed < 500; routeSeed++) {
+        perfect = routeIndexBuild(table, 0);
+        if (perfect) break;
+      }
+      if (perfect || routeSlots >= routeSlotsMax) break;
+      routeSlots *= 2;
+    }
+
+  // no perfect arrangement so fall back to placing in next free slot
+    if (!perfect) {
+      for (uint16_t i=0; i < routeCount; i++) {
+        for (uint16_t j=0; j < i; j++) {
+          if (table[i].method == table[j].method && strcmp(table[i].path, table[j].path) == 0) log_system_message("Routes: '%s' is listed twice for the same method", table[i].path);
+        }
+      }
+      log_system_message("Routes: no index without collisions found for %d pages, using the next free slot", routeCount);
+      routeSeed = 0;
+      routeIndexBuild(table, 1);
+    }
+
+  for (uint16_t i=0; i < routeCount; i++) routeMetric[i] = metricsRouteAdd(table[i].path);
+
+  server.addHandler(&routeHandler);
+  if (serialDebug) Serial.printf("Routes: %u pages, index size %u, seed %u\n", routeCount, routeSlots, routeSeed);
+}
+
+template<size_t N> void routesSetup(const RouteDef (&table)[N]) { routesSetup(table, N); }
+
+
+// --------------------------- E N D -----------------------------
@@ -0,0 +1,263 @@
+/**************************************************************************************************
+ *
+ *      Cooperative task scheduler - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Runs the routine jobs from loop() and keeps a record of how long each one takes so it is
+ *      easy to see what is using up the time (see http://x.x.x.x/tasks).
+ *
+ *      Tasks which run periodically are kept in a 'timer wheel', this is a ring of slots (one per
+ *      10ms) and each task is placed in the slot for when it is next due so finding the tasks
+ *      to run only means looking at one slot each tick however many tasks there are.
+ *      Tasks with a period of 0 are run on every pass of loop().
+ *      The number of tasks there is room for is set with taskMax in the main sketch.
+ *
+ *      Usage:   taskAdd("name", function, period);        period in ms (0 = every time round loop)
+ *               taskAdd("name", function, period, deadline);
+ *                   deadline = how late (ms) the task can run before it is counted as missed
+ *                              (default = the period)
+ *
+ **************************************************************************************************/
+
+
+// forward declarations (i.e. details of all functions in this file)
+  typedef void (*taskFunction)();
+  int taskAdd(const char*, taskFunction, uint32_t, uint32_t = 0);
+  void schedulerLoop();
+  void handleTasks();
+
+
+// ----------------------------------------------------------------
+//                              -Startup
+// ----------------------------------------------------------------
+
+  // taskMax (the most tasks there can be) is set in the main sketch
+  const uint16_t taskNone = 0xFFFF;         // (no task)
+  const uint16_t wheelSlots = 64;           // number of slots in timer wheel (must be a power of 2)
+  const uint16_t wheelTick = 10;            // time covered by each slot (ms)
+
+  struct Task {
+    const char* name = "";
+    taskFunction function = nullptr;
+    uint32_t period = 0;                    // how often to run (ms), 0 = every time round loop
+    uint32_t deadline = 0;                  // how late it can run before counting as a miss (ms)
+    uint32_t due = 0;                       // millis() when next due
+    uint32_t rounds = 0;                    // turns of the timer wheel left before it is due
+    uint16_t next = taskNone;               // next task in the same wheel slot (or the next every pass task)
+    // statistics
+    uint32_t runs = 0;                      // times run
+    uint64_t totalUs = 0;                   // total time spent running (microseconds)
+    uint32_t maxUs = 0;                     // longest run (microseconds)
+    uint32_t misses = 0;                    // times it ran later than its deadline
+  };
+
+  Task tasks[taskMax];
+  uint16_t taskCount = 0;
+  uint16_t taskEveryFirst = taskNone;       // tasks run every pass of loop (in the order they were added)
+  uint16_t taskEveryLast = taskNone;
+  uint16_t wheel[wheelSlots];               // first task in each slot
+  uint32_t wheelTickNow = 0;                // ticks since the scheduler started (a count, so it carries on when millis() wraps round)
+  uint32_t wheelTickMs = 0;                 // millis() when tick wheelTickNow started
+  uint32_t wheelTickDone = 0;               // last tick which has been processed
+  bool wheelReady = 0;
+  uint32_t schedulerPasses = 0;             // number of times schedulerLoop() has run
+  uint64_t schedulerOverheadUs = 0;         // time spent by the scheduler itself (microseconds)
+  uint32_t schedulerStatsStart = millis();  // time statistics were started
+
+
+// ----------------------------------------------------------------
+//                     -move the wheel's clock on
+// ----------------------------------------------------------------
+// counts the ticks from the time passed since the last one rather than from millis() itself so
+// nothing changes when millis() wraps round (every 49.7 days)
+
+void wheelClock() {
+  uint32_t ticks = (uint32_t)(millis() - wheelTickMs) / wheelTick;
+  wheelTickNow += ticks;
+  wheelTickMs += ticks * wheelTick;
+}
+
+
+// ----------------------------------------------------------------
+//                   -place a task in the timer wheel
+// ----------------------------------------------------------------
+
+void wheelInsert(uint16_t id) {
+
+  // the tick it is due on, worked out from the time left until it is due (not from how far the wheel has got,
+  // as that lags behind while catching up after a slow task) but never earlier than the next tick to be processed
+    int32_t left = (int32_t)(tasks[id].due - wheelTickMs);
+    uint32_t dueTick = wheelTickNow;
+    if (left > 0) dueTick += (left + wheelTick - 1) / wheelTick;         // (rounded up so it is never run early)
+    if ((int32_t)(dueTick - (wheelTickDone + 1)) < 0) dueTick = wheelTickDone + 1;
+    uint16_t slot = dueTick & (wheelSlots - 1);
+
+  tasks[id].rounds = (dueTick - wheelTickDone - 1) / wheelSlots;
+  tasks[id].next = wheel[slot];
+  wheel[slot] = id;
+}
+
+
+// ----------------------------------------------------------------
+//                         -add a task
+// ----------------------------------------------------------------
+// returns the task number (-1 if there is no room)
+
+int taskAdd(const char* name, taskFunction function, uint32_t period, uint32_t deadline) {
+
+  if (!wheelReady) {
+    for (int i=0; i < wheelSlots; i++) wheel[i] = taskNone;
+    wheelTickNow = wheelTickDone = 0;
+    wheelTickMs = millis();
+    wheelReady = 1;
+  }
+  if (taskCount >= taskMax) {
+    DEBUG_ERROR("Error: no room for task '%s' (see taskMax)", name);
+    return -1;
+  }
+
+  uint16_t id = taskCount++;
+  tasks[id] = Task();
+  tasks[id].name = name;
+  tasks[id].function = function;
+  tasks[id].period = period;
+  tasks[id].deadline = (deadline > 0) ? deadline : period;
+  tasks[id].due = millis() + period;
+  if (period > 0) {
+    wheelClock();
+    wheelInsert(id);
+  } else {
+    if (taskEveryLast == taskNone) taskEveryFirst = id;
+    else tasks[taskEveryLast].next = id;
+    taskEveryLast = id;
+  }
+  return id;
+}
+
+
+// ----------------------------------------------------------------
+//                 -run a task and record its timing
+// ----------------------------------------------------------------
+
+void taskRun(uint16_t id) {
+
+  Task &t = tasks[id];
+  if (t.period > 0 && (uint32_t)(millis() - t.due) > t.deadline) t.misses++;
+
+  LOOP_SCOPE(t.name);
+  uint32_t startUs = micros();
+  t.function();
+  uint32_t tookUs = micros() - startUs;
+
+  t.runs++;
+  t.totalUs += tookUs;
+  if (tookUs > t.maxUs) t.maxUs = tookUs;
+}
+
+
+// ----------------------------------------------------------------
+//            -run any tasks which are due (called from loop)
+// ----------------------------------------------------------------
+
+void schedulerLoop() {
+
+  uint32_t startUs = micros();
+  uint32_t taskUs = 0;
+  schedulerPasses++;
+
+  // tasks which run every time
+    for (uint16_t id = taskEveryFirst; id != taskNone; id = tasks[id].next) {
+      uint32_t t = micros();
+      taskRun(id);
+      taskUs += micros() - t;
+    }
+
+  // process each wheel tick since last time (at most one turn of the wheel per pass, the rest on the next)
+    wheelClock();
+    for (uint16_t n=0; n < wheelSlots && wheelTickDone != wheelTickNow; n++) {
+      wheelTickDone++;
+      uint16_t slot = wheelTickDone & (wheelSlots - 1);
+
+      // take the tasks which are due out of the slot
+        uint16_t dueList = taskNone;
+        uint16_t *link = &wheel[slot];
+        while (*link != taskNone) {
+          uint16_t id = *link;
+          if (tasks[id].rounds > 0) {
+            tasks[id].rounds--;                          // not due until a later turn of the wheel
+            link = &tasks[id].next;
+          } else {
+            *link = tasks[id].next;
+            tasks[id].next = dueList;
+            dueList = id;
+          }
+        }
+
+      // run them and put them back in the wheel for next time
+        while (dueList != taskNone) {
+          uint16_t id = dueList;
+          dueList = tasks[id].next;
+          uint32_t t = micros();
+          taskRun(id);
+          taskUs += micros() - t;
+          Task &task = tasks[id];
+          task.due += task.period;
+          if ((int32_t)(millis() - task.due) >= 0) task.due = millis() + task.period;    // fallen behind so don't try to catch up
+          wheelInsert(id);
+        }
+    }
+
+  schedulerOverheadUs += (micros() - startUs) - taskUs;
+}
+
+
+// ----------------------------------------------------------------
+//     -task statistics web page requested    i.e. http://x.x.x.x/tasks
+// ----------------------------------------------------------------
+
+void handleTasks() {
+
+  MeteredClient client = server.client();                     // open link with client
+
+  webheader(client);                                       // send html page header
+
+  uint32_t elapsed = millis() - schedulerStatsStart;
+  if (elapsed == 0) elapsed = 1;
+
+  client.print("<P>\n");
+  client.print("<br>TASKS<br><br>\n");
+  client.print("<table style='margin: auto;' border='1' cellpadding='4'>\n");
+  client.print("<tr><th>Task</th><th>Period (ms)</th><th>Runs</th><th>Average (us)</th><th>Max (us)</th><th>Total (ms)</th><th>% of time</th><th>Missed</th></tr>\n");
+  for (uint16_t i=0; i < taskCount; i++) {
+    Task &t = tasks[i];
+    client.printf("<tr><td>%s</td><td>%u</td><td>%u</td><td>%u</td><td>%u</td><td>%u</td><td>%.1f</td><td>%u</td></tr>\n",
+                  t.name, t.period, t.runs, t.runs ? (uint32_t)(t.totalUs / t.runs) : 0, t.maxUs, (uint32_t)(t.totalUs / 1000),
+                  t.totalUs / (elapsed * 10.0), t.misses);
+  }
+  client.print("</table>\n");
+  client.printf("<br>Loop passes: %u, scheduler overhead: %u ms total (%.2f us per pass)<br>\n",
+                schedulerPasses, (uint32_t)(schedulerOverheadUs / 1000), schedulerPasses ? (float)schedulerOverheadUs / schedulerPasses : 0.0);
+
+  // reset statistics if requested
+    if (requestBegin(client).has("reset")) {
+      for (uint16_t i=0; i < taskCount; i++) {
+        tasks[i].runs = 0;
+        tasks[i].totalUs = 0;
+        tasks[i].maxUs = 0;
+        tasks[i].misses = 0;
+      }
+      schedulerPasses = 0;
+      schedulerOverheadUs = 0;
+      schedulerStatsStart = millis();
+    }
+  client.print("<br><a href='/tasks?reset=1'>reset statistics</a><br>\n");
+
+  client.print("</P>\n");
+  webfooter(client);                                       // send html page footer
+  delay(3);
+  client.stop();
+}
+
+
+// --------------------------- E N D -----------------------------
@@ -0,0 +1,51 @@
+/**************************************************************************************************
+ *
+ *      Tagged scopes - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Marks which part of the sketch is currently running so that when something takes too
+ *      long it can be identified (see stall.h) and to show where the time goes (see profiler.h).
+ *
+ *      Usage:   place   LOOP_SCOPE("name");   at the start of a function (or any block of code),
+ *               it is marked as running until the end of the block.
+ *               Scopes can be nested, scopeCurrent is the innermost one running.
+ *
+ *      This only costs a few instructions and nothing at all if ENABLE_STALLS and ENABLE_PROFILER are 0
+ *
+ **************************************************************************************************/
+
+
+#if ENABLE_STALLS || ENABLE_PROFILER
+
+  struct LoopScope {
+    const char* name;
+    LoopScope* prev;                        // the scope this one is inside (nullptr = none)
+    LoopScope(const char* n);
+    ~LoopScope();
+  };
+
+  #if ENABLE_DUALCORE
+    // each core has its own scopes (the interrupts read the ones for the core they are running on)
+      LoopScope* volatile scopeCores[2] = {nullptr, nullptr};
+      #define scopeCurrent scopeCores[xPortGetCoreID()]
+  #else
+    LoopScope* volatile scopeCurrent = nullptr; // innermost scope currently running
+  #endif
+
+  // the scopes are read from timer interrupts so make sure name and prev are stored before it is linked in
+  inline LoopScope::LoopScope(const char* n) : name(n), prev(scopeCurrent) { asm volatile ("" ::: "memory"); scopeCurrent = this; }
+  inline LoopScope::~LoopScope() { scopeCurrent = prev; }
+
+  #define LOOP_SCOPE_JOIN(a, b) a##b
+  #define LOOP_SCOPE_VAR(line) LOOP_SCOPE_JOIN(_loopScope, line)
+  #define LOOP_SCOPE(name) LoopScope LOOP_SCOPE_VAR(__LINE__)(name)
+
+#else
+
+  #define LOOP_SCOPE(name)
+
+#endif
+
+
+// --------------------------- E N D -----------------------------
@@ -0,0 +1,201 @@
+/**************************************************************************************************
+ *
+ *      Loop stall detector - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      A hardware timer checks every 'stallTick' ms that loop() is still going round, if a pass of
+ *      loop takes longer than 'stallThreshold' ms it records which tagged scope (see scope.h) was
+ *      running at the time.  When the pass finally finishes the stall is added to a table of the
+ *      worst offenders which can be seen at http://x.x.x.x/stalls and new worst cases are also
+ *      written to the log.
+ *
+ *      The interrupt only counts and compares so this costs almost nothing when there are no stalls.
+ *
+ *      Note: on the esp8266 this takes timer1, which analogWrite(), tone() and the Servo library also
+ *            use, so it can not be enabled in a sketch which uses any of them (timer 1 on the esp32
+ *            core 2.x, core 3.x picks a free one).
+ *
+ **************************************************************************************************/
+
+
+// forward declarations (i.e. details of all functions in this file)
+  void stallSetup();
+  void stallLoop();
+  void handleStalls();
+
+
+// ----------------------------------------------------------------
+//                              -Startup
+// ----------------------------------------------------------------
+
+  const uint16_t stallTick = 50;            // how often the timer checks on loop (ms)
+  const byte stallMaxSites = 12;            // number of different places stalls are recorded for
+
+  #if defined ESP32
+    #define STALL_IRAM IRAM_ATTR              // interrupt routines need to be in ram
+  #else
+    #define STALL_IRAM ICACHE_RAM_ATTR
+  #endif
+
+  struct StallSite {
+    const char* name = nullptr;             // scope which was running (nullptr = not in use)
+    uint32_t count = 0;                     // number of stalls
+    uint32_t totalMs = 0;                   // total time stalled
+    uint32_t maxMs = 0;                     // longest stall
+    uint32_t lastTime = 0;                  // millis() of the last stall
+  };
+
+  StallSite stallSites[stallMaxSites];
+  uint32_t stallTotal = 0;                  // total number of stalls
+  uint32_t stallDropped = 0;                // stalls not recorded as the table was full
+
+  // shared with the interrupt
+    volatile uint32_t stallTicks = 0;         // timer ticks since startup
+    volatile uint32_t stallPassTick = 0;      // tick count at start of this pass of loop
+    volatile bool stallFlag = 0;              // this pass of loop has stalled
+    const char* volatile stallScope = nullptr;   // scope running when the stall was spotted
+
+  uint32_t stallPassStart = 0;              // millis() at start of this pass of loop
+
+  #if defined ESP32
+    hw_timer_t* stallTimer = nullptr;
+  #endif
+
+
+// ----------------------------------------------------------------
+//                -timer interrupt - check loop is running
+// ----------------------------------------------------------------
+
+void STALL_IRAM stallISR() {
+  uint32_t t = stallTicks + 1;
+  stallTicks = t;
+  if (stallFlag) return;
+  if (t - stallPassTick >= (uint32_t)(stallThreshold / stallTick)) {
+    stallFlag = 1;
+    LoopScope* s = scopeCurrent;
+    stallScope = (s) ? s->name : nullptr;
+  }
+}
+
+
+// ----------------------------------------------------------------
+//                    -start the stall detector
+// ----------------------------------------------------------------
+// called from setup
+
+void stallSetup() {
+
+  stallPassStart = millis();
+  stallPassTick = stallTicks;
+
+  #if defined ESP32 && ESP_ARDUINO_VERSION_MAJOR >= 3
+    stallTimer = timerBegin(1000000);                          // 1MHz (esp32 core 3.x picks a free timer)
+    timerAttachInterrupt(stallTimer, &stallISR);
+    timerAlarm(stallTimer, stallTick * 1000UL, true, 0);
+  #elif defined ESP32
+    stallTimer = timerBegin(1, 80, true);                      // timer 1, 1MHz
+    timerAttachInterrupt(stallTimer, &stallISR, true);
+    timerAlarmWrite(stallTimer, stallTick * 1000UL, true);
+    timerAlarmEnable(stallTimer);
+  #else
+    timer1_attachInterrupt(stallISR);
+    timer1_enable(TIM_DIV256, TIM_EDGE, TIM_LOOP);             // 80MHz / 256 = 312.5 ticks per ms
+    timer1_write(stallTick * 312UL + stallTick / 2);
+  #endif
+}
+
+
+// ----------------------------------------------------------------
+//                    -record a stall in the table
+// ----------------------------------------------------------------
+
+void stallRecord(const char* name, uint32_t duration) {
+
+  stallTotal++;
+  if (!name) name = "loop (untagged)";
+
+  // find the site or a free slot for it
+    int found = -1;
+    for (int i=0; i < stallMaxSites; i++) {
+      if (stallSites[i].name == name) { found = i; break; }
+      if (found == -1 && stallSites[i].name == nullptr) found = i;
+    }
+    if (found == -1) {
+      stallDropped++;
+      return;
+    }
+
+  StallSite &site = stallSites[found];
+  bool worst = (site.name == nullptr || duration > site.maxMs);
+  site.name = name;
+  site.count++;
+  site.totalMs += duration;
+  site.lastTime = millis();
+  if (duration > site.maxMs) site.maxMs = duration;
+
+  // only log the new worst cases so a regular stall does not fill the log
+    if (worst) logMessage(logWarning, "Loop stalled for %ums in %s", (unsigned)duration, name);
+}
+
+
+// ----------------------------------------------------------------
+//              -mark the start of each pass of loop
+// ----------------------------------------------------------------
+// called at the start of loop()
+
+void stallLoop() {
+
+  uint32_t now = millis();
+  // (the interrupt only counts whole ticks so it can flag a pass up to one tick short of the threshold)
+  if (stallFlag && now - stallPassStart >= stallThreshold) stallRecord(stallScope, now - stallPassStart);
+
+  stallPassStart = now;
+  stallPassTick = stallTicks;
+  stallFlag = 0;
+}
+
+
+// ----------------------------------------------------------------
+//        -stalls web page requested    i.e. http://x.x.x.x/stalls
+// ----------------------------------------------------------------
+
+void handleStalls() {
+
+  MeteredClient client = server.client();                  // open link with client
+
+  webheader(client);                                       // send html page header
+
+  client.print("<P>\n");
+  client.printf("<br>LOOP STALLS (passes of loop taking over %dms)<br><br>\n", stallThreshold);
+  client.print("<table style='margin: auto;' border='1' cellpadding='4'>\n");
+  client.print("<tr><th>Running</th><th>Stalls</th><th>Longest (ms)</th><th>Average (ms)</th><th>Total (ms)</th><th>Last (seconds ago)</th></tr>\n");
+
+  // worst offenders first
+    bool shown[stallMaxSites] = {0};
+    for (int n=0; n < stallMaxSites; n++) {
+      int worst = -1;
+      for (int i=0; i < stallMaxSites; i++) {
+        if (shown[i] || stallSites[i].name == nullptr) continue;
+        if (worst == -1 || stallSites[i].totalMs > stallSites[worst].totalMs) worst = i;
+      }
+      if (worst == -1) break;
+      shown[worst] = 1;
+      StallSite &s = stallSites[worst];
+      client.printf("<tr><td>%s</td><td>%u</td><td>%u</td><td>%u</td><td>%u</td><td>%u</td></tr>\n",
+                    s.name, s.count, s.maxMs, s.totalMs / s.count, s.totalMs, (millis() - s.lastTime) / 1000);
+    }
+  client.print("</table>\n");
+
+  client.printf("<br>Total stalls: %u", stallTotal);
+  if (stallDropped) client.printf(" (%u not recorded as table full)", stallDropped);
+  client.print("<br>\n");
+
+  client.print("</P>\n");
+  webfooter(client);                                       // send html page footer
+  delay(3);
+  client.stop();
+}
+
+
+// --------------------------- E N D -----------------------------
@@ -9,7 +9,18 @@
 
 
 // forward declarations (i.e. details of all functions in this file)
-  void log_system_message(String);
+  void log_system_message(const char*, ...);
+  void log_system_message(const String&);
+  void logMessage(byte, const char*, ...);
+  void logMessageV(byte, const char*, va_list);
+  byte logCaller();
+  int logTimeStamp(char*, size_t);
+  bool logFilter(byte, const char*);
+  bool logSend(const char*, byte, bool);
+  void logAdd(const char*, byte, bool);
+  void logStore(const char*);
+  const char* logEntry(int);
+  uint16_t logEntryRepeats(int);
   void webheader();
   void webfooter();
   void handleLogpage();
@@ -28,25 +39,209 @@
   const char colblue[] = "<font color='#0000FF'>";          // blue text
   const char colEnd[] = "</font>";                          // end coloured text
 
-String system_message[LogNumber + 1];                       // system log message store
+// system log message store (fixed size so storing messages does not break up the heap)
+  char system_message[LogNumber + 1][LogLength];
+  uint16_t logRepeats[LogNumber + 1];                       // number of times each entry was repeated
+  byte logNewest = LogNumber;                               // entry holding the most recent message
+  byte logNewestFrom = 0xFF;                                // who logged the most recent entry (0xFF = it can not be repeated)
+
+// log message levels (messages below LogLevel are not stored, see settings)
+  enum logLevels { logDebug, logInfo, logWarning, logError };
+  const char* const logLevelText[] = { "Debug: ", "", "Warning: ", "Error: " };
+
+// rate limiting - each message (i.e. each place in the sketch which logs one) can only be stored
+// logRateBurst times in logRatePeriod, any more are counted but not stored
+  const byte logTypeSlots = 16;                             // number of messages which are limited separately (must be a power of 2)
+  const uint32_t logRatePeriod = 60000;                     // (ms)
+  const byte logRateBurst = 5;
+
+  struct LogType {
+    const char* fmt;                                        // the message (nullptr = not used)
+    uint32_t periodStart;                                   // millis() when this period started
+    uint16_t count;                                         // number stored this period
+    uint16_t dropped;                                       // number not stored this period
+  };
+// the checks are made by whoever logs the message so each has its own limits and counts
+// (with ENABLE_DUALCORE loop and the web server task, see logCaller(), so neither waits for the other)
+  #if ENABLE_DUALCORE
+    const byte logCallers = 2;
+  #else
+    const byte logCallers = 1;
+  #endif
+  LogType logTypes[logCallers][logTypeSlots];
+  uint32_t logDropped[logCallers];                          // total messages not stored as they were rate limited
+  uint32_t logFiltered[logCallers];                         // total messages below LogLevel
+  char logLast[logCallers][LogLength];                      // the last message each logged (without the time) to spot repeats
 
 
 // ----------------------------------------------------------------
 //                      -log a system message  
 // ----------------------------------------------------------------
+// printf style e.g.  log_system_message("Wifi connected");
+//                    logMessage(logWarning, "Loop stalled for %ums in %s", duration, name);
+//
+// the level and rate limit are checked from the text passed before anything is formatted so messages
+// which are not stored take very little time:
+//    below LogLevel                                  not stored
+//    more than logRateBurst in logRatePeriod         counted (the number is logged when it is next stored)
+//    exactly the same as the most recent log entry   that entry's repeat count goes up (shown on the log page)
+// Note: the text passed must be fixed (e.g. "text" not a buffer which changes) as it is used to identify the
+//       message for rate limiting
+// With ENABLE_DUALCORE messages logged from loop are checked the same way then passed to the web server
+// task which owns the log (see dualcore.h), a repeat only counts if it is from the same core.
+
+void log_system_message(const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  logMessageV(logInfo, fmt, args);
+  va_end(args);
+}
+
+// (all messages passed as a String are treated as one message when rate limiting, but only exact repeats are collapsed)
+void log_system_message(const String &smes) {
+  logMessage(logInfo, "%s", smes.c_str());
+}
+
+void logMessage(byte level, const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  logMessageV(level, fmt, args);
+  va_end(args);
+}
+
+void logMessageV(byte level, const char* fmt, va_list args) {
 
-void log_system_message(String smes) {
+  byte from = logCaller();
+
+  if (level < LogLevel) {
+    logFiltered[from]++;
+    return;
+  }
+
+  LOOP_SCOPE("log_system_message");
+
+  if (!logFilter(from, fmt)) return;
+
+  char entry[LogLength];                                    // (messages longer than LogLength are cut short)
+  int len = logTimeStamp(entry, sizeof(entry));
+  int body = len;
+  len += snprintf(entry + len, sizeof(entry) - len, "%s", logLevelText[level]);
+  if (len < (int)sizeof(entry)) vsnprintf(entry + len, sizeof(entry) - len, fmt, args);
+
+  // the same as the last message logged from here (ignoring the time)
+    bool repeat = logLast[from][0] && strcmp(entry + body, logLast[from]) == 0;
+    if (!repeat) strcpy(logLast[from], entry + body);
+
+  if (!logSend(entry, from, repeat)) logLast[from][0] = 0;
+}
 
-  //scroll old log entries up 
-    for (int i=0; i < LogNumber; i++){
-      system_message[i]=system_message[i+1];
+// who is logging a message (0 = the web server task or the only one, 1 = loop when ENABLE_DUALCORE)
+byte logCaller() {
+  #if ENABLE_DUALCORE
+    return onWebTask() ? 0 : 1;
+  #else
+    return 0;
+  #endif
+}
+
+// start a log entry with the time, returns its length
+int logTimeStamp(char* entry, size_t size) {
+  #if ENABLE_DUALCORE
+    int len = snprintf(entry, size, "%s - ", statusRead().time);              // (the time as loop last published it, see status.h)
+  #else
+    int len = snprintf(entry, size, "%s - ", currentTime().c_str());
+  #endif
+  return (len >= (int)size) ? size - 1 : len;
+}
+
+// rate limit a message (before it is formatted), returns 0 if it should not be stored
+bool logFilter(byte from, const char* fmt) {
+
+  // find the message in the rate limits (if the table is full the one with the oldest period is replaced)
+    uint32_t t = millis();
+    byte slot = ((uint32_t)(uintptr_t)fmt * 2654435761u) >> 24 & (logTypeSlots - 1);
+    LogType* lt = nullptr;
+    for (byte n=0; n < logTypeSlots; n++, slot = (slot + 1) & (logTypeSlots - 1)) {
+      LogType &e = logTypes[from][slot];
+      if (e.fmt == fmt || !e.fmt) {
+        lt = &e;
+        break;
+      }
+      if (!lt || (int32_t)(e.periodStart - lt->periodStart) < 0) lt = &e;
+    }
+    if (lt->fmt != fmt) {
+      lt->fmt = fmt;
+      lt->periodStart = t;
+      lt->count = 0;
+      lt->dropped = 0;
     }
 
-  // add the new message to the end
-    system_message[LogNumber] = currentTime() + " - " + smes;
-  
+  // start a new period (noting how many were not stored in the last one)
+    if ((uint32_t)(t - lt->periodStart) >= logRatePeriod) {
+      if (lt->dropped) {
+        char entry[LogLength];
+        int len = logTimeStamp(entry, sizeof(entry));
+        snprintf(entry + len, sizeof(entry) - len, "%u more '%.30s' messages were not logged", lt->dropped, fmt);
+        logSend(entry, from, 0);
+        logLast[from][0] = 0;                               // (so the next message is not counted as a repeat of the entry before the note)
+      }
+      lt->periodStart = t;
+      lt->count = 0;
+      lt->dropped = 0;
+    }
+
+  if (lt->count >= logRateBurst) {
+    if (lt->dropped < 0xFFFF) lt->dropped++;
+    logDropped[from]++;
+    logLast[from][0] = 0;                                   // (so the next message is not counted as a repeat of the entry before this)
+    return 0;
+  }
+  lt->count++;
+  return 1;
+}
+
+// pass an entry to the log, returns 0 if it could not be (from loop it goes to the web server task
+// which owns the log, see dualcore.h)
+bool logSend(const char* entry, byte from, bool repeat) {
+  #if ENABLE_DUALCORE
+    if (from != 0) return logQueueAdd(entry, from, repeat);
+  #endif
+  logAdd(entry, from, repeat);
+  return 1;
+}
+
+// add a message to the log, or count it as a repeat if it is the same as the most recent entry and from
+// the same place (only called from the web server task when ENABLE_DUALCORE)
+void logAdd(const char* entry, byte from, bool repeat) {
+  if (repeat && logNewestFrom == from) {
+    logRepeats[logNewest]++;
+    return;
+  }
+  logStore(entry);
+  logNewestFrom = from;
+}
+
+// store an entry in the log (replacing the oldest one)
+void logStore(const char* entry) {
+
+  logNewest = (logNewest + 1) % (LogNumber + 1);
+  strncpy(system_message[logNewest], entry, LogLength - 1);
+  system_message[logNewest][LogLength - 1] = 0;
+  logRepeats[logNewest] = 0;
+  logNewestFrom = 0xFF;                                     // (set by logAdd() for the messages which can be repeated)
+
   // also send message to serial port
-    if (serialDebug) Serial.println("Log:" + system_message[LogNumber]);
+    DEBUG_INFO("Log:%s", system_message[logNewest]);
+}
+
+// log entry, 0 = most recent, 1 = the one before etc.
+const char* logEntry(int back) {
+  return system_message[(logNewest + LogNumber + 1 - back) % (LogNumber + 1)];
+}
+
+// number of times a log entry was repeated
+uint16_t logEntryRepeats(int back) {
+  return logRepeats[(logNewest + LogNumber + 1 - back) % (LogNumber + 1)];
 }
 
 
@@ -57,34 +252,10 @@ void log_system_message(String smes) {
 //    additional style settings can be included and auto page refresh rate
 
 
-void webheader(WiFiClient &client, char style[] = " ", int refresh = 0) {
-
-  client.print (R"=====(
-    <!DOCTYPE html>
-    <html lang='en'>
-    <head>
-      <meta name='viewport' content='width=device-width, initial-scale=1.0'>
-  )=====");
-  if (refresh > 0) client.print( "<meta http-equiv='refresh' content='" + String(refresh) + "'>\n");    // auto refresh page
-  client.printf("<title> %s </title>\n", stitle);                                                       // insert sketch title
-  client.print (R"=====(
-    <style> 
-      ul {list-style-type: none; margin: 0; padding: 0; overflow: hidden; background-color: rgb(128, 64, 0);} 
-      li {float: left;}
-      li a {display: inline-block; color: white; text-align: center; padding: 30px 20px; text-decoration: none;}
-      li a:hover { background-color: rgb(100, 0, 0);}
-  )=====");
-  client.print(style);                                                                                  // insert aditional style if supplied 
-  client.print (R"=====(
-    </style>
-    </head>
-      <body style='color: rgb(0, 0, 0); background-color: yellow; text-align: center;'>
-      <ul>
-  )=====");
-  client.printf("<li><a href='%s'>Home</a></li>", HomeLink);                                          // home page url
-  client.print("<li><a href='/log'>Log</a></li>");                                                    // log menu button 
-  client.printf("<h1> <font color='#FF0000'>%s</h1></font>", stitle);                                 // sketch title
-  client.print("</ul>");
+void webheader(Print &client, const char* style = " ", int refresh = 0) {
+
+  TRACE_SCOPE(trWebheader);
+  render_header(client, refresh > 0, refresh, stitle, style, HomeLink);        // see templates/header.html
 }
 
 
@@ -93,41 +264,28 @@ void webheader(WiFiClient &client, char style[] = " ", int refresh = 0) {
 // ----------------------------------------------------------------
 // HTML at the end of each web page
 
-void webfooter(WiFiClient &client) {
-
-   // get mac address
-     byte mac[6];
-     WiFi.macAddress(mac);
-   
-   client.print("<br>\n"); 
-   
-   /* Status display at bottom of screen */
-   client.print("<div style='text-align: center;background-color:rgb(128, 64, 0)'>\n");
-   client.printf("<small> %s", colRed); 
-   client.printf("%s %s", stitle, sversion); 
-   client.printf(" | Memory: %dK", ESP.getFreeHeap() /1000); 
-   client.printf(" | Wifi: %ddBm", WiFi.RSSI()); 
-   
+void webfooter(Print &client) {
+
+   TRACE_SCOPE(trWebfooter);
+
+   StatusSnapshot status = statusRead();     // wifi, ntp, free memory etc. (see status.h)
+
   // NTP server link status
-    int tstat = timeStatus();   // ntp status
-    if (tstat == timeSet) client.print(" | NTP OK");
-    else if (tstat == timeNeedsSync) client.print(" | NTP Sync failed");
-    else if (tstat == timeNotSet) client.print(" | NTP Failed");
+    const char* ntp = "";
+    if (status.ntp == timeSet) ntp = " | NTP OK";
+    else if (status.ntp == timeNeedsSync) ntp = " | NTP Sync failed";
+    else if (status.ntp == timeNotSet) ntp = " | NTP Failed";
 
+  // GSM board link status
+    const char* gsm = "";
   #if ENABLE_GSM
-    // GSM board link status
-      if (GSMconnected) client.print(" | GSM OK");
-      else client.print(" | GSM Not Responding");
+    gsm = status.gsm ? " | GSM OK" : " | GSM Not Responding";
   #endif
-    
-   // client.printf(" | Spiffs: %dK", ( SPIFFS.totalBytes() - SPIFFS.usedBytes() / 1000 ) );             // if using spiffs 
-   // client.printf(" | MAC: %2x%2x%2x%2x%2x%2x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);       // mac address
-   client.printf("%s </small>\n", colEnd);
-   client.print("</div>\n"); 
-     
-  /* end of HTML */  
-   client.print("</body>\n");
-   client.print("</html>\n");
+
+   // to show more in the status line add it to templates/footer.html e.g.
+   //   Spiffs: ( SPIFFS.totalBytes() - SPIFFS.usedBytes() / 1000 )
+   //   MAC: WiFi.macAddress() (or add it to StatusSnapshot in status.h so it is not read for every page)
+   render_footer(client, stitle, sversion, status.heap /1000, status.rssi, ntp, gsm);     // see templates/footer.html
 
 }
 
@@ -135,16 +293,11 @@ void webfooter(WiFiClient &client) {
 // ----------------------------------------------------------------
 //   -log web page requested    i.e. http://x.x.x.x/log
 // ----------------------------------------------------------------
+// http://x.x.x.x/log/10 shows only the 10 most recent entries
 
 void handleLogpage() {
 
-  WiFiClient client = server.client();                     // open link with client
-
-  // log page request including clients IP address
-      IPAddress cip = client.remoteIP();
-      log_system_message("Log page requested from: " + String(cip[0]) +"." + String(cip[1]) + "." + String(cip[2]) + "." + String(cip[3]));   
-      // To send to serial port use: Serial.println(cip.toString());
-      
+  MeteredClient client = server.client();                     // open link with client
 
     // build the html for /log page
 
@@ -154,15 +307,24 @@ void handleLogpage() {
   
       client.print("<br>SYSTEM LOG<br><br>\n");
   
-      // list all system messages
-      for (int i=LogNumber; i != 0; i--){
-        client.print(system_message[i].c_str());
-        if (i == LogNumber) {
+      // list the system messages
+      int lines = LogNumber;
+      if (routeParamCount) lines = constrain(routeParam("lines").toInt(), 1, LogNumber);
+      for (int i=0; i < lines; i++){
+        client.print(logEntry(i));
+        if (logEntryRepeats(i)) client.printf("%s  {repeated %u times} %s", colblue, logEntryRepeats(i), colEnd);
+        if (i == 0) {
           client.printf("%s  {Most Recent Entry} %s", colRed, colEnd);          // build line of html
         }
         client.print("<br>\n");    // new line
       }
     
+      uint32_t dropped = 0, filtered = 0;
+      for (byte i=0; i < logCallers; i++) {
+        dropped += logDropped[i];
+        filtered += logFiltered[i];
+      }
+      if (dropped || filtered) client.printf("<br>%u messages not logged as they were repeated too often, %u below the log level<br>\n", dropped, filtered);
       client.print("<br>");
     
       // close html page
@@ -178,24 +340,35 @@ void handleLogpage() {
 // ----------------------------------------------------------------
 
 void handleNotFound() {
+
+  #if ENABLE_ADMISSION
+    if (!admitRequest(routeBogus)) return;                    // (client is sending too many requests)
+  #endif
+  #if ENABLE_ACCESS
+    accessBegin();                                            // (see access.h)
+  #endif
   
+  MeteredClient client = server.client();
+  RequestContext &req = requestBegin(client);                 // arguments and client ip
+
   log_system_message("invalid web page requested");      
-  String message = "File Not Found\n\n";
-  message += "URI: ";
-  message += server.uri();
-  message += "\nMethod: ";
-  message += ( server.method() == HTTP_GET ) ? "GET" : "POST";
-  message += "\nArguments: ";
-  message += server.args();
-  message += "\n";
-
-  for ( uint8_t i = 0; i < server.args(); i++ ) {
-    message += " " + server.argName ( i ) + ": " + server.arg ( i ) + "\n";
-  }
 
-  server.send ( 404, "text/plain", message );
-  message = "";      // clear variable
-  
+  // build the reply in the request memory (see arena.h)
+    ArenaString message;
+    message.printf("File Not Found\n\nURI: %s\nMethod: %s\nArguments: %d\n",
+                   server.uri().c_str(), ( server.method() == HTTP_GET ) ? "GET" : "POST", req.count);
+    for ( uint8_t i = 0; i < req.count; i++ ) {
+      message.printf(" %s: %s\n", req.names[i].ptr, req.values[i].ptr);
+    }
+
+  client.printf("HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\nContent-Length: %u\r\nConnection: close\r\n\r\n", message.length());
+  client.write((const uint8_t*)message.c_str(), message.length());
+  delay(3);
+  client.stop();
+
+  #if ENABLE_ACCESS
+    accessEnd("(invalid page)");
+  #endif
 }
 
 
@@ -227,7 +400,7 @@ void WIFIcheck() {
   
     if (WiFi.status() != WL_CONNECTED) {
       if ( wifiok == 1) {
-        log_system_message("Wifi connection lost");          // log system message if wifi was ok but now down
+        logMessage(logWarning, "Wifi connection lost");     // log system message if wifi was ok but now down
         wifiok = 0;                                          // flag problem with wifi
       }
     } else { 
@@ -235,6 +408,7 @@ void WIFIcheck() {
       if ( wifiok == 0) {
         log_system_message("Wifi connection is back");       // log system message if wifi was down but now back
         wifiok = 1;                                          // flag wifi is now ok
+        wifiReconnects++;
       }
     }
 
@@ -0,0 +1,126 @@
+/**************************************************************************************************
+ *
+ *      Status snapshot - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      The status shown on the web pages (time, wifi signal, free memory, NTP and GSM status) is
+ *      gathered once a second by a task run from loop, so the web pages just read a copy of it rather
+ *      than each one working it out (reading the wifi signal level etc. takes a surprising amount of time).
+ *
+ *      Usage:   StatusSnapshot status = statusRead();
+ *               status.time      etc.
+ *
+ *      The reply for http://x.x.x.x/healthz (for a monitor or load balancer checking the device is
+ *      running) is also made here, so sending it is just copying ready made bytes - nothing is
+ *      worked out, allocated or logged for each request.
+ *
+ *      With ENABLE_DUALCORE the web pages are on the other core so the copy is protected with a
+ *      seqlock (see dualcore.h).
+ *
+ **************************************************************************************************/
+
+
+// forward declarations (i.e. details of all functions in this file)
+  void statusUpdate();
+
+
+// ----------------------------------------------------------------
+//                              -Startup
+// ----------------------------------------------------------------
+
+  struct StatusSnapshot {
+    char time[32];                          // currentTime()
+    uint32_t minute;                        // now() / 60
+    int rssi;                               // wifi signal level (dBm)
+    int ntp;                                // timeStatus()
+    bool gsm;                               // GSMconnected
+    uint32_t heap;                          // ESP.getFreeHeap()
+  };
+
+  const byte statusReplySize = 224;
+
+  struct StatusReply {
+    uint16_t len;
+    char text[statusReplySize];             // complete http reply including the headers
+  };
+
+  #if ENABLE_DUALCORE
+    SeqLock<StatusSnapshot> statusShared;
+    SeqLock<StatusReply> statusHealthz;
+  #else
+    StatusSnapshot statusShared;
+    StatusReply statusHealthz;
+  #endif
+
+
+// ----------------------------------------------------------------
+//                  -make the reply for /healthz
+// ----------------------------------------------------------------
+
+void statusHealthzBuild(const StatusSnapshot &s) {
+
+  char body[120];
+  int bodyLen = snprintf(body, sizeof(body), "{\"status\":\"ok\",\"uptime\":%u,\"heap\":%u,\"rssi\":%d,\"time_set\":%s}\n",
+                         (unsigned)(millis() / 1000), s.heap, s.rssi, (s.ntp == timeSet) ? "true" : "false");
+
+  StatusReply r;
+  r.len = snprintf(r.text, sizeof(r.text), "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                   "Cache-Control: no-store\r\nContent-Length: %d\r\nConnection: close\r\n\r\n%s", bodyLen, body);
+  if (r.len >= sizeof(r.text)) r.len = sizeof(r.text) - 1;
+
+  #if ENABLE_DUALCORE
+    statusHealthz.write(r);
+  #else
+    statusHealthz = r;
+  #endif
+}
+
+
+// ----------------------------------------------------------------
+//         -gather the status (a task run from loop once a second)
+// ----------------------------------------------------------------
+
+void statusUpdate() {
+
+  StatusSnapshot s;
+  snprintf(s.time, sizeof(s.time), "%s", currentTime().c_str());
+  s.minute = now() / 60;
+  s.rssi = WiFi.RSSI();
+  s.ntp = timeStatus();
+  s.gsm = GSMconnected;
+  s.heap = ESP.getFreeHeap();
+
+  #if ENABLE_DUALCORE
+    statusShared.write(s);
+  #else
+    statusShared = s;
+  #endif
+
+  statusHealthzBuild(s);
+}
+
+
+// ----------------------------------------------------------------
+//                      -get the current status
+// ----------------------------------------------------------------
+
+StatusSnapshot statusRead() {
+  #if ENABLE_DUALCORE
+    return statusShared.read();
+  #else
+    return statusShared;
+  #endif
+}
+
+// the reply for /healthz
+StatusReply statusHealthzRead() {
+  #if ENABLE_DUALCORE
+    return statusHealthz.read();
+  #else
+    return statusHealthz;
+  #endif
+}
+
+
+// --------------------------- E N D -----------------------------
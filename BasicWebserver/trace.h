@@ -0,0 +1,141 @@
+/**************************************************************************************************
+ *
+ *      Request tracing - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Records timestamped begin/end events in a ring buffer to show where the time goes when
+ *      handling individual web page requests.  http://x.x.x.x/trace.json gives the most recent
+ *      events in Chrome trace-event format which can be loaded in to chrome://tracing or
+ *      https://ui.perfetto.dev
+ *
+ *      Usage:   TRACE_BEGIN(tag);  ...  TRACE_END(tag);     or     TRACE_SCOPE(tag);  (until end of block)
+ *               tags are from the list below or can be added with traceTag("name")
+ *
+ *      If ENABLE_TRACE is 0 the macros compile to nothing.
+ *
+ *      Note: accepting the connection and reading the request is done inside server.handleClient()
+ *            so shows as the part of 'handleClient' before the page handler starts.
+ *
+ **************************************************************************************************/
+
+
+#if ENABLE_TRACE
+
+// forward declarations (i.e. details of all functions in this file)
+  uint16_t traceTag(const char*);
+  void handleTrace();
+
+
+// ----------------------------------------------------------------
+//                              -Startup
+// ----------------------------------------------------------------
+
+  const uint16_t traceSize = 256;           // number of events stored (must be a power of 2)
+  const byte traceMaxTags = 40;             // max number of different tags
+
+  // fixed tags
+    enum traceTags {trHandleClient, trHandler, trWebheader, trWebfooter, trFlush, trStop, trFixedTags};
+    const char* traceTagNames[traceMaxTags] = {"handleClient", "handler", "webheader", "webfooter", "flush", "client.stop"};
+    byte traceTagCount = trFixedTags;
+
+  struct TraceEvent {
+    uint32_t us;                            // micros() when it happened
+    uint16_t tag;
+    char phase;                             // 'B' = begin, 'E' = end
+  };
+
+  TraceEvent traceRing[traceSize];
+  uint32_t traceHead = 0;                   // number of events recorded
+  bool traceRecording = 1;                  // paused while the trace is being sent
+
+  inline void traceEvent(uint16_t tag, char phase) {
+    if (!traceRecording) return;
+    TraceEvent &e = traceRing[traceHead++ & (traceSize - 1)];
+    e.us = micros();
+    e.tag = tag;
+    e.phase = phase;
+  }
+
+  struct TraceScope {
+    uint16_t tag;
+    TraceScope(uint16_t t) : tag(t) { traceEvent(tag, 'B'); }
+    ~TraceScope() { traceEvent(tag, 'E'); }
+  };
+
+  #define TRACE_BEGIN(tag) traceEvent(tag, 'B')
+  #define TRACE_END(tag) traceEvent(tag, 'E')
+  #define TRACE_SCOPE_JOIN(a, b) a##b
+  #define TRACE_SCOPE_VAR(line) TRACE_SCOPE_JOIN(_traceScope, line)
+  #define TRACE_SCOPE(tag) TraceScope TRACE_SCOPE_VAR(__LINE__)(tag)
+
+
+// ----------------------------------------------------------------
+//                       -get tag for a name
+// ----------------------------------------------------------------
+// call when setting up (not every time it is used), returns 'handler' tag if there is no room
+
+uint16_t traceTag(const char* name) {
+  for (byte i=0; i < traceTagCount; i++) {
+    if (traceTagNames[i] == name || strcmp(traceTagNames[i], name) == 0) return i;
+  }
+  if (traceTagCount >= traceMaxTags) return trHandler;
+  traceTagNames[traceTagCount] = name;
+  return traceTagCount++;
+}
+
+
+// ----------------------------------------------------------------
+//     -trace web page requested    i.e. http://x.x.x.x/trace.json
+// ----------------------------------------------------------------
+// sends the events in Chrome trace-event format,  add ?clear=1 to start again
+
+void handleTrace() {
+
+  ServerClient client = server.client();                   // open link with client
+
+  traceRecording = 0;                                      // pause recording while sending
+
+  uint32_t count = (traceHead < traceSize) ? traceHead : traceSize;
+  uint32_t first = traceHead - count;
+  uint32_t startUs = traceRing[first & (traceSize - 1)].us;
+
+  client.print("HTTP/1.1 200 OK\r\n");
+  client.print("Content-Type: application/json\r\n");
+  client.print("Connection: close\r\n\r\n");
+  client.print("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+  int depth = 0;
+  bool comma = 0;
+  for (uint32_t i=first; i != traceHead; i++) {
+    TraceEvent &e = traceRing[i & (traceSize - 1)];
+    if (e.phase == 'E') {
+      if (depth == 0) continue;                            // its start has been overwritten
+      depth--;
+    } else {
+      depth++;
+    }
+    client.printf("%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%u,\"pid\":1,\"tid\":1}\n",
+                  (comma) ? "," : "", traceTagNames[e.tag], e.phase, e.us - startUs);
+    comma = 1;
+  }
+  client.print("]}\n");
+
+  if (server.hasArg("clear")) traceHead = 0;
+  traceRecording = 1;
+
+  delay(3);
+  client.stop();
+}
+
+#else
+
+  #define TRACE_BEGIN(tag)
+  #define TRACE_END(tag)
+  #define TRACE_SCOPE(tag)
+  #define traceTag(name) 0
+
+#endif    // ENABLE_TRACE
+
+
+// --------------------------- E N D -----------------------------
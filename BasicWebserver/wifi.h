@@ -39,10 +39,14 @@
   bool IsBST();
   void sendNTPpacket();
   time_t getNTPTime();
+  time_t ntpReadReply();
   String requestWebPage(String, String, int, int);
   
   
 bool wifiok = 0;                // flag if wifi connection is ok
+uint32_t wifiReconnects = 0;    // number of times wifi has come back after being lost
+uint32_t ntpSyncOk = 0;         // number of successful NTP time requests
+uint32_t ntpSyncFail = 0;       // number of failed NTP time requests
 
 
 // ----------------------------------------------------------------
@@ -56,7 +60,8 @@ bool wifiok = 0;                // flag if wifi connection is ok
     #include <WiFiClient.h>
     #include <WebServer.h>
     #define ESP_getChipId()   ((uint32_t)ESP.getEfuseMac())
-    WebServer server(ServerPort);
+    typedef WebServer WebServerBase;          // web server library
+    typedef WiFiClient ServerClient;          // type of server.client()
     //#include <ESPmDNS.h>                // see https://github.com/espressif/arduino-esp32/tree/master/libraries/ESPmDNS      
   #elif defined ESP8266
     #include <ESP8266WiFi.h>          //https://github.com/esp8266/Arduino
@@ -64,11 +69,29 @@ bool wifiok = 0;                // flag if wifi connection is ok
     #include <DNSServer.h>
     #include <ESP8266WebServer.h>
     #define ESP_getChipId()   (ESP.getChipId())
-    ESP8266WebServer server(ServerPort);
+    #if ENABLE_HTTPS
+      #include <ESP8266WebServerSecure.h>
+      BearSSL::ESP8266WebServerSecure server(HttpsPort);
+      ESP8266WebServer redirectServer(ServerPort);         // sends http requests to https (see https.h)
+      typedef BearSSL::WiFiClientSecure ServerClient;
+    #else
+      typedef ESP8266WebServer WebServerBase;
+      typedef WiFiClient ServerClient;
+    #endif
     //#include <ESP8266mDNS.h>
   #else
       #error "This sketch only works with the ESP8266 or ESP32"
   #endif
+
+// the web server (with https it is created above)
+  #if !ENABLE_HTTPS
+    #include "guard.h"                        // closes connections which are too slow sending their request
+    #if ENABLE_GUARD
+      ClientGuard<WebServerBase> server(ServerPort);
+    #else
+      WebServerBase server(ServerPort);
+    #endif
+  #endif
  
   #include <ESP_WiFiManager.h>              //https://github.com/khoih-prog/ESP_WiFiManager   
 
@@ -103,17 +126,17 @@ void startWifiManager() {
   // get stored wifi settings
     String Router_SSID = ESP_wifiManager.WiFi_SSID();    
     String Router_Pass = ESP_wifiManager.WiFi_Pass();
-    if (Router_SSID == "") if (serialDebug) Serial.println("There are no wifi settings stored");
+    if (Router_SSID == "") DEBUG_WARN("There are no wifi settings stored");
 
   // try connecting to wifi
-    if (serialDebug) Serial.println("Connecting to wifi using WifiManager");
+    DEBUG_INFO("Connecting to wifi using WifiManager");
     WiFi.begin(Router_SSID.c_str(), Router_Pass.c_str());
 
   // if unable to connect to wifi start config portal  
     if (WiFi.waitForConnectResult() != WL_CONNECTED) {
-      if (serialDebug) Serial.println("Unable to connect to WiFi - starting Wifimanager config portal");
+      DEBUG_WARN("Unable to connect to WiFi - starting Wifimanager config portal");
       if ( !ESP_wifiManager.startConfigPortal(AP_SSID.c_str(), AP_PASS.c_str()) ) {
-        if (serialDebug) Serial.println("Not connected to WiFi - rebooting");
+        DEBUG_ERROR("Not connected to WiFi - rebooting");
         delay(1000);
         ESP.restart();  
         delay(5000);           // restart will fail without this delay
@@ -122,11 +145,10 @@ void startWifiManager() {
 
   // finished connecting to wifi (it should be connected at this point)
     if (WiFi.status() == WL_CONNECTED) {
-      if (serialDebug) Serial.print("connected to wifi. Local IP: ");
-      if (serialDebug) Serial.println(WiFi.localIP());
+      DEBUG_INFO("connected to wifi. Local IP: %s", WiFi.localIP().toString().c_str());
       wifiok = 1;  
     } else {
-      if (serialDebug) Serial.println(ESP_wifiManager.getStatus(WiFi.status()));
+      DEBUG_ERROR("%s", ESP_wifiManager.getStatus(WiFi.status()).c_str());
     }  
           
 //  // Set up mDNS responder:
@@ -260,12 +282,10 @@ void sendNTPpacket(const char* address) {
 
 time_t getNTPTime() {
 
+  LOOP_SCOPE("getNTPTime");
+
   // Send a UDP packet to the NTP pool address
-  if (serialDebug) {
-    Serial.print("\nSending NTP packet to ");
-    Serial.print(timeServer);
-    Serial.print(": ");
-  }
+  DEBUG_INFO("Sending NTP packet to %s", timeServer);
   sendNTPpacket(timeServer);
 
   // Wait to see if a reply is available - timeout after X seconds. At least
@@ -277,46 +297,56 @@ time_t getNTPTime() {
   }
 
   // Is there UDP data present to be processed? Sneak a peek!
-  if (NTPUdp.peek() != -1) {
-    // We've received a packet, read the data from it
-    NTPUdp.read(packetBuffer, NTP_PACKET_SIZE); // read the packet into the buffer
-
-    // The time-stamp starts at byte 40 of the received packet and is four bytes,
-    // or two words, long. First, extract the two words:
-    unsigned long highWord = word(packetBuffer[40], packetBuffer[41]);
-    unsigned long lowWord = word(packetBuffer[42], packetBuffer[43]);
-
-    // combine the four bytes (two words) into a long integer
-    // this is NTP time (seconds since Jan 1 1900)
-    unsigned long secsSince1900 = highWord << 16 | lowWord;     // shift highword 16 binary places to the left then combine with lowword
-    if (serialDebug) {
-      Serial.print("Seconds since Jan 1 1900 = ");
-      Serial.println(secsSince1900);
-    }
-
-    // now convert NTP time into everyday time:
-
-    // Unix time starts on Jan 1 1970. In seconds, that's 2208988800:
-    const unsigned long seventyYears = 2208988800UL;     // UL denotes it is 'unsigned long' 
-
-    // subtract seventy years:
-    unsigned long epoch = secsSince1900 - seventyYears;
-
-    // Reset the interval to get the time from NTP server in case we previously changed it
-    setSyncInterval(_resyncSeconds);
-
-    return epoch;
-  }
+  if (NTPUdp.peek() != -1) return ntpReadReply();
 
   // Failed to get an NTP/UDP response
-    if (serialDebug) Serial.println("No NTP response received");
+    DEBUG_WARN("No NTP response received");
     setSyncInterval(_resyncErrorSeconds);       // try more frequently until a response is received
+    ntpSyncFail++;
+    pageChanged();
 
     return 0;
     
 }  // getNTPTime
 
 
+//-----------------------------------------------------------------------------
+//           read the reply from the NTP server and return the time
+//-----------------------------------------------------------------------------
+
+time_t ntpReadReply() {
+
+  // We've received a packet, read the data from it
+  NTPUdp.read(packetBuffer, NTP_PACKET_SIZE); // read the packet into the buffer
+
+  // The time-stamp starts at byte 40 of the received packet and is four bytes,
+  // or two words, long. First, extract the two words:
+  unsigned long highWord = word(packetBuffer[40], packetBuffer[41]);
+  unsigned long lowWord = word(packetBuffer[42], packetBuffer[43]);
+
+  // combine the four bytes (two words) into a long integer
+  // this is NTP time (seconds since Jan 1 1900)
+  unsigned long secsSince1900 = highWord << 16 | lowWord;     // shift highword 16 binary places to the left then combine with lowword
+  DEBUG_VERBOSE("Seconds since Jan 1 1900 = %lu", secsSince1900);
+
+  // now convert NTP time into everyday time:
+
+  // Unix time starts on Jan 1 1970. In seconds, that's 2208988800:
+  const unsigned long seventyYears = 2208988800UL;     // UL denotes it is 'unsigned long' 
+
+  // subtract seventy years:
+  unsigned long epoch = secsSince1900 - seventyYears;
+
+  // Reset the interval to get the time from NTP server in case we previously changed it
+  setSyncInterval(_resyncSeconds);
+
+  ntpSyncOk++;
+  pageChanged();                              // NTP status is shown on the web pages
+  return epoch;
+
+}  // ntpReadReply
+
+
 // ----------------------------------------------------------------
 //                        request a web page
 // ----------------------------------------------------------------
@@ -325,6 +355,8 @@ time_t getNTPTime() {
 
 String requestWebPage(String ip, String page, int port, int maxChars, String cuttoffText = ""){
 
+  LOOP_SCOPE("requestWebPage");
+
   int maxWaitTime = 3000;                 // max time to wait for reply (ms)
 
   char received[maxChars + 1];            // temp store for incoming character data
@@ -332,34 +364,30 @@ String requestWebPage(String ip, String page, int port, int maxChars, String cut
 
   if (!page.startsWith("/")) page = "/" + page;     // make sure page begins with "/" 
 
-  if (serialDebug) {
-    Serial.print("requesting web page: ");
-    Serial.print(ip);
-    Serial.println(page);
-  }
+  DEBUG_INFO("requesting web page: %s%s", ip.c_str(), page.c_str());
      
     WiFiClient client;
 
     // Connect to the site 
       if (!client.connect(ip.c_str() , port)) {                                      
-        if (serialDebug) Serial.println("Web client connection failed");   
+        DEBUG_WARN("Web client connection failed");
         return "web client connection failed";
       } 
-      if (serialDebug) Serial.println("Connected to host - sending request...");
+      DEBUG_VERBOSE("Connected to host - sending request...");
     
     // send request - A basic request looks something like: "GET /index.html HTTP/1.1\r\nHost: 192.168.0.4:8085\r\n\r\n"
       client.print("GET " + page + " HTTP/1.1\r\n" +
                    "Host: " + ip + "\r\n" + 
                    "Connection: close\r\n\r\n");
   
-      if (serialDebug) Serial.println("Request sent - waiting for reply...");
+      DEBUG_VERBOSE("Request sent - waiting for reply...");
   
     // Wait for a response
       uint32_t ttimer = millis();
       while ( !client.available() && (uint32_t)(millis() - ttimer) < maxWaitTime ) {
         delay(10);
       }
-      if ( ((uint32_t)(millis() - ttimer) > maxWaitTime ) && serialDebug) Serial.println("-Timed out");
+      if ((uint32_t)(millis() - ttimer) > maxWaitTime) DEBUG_WARN("-Timed out");
 
     // read the response
       while ( client.available() && received_counter < maxChars ) {
@@ -369,23 +397,18 @@ String requestWebPage(String ip, String page, int port, int maxChars, String cut
       }
       received[received_counter] = '\0';     // end of string marker
             
-    if (serialDebug) {
-      Serial.println("--------received web page-----------");
-      Serial.println(received);
-      Serial.println("------------------------------------");
-      Serial.flush();     // wait for serial data to finish sending
-    }
+    DEBUG_VERBOSE("--------received web page-----------\n%s\n------------------------------------", received);
     
     client.stop();    // close connection
-    if (serialDebug) Serial.println("Connection closed");
+    DEBUG_VERBOSE("Connection closed");
 
     // if cuttoffText was supplied then only return the text following this 
       if (cuttoffText != "") {
         char* locus = strstr(received,cuttoffText.c_str());    // locus = pointer to the found text
         if (locus) {                                           // if text was found
-          if (serialDebug) Serial.println("The text '" + cuttoffText + "' was found in reply");
+          DEBUG_VERBOSE("The text '%s' was found in reply", cuttoffText.c_str());
           return locus;                                        // return the reply text following 'cuttoffText'
-        } else if (serialDebug) Serial.println("The text '" + cuttoffText + "' WAS NOT found in reply");
+        } else DEBUG_INFO("The text '%s' WAS NOT found in reply", cuttoffText.c_str());
       }
     
   return received;        // return the full reply text
@@ -0,0 +1,88 @@
+/**************************************************************************************************
+ *
+ *      Adafruit GFX stand-in for the host tests - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Draws in to a 1 bit per pixel buffer laid out as the SSD1306 has it (a byte is 8 pixels high,
+ *      one 'page' of rows after another).  Text is drawn in the library's 6x8 character cells (times
+ *      the text size) but each character is a made up pattern, only what changes matters to the tests.
+ *
+ **************************************************************************************************/
+
+#pragma once
+
+#include "Arduino.h"
+#include <vector>
+#include <algorithm>
+
+#define BLACK 0
+#define WHITE 1
+#define INVERSE 2
+
+class Adafruit_GFX : public Print {
+  public:
+    Adafruit_GFX(int w, int h) : w(w), h(h), buffer(w * h / 8) {}
+
+    int width() { return w; }
+    int height() { return h; }
+    uint8_t* getBuffer() { return buffer.data(); }
+    void clearDisplay() { std::fill(buffer.begin(), buffer.end(), 0); }
+
+    void drawPixel(int x, int y, int colour) {
+      if (x < 0 || y < 0 || x >= w || y >= h) return;
+      uint8_t &b = buffer[(y / 8) * w + x];
+      uint8_t bit = 1 << (y & 7);
+      if (colour == WHITE) b |= bit;
+      else if (colour == BLACK) b &= ~bit;
+      else b ^= bit;
+    }
+    void fillRect(int x, int y, int rw, int rh, int colour) {
+      for (int i=x; i < x + rw; i++) for (int j=y; j < y + rh; j++) drawPixel(i, j, colour);
+    }
+    void drawLine(int x0, int y0, int x1, int y1, int colour) {
+      int dx = abs(x1 - x0), dy = -abs(y1 - y0), sx = x0 < x1 ? 1 : -1, sy = y0 < y1 ? 1 : -1, err = dx + dy;
+      while (1) {
+        drawPixel(x0, y0, colour);
+        if (x0 == x1 && y0 == y1) break;
+        int e2 = 2 * err;
+        if (e2 >= dy) { err += dy; x0 += sx; }
+        if (e2 <= dx) { err += dx; y0 += sy; }
+      }
+    }
+
+    // text
+      void setCursor(int x, int y) { cx = x; cy = y; }
+      void setTextSize(int s) { size = s; }
+      void setTextColor(int c) { fg = bg = c; }                       // (background left as it is)
+      void setTextColor(int c, int b) { fg = c; bg = b; }
+      using Print::write;
+      using Print::print;
+      size_t write(const uint8_t* buf, size_t len) override {
+        for (size_t i=0; i < len; i++) write(buf[i]);
+        return len;
+      }
+      size_t write(uint8_t c) override {
+        if (c == '\n') { cx = 0; cy += 8 * size; return 1; }
+        if (cx + 6 * size > w) { cx = 0; cy += 8 * size; }
+        for (int col=0; col < 6; col++) {
+          uint8_t bits = (c == ' ' || col == 5) ? 0 : ((c * 2654435761u) >> (col * 5)) & 0x7f;
+          for (int row=0; row < 8; row++) {
+            bool on = bits & (1 << row);
+            if (on || bg != fg) fillRect(cx + col * size, cy + row * size, size, size, on ? fg : bg);
+          }
+        }
+        cx += 6 * size;
+        return 1;
+      }
+      size_t print(int v) { return print(String(v)); }
+      size_t print(const IPAddress &ip) { return print(ip.toString()); }
+
+  protected:
+    int w, h;
+    std::vector<uint8_t> buffer;
+    int cx = 0, cy = 0, size = 1, fg = WHITE, bg = WHITE;
+};
+
+
+// --------------------------- E N D -----------------------------
@@ -0,0 +1,92 @@
+/**************************************************************************************************
+ *
+ *      SSD1306 display and i2c (Wire) stand-ins for the host tests - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Wire counts what is sent and acts on the display's column / page address commands and data
+ *      the way the SSD1306 does, keeping what the display is showing in hostOledRam so a test can
+ *      check it matches the buffer after a refresh.  display() sends the whole buffer as the
+ *      Adafruit library does.
+ *
+ **************************************************************************************************/
+
+#pragma once
+
+#include "Adafruit_GFX.h"
+
+#define SSD1306_SWITCHCAPVCC 2
+
+
+// ----------------------------------------------------------------
+//                              -i2c
+// ----------------------------------------------------------------
+
+  inline uint8_t hostOledRam[128 * 64 / 8];   // what the display is showing
+  inline uint32_t hostI2CBytes = 0;           // bytes sent (including the address byte of each transmission)
+  inline uint32_t hostI2CTransmissions = 0;
+  inline uint32_t hostI2CTooLong = 0;         // transmissions longer than the 32 byte Wire buffer
+  inline uint32_t hostI2CClock = 100000;
+
+  class TwoWire {
+    public:
+      void begin(int, int) {}
+      void setClock(uint32_t hz) { hostI2CClock = hz; }
+      void beginTransmission(uint8_t) { tx.clear(); }
+      size_t write(uint8_t b) { tx.push_back(b); return 1; }
+      size_t write(const uint8_t* buf, size_t n) { tx.insert(tx.end(), buf, buf + n); return n; }
+      uint8_t endTransmission() {
+        hostI2CBytes += tx.size() + 1;
+        hostI2CTransmissions++;
+        if (tx.size() > 32) hostI2CTooLong++;
+        if (!tx.empty() && tx[0] == 0x00) {                   // commands
+          for (size_t i=1; i < tx.size(); i++) {
+            if (tx[i] == 0x21 && i + 2 < tx.size()) { colStart = col = tx[i+1]; colEnd = tx[i+2]; i += 2; }
+            else if (tx[i] == 0x22 && i + 2 < tx.size()) { pageStart = page = tx[i+1]; pageEnd = tx[i+2] & 7; i += 2; }
+          }
+        } else if (!tx.empty() && tx[0] == 0x40) {            // data, written from the column / page address onwards
+          for (size_t i=1; i < tx.size(); i++) {
+            hostOledRam[page * 128 + col] = tx[i];
+            if (++col > colEnd) {
+              col = colStart;
+              if (++page > pageEnd) page = pageStart;
+            }
+          }
+        }
+        return 0;
+      }
+    private:
+      std::vector<uint8_t> tx;
+      int col = 0, colStart = 0, colEnd = 127, page = 0, pageStart = 0, pageEnd = 7;
+  };
+  inline TwoWire Wire;
+
+
+// ----------------------------------------------------------------
+//                            -the display
+// ----------------------------------------------------------------
+
+class Adafruit_SSD1306 : public Adafruit_GFX {
+  public:
+    Adafruit_SSD1306(int w, int h, TwoWire*, int) : Adafruit_GFX(w, h) {}
+    bool begin(int, int) {
+      memset(hostOledRam, 0xa5, sizeof(hostOledRam));       // (not known until something is sent)
+      return 1;
+    }
+    void display() {
+      static const uint8_t window[] = { 0x00, 0x22, 0, 0xff, 0x21, 0, 127 };
+      Wire.beginTransmission(0x3c);
+      Wire.write(window, sizeof(window));
+      Wire.endTransmission();
+      for (int i=0; i < w * h / 8; i += 31) {
+        int n = std::min(31, w * h / 8 - i);
+        Wire.beginTransmission(0x3c);
+        Wire.write((uint8_t)0x40);
+        Wire.write(&buffer[i], n);
+        Wire.endTransmission();
+      }
+    }
+};
+
+
+// --------------------------- E N D -----------------------------
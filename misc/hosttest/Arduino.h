@@ -0,0 +1,214 @@
+/**************************************************************************************************
+ *
+ *      Arduino stand-ins for the host tests - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Just enough of the Arduino core for the sketch's modules to be compiled and run on a PC
+ *      (see run.sh).  Each test adds whatever else the module it tests needs (web server, update
+ *      library etc.) as simple fakes.
+ *
+ *      The clock is a fake one moved on by the test (hostAdvance()) so runs are the same every time,
+ *      set hostRealClock for tests which talk to a real server or measure how long things take.
+ *
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdarg>
+#include <string>
+#include <chrono>
+#include <thread>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define PROGMEM
+#define PGM_P const char*
+#define memcpy_P memcpy
+#define ICACHE_RAM_ATTR
+#define IRAM_ATTR
+
+
+// ----------------------------------------------------------------
+//                            -the clock
+// ----------------------------------------------------------------
+
+  inline uint64_t hostUs = 1000000;         // fake time (microseconds), starts at 1 second
+  inline bool hostRealClock = 0;            // use the real time instead
+
+  inline uint64_t hostRealUs() {
+    static auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  inline uint64_t hostNowUs() { return hostRealClock ? hostRealUs() : hostUs; }
+  inline uint32_t micros() { return hostNowUs(); }
+  inline uint32_t millis() { return hostNowUs() / 1000; }            // (wraps round after 49.7 days as on the esp)
+  inline void hostAdvance(uint32_t ms) { hostUs += ms * 1000ULL; }
+
+  inline void delay(uint32_t ms) {
+    if (hostRealClock) std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    else hostAdvance(ms);
+  }
+  inline void yield() {}
+  #define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+  inline long map(long x, long inLow, long inHigh, long outLow, long outHigh) {
+    return (x - inLow) * (outHigh - outLow) / (inHigh - inLow) + outLow;
+  }
+  inline void noInterrupts() {}
+  inline void interrupts() {}
+
+  // time a piece of code on the real clock (ns per call)
+  template<typename F> double hostTimeNs(int calls, F f) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i=0; i < calls; i++) f(i);
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+  }
+
+
+// ----------------------------------------------------------------
+//                              -pins
+// ----------------------------------------------------------------
+
+  #define LOW 0
+  #define HIGH 1
+  #define INPUT 0
+  #define INPUT_PULLUP 2
+  #define OUTPUT 1
+  #define CHANGE 3
+
+  inline int hostPins[64];                  // pin levels (set by the test with hostPinSet())
+  inline void (*hostInterrupts[64])();      // interrupt routine attached to each pin
+
+  inline void pinMode(int, int) {}
+  inline int digitalRead(int pin) { return hostPins[pin]; }
+  inline void digitalWrite(int pin, int v) { hostPins[pin] = v; }
+  inline int digitalPinToInterrupt(int pin) { return pin; }
+  inline void attachInterrupt(int pin, void (*isr)(), int) { hostInterrupts[pin] = isr; }
+
+  // change a pin, its interrupt routine runs if it has one (set 'missed' for a change the interrupt did not see)
+  inline void hostPinSet(int pin, int v, bool missed = 0) {
+    if (hostPins[pin] == v) return;
+    hostPins[pin] = v;
+    if (hostInterrupts[pin] && !missed) hostInterrupts[pin]();
+  }
+
+
+// ----------------------------------------------------------------
+//                              -String
+// ----------------------------------------------------------------
+
+class String {
+  public:
+    String() {}
+    String(const char* c) : s(c ? c : "") {}
+    String(const std::string &x) : s(x) {}
+    String(char c) : s(1, c) {}
+    String(int v) : s(std::to_string(v)) {}
+    String(unsigned v) : s(std::to_string(v)) {}
+    String(long v) : s(std::to_string(v)) {}
+    String(unsigned long v) : s(std::to_string(v)) {}
+    const char* c_str() const { return s.c_str(); }
+    unsigned length() const { return s.size(); }
+    bool reserve(unsigned n) { s.reserve(n); return 1; }
+    char operator[](unsigned i) const { return s[i]; }
+    String& operator+=(const String &o) { s += o.s; return *this; }
+    String& operator+=(const char* o) { s += o; return *this; }
+    String& operator+=(char c) { s += c; return *this; }
+    bool operator==(const String &o) const { return s == o.s; }
+    bool operator==(const char* o) const { return s == o; }
+    bool operator!=(const String &o) const { return s != o.s; }
+    bool operator!=(const char* o) const { return s != o; }
+    bool startsWith(const String &x) const { return s.rfind(x.s, 0) == 0; }
+    String substring(unsigned a) const { return String(s.substr(a)); }
+    String substring(unsigned a, unsigned b) const { return String(s.substr(a, b - a)); }
+    int indexOf(char c) const { auto p = s.find(c); return p == std::string::npos ? -1 : (int)p; }
+    int indexOf(const char* t) const { auto p = s.find(t); return p == std::string::npos ? -1 : (int)p; }
+    long toInt() const { return atol(s.c_str()); }
+    void trim() {
+      s.erase(0, s.find_first_not_of(" \t\r\n"));
+      s.erase(s.find_last_not_of(" \t\r\n") + 1);
+    }
+    void toLowerCase() { for (char &c : s) c = tolower(c); }
+    std::string s;
+};
+inline String operator+(const String &a, const String &b) { return String(a.s + b.s); }
+inline String operator+(const String &a, const char* b) { return String(a.s + b); }
+inline String operator+(const char* a, const String &b) { return String(std::string(a) + b.s); }
+
+
+// ----------------------------------------------------------------
+//                          -Print / Serial
+// ----------------------------------------------------------------
+
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(const uint8_t* buf, size_t len) = 0;
+    virtual size_t write(uint8_t c) { return write(&c, 1); }
+    size_t write(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+    size_t write(const char* buf, size_t len) { return write((const uint8_t*)buf, len); }
+    size_t print(const char* text) { return write(text); }
+    size_t print(const String &text) { return write(text.c_str()); }
+    size_t print(int v) { return print(String(v)); }
+    size_t println(const char* text = "") { return print(text) + write("\r\n"); }
+    size_t println(const String &text) { return println(text.c_str()); }
+    size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+      char buf[512];
+      va_list args;
+      va_start(args, fmt);
+      int len = vsnprintf(buf, sizeof(buf), fmt, args);
+      va_end(args);
+      if (len > (int)sizeof(buf) - 1) len = sizeof(buf) - 1;
+      return (len > 0) ? write((const uint8_t*)buf, len) : 0;
+    }
+};
+
+// the serial port, sent to stdout if 'shown' is set (otherwise only counted)
+class HostSerial : public Print {
+  public:
+    using Print::write;
+    size_t write(const uint8_t* buf, size_t len) override {
+      if (shown) fwrite(buf, 1, len, stdout);
+      if (keep) kept.append((const char*)buf, len);
+      sent += len;
+      room = (room > len) ? room - len : 0;
+      return len;
+    }
+    size_t availableForWrite() { return room; }
+    void setDebugOutput(bool) {}
+    bool shown = 0;
+    bool keep = 0;                          // keep what is sent in 'kept'
+    std::string kept;
+    size_t sent = 0;                        // bytes sent
+    size_t room = 128;                      // space in the transmit buffer (set by the test)
+};
+inline HostSerial Serial;
+
+
+// ----------------------------------------------------------------
+//                            -IPAddress
+// ----------------------------------------------------------------
+
+class IPAddress {
+  public:
+    IPAddress(uint32_t a = 0) : addr(a) {}
+    IPAddress(byte a, byte b, byte c, byte d) : addr(a | b << 8 | c << 16 | (uint32_t)d << 24) {}
+    operator uint32_t() const { return addr; }
+    byte operator[](int i) const { return addr >> (8 * i); }
+    String toString() const {
+      char s[16];
+      snprintf(s, sizeof(s), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+      return String(s);
+    }
+  private:
+    uint32_t addr;
+};
+
+
+// --------------------------- E N D -----------------------------
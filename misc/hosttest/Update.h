@@ -0,0 +1,57 @@
+/**************************************************************************************************
+ *
+ *      Update library stand-in for the host tests - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Keeps the firmware written in memory along with the md5 it was given and how the update
+ *      was ended, so a test can check what would have been flashed.  (Also included by ota.h when
+ *      built as for the esp32.)
+ *
+ **************************************************************************************************/
+
+#pragma once
+
+#include "Arduino.h"
+#include <vector>
+
+
+struct HostUpdate {
+  std::vector<uint8_t> data;                // firmware written so far
+  uint32_t size = 0;                        // size given to begin()
+  bool running = 0;
+  bool aborted = 0;                         // ended with abort() (esp32)
+  String md5;                               // md5 given to setMD5()
+
+  bool begin(uint32_t s = 0) {
+    size = s;
+    data.clear();
+    md5 = String();
+    running = 1;
+    aborted = 0;
+    return 1;
+  }
+  size_t write(const uint8_t* buf, size_t len) {
+    if (!running) return 0;
+    data.insert(data.end(), buf, buf + len);
+    return len;
+  }
+  bool end(bool = 0) {
+    bool ok = running && data.size() == size;
+    running = 0;
+    return ok;
+  }
+  void abort() {
+    running = 0;
+    aborted = 1;
+  }
+  uint32_t progress() { return data.size(); }                 // (size_t is 32 bits on the esp)
+  bool isRunning() { return running; }
+  bool hasError() { return 0; }
+  void setMD5(const char* m) { md5 = String(m); }
+  void printError(Print &p) { p.println("update error"); }
+};
+inline HostUpdate Update;
+
+
+// --------------------------- E N D -----------------------------
@@ -0,0 +1,93 @@
+/**************************************************************************************************
+ *
+ *      Host test - access statistics (access.h) - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Checks requests are counted against the right client / page (requests, bytes, time), that
+ *      when the table is full the entry not requested for the longest is replaced and that the
+ *      /access page shows and resets them.  Then times recording a request with few clients (all
+ *      fit in the table) and many (the table is always full so every new one searches all of it).
+ *
+ **************************************************************************************************/
+
+#include "sketch.h"
+uint32_t metricsBytesSent = 0;              // (kept by MeteredClient in metrics.h)
+#define ENABLE_ACCESS 1
+#include "../../BasicWebserver/access.h"
+
+const char* pages[] = { "/", "/data", "/ping", "/log", "/test", "/tasks", "/a/{name}", "(invalid page)" };
+
+int failures = 0;
+void check(bool ok, const char* what) {
+  if (ok) return;
+  printf("FAILED: %s\n", what);
+  failures++;
+}
+
+// a request for 'page' from 'ip' which sends 'bytes' and takes 'ms'
+void request(uint32_t ip, const char* page, uint32_t bytes, uint32_t ms) {
+  hostClientIP = ip;
+  accessBegin();
+  metricsBytesSent += bytes;
+  hostAdvance(ms);
+  accessEnd(page);
+}
+
+AccessEntry* entry(uint32_t ip, const char* page) {
+  for (AccessEntry &e : accessTable) if (e.ip == ip && e.page == page) return &e;
+  return nullptr;
+}
+
+
+int main() {
+
+  // counting
+    for (int i=0; i < 10; i++) request(0x0100A8C0, pages[0], 1000, 20);
+    for (int i=0; i < 5; i++) request(0x0100A8C0, pages[1], 200, 4);
+    request(0x0200A8C0, pages[0], 1000, 30);
+    AccessEntry* e = entry(0x0100A8C0, pages[0]);
+    check(e && e->hits == 10 && e->bytes == 10000 && e->totalUs == 200000 && e->lastSeen == millis() - 5 * 4 - 30,
+          "root page from 192.168.0.1");
+    e = entry(0x0100A8C0, pages[1]);
+    check(e && e->hits == 5 && e->bytes == 1000, "/data from 192.168.0.1");
+    e = entry(0x0200A8C0, pages[0]);
+    check(e && e->hits == 1 && e->totalUs == 30000, "root page from 192.168.0.2");
+
+  // a full table replaces the entry not requested for the longest (the first client's /data)
+    request(0x0100A8C0, pages[0], 0, 1);
+    for (uint32_t i=0; i < accessSlots - 2u; i++) request(0x0300A8C0 + (i << 24), pages[2], 10, 1);
+    check(entry(0x0100A8C0, pages[0]) && !entry(0x0100A8C0, pages[1]) && entry(0x0200A8C0, pages[0]) && accessReplaced == 1,
+          "least recently requested entry not replaced");
+
+  // the page
+    hostSent.clear();
+    handleAccess();
+    check(hostSent.find("<td>192.168.0.1</td><td>/</td><td>11</td><td>10000</td><td>18.3</td>") != std::string::npos,
+          "/access page does not show the root page from 192.168.0.1");
+    hostRequest.args.emplace("reset", "1");
+    handleAccess();
+    hostRequest.args.clear();
+    check(!entry(0x0100A8C0, pages[0]) && accessReplaced == 0, "/access?reset=1 did not reset");
+
+  // time to record a request (on this PC)
+    for (int clients : {4, 16, 200}) {
+      memset(accessTable, 0, sizeof(accessTable));
+      accessReplaced = 0;
+      uint32_t x = 1;
+      double ns = hostTimeNs(10000000, [&](int) {
+        x = x * 1103515245 + 12345;
+        hostClientIP = 0x0000A8C0 + ((x >> 16) % clients << 24);
+        accessBegin();
+        metricsBytesSent += 100;
+        hostUs += 1000;
+        accessEnd(pages[(x >> 8) & 7]);
+      });
+      printf("access: %3d clients x 8 pages in %d entries, %.0f ns to record a request, %u replaced\n", clients, accessSlots, ns, accessReplaced);
+    }
+
+  return failures ? 1 : 0;
+}
+
+
+// --------------------------- E N D -----------------------------
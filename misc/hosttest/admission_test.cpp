@@ -0,0 +1,122 @@
+/**************************************************************************************************
+ *
+ *      Host test - admission control (admission.h) - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Ten minutes of a web server which handles one request at a time: a browser polling /data
+ *      every 3 seconds and another loading the root page every 10 seconds, while one client floods
+ *      it with 1000 requests a second for pages which do not exist and 64 others scan it.  Each
+ *      request takes the server a set time (a page, or just the ready made 429/503 reply) and the
+ *      time the two browsers wait is compared with and without admission control.
+ *
+ **************************************************************************************************/
+
+#include "sketch.h"
+#define ENABLE_ADMISSION 1
+#include "../../BasicWebserver/admission.h"
+#include <vector>
+#include <algorithm>
+
+
+// time the server takes for each (us)
+  const uint32_t pageUs = 20000;            // root page
+  const uint32_t pollUs = 5000;             // /data
+  const uint32_t bogusUs = 8000;            // 404 page (building the reply and logging it)
+  const uint32_t refuseUs = 100;            // sending a ready made 429 / 503
+
+struct Request {
+  uint64_t at;                              // when it arrives (us)
+  uint32_t ip;
+  byte cls;
+  bool browser;                             // one of the well behaved browsers
+};
+
+int failures = 0;
+void check(bool ok, const char* what) {
+  if (ok) return;
+  printf("FAILED: %s\n", what);
+  failures++;
+}
+
+// ten minutes of requests
+std::vector<Request> traffic() {
+  std::vector<Request> r;
+  const uint64_t start = hostUs;
+  for (uint64_t ms=0; ms < 600000; ms++) {
+    uint64_t t = start + ms * 1000;
+    r.push_back({t, 0x0B00000A, routeBogus, 0});                              // flood (10.0.0.11)
+    if (ms % 10 == 5) r.push_back({t, 0x0000010Au + (uint32_t)(ms / 10 % 64 << 24), routePage, 0});    // scanners (10.1.0.x)
+    if (ms % 3000 == 1) r.push_back({t, 0x1400A8C0, routePoll, 1});            // browser polling /data (192.168.0.20)
+    if (ms % 10000 == 2) r.push_back({t, 0x1500A8C0, routePage, 1});           // browser loading / (192.168.0.21)
+  }
+  return r;
+}
+
+// run the requests through a server which handles one at a time, returns the browsers' waits (ms)
+std::vector<double> serve(const std::vector<Request> &requests, bool admission, uint32_t &browserRefused) {
+  std::vector<double> waits;
+  uint64_t freeAt = 0;                      // when the server has finished the request it is on
+  browserRefused = 0;
+  for (const Request &q : requests) {
+    hostUs = std::max(q.at, freeAt);
+    hostClientIP = q.ip;
+    hostSent.clear();
+    uint32_t took;
+    if (!admission || admitRequest(q.cls)) took = (q.cls == routePage) ? pageUs : (q.cls == routePoll) ? pollUs : bogusUs;
+    else {
+      took = refuseUs;
+      if (q.browser) browserRefused++;
+    }
+    freeAt = hostUs + took;
+    if (q.browser) waits.push_back((freeAt - q.at) / 1000.0);
+  }
+  return waits;
+}
+
+double percentile(std::vector<double> v, double p) {
+  std::sort(v.begin(), v.end());
+  return v[(size_t)(p * (v.size() - 1))];
+}
+
+
+int main() {
+
+  std::vector<Request> requests = traffic();
+  uint32_t refused;
+
+  // without admission control (only the first minute, after that the browsers would wait for ever)
+    std::vector<Request> minute(requests.begin(), requests.begin() + requests.size() / 10);
+    std::vector<double> waits = serve(minute, 0, refused);
+    printf("admission: without, the browsers waited p50 %.0f ms, p99 %.0f ms (first minute)\n",
+           percentile(waits, 0.5), percentile(waits, 0.99));
+
+  // with
+    hostUs = requests[0].at;
+    waits = serve(requests, 1, refused);
+    double p50 = percentile(waits, 0.5);
+    double p99 = percentile(waits, 0.99);
+    printf("admission: with, the browsers waited p50 %.0f ms, p99 %.0f ms, %zu requests, %u refused\n",
+           p50, p99, waits.size(), refused);
+    printf("admission: admitted page %u poll %u bogus %u, 429 page %u poll %u bogus %u, 503 %u\n",
+           admitCount[routePage], admitCount[routePoll], admitCount[routeBogus],
+           admitLimited[routePage], admitLimited[routePoll], admitLimited[routeBogus], admitFull);
+    check(refused == 0, "a well behaved browser was turned away");
+    check(p99 < 50, "browsers waited too long during the flood");
+    uint32_t floodMax = admitLimits[routeBogus].burst + 600 * admitLimits[routeBogus].perMinute / 60;
+    check(admitCount[routeBogus] <= floodMax + 1, "the flood got more than its rate");
+    check(admitFull > 0, "the scanners did not fill the table");
+
+  // the replies (the flood's bucket is empty and the scanners have filled the table)
+    hostClientIP = 0x0B00000A;
+    hostSent.clear();
+    check(!admitRequest(routeBogus) && hostSent.rfind("HTTP/1.1 429", 0) == 0 && hostSent.find("Retry-After:") != std::string::npos, "429 reply");
+    hostClientIP = 0x0C00000A;
+    hostSent.clear();
+    check(!admitRequest(routePage) && hostSent.rfind("HTTP/1.1 503", 0) == 0 && hostSent.find("Retry-After:") != std::string::npos, "503 reply");
+
+  return failures ? 1 : 0;
+}
+
+
+// --------------------------- E N D -----------------------------
@@ -0,0 +1,103 @@
+/**************************************************************************************************
+ *
+ *      Host test - request memory (arena.h) - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      A million requests each building text the way the pages do (client address, time, a 404
+ *      reply of varying length), checks none of them use the heap, that the memory used does not
+ *      creep up, that text which does not fit is cut short and counted, and compares the time with
+ *      building the same text in Strings.
+ *
+ **************************************************************************************************/
+
+#include "sketch.h"
+#include <new>
+#include "../../BasicWebserver/arena.h"
+
+// count heap allocations
+size_t heapAllocs = 0;
+void* operator new(size_t n) {
+  heapAllocs++;
+  if (void* p = malloc(n ? n : 1)) return p;
+  throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+int failures = 0;
+void check(bool ok, const char* what) {
+  if (ok) return;
+  printf("FAILED: %s\n", what);
+  failures++;
+}
+
+// what a page request builds (the uri gets longer and shorter so blocks are different sizes)
+int request(int i) {
+  ArenaString ip;
+  ip.printf("%u.%u.%u.%u", 192, 168, 0, i & 255);
+  ArenaString tstr;
+  tstr.printf("%02d:%02d:%02d", i / 3600 % 24, i / 60 % 60, i % 60);
+  ArenaString msg;
+  msg.print("File Not Found\n\nURI: /");
+  for (int j=0; j < i % 200; j++) msg.write('a' + j % 26);
+  msg.printf("\nMethod: GET\nArguments: %d\nfrom %s at %s\n", i % 4, ip.c_str(), tstr.c_str());
+  int len = msg.length();
+  arenaReset();                             // (the web server task does this after each request)
+  return len;
+}
+
+int requestString(int i) {
+  String ip = String(192) + "." + String(168) + "." + String(0) + "." + String(i & 255);
+  String tstr = String(i / 3600 % 24) + ":" + String(i / 60 % 60) + ":" + String(i % 60);
+  String msg = "File Not Found\n\nURI: /";
+  for (int j=0; j < i % 200; j++) msg += (char)('a' + j % 26);
+  msg += "\nMethod: GET\nArguments: " + String(i % 4) + "\nfrom " + ip + " at " + tstr + "\n";
+  return msg.length();
+}
+
+
+int main() {
+
+  // a million requests
+    const int requests = 1000000;
+    size_t before = heapAllocs;
+    long total = 0;
+    uint16_t peakAfterFirst = 0;
+    for (int i=0; i < requests; i++) {
+      total += request(i);
+      if (i == 999) peakAfterFirst = arenaPeak;
+    }
+    printf("arena: %d requests, %ld bytes of text, heap allocations %zu, most used %u of %u bytes (%u after 1000)\n",
+           requests, total, heapAllocs - before, arenaPeak, arenaSize, peakAfterFirst);
+    check(heapAllocs == before, "requests used the heap");
+    check(arenaUsed == 0 && arenaFails == 0, "memory not all given back or ran out");
+    check(arenaPeak == peakAfterFirst, "memory used crept up");
+
+  // the same text in Strings
+    before = heapAllocs;
+    for (int i=0; i < requests; i++) requestString(i);
+    printf("arena: the same text in Strings made %zu heap allocations\n", heapAllocs - before);
+
+  // text bigger than the arena is cut short
+    ArenaString big;
+    for (int i=0; i < arenaSize; i++) big.print("0123456789");
+    printf("arena: %d bytes written to one ArenaString kept %u, truncated %d, full %u times\n",
+           arenaSize * 10, big.length(), big.truncated, arenaFails);
+    check(big.truncated && big.length() > arenaSize / 2 && big.length() < arenaSize, "long text not cut short");
+    check(strncmp(big.c_str(), "0123456789012", 13) == 0 && big.c_str()[big.length()] == 0, "long text corrupted");
+    check(arenaAlloc(16) == nullptr && arenaFails > 0, "full arena not counted");
+    arenaReset();
+    check(arenaAlloc(16) != nullptr, "memory not given back");
+    arenaReset();
+
+  // time per request on this PC
+    double arena = hostTimeNs(1000000, [](int i) { request(i); });
+    double string = hostTimeNs(1000000, [](int i) { requestString(i); });
+    printf("arena: %.0f ns per request with ArenaString, %.0f ns with String\n", arena, string);
+
+  return failures ? 1 : 0;
+}
+
+
+// --------------------------- E N D -----------------------------
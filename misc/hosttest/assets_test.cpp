@@ -0,0 +1,91 @@
+/**************************************************************************************************
+ *
+ *      Host test - static files (assets.h) - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Requests /a/style.css as browsers do: gzipped or not, then again with If-None-Match holding
+ *      its ETag on its own, in a list, as a weak ETag or *, which should get a short 304 reply, and
+ *      with ETags which do not match which should get the file again.
+ *
+ **************************************************************************************************/
+
+#include "sketch.h"
+
+#define ENABLE_ADMISSION 0
+#define ENABLE_ACCESS 0
+#include "../../BasicWebserver/admission.h"
+
+void log_system_message(const char*, ...) {}
+int8_t metricsRouteAdd(const char*) { return -1; }
+template<typename F> void metricsRun(int8_t, F &handler) { handler(); }
+const uint16_t routeMax = 8;                // (a setting in the main sketch)
+#include "../../BasicWebserver/routes.h"
+
+#include "../../BasicWebserver/gzip.h"
+#include "../../BasicWebserver/pages.h"
+
+int notFound = 0;
+void handleNotFound() { notFound++; }
+#include "../../BasicWebserver/assets.h"
+
+constexpr RouteDef webPages[] = {
+  ROUTE_POLL(HTTP_GET, "/a/{name}", handleAsset),
+};
+
+int failures = 0;
+void check(bool ok, const char* what) {
+  if (ok) return;
+  printf("FAILED: %s\n", what);
+  failures++;
+}
+
+// request a page with these headers, returns the status code (0 if nothing sent)
+int request(const char* uri, const char* ifNoneMatch, bool gzip) {
+  server.hostHeaders.clear();
+  if (ifNoneMatch) server.hostHeaders["If-None-Match"] = ifNoneMatch;
+  if (gzip) server.hostHeaders["Accept-Encoding"] = "gzip, deflate, br";
+  hostSent.clear();
+  routeHandler.handle(server, HTTP_GET, String(uri));
+  return hostSent.empty() ? 0 : atoi(hostSent.c_str() + 9);
+}
+
+
+int main() {
+
+  routesSetup(webPages);
+  const AssetFile* css = nullptr;
+  for (const AssetFile &a : assetFiles) if (strcmp(a.name, "style.css") == 0) css = &a;
+  check(css && css->gz, "style.css not found or not gzipped");
+  if (!css) return 1;
+  std::string etag = css->etag;                                     // (with quotes)
+
+  // first request
+    check(request("/a/style.css", nullptr, 0) == 200 && hostSent.find("Content-Encoding") == std::string::npos, "style.css not sent");
+    size_t plainSize = hostSent.size();
+    check(request("/a/style.css", nullptr, 1) == 200 && hostSent.find("Content-Encoding: gzip\r\n") != std::string::npos, "style.css not sent gzipped");
+    printf("assets: style.css reply %zu bytes, %zu gzipped\n", plainSize, hostSent.size());
+
+  // browser already has it
+    std::string list = "\"00000000\", " + etag + ", \"11111111\"";
+    std::string weak = "W/" + etag;
+    std::string weakList = "W/\"00000000\",W/" + etag;
+    for (const std::string &h : { etag, list, weak, weakList, std::string("*") }) {
+      int status = request("/a/style.css", h.c_str(), 1);
+      printf("assets: If-None-Match: %-40s %d, %zu bytes\n", h.c_str(), status, hostSent.size());
+      check(status == 304 && hostSent.find("\r\n\r\n") == hostSent.size() - 4, "ETag not matched");
+    }
+
+  // browser has a different version
+    std::string part = etag.substr(0, etag.size() - 2) + "\"";    // (the start of the ETag)
+    for (const std::string &h : { std::string("\"00000000\""), std::string("W/\"00000000\", \"11111111\""), part, etag.substr(1, etag.size() - 2), std::string("") }) {
+      check(request("/a/style.css", h.c_str(), 1) == 200, "ETag which is different matched");
+    }
+
+  check(request("/a/nothing.css", nullptr, 1) == 0 && notFound == 1, "missing file not passed to handleNotFound");
+
+  return failures ? 1 : 0;
+}
+
+
+// --------------------------- E N D -----------------------------
@@ -0,0 +1,121 @@
+/**************************************************************************************************
+ *
+ *      Host test - coroutine web pages (coro.h) - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      20 requests arrive at once for a page which fetches from another server that takes a second
+ *      to answer.  As coroutines they wait side by side while loop keeps running, so they should
+ *      all be finished in a few seconds rather than the 20 it would take one after another.  Only
+ *      coroMax can run at once, a request which is refused (503) tries again shortly after as a
+ *      browser would.
+ *
+ **************************************************************************************************/
+
+#include "Arduino.h"
+#include "hostnet.h"
+
+
+// ----------------------------------------------------------------
+//                  -what coro.h needs from the sketch
+// ----------------------------------------------------------------
+
+  #define DEBUG_LEVEL 3
+  #define ENABLE_DUALCORE 0
+  const bool serialDebug = 1;
+  #include "../../BasicWebserver/debug.h"
+
+  // NTP (not used here)
+  struct {
+    int parsePacket() { return 0; }
+    void flush() {}
+  } NTPUdp;
+  IPAddress timeServer;
+  uint32_t ntpSyncFail = 0;
+  void sendNTPpacket(IPAddress&) {}
+  uint32_t ntpReadReply() { return 0; }
+  void setTime(uint32_t) {}
+
+
+#define ENABLE_COROUTINES 1
+#include "../../BasicWebserver/coro.h"
+
+
+// ----------------------------------------------------------------
+//                              -test
+// ----------------------------------------------------------------
+
+const int requests = 20;
+const uint32_t upstreamMs = 1000;           // time the other server takes to answer
+uint16_t upstreamPort;
+
+uint32_t finished[requests];                // when each request finished (ms)
+bool finishedYet[requests];
+bool replyOk[requests];
+
+// the page
+Async fetchPage(int id) {
+  char buf[200];
+  int len = co_await coroFetch("127.0.0.1", "/slow", upstreamPort, buf, sizeof(buf));
+  replyOk[id] = (len > 0 && strstr(buf, "slow reply"));
+  finished[id] = millis();
+  finishedYet[id] = 1;
+}
+
+
+int main() {
+
+  hostRealClock = 1;
+  upstreamPort = hostSlowServer(upstreamMs);
+
+  // the requests all arrive at once, loop runs every ms until they have all finished (or 30 seconds)
+    uint32_t start = millis();
+    bool started[requests] = {};
+    uint32_t retryAt[requests] = {};
+    uint32_t refused = 0;
+    uint32_t longest = 0;                   // longest pass of loop (ms)
+    uint32_t passes = 0;
+    for (int i=0; i < requests; i++) retryAt[i] = start;
+
+    int done = 0;
+    while (done < requests && millis() - start < 30000) {
+      uint32_t t = micros();
+      for (int i=0; i < requests; i++) {
+        if (started[i] || millis() < retryAt[i]) continue;
+        if (fetchPage(i).started) started[i] = 1;
+        else {
+          refused++;
+          retryAt[i] = millis() + 200;      // (503 - the browser tries again)
+        }
+      }
+      coroLoop();
+      t = micros() - t;
+      if (t / 1000 > longest) longest = t / 1000;
+      passes++;
+      done = 0;
+      for (int i=0; i < requests; i++) done += finishedYet[i];
+      delay(1);
+    }
+
+  uint32_t last = 0;
+  int ok = 0;
+  for (int i=0; i < requests; i++) {
+    if (finished[i] - start > last) last = finished[i] - start;
+    ok += replyOk[i];
+  }
+  int rounds = (requests + coroMax - 1) / coroMax;
+  printf("coro: %d requests to a %u ms server, %d at once, all finished in %.1f s (%.0f s one after another)\n",
+         requests, upstreamMs, coroMax, last / 1000.0, requests * upstreamMs / 1000.0);
+  printf("coro: %d replies ok, %u refused (503) and tried again, loop ran %u times, longest pass %u ms\n",
+         ok, refused, passes, longest);
+  printf("coro: most running at once %u, largest frame %u of %u bytes, %u running at the end\n",
+         coroPeak, coroLargest, coroFrameSize, coroRunning);
+
+  bool pass = (done == requests && ok == requests && coroPeak == coroMax && coroRunning == 0
+               && last < rounds * (upstreamMs + 300) && longest < 50);
+  if (!pass) printf("FAILED: the requests did not overlap\n");
+  return pass ? 0 : 1;
+}
+
+
+// --------------------------- E N D -----------------------------
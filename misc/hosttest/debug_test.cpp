@@ -0,0 +1,107 @@
+/**************************************************************************************************
+ *
+ *      Host test - buffered debug output (debug.h) - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Times a DEBUG_INFO() when the serial port can not take any more (so the buffer fills and
+ *      messages are dropped rather than waited for), checks that when the buffer is being emptied
+ *      a little at a time every message arrives whole and in order or is counted as dropped, and
+ *      that the text of a level which is turned off is not in the program at all.
+ *
+ **************************************************************************************************/
+
+#define DEBUG_LEVEL 3                       // (info, so DEBUG_VERBOSE is removed)
+#include "sketch.h"
+#include <fstream>
+#include <iterator>
+
+int failures = 0;
+void check(bool ok, const char* what) {
+  if (ok) return;
+  printf("FAILED: %s\n", what);
+  failures++;
+}
+
+// true if the program contains 'text'
+bool inProgram(const std::string &text) {
+  std::ifstream f("/proc/self/exe", std::ios::binary);
+  std::string exe((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+  return exe.find(text) != std::string::npos;
+}
+
+
+int main() {
+
+  Serial.keep = 1;
+
+  // before the task runs (setup) it is sent straight away
+    DEBUG_INFO("setup message %d", 1);
+    check(Serial.kept == "setup message 1\r\n", "message during setup not sent straight away");
+    debugLoop();                            // (the task has started)
+
+  // the serial port is full
+    Serial.room = 0;
+    Serial.kept.clear();
+    const int calls = 100000;
+    double ns = hostTimeNs(calls, [](int i) { DEBUG_INFO("requesting web page: %s%s (%d)", "192.168.1.166", "/log", i); });
+    printf("debug: serial port full, %.0f ns per DEBUG_INFO, %u of %d dropped\n", ns, debugDropped(), calls);
+    check(debugDropped() > calls - debugBufferSize / 30 && Serial.kept.empty(), "messages not dropped when the buffer is full");
+    Serial.room = 1 << 20;
+    debugLoop();
+    check(Serial.kept.rfind("requesting web page: 192.168.1.166/log (0)\n", 0) == 0, "messages before the buffer was full lost");
+
+  // messages of different lengths while the buffer is emptied a little each pass
+    Serial.kept.clear();
+    uint32_t dropped = debugDropped();
+    uint32_t x = 1;
+    const int messages = 20000;
+    for (int i=0; i < messages; i++) {
+      x = x * 1103515245 + 12345;
+      int len = (x >> 16) % 150;
+      DEBUG_INFO("msg %d %d %.*s", i, len, len, "0123456789012345678901234567890123456789012345678901234567890123456789"
+                 "0123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789");
+      if (i % 3 == 0) {
+        Serial.room = (x >> 8) % 200;       // (what the serial port can take this pass)
+        debugLoop();
+      }
+    }
+    Serial.room = 1 << 20;
+    debugLoop();
+
+    int received = 0;
+    int broken = 0;
+    int last = -1;
+    for (size_t pos = 0; pos < Serial.kept.size(); ) {
+      size_t end = Serial.kept.find('\n', pos);
+      if (end == std::string::npos) end = Serial.kept.size();
+      std::string line = Serial.kept.substr(pos, end - pos);
+      pos = end + 1;
+      int i, len, n = 0;
+      if (sscanf(line.c_str(), "msg %d %d %n", &i, &len, &n) != 2 || i <= last || (int)line.size() - n != len
+          || line.compare(n, len, std::string("0123456789012345678901234567890123456789012345678901234567890123456789"
+                                              "0123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789"), 0, len) != 0) {
+        broken++;
+        continue;
+      }
+      last = i;
+      received++;
+    }
+    printf("debug: %d messages while emptying the buffer, %d arrived whole, %d broken, %u dropped\n",
+           messages, received, broken, debugDropped() - dropped);
+    check(broken == 0 && received + (int)(debugDropped() - dropped) == messages, "messages broken or lost without being counted");
+
+  // a level which is turned off
+    DEBUG_INFO("zq" "INFO_MARKER");
+    DEBUG_VERBOSE("zq" "VERBOSE_MARKER");
+    std::string zq = "zq";
+    bool info = inProgram(zq + "INFO_MARKER");
+    bool verbose = inProgram(zq + "VERBOSE_MARKER");
+    printf("debug: DEBUG_INFO text in the program: %s, DEBUG_VERBOSE text: %s\n", info ? "yes" : "no", verbose ? "yes" : "no");
+    check(info && !verbose, "DEBUG_VERBOSE text is in the program");
+
+  return failures ? 1 : 0;
+}
+
+
+// --------------------------- E N D -----------------------------
@@ -0,0 +1,294 @@
+/**************************************************************************************************
+ *
+ *      Host test - delta (patch) updates (ota.h) - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Makes up a firmware and a changed copy of it (some bytes changed, a block inserted, a block
+ *      moved and the end cut off), has misc/otadelta.py make the patch and applies it with the real
+ *      deltaWrite() to the (fake) update library, in one go and in pieces of every size from 1 byte
+ *      so the pieces end part way through lengths and data.  Checks the firmware written is exactly
+ *      the new one.  Then patches which must be refused: not a patch, made from other firmware, a
+ *      seek or copy outside the old firmware, cut short and producing more than the new size, each of
+ *      which must discard the update.  Then times applying the patch.
+ *
+ *      run.sh also builds it as for the esp32 (old firmware read from the partition, abort()).
+ *
+ **************************************************************************************************/
+
+#include "Arduino.h"
+#include "hostnet.h"
+#include "Update.h"
+#include "esp_ota_ops.h"
+#include <vector>
+#include <random>
+#include <filesystem>
+#include <unistd.h>
+
+
+// ----------------------------------------------------------------
+//                  -what ota.h needs from the sketch
+// ----------------------------------------------------------------
+
+  const bool serialDebug = 0;
+  bool wifiok = 1;
+  const char* stitle = "BasicWebServer";
+  const char* sversion = "22Jan21";
+  const char OTAServer[] = "";
+  uint16_t OTAServerPort = 80;
+  const char OTAManifest[] = "/manifest.txt";
+  const char colRed[] = "";
+  const char colEnd[] = "";
+
+  enum logLevels { logDebug, logInfo, logWarning, logError };
+  std::string lastLog;
+  void logMessage(byte, const char* fmt, ...) {
+    char buf[200];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    lastLog = buf;
+  }
+  #define log_system_message(...) logMessage(logInfo, __VA_ARGS__)
+
+
+typedef WiFiClient MeteredClient;
+
+// the running firmware is in hostFlash (esp_ota_ops.h)
+String hostMD5;                             // md5 of the running firmware
+size_t flashReads = 0, flashUnaligned = 0;
+struct {
+  void restart() {}
+  String getSketchMD5() { return hostMD5; }
+  uint32_t getSketchSize() { return hostFlash.size(); }
+  uint32_t getFreeSketchSpace() { return 1 << 20; }
+  bool flashRead(uint32_t address, uint32_t* buf, size_t len) {
+    flashReads++;
+    if ((address | len) & 3) flashUnaligned++;
+    if (address + len > hostFlash.size()) return 0;
+    memcpy(buf, hostFlash.data() + address, len);
+    return 1;
+  }
+} ESP;
+
+
+// web server (the upload pages are not used here)
+
+  enum HTTPUploadStatus { UPLOAD_FILE_START, UPLOAD_FILE_WRITE, UPLOAD_FILE_END, UPLOAD_FILE_ABORTED };
+  struct HTTPUpload { HTTPUploadStatus status; String filename; uint8_t* buf; size_t currentSize; uint32_t totalSize; };   // (size_t is 32 bits on the esp)
+  const int HTTP_POST = 3;
+  struct {
+    HTTPUpload up;
+    template<typename A, typename B> void on(const char*, int, A, B) {}
+    HTTPUpload& upload() { return up; }
+    void sendHeader(const char*, const char*) {}
+    template<typename T> void send(int, const char*, const T&) {}
+    WiFiClient client() { return WiFiClient(); }
+  } server;
+  void routeOn(const char*, void (*)()) {}
+  void webheader(WiFiClient&) {}
+  void webfooter(WiFiClient&) {}
+
+
+#include "../../BasicWebserver/ota.h"
+
+
+// ----------------------------------------------------------------
+//                              -test
+// ----------------------------------------------------------------
+
+typedef std::vector<uint8_t> Bytes;
+
+int failures = 0;
+void check(bool ok, const char* what) {
+  if (ok) return;
+  printf("FAILED: %s\n", what);
+  failures++;
+}
+
+std::string dir;                            // temporary folder for the files given to otadelta.py
+
+void writeFile(const std::string &name, const Bytes &b) {
+  FILE* f = fopen((dir + name).c_str(), "wb");
+  if (f) fwrite(b.data(), 1, b.size(), f);
+  if (f) fclose(f);
+}
+
+Bytes readFile(const std::string &name) {
+  Bytes b;
+  FILE* f = fopen((dir + name).c_str(), "rb");
+  for (int c; f && (c = fgetc(f)) != EOF; ) b.push_back(c);
+  if (f) fclose(f);
+  return b;
+}
+
+// md5 of a file as text (from md5sum)
+String md5Of(const std::string &name) {
+  char line[100] = "";
+  FILE* p = popen(("md5sum " + dir + name).c_str(), "r");
+  if (p && !fgets(line, sizeof(line), p)) line[0] = 0;
+  if (p) pclose(p);
+  line[32] = 0;
+  return String(line);
+}
+
+// what the operations in a patch are (to check the made up firmware gives a patch using all of them)
+struct Ops { int copy = 0, add = 0, insert = 0, seekBack = 0, longLengths = 0; };
+Ops opsIn(const Bytes &p) {
+  Ops ops;
+  size_t pos = deltaHeaderSize;
+  while (pos < p.size() && p[pos] != deltaEND) {
+    byte op = p[pos++];
+    uint32_t value = 0;
+    int shift = 0;
+    while (p[pos] & 0x80) {
+      value |= (uint32_t)(p[pos++] & 0x7F) << shift;
+      shift += 7;
+    }
+    value |= (uint32_t)p[pos++] << shift;
+    if (shift) ops.longLengths++;
+    if (op == deltaCOPY) ops.copy++;
+    if (op == deltaADD) ops.add++;
+    if (op == deltaINSERT) ops.insert++;
+    if (op == deltaSEEK && (value & 1)) ops.seekBack++;
+    if (op == deltaADD || op == deltaINSERT) pos += value;
+  }
+  return ops;
+}
+
+// send a patch as an upload would, in pieces of 'piece' bytes (the last 'cut' bytes are not sent)
+void upload(const Bytes &patch, size_t piece, size_t cut = 0) {
+  Bytes buf(piece);                         // (copied to a buffer of its own as the library does)
+  deltaBegin();
+  for (size_t pos = 0; pos + cut < patch.size(); pos += piece) {
+    size_t n = std::min(piece, patch.size() - cut - pos);
+    memcpy(buf.data(), &patch[pos], n);
+    deltaWrite(buf.data(), n);
+  }
+  deltaEnd();
+}
+
+bool installed(const Bytes &image) {
+  return delta.stage == deltaFinished && !Update.running && !Update.aborted && Update.data == image;
+}
+
+// a patch which must be refused with 'error'
+void refused(const char* what, const Bytes &patch, const char* error) {
+  upload(patch, 1436);
+  bool ok = delta.stage == deltaFailed && !strcmp(delta.error, error) && !Update.running;
+  #if defined ESP32
+    ok = ok && Update.aborted;
+  #endif
+  printf("delta: %-34s %s\n", what, ok ? delta.error : "NOT REFUSED AS IT SHOULD BE");
+  check(ok, what);
+}
+
+// a patch header for the running firmware followed by 'ops'
+Bytes handMade(const Bytes &real, uint32_t newSize, const Bytes &ops) {
+  Bytes p(real.begin(), real.begin() + deltaHeaderSize);
+  memcpy(&p[12], &newSize, 4);
+  p.insert(p.end(), ops.begin(), ops.end());
+  p.push_back(deltaEND);
+  return p;
+}
+
+// a SEEK operation moving 'offset' bytes
+Bytes seek(int32_t offset) {
+  uint32_t z = (offset >= 0) ? (uint32_t)offset << 1 : ((uint32_t)-offset << 1) - 1;     // zigzag
+  Bytes op = {deltaSEEK};
+  for (; z >= 0x80; z >>= 7) op.push_back((z & 0x7F) | 0x80);
+  op.push_back(z);
+  return op;
+}
+Bytes operator+(Bytes a, const Bytes &b) {
+  a.insert(a.end(), b.begin(), b.end());
+  return a;
+}
+
+
+int main() {
+
+  char tmp[] = "/tmp/deltatestXXXXXX";
+  if (!mkdtemp(tmp)) return 1;
+  dir = std::string(tmp) + "/";
+
+  // made up firmware and a changed copy of it
+    std::mt19937 rng(1);
+    Bytes oldImage(300000);
+    for (size_t i=0; i < oldImage.size(); i++) oldImage[i] = (i % 4096 < 3000) ? rng() : (i >> 4);   // (some of it repeats)
+    Bytes newImage(oldImage.begin(), oldImage.begin() + 120000);
+    for (size_t i=1000; i < newImage.size(); i += 997) newImage[i] ^= 0x5A;                     // addresses changed
+    for (int i=0; i < 3000; i++) newImage.push_back(rng());                                    // new code
+    newImage.insert(newImage.end(), oldImage.begin() + 200000, oldImage.begin() + 260000);      // moved
+    newImage.insert(newImage.end(), oldImage.begin() + 130000, oldImage.begin() + 190000);      // (seek back)
+    writeFile("old.bin", oldImage);
+    writeFile("new.bin", newImage);
+    std::string cmd = "python3 ../otadelta.py " + dir + "old.bin " + dir + "new.bin " + dir + "patch.bin > /dev/null";
+    if (system(cmd.c_str()) != 0) {
+      printf("FAILED: otadelta.py did not make the patch\n");
+      return 1;
+    }
+    Bytes patch = readFile("patch.bin");
+    hostFlash = oldImage;
+    hostMD5 = md5Of("old.bin");
+    String newMD5 = md5Of("new.bin");
+    Ops ops = opsIn(patch);
+    printf("delta: %zu -> %zu bytes, patch %zu bytes (%d copy, %d add, %d insert, %d seek back, %d lengths over 1 byte)\n",
+           oldImage.size(), newImage.size(), patch.size(), ops.copy, ops.add, ops.insert, ops.seekBack, ops.longLengths);
+    check(ops.copy && ops.add && ops.insert && ops.seekBack && ops.longLengths, "patch does not use every operation");
+
+  // applied in one go, then in pieces of every size from 1 byte (ending part way through lengths and data)
+    upload(patch, patch.size());
+    check(installed(newImage) && Update.md5 == newMD5, "patch applied in one go");
+    int badPieces = 0;
+    for (size_t piece=1; piece <= 64; piece++) {
+      upload(patch, piece);
+      if (!installed(newImage)) badPieces++;
+    }
+    for (size_t piece : {127, 128, 255, 256, 257, 1436, 2048}) {                               // (1436 is the esp8266 upload buffer)
+      upload(patch, piece);
+      if (!installed(newImage)) badPieces++;
+    }
+    printf("delta: applied in pieces of 1 to 64 bytes and 7 larger sizes, %d wrong\n", badPieces);
+    check(badPieces == 0, "patch applied in pieces");
+    #if !defined ESP32
+      check(flashReads && flashUnaligned == 0, "flash read not 4 byte aligned");
+    #endif
+
+  // patches which must be refused
+    Bytes bad = patch;
+    bad[0] = 'X';
+    refused("not a patch", bad, "not a delta patch file");
+    hostMD5 = newMD5;
+    refused("made from other firmware", patch, "patch was not made from the running firmware");
+    hostMD5 = md5Of("old.bin");
+    refused("seek before the start", handMade(patch, 10, seek(-1)), "seek outside old firmware");
+    refused("seek past the end", handMade(patch, 10, seek(oldImage.size() + 1)), "seek outside old firmware");
+    refused("copy past the end", handMade(patch, 10, seek(oldImage.size() - 3) + Bytes{deltaCOPY, 10}), "copy outside old firmware");
+    refused("more than the new size", handMade(patch, 10, {deltaINSERT, 11, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11}),
+            "patch produces more data than expected");
+    refused("invalid operation", handMade(patch, 10, {7, 1}), "invalid operation in patch");
+    upload(patch, 1436, 100);
+    bool cut = delta.stage == deltaFailed && !strcmp(delta.error, "patch is incomplete") && !Update.running;
+    #if defined ESP32
+      cut = cut && Update.aborted;
+    #endif
+    printf("delta: %-34s %s\n", "cut short", cut ? delta.error : "NOT REFUSED AS IT SHOULD BE");
+    check(cut, "cut short");
+    check(lastLog == "Delta update failed: patch is incomplete", "failure not logged");
+
+  // time to apply the patch in upload sized pieces (on this PC)
+    uint64_t t = hostRealUs();
+    const int runs = 20;
+    for (int i=0; i < runs; i++) upload(patch, 1436);
+    double ms = (hostRealUs() - t) / 1000.0 / runs;
+    printf("delta: %.2f ms to apply the patch (%.0f MB of new firmware a second)\n", ms, newImage.size() / ms / 1000);
+    check(installed(newImage), "patch applied when timed");
+
+  std::filesystem::remove_all(dir);
+  return failures ? 1 : 0;
+}
+
+
+// --------------------------- E N D -----------------------------
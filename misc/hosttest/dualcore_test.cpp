@@ -0,0 +1,196 @@
+/**************************************************************************************************
+ *
+ *      Host test - web server and loop on separate cores (dualcore.h) - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Runs the real web server task (webTask) in a thread standing in for core 0 while the main
+ *      thread is loop on core 1, passing log messages, commands and a status snapshot between them
+ *      as fast as they can.  Checks nothing is lost without being counted, nothing arrives out of
+ *      order and the snapshot is never read half written.  Also several threads adding to and
+ *      taking from one queue at once.
+ *
+ *      run.sh also runs it built with ThreadSanitizer, which fails it if the two sides share
+ *      anything without atomics.
+ *
+ **************************************************************************************************/
+
+#include "Arduino.h"
+#include <atomic>
+#include <vector>
+
+
+// ----------------------------------------------------------------
+//                  -FreeRTOS stand-ins (a thread per task)
+// ----------------------------------------------------------------
+
+  typedef void* TaskHandle_t;
+  thread_local int hostCore = 1;            // core the thread stands in for (loop is on core 1)
+  thread_local TaskHandle_t hostTask = nullptr;
+  std::atomic<bool> hostStop{0};            // ends the tasks (at their next vTaskDelay)
+  std::vector<std::thread> hostTasks;
+  struct HostStopped {};
+
+  int xPortGetCoreID() { return hostCore; }
+  TaskHandle_t xTaskGetCurrentTaskHandle() { return hostTask; }
+  void vTaskDelay(uint32_t) {
+    if (hostStop) throw HostStopped();
+    std::this_thread::yield();
+  }
+  void xTaskCreatePinnedToCore(void (*task)(void*), const char*, uint32_t, void* param, int, TaskHandle_t* handle, int core) {
+    static int tasks = 0;
+    *handle = (TaskHandle_t)(intptr_t)++tasks;
+    TaskHandle_t h = *handle;
+    hostTasks.emplace_back([=]() {
+      hostCore = core;
+      hostTask = h;
+      try { task(param); } catch (HostStopped&) {}
+    });
+  }
+
+
+#define ENABLE_DUALCORE 1
+#include "sketch.h"
+#define TRACE_SCOPE(tag)
+const byte LogLength = 100;
+#include "../../BasicWebserver/arena.h"
+
+void logAdd(const char*, byte, bool);
+void webCommand(byte);
+#include "../../BasicWebserver/dualcore.h"
+
+
+// ----------------------------------------------------------------
+//                              -test
+// ----------------------------------------------------------------
+
+#ifdef __SANITIZE_THREAD__
+  const uint32_t scale = 20;                // (ThreadSanitizer is much slower so do less)
+#else
+  const uint32_t scale = 1;
+#endif
+
+int failures = 0;
+void check(bool ok, const char* what) {
+  if (ok) return;
+  printf("FAILED: %s\n", what);
+  failures++;
+}
+
+// the status published by loop (every field worked out from one number so a half written copy shows)
+struct Snapshot {
+  uint32_t n;
+  uint32_t twice;
+  uint64_t squared;
+  char text[12];
+};
+SeqLock<Snapshot> status;
+
+// web server task (core 0)
+  std::atomic<uint32_t> logsStored{0};
+  uint32_t lastLog = 0;
+  bool logOrder = 1;
+  uint32_t commandsSent = 0;
+  uint32_t pagesTorn = 0;
+  uint32_t pages = 0;
+
+  void logAdd(const char* entry, byte, bool) {
+    uint32_t n = strtoul(entry + 5, nullptr, 10);          // "loop 123"
+    if (strncmp(entry, "loop ", 5) != 0 || n <= lastLog) logOrder = 0;
+    lastLog = n;
+    logsStored++;
+  }
+
+  // a page which shows the status and has a button
+  void page() {
+    Snapshot s = status.read();
+    char text[12];
+    snprintf(text, sizeof(text), "%u", s.n);
+    if (s.twice != s.n * 2 || s.squared != (uint64_t)s.n * s.n || strcmp(text, s.text) != 0) pagesTorn++;
+    int buttons = (++pages % 1000) ? 1 : 40;              // (now and then more than the queue holds)
+    for (int i=0; i < buttons; i++) sendCommand(commandsSent++ & 255);
+  }
+
+// loop (core 1)
+  uint32_t commandsRun = 0;
+  byte lastCommand = 255;
+  bool commandOrder = 1;
+
+  void webCommand(byte cmd) {
+    if (cmd == lastCommand) commandOrder = 0;               // (a repeat would be out of order, gaps are dropped commands)
+    lastCommand = cmd;
+    commandsRun++;
+  }
+
+
+int main() {
+
+  // loop and the web server task
+    const uint32_t loops = 200000 / scale;
+    uint32_t logsSent = 0;
+    hostHandleClient = page;
+    status.write({0, 0, 0, "0"});          // (setup publishes the status before starting the task)
+    dualcoreStart();
+    for (uint32_t i=1; i <= loops; i++) {
+      Snapshot s = {i, i * 2, (uint64_t)i * i, ""};
+      snprintf(s.text, sizeof(s.text), "%u", i);
+      status.write(s);
+      for (int m = (i % 1000) ? 1 : 40; m > 0; m--) {    // (now and then more than the queue holds)
+        char entry[20];
+        snprintf(entry, sizeof(entry), "loop %u", ++logsSent);
+        logQueueAdd(entry, 1, 0);
+      }
+      commandsLoop();
+      debugLoop();
+      std::this_thread::yield();
+    }
+    for (int t=0; t < 5000 && logsStored + logQueue.dropped < logsSent; t++) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    hostStop = 1;
+    for (std::thread &t : hostTasks) t.join();
+    commandsLoop();
+
+    printf("dualcore: %u log messages, %u stored, %u dropped (queue full)\n", logsSent, logsStored.load(), logQueue.dropped.load());
+    printf("dualcore: %u pages, %u half written status, %u commands, %u run, %u dropped\n",
+           pages, pagesTorn, commandsSent, commandsRun, commandQueue.dropped.load());
+    check(logsStored + logQueue.dropped == logsSent, "log messages lost without being counted");
+    check(logOrder, "log messages out of order");
+    check(pagesTorn == 0, "status read half written");
+    check(commandsRun + commandQueue.dropped == commandsSent, "commands lost without being counted");
+    check(commandOrder, "commands out of order");
+
+  // four threads adding to one queue and two taking from it
+    const uint32_t each = 100000 / scale;
+    MsgQueue<uint32_t, 16> queue;
+    std::vector<std::atomic<uint8_t>> seen(4 * each);
+    std::atomic<uint32_t> taken{0};
+    std::atomic<bool> orderOk{1};
+    std::vector<std::thread> threads;
+    for (uint32_t p=0; p < 4; p++) threads.emplace_back([&, p]() {
+      for (uint32_t i=0; i < each; i++) while (!queue.push(p * each + i)) std::this_thread::yield();
+    });
+    for (int c=0; c < 2; c++) threads.emplace_back([&]() {
+      int32_t last[4] = {-1, -1, -1, -1};                 // each adder's messages must arrive in order
+      uint32_t v;
+      while (taken < 4 * each) {
+        if (!queue.pop(v)) {
+          std::this_thread::yield();
+          continue;
+        }
+        if ((int32_t)(v % each) <= last[v / each]) orderOk = 0;
+        last[v / each] = v % each;
+        seen[v]++;
+        taken++;
+      }
+    });
+    for (std::thread &t : threads) t.join();
+    uint32_t once = 0;
+    for (auto &s : seen) once += (s == 1);
+    printf("dualcore: 4 threads added %u messages to one queue, 2 threads took %u, each exactly once %u\n",
+           4 * each, taken.load(), once);
+    check(once == 4 * each && orderOk, "messages lost, repeated or out of order");
+
+  return failures ? 1 : 0;
+}
+
+
+// --------------------------- E N D -----------------------------
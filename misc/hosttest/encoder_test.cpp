@@ -0,0 +1,191 @@
+/**************************************************************************************************
+ *
+ *      Host test - rotary encoder decoder and event queue (oled.h) - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Plays pin changes in to the real interrupt routines: clean turns, turns where every change
+ *      bounces, changes the interrupt missed and more turns than the queue holds, then a button which
+ *      bounces, changes before the interrupt for it (as when it runs on the other core), is released
+ *      inside the debounce time and is held for a long press (which confirms an action).  Checks the events read with reGetEvent() each time and times the interrupt routine.
+ *
+ **************************************************************************************************/
+
+#define ESP8266
+#define D1 5
+#define D2 4
+#define D5 14
+#define D6 12
+#define D7 13
+#include "sketch.h"
+#include <ctime>
+
+
+// ----------------------------------------------------------------
+//                -what oled.h needs from the sketch
+// ----------------------------------------------------------------
+
+  const char* stitle = "BasicWebServer";
+  const char* sversion = "22Jan21";
+  void log_system_message(const char*, ...) {}
+  time_t now() { return 1700000000; }
+  int hour(time_t) { return 12; }
+  int minute(time_t) { return 0; }
+  int weekday(time_t) { return 1; }
+  int day(time_t) { return 1; }
+  int month(time_t) { return 1; }
+  int year(time_t) { return 2026; }
+  struct { IPAddress localIP() { return IPAddress(192, 168, 0, 50); } } WiFi;
+
+
+#include "../../BasicWebserver/oled.h"
+
+
+// ----------------------------------------------------------------
+//                              -test
+// ----------------------------------------------------------------
+
+int failures = 0;
+void check(bool ok, const char* what) {
+  if (ok) return;
+  printf("FAILED: %s\n", what);
+  failures++;
+}
+
+int events[6];                              // events read (by type)
+
+void readEvents() {
+  byte e;
+  while ((e = reGetEvent()) != reNone) events[e]++;
+}
+
+// pin change, 'bounces' extra times there and back first (1ms apart)
+void change(int pin, int v, int bounces = 0, bool missed = 0) {
+  for (int i=0; i < bounces; i++) {
+    hostPinSet(pin, v);
+    hostPinSet(pin, !v);
+  }
+  hostPinSet(pin, v, missed);
+  hostAdvance(1);
+}
+
+// one step (4 changes) up or down
+void step(bool up, int bounces = 0, int missed = -1) {
+  static const byte seq[4] = { 1, 3, 2, 0 };              // (A << 1 | B) turning up
+  for (int i=0; i < 4; i++) {
+    byte s = seq[up ? i : (6 - i) % 4];
+    byte pins = (hostPins[encoder0PinA] << 1) | hostPins[encoder0PinB];
+    if ((s ^ pins) & 2) change(encoder0PinA, s >> 1, bounces, i == missed);
+    else change(encoder0PinB, s & 1, bounces, i == missed);
+  }
+}
+
+
+int main() {
+
+  hostPins[encoder0Press] = HIGH;           // (button not pressed)
+  oledSetup();
+  readEvents();
+
+  // clean turns
+    memset(events, 0, sizeof(events));
+    for (int i=0; i < 50; i++) { step(1); readEvents(); }
+    for (int i=0; i < 20; i++) { step(0); readEvents(); }
+    printf("encoder: 50 steps up and 20 down, read %d up %d down\n", events[reStepUp], events[reStepDown]);
+    check(events[reStepUp] == 50 && events[reStepDown] == 20, "clean turns");
+
+  // every change bouncing
+    memset(events, 0, sizeof(events));
+    for (int i=0; i < 50; i++) { step(1, 3); readEvents(); }
+    printf("encoder: 50 steps up with each change bouncing 3 times, read %d up %d down\n", events[reStepUp], events[reStepDown]);
+    check(events[reStepUp] == 50 && events[reStepDown] == 0, "bouncing turns");
+
+  // changes the interrupt missed (one in every 10 steps), a skipped state is ignored so it can not step the wrong way
+    memset(events, 0, sizeof(events));
+    uint32_t x = 1;
+    int missed = 0;
+    for (int i=0; i < 1000; i++) {
+      x = x * 1103515245 + 12345;
+      bool miss = (x >> 16) % 10 == 0;
+      missed += miss;
+      step(1, (x >> 8) & 1, miss ? (x >> 4) & 3 : -1);
+      readEvents();
+    }
+    printf("encoder: 1000 steps up with %d changes missed, read %d up %d down\n", missed, events[reStepUp], events[reStepDown]);
+    check(events[reStepDown] == 0 && events[reStepUp] >= 1000 - missed, "missed changes");
+    encoderA.count = 0;
+
+  // more steps than the queue holds before they are read
+    memset(events, 0, sizeof(events));
+    uint32_t dropped = encoderA.dropped;
+    for (int i=0; i < 40; i++) step(1);
+    readEvents();
+    printf("encoder: 40 steps before reading, read %d, %u dropped\n", events[reStepUp], encoderA.dropped - dropped);
+    check(events[reStepUp] == reQueueSize - 1 && encoderA.dropped - dropped == 40 - (reQueueSize - 1u), "queue full");
+
+  // button bouncing on press and release
+    memset(events, 0, sizeof(events));
+    hostAdvance(100);
+    change(encoder0Press, LOW, 3);
+    readEvents();
+    hostAdvance(200);
+    change(encoder0Press, HIGH, 3);
+    readEvents();
+    check(events[rePress] == 1 && events[reRelease] == 1 && events[reLongPress] == 0, "bouncing button");
+
+  // a press loop sees before the interrupt for it (on the other core) is only read once
+    memset(events, 0, sizeof(events));
+    hostAdvance(100);
+    hostPinSet(encoder0Press, LOW, 1);
+    hostAdvance(reDebounceTime);
+    readEvents();
+    hostInterrupts[encoder0Press]();                           // (the interrupt arriving late)
+    readEvents();
+    hostAdvance(200);
+    change(encoder0Press, HIGH);
+    readEvents();
+    check(events[rePress] == 1 && events[reRelease] == 1, "press read twice");
+
+  // released inside the debounce time (the interrupt ignores it, reGetEvent() picks it up afterwards)
+    memset(events, 0, sizeof(events));
+    hostAdvance(100);
+    change(encoder0Press, LOW);
+    hostAdvance(10);
+    change(encoder0Press, HIGH);
+    readEvents();
+    check(events[rePress] == 1 && events[reRelease] == 0 && encoderA.pressed, "quick release reported too soon");
+    hostAdvance(reDebounceTime);
+    readEvents();
+    check(events[reRelease] == 1 && !encoderA.pressed, "quick release lost");
+
+  // a long press confirms as soon as it is long enough
+    static int confirmed = -1;
+    static uint32_t confirmedAt = 0;
+    hostAdvance(100);
+    confirmActionRequired([](int c) { confirmed = c; confirmedAt = millis(); });
+    uint32_t start = millis();
+    change(encoder0Press, LOW);
+    for (int i=0; i < 250 && confirmed < 0; i++) {
+      hostAdvance(10);
+      oledLoop();
+    }
+    printf("encoder: confirm widget finished with %d after %u ms\n", confirmed, confirmedAt - start);
+    check(confirmed == 1 && confirmedAt - start < 2000, "long press did not confirm");
+    change(encoder0Press, HIGH);
+    hostAdvance(reDebounceTime);
+    oledLoop();
+
+  // time for the interrupt routine (on this PC)
+    double ns = hostTimeNs(1000000, [](int i) {
+      hostPins[encoder0PinA] = (i >> 1 ^ i) & 1;                 // (gray code, a change every call)
+      hostPins[encoder0PinB] = (i >> 1) & 1;
+      doEncoder();
+      if ((i & 7) == 7) while (reGetEvent() != reNone);
+    });
+    printf("encoder: %.1f ns per pin change interrupt\n", ns);
+
+  return failures ? 1 : 0;
+}
+
+
+// --------------------------- E N D -----------------------------
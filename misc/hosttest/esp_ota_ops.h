@@ -0,0 +1,37 @@
+/**************************************************************************************************
+ *
+ *      ESP-IDF partition stand-in for the host tests - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      The running firmware is kept in hostFlash (set by the test) and read from there.
+ *
+ **************************************************************************************************/
+
+#pragma once
+
+#include "Arduino.h"
+#include <vector>
+
+
+typedef int esp_err_t;
+const esp_err_t ESP_OK = 0;
+const esp_err_t ESP_ERR_INVALID_SIZE = 0x104;
+
+struct esp_partition_t {};
+
+inline std::vector<uint8_t> hostFlash;      // the running firmware
+
+inline const esp_partition_t* esp_ota_get_running_partition() {
+  static esp_partition_t running;
+  return &running;
+}
+
+inline esp_err_t esp_partition_read(const esp_partition_t*, size_t offset, void* dst, size_t size) {
+  if (offset + size > hostFlash.size()) return ESP_ERR_INVALID_SIZE;
+  memcpy(dst, hostFlash.data() + offset, size);
+  return ESP_OK;
+}
+
+
+// --------------------------- E N D -----------------------------
@@ -0,0 +1,183 @@
+/**************************************************************************************************
+ *
+ *      Host test - connection guard (guard.h) - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      A minute of 50 new 'slowloris' connections a second (each sending a few bytes a second and
+ *      never finishing its request) while a browser makes a normal request every 250ms, checks every
+ *      browser request is handled quickly and none of the slow ones reach the web server library.
+ *      Then single connections for each way of being closed (header / body too slow, header too big).
+ *
+ *      The web server library is a fake which only has what guard.h uses, it notes if it is ever
+ *      given a request which has not all arrived.
+ *
+ **************************************************************************************************/
+
+#include "Arduino.h"
+#include <memory>
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <strings.h>
+
+
+// ----------------------------------------------------------------
+//               -connections and the web server library
+// ----------------------------------------------------------------
+
+// a connection, its request arrives at 'rate' bytes a second (0 = all at once)
+struct Conn {
+  std::string data;
+  uint32_t start;
+  int rate;
+  bool closed = 0;
+  std::string reply;                        // what the guard sent back
+  bool handled = 0;                         // passed to the library
+  uint32_t handledAt = 0;
+  int arrived() {
+    if (rate <= 0) return data.size();
+    return std::min<long>((long)(millis() - start) * rate / 1000, data.size());
+  }
+};
+
+class ServerClient {
+  public:
+    std::shared_ptr<Conn> c;
+    int available() { return (c && !c->closed) ? c->arrived() : 0; }
+    bool connected() { return c && !c->closed; }
+    int peekBytes(uint8_t* buf, int n) { memcpy(buf, c->data.data(), n); return n; }
+    size_t write(const uint8_t* buf, size_t n) { c->reply.append((const char*)buf, n); return n; }
+    void stop() { if (c) c->closed = 1; }
+    explicit operator bool() const { return (bool)c; }
+};
+
+enum HTTPClientStatus { HC_NONE, HC_WAIT_READ, HC_WAIT_CLOSE };
+
+struct HostListener {
+  std::deque<std::shared_ptr<Conn>> waiting;
+  bool hasClient() { return !waiting.empty(); }
+  ServerClient available() {
+    ServerClient s;
+    if (!waiting.empty()) {
+      s.c = waiting.front();
+      waiting.pop_front();
+    }
+    return s;
+  }
+};
+
+uint32_t incomplete = 0;                    // requests the library was given before they had all arrived
+
+// the library (handles the request it is given straight away)
+struct HostWebServer {
+  HostWebServer(int) {}
+  HostListener _server;
+  ServerClient _currentClient;
+  HTTPClientStatus _currentStatus = HC_NONE;
+  unsigned long _statusChange = 0;
+  void handleClient() {
+    if (_currentStatus != HC_WAIT_READ || !_currentClient.available()) return;
+    Conn &c = *_currentClient.c;
+    if ((size_t)c.arrived() < c.data.size()) incomplete++;
+    c.handled = 1;
+    c.handledAt = millis();
+    _currentClient.stop();
+    _currentStatus = HC_NONE;
+  }
+};
+
+#define ENABLE_GUARD 1
+#include "../../BasicWebserver/guard.h"
+
+
+// ----------------------------------------------------------------
+//                              -test
+// ----------------------------------------------------------------
+
+int failures = 0;
+void check(bool ok, const char* what) {
+  if (ok) return;
+  printf("FAILED: %s\n", what);
+  failures++;
+}
+
+const std::string get = "GET /data HTTP/1.1\r\nHost: esp\r\n\r\n";
+const std::string post = "POST /form HTTP/1.1\r\nHost: esp\r\nContent-Length: 10\r\n\r\n0123456789";
+
+std::shared_ptr<Conn> connect(ClientGuard<HostWebServer> &g, const std::string &data, int rate) {
+  auto c = std::make_shared<Conn>();
+  c->data = data;
+  c->start = millis();
+  c->rate = rate;
+  g._server.waiting.push_back(c);
+  return c;
+}
+
+// run loop (every 3ms) for a while
+void run(ClientGuard<HostWebServer> &g, uint32_t ms) {
+  for (uint32_t i=0; i < ms; i++) {
+    if (millis() % 3 == 0) g.handleClient();
+    hostAdvance(1);
+  }
+}
+
+
+int main() {
+
+  // a minute of slowloris with a browser request every 250ms
+    ClientGuard<HostWebServer> g(80);
+    std::vector<std::shared_ptr<Conn>> browser, slow;
+    for (uint32_t ms=1; ms <= 60000; ms++) {
+      if (ms % 20 == 0) slow.push_back(connect(g, std::string(2000, 'a'), 5));
+      if (ms % 250 == 0) browser.push_back(connect(g, (ms % 500) ? get : post, 0));
+      run(g, 1);
+    }
+    run(g, 100);
+
+    std::vector<uint32_t> waits;
+    for (auto &c : browser) if (c->handled) waits.push_back(c->handledAt - c->start);
+    std::sort(waits.begin(), waits.end());
+    int slowHandled = 0;
+    for (auto &c : slow) slowHandled += c->handled;
+    uint32_t p99 = waits.empty() ? 0 : waits[waits.size() * 99 / 100];
+    printf("guard: %zu slow connections, %zu browser requests, %zu handled, p50 %u ms, p99 %u ms, slow ones handled %d\n",
+           slow.size(), browser.size(), waits.size(), waits.empty() ? 0 : waits[waits.size() / 2], p99, slowHandled);
+    printf("guard:");
+    for (byte r=0; r < guardResultCount; r++) printf(" %s %u", guardResultNames[r], guardCount[r]);
+    printf("\n");
+    check(waits.size() == browser.size(), "browser requests were not handled");
+    check(p99 <= 10, "browser requests waited too long");
+    check(slowHandled == 0 && incomplete == 0, "a request was handled before it had all arrived");
+
+  // without the guard the library takes each connection in turn and waits up to 5 seconds for it
+    uint64_t freeAt = 0;
+    uint32_t served = 0;
+    for (uint32_t ms=1; ms <= 60000; ms++) {
+      if (ms % 20 == 0) freeAt = std::max<uint64_t>(freeAt, ms) + 5000;
+      if (ms % 250 == 0 && std::max<uint64_t>(freeAt, ms) <= 60000) served++;
+    }
+    printf("guard: without it %u of the %zu browser requests would have been answered in the minute\n", served, browser.size());
+
+  // one connection for each way of being closed
+    struct { const char* what; std::string data; int rate; byte result; const char* reply; } cases[] = {
+      { "header too slow", get, 10, guardHeaderTimeout, "HTTP/1.1 408" },
+      { "body too slow", "POST /form HTTP/1.1\r\nContent-Length: 500\r\n\r\n" + std::string(500, 'b'), 100, guardBodyTimeout, "HTTP/1.1 408" },
+      { "header too big", "GET / HTTP/1.1\r\nCookie: " + std::string(2000, 'c'), 0, guardTooBig, "HTTP/1.1 431" },
+      { "large upload (left to the library)", "POST /ota HTTP/1.1\r\nContent-Length: 100000\r\n\r\n" + std::string(100000, 'd'), 2000, guardHandled, "" },
+    };
+    for (auto &k : cases) {
+      ClientGuard<HostWebServer> g1(80);
+      uint32_t before = guardCount[k.result];
+      auto c = connect(g1, k.data, k.rate);
+      run(g1, guardTotalMs + 100);
+      bool ok = (guardCount[k.result] == before + 1 && c->reply.rfind(k.reply, 0) == 0 && c->handled == (k.result == guardHandled));
+      printf("guard: %-35s %s\n", k.what, ok ? "ok" : "FAILED");
+      check(ok, k.what);
+    }
+
+  return failures ? 1 : 0;
+}
+
+
+// --------------------------- E N D -----------------------------
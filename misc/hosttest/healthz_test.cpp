@@ -0,0 +1,144 @@
+/**************************************************************************************************
+ *
+ *      Host test - status snapshot and /healthz reply (status.h) - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Checks the ready made /healthz reply is a complete http reply (length, json) which follows
+ *      the status as it is updated, that sending it uses no heap, and compares how many can be sent
+ *      a second with working the reply out for every request.
+ *
+ *      run.sh also runs it built with ENABLE_DUALCORE, where the reply is copied out through the
+ *      seqlock loop writes it with, so that copy is timed as well.
+ *
+ **************************************************************************************************/
+
+#include "Arduino.h"
+#include <new>
+
+#if ENABLE_DUALCORE
+  // FreeRTOS stand-ins (the web server task is not started here, only the seqlock is used)
+  typedef void* TaskHandle_t;
+  int xPortGetCoreID() { return 1; }
+  TaskHandle_t xTaskGetCurrentTaskHandle() { return nullptr; }
+  void vTaskDelay(uint32_t) {}
+  void xTaskCreatePinnedToCore(void (*)(void*), const char*, uint32_t, void*, int, TaskHandle_t*, int) {}
+#endif
+
+#include "sketch.h"
+
+#if ENABLE_DUALCORE
+  #define TRACE_SCOPE(tag)
+  const byte LogLength = 100;
+  #include "../../BasicWebserver/arena.h"
+  void logAdd(const char*, byte, bool) {}
+  void webCommand(byte) {}
+  #include "../../BasicWebserver/dualcore.h"
+#endif
+
+
+// ----------------------------------------------------------------
+//                -what status.h needs from the sketch
+// ----------------------------------------------------------------
+
+  enum timeStatus_t { timeNotSet, timeNeedsSync, timeSet };
+  timeStatus_t timeNow = timeNotSet;
+  timeStatus_t timeStatus() { return timeNow; }
+  uint32_t now() { return millis() / 1000; }
+  String currentTime() { return String("12:00:00"); }
+  bool GSMconnected = 0;
+
+  struct {
+    int rssi = -60;
+    int RSSI() { return rssi; }
+  } WiFi;
+  struct {
+    uint32_t heap = 41000;
+    uint32_t getFreeHeap() { return heap; }
+  } ESP;
+
+
+#include "../../BasicWebserver/status.h"
+
+// the /healthz page (the same as handleHealthz() in the main sketch)
+void handleHealthz() {
+  MeteredClient client = server.client();
+  StatusReply reply = statusHealthzRead();
+  client.write((const uint8_t*)reply.text, reply.len);
+  client.stop();
+}
+
+
+// ----------------------------------------------------------------
+//                              -test
+// ----------------------------------------------------------------
+
+// count heap allocations
+size_t heapAllocs = 0;
+void* operator new(size_t n) {
+  heapAllocs++;
+  if (void* p = malloc(n ? n : 1)) return p;
+  throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+int failures = 0;
+void check(bool ok, const char* what) {
+  if (ok) return;
+  printf("FAILED: %s\n", what);
+  failures++;
+}
+
+// check a reply is complete and its body contains 'has'
+bool replyOk(const std::string &reply, const char* has) {
+  size_t split = reply.find("\r\n\r\n");
+  size_t lenAt = reply.find("Content-Length: ");
+  if (reply.rfind("HTTP/1.1 200 OK\r\n", 0) != 0 || split == std::string::npos || lenAt == std::string::npos) return 0;
+  std::string body = reply.substr(split + 4);
+  return atoi(reply.c_str() + lenAt + 16) == (int)body.size() && body.front() == '{' && body.find(has) != std::string::npos;
+}
+
+
+int main() {
+
+  // the reply follows the status
+    statusUpdate();
+    hostSent.clear();
+    handleHealthz();
+    printf("healthz: %zu byte reply: %s", hostSent.size(), hostSent.substr(hostSent.find("\r\n\r\n") + 4).c_str());
+    check(replyOk(hostSent, "\"heap\":41000,\"rssi\":-60,\"time_set\":false"), "reply");
+
+    timeNow = timeSet;
+    WiFi.rssi = -72;
+    ESP.heap = 39000;
+    hostAdvance(1000);
+    statusUpdate();
+    hostSent.clear();
+    handleHealthz();
+    check(replyOk(hostSent, "\"uptime\":2,\"heap\":39000,\"rssi\":-72,\"time_set\":true"), "reply after the status changed");
+
+  // sending it uses no heap (hostSent is made big enough first as it is the test's, not the sketch's)
+    std::string reserve(1 << 20, 0);
+    hostSent.swap(reserve);
+    hostSent.clear();
+    size_t before = heapAllocs;
+    for (int i=0; i < 100000; i++) {
+      handleHealthz();
+      hostSent.clear();
+    }
+    printf("healthz: heap allocations for 100000 replies %zu\n", heapAllocs - before);
+    check(heapAllocs == before, "sending the reply used the heap");
+
+  // replies a second (on this PC)
+    double ready = hostTimeNs(5000000, [](int) { handleHealthz(); hostSent.clear(); });
+    StatusSnapshot s = statusRead();
+    double worked = hostTimeNs(5000000, [&](int) { statusHealthzBuild(s); handleHealthz(); hostSent.clear(); });
+    printf("healthz: %s ready made %.0f ns per reply (%.1f million a second), worked out each time %.0f ns\n",
+           ENABLE_DUALCORE ? "dual core (seqlock)" : "single core", ready, 1000 / ready, worked);
+
+  return failures ? 1 : 0;
+}
+
+
+// --------------------------- E N D -----------------------------
@@ -0,0 +1,113 @@
+/**************************************************************************************************
+ *
+ *      Network stand-ins for the host tests - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      A WiFiClient which uses a real socket (so a test can talk to a server on the PC) and a
+ *      slow web server for tests which need something to wait for.
+ *
+ **************************************************************************************************/
+
+#pragma once
+
+#include "Arduino.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+
+// ----------------------------------------------------------------
+//                 -a WiFiClient using a real socket
+// ----------------------------------------------------------------
+
+class WiFiClient : public Print {
+  public:
+    using Print::write;
+    int connect(const char* host, uint16_t port) {
+      stop();
+      sock = socket(AF_INET, SOCK_STREAM, 0);
+      sockaddr_in addr = {};
+      addr.sin_family = AF_INET;
+      addr.sin_port = htons(port);
+      inet_pton(AF_INET, host, &addr.sin_addr);
+      if (::connect(sock, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        stop();
+        return 0;
+      }
+      fcntl(sock, F_SETFL, O_NONBLOCK);
+      connects++;
+      return 1;
+    }
+    size_t write(const uint8_t* buf, size_t len) override { return (sock < 0) ? 0 : ::send(sock, buf, len, MSG_NOSIGNAL); }
+    int available() {
+      int n = 0;
+      if (sock >= 0) ioctl(sock, FIONREAD, &n);
+      return n;
+    }
+    int read() {
+      uint8_t c;
+      return (read(&c, 1) == 1) ? c : -1;
+    }
+    int read(uint8_t* buf, size_t len) { return (sock < 0) ? -1 : recv(sock, buf, len, 0); }
+    bool connected() {
+      if (sock < 0) return 0;
+      char c;
+      return recv(sock, &c, 1, MSG_PEEK) != 0;                 // (0 = closed by the server)
+    }
+    void stop() {
+      if (sock >= 0) close(sock);
+      sock = -1;
+    }
+    IPAddress remoteIP() { return IPAddress(127, 0, 0, 1); }
+    static inline int connects = 0;
+  private:
+    int sock = -1;
+};
+
+
+// ----------------------------------------------------------------
+//     -a web server which takes 'delayMs' to answer each request
+// ----------------------------------------------------------------
+// runs in its own threads (one per connection) so requests overlap, returns the port it is on
+
+inline uint16_t hostSlowServer(uint32_t delayMs) {
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  bind(listener, (sockaddr*)&addr, sizeof(addr));
+  listen(listener, 64);
+  socklen_t len = sizeof(addr);
+  getsockname(listener, (sockaddr*)&addr, &len);
+
+  std::thread([listener, delayMs]() {
+    for (;;) {
+      int sock = accept(listener, nullptr, nullptr);
+      if (sock < 0) return;
+      std::thread([sock, delayMs]() {
+        char req[512];
+        size_t got = 0;
+        while (got < sizeof(req) - 1) {                        // (read the request headers)
+          ssize_t n = recv(sock, req + got, sizeof(req) - 1 - got, 0);
+          if (n <= 0) break;
+          got += n;
+          req[got] = 0;
+          if (strstr(req, "\r\n\r\n")) break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+        const char reply[] = "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nConnection: close\r\n\r\nslow reply\n";
+        send(sock, reply, sizeof(reply) - 1, MSG_NOSIGNAL);
+        close(sock);
+      }).detach();
+    }
+  }).detach();
+
+  return ntohs(addr.sin_port);
+}
+
+
+// --------------------------- E N D -----------------------------
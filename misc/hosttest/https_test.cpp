@@ -0,0 +1,210 @@
+/**************************************************************************************************
+ *
+ *      Host test - https session cache statistics and redirect (https.h) - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      The handshake itself can not be done on a PC so BearSSL is a fake here: the server does a
+ *      'full' or 'resumed' handshake (each taking a set time on the fake clock) through the session
+ *      cache the sketch sets up, which is a least recently used list of session ids as BearSSL's is.
+ *      Checks the counts and times shown on /metrics for browsers coming back, more browsers than
+ *      the cache holds, a connection which sends no request, and that http is redirected to https
+ *      without the arguments.
+ *
+ **************************************************************************************************/
+
+#include "Arduino.h"
+#include <deque>
+#include <functional>
+#include <algorithm>
+
+
+// ----------------------------------------------------------------
+//                         -BearSSL stand-in
+// ----------------------------------------------------------------
+
+  struct br_ssl_server_context {};
+  struct br_ssl_session_parameters { uint32_t id; };          // (session id)
+  struct br_ssl_session_cache_class {
+    size_t context_size;
+    void (*save)(const br_ssl_session_cache_class **ctx, br_ssl_server_context *cc, const br_ssl_session_parameters *params);
+    int (*load)(const br_ssl_session_cache_class **ctx, br_ssl_server_context *cc, br_ssl_session_parameters *params);
+  };
+  #define BR_KEYTYPE_KEYX 0x10
+  #define BR_KEYTYPE_SIGN 0x20
+
+  // the least recently used cache (ctx points at its first member, as in BearSSL)
+  struct HostLru {
+    const br_ssl_session_cache_class* vtable;
+    std::deque<uint32_t> ids;               // most recently used first
+    size_t size;
+  };
+  void hostLruSave(const br_ssl_session_cache_class **ctx, br_ssl_server_context*, const br_ssl_session_parameters *params) {
+    HostLru &c = *(HostLru*)ctx;
+    c.ids.push_front(params->id);
+    if (c.ids.size() > c.size) c.ids.pop_back();
+  }
+  int hostLruLoad(const br_ssl_session_cache_class **ctx, br_ssl_server_context*, br_ssl_session_parameters *params) {
+    HostLru &c = *(HostLru*)ctx;
+    auto i = std::find(c.ids.begin(), c.ids.end(), params->id);
+    if (i == c.ids.end()) return 0;
+    c.ids.erase(i);
+    c.ids.push_front(params->id);
+    return 1;
+  }
+  const br_ssl_session_cache_class hostLruClass = { sizeof(HostLru), hostLruSave, hostLruLoad };
+
+  namespace BearSSL {
+    struct X509List { X509List(const char*) {} };
+    struct PrivateKey {
+      PrivateKey(const char*) {}
+      bool isEC() { return 1; }
+      bool isRSA() { return 0; }
+    };
+    struct ServerSession {};
+    class ServerSessions {
+      public:
+        ServerSessions(ServerSession*, size_t size) : lru{&hostLruClass, {}, size} {}
+        const br_ssl_session_cache_class** getCache() { return &lru.vtable; }
+        HostLru lru;
+    };
+  }
+
+
+// ----------------------------------------------------------------
+//                         -the web servers
+// ----------------------------------------------------------------
+
+  const bool serialDebug = 1;
+  const uint16_t HttpsPort = 443;
+  void httpsRequestStart();
+
+  // a browser connecting ('session' is the id it asks to resume, 0 = none)
+  struct Connection { uint32_t session; bool sendsRequest; };
+  std::deque<Connection> hostConnecting;
+  uint32_t hostNextSession = 1000;
+  const uint32_t fullMs = 600, resumedMs = 40, requestMs = 5;
+
+  struct HostSecureServer {
+    BearSSL::ServerSessions* cache = nullptr;
+    bool ec = 0;
+    void setECCert(BearSSL::X509List*, int, BearSSL::PrivateKey*) { ec = 1; }
+    void setRSACert(BearSSL::X509List*, BearSSL::PrivateKey*) {}
+    void setCache(BearSSL::ServerSessions* c) { cache = c; }
+  };
+
+  // accepts a connection and does the handshake (as BearSSL does it) then reads and handles the request
+  struct HostWebServerSecure {
+    HostSecureServer secure;
+    uint32_t handled = 0;
+    HostSecureServer& getServer() { return secure; }
+    void handleClient() {
+      if (hostConnecting.empty()) return;
+      Connection c = hostConnecting.front();
+      hostConnecting.pop_front();
+      const br_ssl_session_cache_class** cache = secure.cache->getCache();
+      br_ssl_server_context cc;
+      br_ssl_session_parameters params = { c.session };
+      if (c.session && (*cache)->load(cache, &cc, &params)) hostAdvance(resumedMs);
+      else {
+        hostAdvance(fullMs);
+        params.id = hostNextSession++;
+        (*cache)->save(cache, &cc, &params);
+      }
+      if (!c.sendsRequest) return;
+      hostAdvance(requestMs);
+      httpsRequestStart();                  // (from metricsRun in the sketch)
+      handled++;
+    }
+  };
+  HostWebServerSecure server;
+
+  // the plain http server (redirects)
+  struct HostRedirectServer {
+    std::function<void()> notFound;
+    String host, path, location;
+    int code = 0;
+    void onNotFound(std::function<void()> f) { notFound = f; }
+    void begin() {}
+    void handleClient() {}
+    String hostHeader() { return host; }
+    String uri() { return path; }             // (the library keeps the arguments separately)
+    void sendHeader(const char* name, const String &value, bool) { if (!strcmp(name, "Location")) location = value; }
+    void send(int c, const char*, const char*) { code = c; }
+  };
+  HostRedirectServer redirectServer;
+
+
+#include "../../BasicWebserver/https.h"
+
+
+// ----------------------------------------------------------------
+//                              -test
+// ----------------------------------------------------------------
+
+int failures = 0;
+void check(bool ok, const char* what) {
+  if (ok) return;
+  printf("FAILED: %s\n", what);
+  failures++;
+}
+
+void resetStats() { httpsFull = httpsResumed = httpsCacheMiss = httpsFullUs = httpsResumedUs = 0; }
+
+// 'browsers' each connecting 'visits' times in turn, each resuming its last session
+void visits(int browsers, int visits) {
+  std::vector<uint32_t> session(browsers, 0);
+  for (int v=0; v < visits; v++) {
+    for (int b=0; b < browsers; b++) {
+      uint32_t next = hostNextSession;
+      hostConnecting.push_back({session[b], 1});
+      httpsHandleClient();
+      if (hostNextSession != next) session[b] = next;         // (given a new session)
+      hostAdvance(100);
+    }
+  }
+}
+
+void report(const char* what) {
+  printf("https: %-34s %3u full (%u ms each), %3u resumed (%u ms each), %3u cache misses\n", what,
+         httpsFull, httpsFull ? httpsFullUs / httpsFull / 1000 : 0, httpsResumed, httpsResumed ? httpsResumedUs / httpsResumed / 1000 : 0, httpsCacheMiss);
+}
+
+
+int main() {
+
+  httpsSetup();
+  check(server.secure.ec && server.secure.cache == &httpsSessions && *httpsSessions.getCache() == &httpsCountingClass,
+        "counting cache not set up");
+
+  // browsers coming back (fewer than the cache holds)
+    visits(httpsCacheSize, 5);
+    report("8 browsers x 5 visits");
+    check(httpsFull == httpsCacheSize && httpsResumed == httpsCacheSize * 4u && httpsCacheMiss == 0, "returning browsers not resumed");
+    check(httpsFullUs == httpsFull * (fullMs + requestMs) * 1000 && httpsResumedUs == httpsResumed * (resumedMs + requestMs) * 1000,
+          "handshake times");
+
+  // more browsers than the cache holds, taking turns (each session has gone by the time it comes back)
+    resetStats();
+    visits(httpsCacheSize + 2, 5);
+    report("10 browsers x 5 visits in turn");
+    check(httpsFull == (httpsCacheSize + 2u) * 5 && httpsResumed == 0 && httpsCacheMiss == (httpsCacheSize + 2u) * 4, "cache misses");
+
+  // a connection which does not send a request in the same pass is still timed (by httpsHandleClient)
+    resetStats();
+    hostConnecting.push_back({0, 0});
+    httpsHandleClient();
+    check(httpsFull == 1 && httpsFullUs == fullMs * 1000 && httpsHandshake == 0, "handshake without a request");
+
+  // http redirected to https, without the arguments
+    redirectServer.host = "esp.local:80";
+    redirectServer.path = "/ota";
+    redirectServer.notFound();
+    printf("https: http://esp.local:80/ota?pwd=... redirected with %d to %s\n", redirectServer.code, redirectServer.location.c_str());
+    check(redirectServer.code == 301 && redirectServer.location == "https://esp.local/ota", "redirect");
+
+  return failures ? 1 : 0;
+}
+
+
+// --------------------------- E N D -----------------------------
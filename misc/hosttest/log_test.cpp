@@ -0,0 +1,193 @@
+/**************************************************************************************************
+ *
+ *      Host test - system log levels, rate limits and repeats (standard.h) - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Logs a few important messages and then bursts of 10,000: the same message (a scanner),
+ *      wifi going up and down (WIFIcheck) and debug messages below the log level.  Checks how long
+ *      each burst takes, what ends up in the log and that the important messages are still there,
+ *      and that the /log page shows the repeat counts.
+ *      Also built with ENABLE_DUALCORE (see run.sh) when the same messages are logged from loop,
+ *      which are checked before they are formatted and queued for the web server task.
+ *
+ **************************************************************************************************/
+
+#define HOST_STANDARD
+#include "Arduino.h"
+
+#if ENABLE_DUALCORE
+  // FreeRTOS stand-in (the test says which core it is running on)
+  bool hostOnWebTask = 1;
+  int xPortGetCoreID() { return hostOnWebTask ? 0 : 1; }
+#endif
+
+#include "sketch.h"
+
+
+// ----------------------------------------------------------------
+//                -what standard.h needs from the sketch
+// ----------------------------------------------------------------
+
+  const char* stitle = "BasicWebServer";
+  const char* sversion = "22Jan21";
+  const char HomeLink[] = "/";
+  const byte LogNumber = 40;
+  const byte LogLength = 100;
+  const byte LogLevel = 1;
+
+  int timeCalls = 0;                        // (not safe from loop when ENABLE_DUALCORE)
+  String currentTime() { timeCalls++; return String("12:00:00"); }
+
+  // wifi (status set by the test)
+  enum wl_status_t { WL_IDLE_STATUS, WL_CONNECTED, WL_CONNECTION_LOST };
+  struct {
+    wl_status_t now = WL_CONNECTED;
+    wl_status_t status() { return now; }
+  } WiFi;
+  bool wifiok = 1;
+  uint32_t wifiReconnects = 0;
+
+  // status line on the web pages (status.h)
+  enum timeStatus_t { timeNotSet, timeNeedsSync, timeSet };
+  struct StatusSnapshot { int ntp; bool gsm; uint32_t heap; int rssi; char time[10]; };
+  StatusSnapshot statusRead() { return { timeSet, 0, 30000, -60, "12:00:00" }; }
+  #define ENABLE_GSM 0
+  #define TRACE_SCOPE(tag)
+  void render_header(Print&, bool, int, const char*, const char*, const char*) {}
+  void render_footer(Print&, const char*, const char*, int, int, const char*, const char*) {}
+
+  struct { void restart() {} } ESP;
+
+  // route parameters (routes.h) and request arguments (reqctx.h)
+  #define ENABLE_ADMISSION 0
+  #define ENABLE_ACCESS 0
+  #include "../../BasicWebserver/admission.h"
+  int8_t metricsRouteAdd(const char*) { return -1; }
+  template<typename F> void metricsRun(int8_t, F &handler) { handler(); }
+  const uint16_t routeMax = 32;           // (a setting in the main sketch)
+  #include "../../BasicWebserver/routes.h"
+  #include "../../BasicWebserver/arena.h"
+  #include "../../BasicWebserver/reqctx.h"
+
+  // the two cores (dualcore.h), messages queued from loop are passed to the log when the test says
+  #if ENABLE_DUALCORE
+    bool onWebTask() { return hostOnWebTask; }
+    struct QueuedLog { std::string text; byte from; bool repeat; };
+    std::vector<QueuedLog> logQueued;
+    bool logQueueAdd(const char* entry, byte from, bool repeat) {
+      logQueued.push_back({ entry, from, repeat });
+      return 1;
+    }
+  #endif
+
+
+#include "../../BasicWebserver/standard.h"
+
+#if ENABLE_DUALCORE
+  void logQueueDeliver() {                  // (what the web server task does)
+    for (QueuedLog &m : logQueued) logAdd(m.text.c_str(), m.from, m.repeat);
+    logQueued.clear();
+  }
+#endif
+
+
+// ----------------------------------------------------------------
+//                              -test
+// ----------------------------------------------------------------
+
+int failures = 0;
+void check(bool ok, const char* what) {
+  if (ok) return;
+  printf("FAILED: %s\n", what);
+  failures++;
+}
+
+// number of log entries containing 'text'
+int entries(const char* text) {
+  int n = 0;
+  for (int i=0; i <= LogNumber; i++) n += (strstr(logEntry(i), text) != nullptr);
+  return n;
+}
+
+
+int main() {
+
+  // important messages first
+    log_system_message("Started, wifi connected");
+    logMessage(logError, "GSM module not responding");
+    for (int i=1; i <= 3; i++) log_system_message("Sensor %d reading out of range", i);     // (different text so not repeats)
+    check(entries("Sensor ") == 3, "messages with different text were collapsed");
+
+  // a scanner: the same message 10,000 times
+    hostAdvance(1000);
+    double us = hostTimeNs(10000, [](int) { log_system_message("invalid web page requested"); }) * 10000 / 1000;
+    printf("log: 10k identical messages took %.0f us, %d entry repeated %u times, %u not logged\n",
+           us, entries("invalid web page"), logEntryRepeats(0), logDropped[0]);
+    check(entries("invalid web page") == 1 && logEntryRepeats(0) == logRateBurst - 1, "identical messages not collapsed");
+
+  // wifi going up and down 10,000 times (5,000 each way)
+    uint32_t dropped = logDropped[0];
+    us = hostTimeNs(10000, [](int i) {
+      WiFi.now = (i & 1) ? WL_CONNECTED : WL_CONNECTION_LOST;
+      WIFIcheck();
+    }) * 10000 / 1000;
+    printf("log: 10k wifi lost / back messages took %.0f us, stored %d lost and %d back, %u not logged\n",
+           us, entries("Wifi connection lost"), entries("Wifi connection is back"), logDropped[0] - dropped);
+    check(entries("Wifi connection lost") == logRateBurst && entries("Wifi connection is back") == logRateBurst,
+          "wifi messages not rate limited");
+
+  // debug messages below the log level
+    uint32_t filtered = logFiltered[0];
+    us = hostTimeNs(10000, [](int i) { logMessage(logDebug, "Debug value %d", i); }) * 10000 / 1000;
+    printf("log: 10k debug messages below the log level took %.0f us, %u not logged\n", us, logFiltered[0] - filtered);
+    check(entries("Debug value") == 0 && logFiltered[0] - filtered == 10000, "debug messages stored");
+
+  // the number not logged is noted when the message is next stored (after the rate limit period)
+    hostAdvance(logRatePeriod);
+    WiFi.now = WL_CONNECTION_LOST;
+    WIFIcheck();
+    check(entries("more 'Wifi connection lost' messages were not logged") == 1, "no note of messages not logged");
+
+  check(entries("Started") == 1 && entries("Error: GSM module") == 1, "earlier entries pushed out of the log");
+
+  // the log page
+    hostSent.clear();
+    handleLogpage();
+    char repeated[40];
+    snprintf(repeated, sizeof(repeated), "{repeated %u times}", logRateBurst - 1);
+    check(hostSent.find(repeated) != std::string::npos, "/log does not show the repeat count");
+    check(hostSent.find("not logged as they were repeated too often") != std::string::npos, "/log does not show the number not logged");
+
+  #if ENABLE_DUALCORE
+    // the same from loop: only the messages which are stored are queued and the time is not worked out
+      hostOnWebTask = 0;
+      hostAdvance(logRatePeriod);
+      int calls = timeCalls;
+      us = hostTimeNs(10000, [](int) { log_system_message("loop message"); }) * 10000 / 1000;
+      size_t queued = logQueued.size();
+      printf("log: from loop 10k identical messages took %.0f us, %u queued, %u not logged\n", us, (unsigned)queued, logDropped[1]);
+      check(queued == logRateBurst && logDropped[1] == 10000 - logRateBurst, "messages from loop not rate limited before queueing");
+      for (int i=0; i < 10000; i++) logMessage(logDebug, "Debug value %d", i);
+      check(logQueued.size() == queued && logFiltered[1] == 10000, "debug messages from loop queued");
+      check(timeCalls == calls, "currentTime() used from loop");
+      logQueueDeliver();
+      check(entries("loop message") == 1 && logEntryRepeats(0) == logRateBurst - 1, "repeats from loop not collapsed");
+
+    // a repeat only counts if the most recent entry came from the same core
+      log_system_message("from both cores");
+      logQueueDeliver();
+      hostOnWebTask = 1;
+      log_system_message("from both cores");
+      check(entries("from both cores") == 2, "repeat counted for a message from the other core");
+  #endif
+
+  int used = 0;
+  for (int i=0; i <= LogNumber; i++) used += (logEntry(i)[0] != 0);
+  printf("log: %d of %d entries used after 30k messages, important ones still there\n", used, LogNumber + 1);
+
+  return failures ? 1 : 0;
+}
+
+
+// --------------------------- E N D -----------------------------
@@ -0,0 +1,149 @@
+/**************************************************************************************************
+ *
+ *      Host test - oled partial refresh and menu redraws (oled.h) - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Runs the menu and a value entry screen on the display stand-in and checks after every refresh
+ *      that what the display is showing matches the buffer, that an unchanged menu is not redrawn or
+ *      sent, and how many bytes go over i2c compared with sending the whole display each time.
+ *
+ **************************************************************************************************/
+
+#define ESP8266
+#define D1 5
+#define D2 4
+#define D5 14
+#define D6 12
+#define D7 13
+#include "sketch.h"
+#include <ctime>
+
+
+// ----------------------------------------------------------------
+//                -what oled.h needs from the sketch
+// ----------------------------------------------------------------
+
+  const char* stitle = "BasicWebServer";
+  const char* sversion = "22Jan21";
+
+  std::string hostLogged;
+  void log_system_message(const char* fmt, ...) {
+    char buf[100];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    hostLogged = buf;
+  }
+
+  time_t now() { return 1700000000 + millis() / 1000; }
+  int hour(time_t t) { return gmtime(&t)->tm_hour; }
+  int minute(time_t t) { return gmtime(&t)->tm_min; }
+  int weekday(time_t t) { return gmtime(&t)->tm_wday + 1; }
+  int day(time_t t) { return gmtime(&t)->tm_mday; }
+  int month(time_t t) { return gmtime(&t)->tm_mon + 1; }
+  int year(time_t t) { return gmtime(&t)->tm_year + 1900; }
+
+  struct { IPAddress localIP() { return IPAddress(192, 168, 0, 50); } } WiFi;
+
+
+#include "../../BasicWebserver/oled.h"
+
+
+// ----------------------------------------------------------------
+//                              -test
+// ----------------------------------------------------------------
+
+int failures = 0;
+void check(bool ok, const char* what) {
+  if (ok) return;
+  printf("FAILED: %s\n", what);
+  failures++;
+}
+
+bool showing() { return memcmp(hostOledRam, display.getBuffer(), oledBufSize) == 0; }
+
+// one pass of loop 10ms later, returns the i2c bytes sent
+uint32_t pass() {
+  uint32_t before = hostI2CBytes;
+  hostAdvance(10);
+  oledLoop();
+  return hostI2CBytes - before;
+}
+
+
+int main() {
+
+  hostPins[encoder0Press] = HIGH;           // (button not pressed)
+
+  // the splash screen is all sent as the display's contents are not known
+    oledSetup();
+    uint32_t first = hostI2CBytes;
+    check(showing(), "splash screen not showing");
+    check(first > oledBufSize, "whole display not sent at the start");
+
+  // the menu, then nothing changing
+    pass();
+    check(showing(), "menu not showing");
+    uint32_t refreshes = oledRefreshCount;
+    uint32_t idle = 0;
+    for (int i=0; i < 1000; i++) idle += pass();
+    printf("oled: 1000 passes with the menu unchanged, %u redraws, %u bytes sent\n", oledRefreshCount - refreshes, idle);
+    check(oledRefreshCount == refreshes && idle == 0, "unchanged menu redrawn");
+
+  // moving the highlight
+    reQueueEvent(reStepUp);
+    uint32_t moved = pass();
+    check(showing() && menuCount == 1, "highlight move not showing");
+
+  // entering a value, 30 turns of the knob
+    int result = -1;
+    enterValue("Testval", 15, 1, 0, 30, [](int v) { log_system_message("value %d", v); });
+    uint32_t valueBytes = pass();
+    int frames = 1;
+    for (int i=0; i < 30; i++) {
+      reQueueEvent(i < 15 ? reStepDown : reStepUp);
+      valueBytes += pass();
+      frames++;
+      check(showing(), "value not showing");
+    }
+    reQueueEvent(rePress);
+    reQueueEvent(reRelease);
+    pass();
+    sscanf(hostLogged.c_str(), "value %d", &result);
+    check(result == 15 && widget.type == widgetNone, "value entry did not finish");
+    pass();
+    check(showing() && !menuChanged, "menu not redrawn after the value was entered");
+
+  // changing to menu 2 (which has fewer items)
+    reQueueEvent(reStepUp);
+    reQueueEvent(reStepUp);
+    reQueueEvent(rePress);
+    reQueueEvent(reRelease);
+    pass();
+    pass();
+    check(menuTitle == "Menu 2" && menuOption[2] == "RETURN" && menuOption[3] == "", "main menu items left in menu 2");
+    check(showing(), "menu 2 not showing");
+
+  // the whole display as display() sends it
+    uint32_t before = hostI2CBytes;
+    display.display();
+    uint32_t full = hostI2CBytes - before;
+    check(showing() && hostI2CTooLong == 0, "a transmission was longer than the Wire buffer");
+
+    auto ms = [](uint32_t bytes) { return bytes * 9 / 400.0; };     // (9 bits per byte at 400kHz)
+    printf("oled: whole display %u bytes (%.1f ms), highlight move %u bytes (%.1f ms)\n", full, ms(full), moved, ms(moved));
+    printf("oled: value entry %d frames %u bytes (%.1f ms a frame), %u bytes sending the whole display\n",
+           frames, valueBytes, ms(valueBytes) / frames, full * frames);
+    check(moved < full / 4 && valueBytes < full * frames / 4, "too much sent");
+
+  // time to compare an unchanged frame (on this PC)
+    double ns = hostTimeNs(1000000, [](int) { oledRefresh(); });
+    printf("oled: %.0f ns to check an unchanged display\n", ns);
+
+  return failures ? 1 : 0;
+}
+
+
+// --------------------------- E N D -----------------------------
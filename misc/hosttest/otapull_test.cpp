@@ -0,0 +1,124 @@
+/**************************************************************************************************
+ *
+ *      Host test - pull updates over a connection which keeps dropping (ota.h) - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Runs the real pull update code against otaserver.py (started by run.sh) which cuts the
+ *      connection part way through every few requests, and checks the firmware written to the
+ *      (fake) update library ends up exactly the same as the file on the server.
+ *
+ *      usage:    otapull_test <port of update server> <firmware file>
+ *
+ **************************************************************************************************/
+
+#include "Arduino.h"
+#include "hostnet.h"
+#include <vector>
+
+
+// ----------------------------------------------------------------
+//                  -what ota.h needs from the sketch
+// ----------------------------------------------------------------
+
+  const bool serialDebug = 1;
+  bool wifiok = 1;
+  const char* stitle = "BasicWebServer";
+  const char* sversion = "22Jan21";
+  const char OTAServer[] = "127.0.0.1";
+  uint16_t OTAServerPort = 0;                                  // (from the command line)
+  const char OTAManifest[] = "/manifest.txt";
+  const char colRed[] = "";
+  const char colEnd[] = "";
+
+  enum logLevels { logDebug, logInfo, logWarning, logError };
+  void logMessage(byte, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    printf("  log: ");
+    vprintf(fmt, args);
+    printf("\n");
+    va_end(args);
+  }
+  #define log_system_message(...) logMessage(logInfo, __VA_ARGS__)
+
+
+typedef WiFiClient MeteredClient;
+
+
+// the update library, keeps what is written in memory
+#include "Update.h"
+
+struct Restarted {};                                           // thrown by ESP.restart() to end the test
+struct {
+  void restart() { throw Restarted(); }
+  String getSketchMD5() { return String("0"); }
+  uint32_t getSketchSize() { return 0; }
+  uint32_t getFreeSketchSpace() { return 1 << 20; }
+  bool flashRead(uint32_t, uint32_t*, size_t) { return 0; }
+} ESP;
+
+
+// web server (the upload pages are not used here)
+
+  enum HTTPUploadStatus { UPLOAD_FILE_START, UPLOAD_FILE_WRITE, UPLOAD_FILE_END, UPLOAD_FILE_ABORTED };
+  struct HTTPUpload { HTTPUploadStatus status; String filename; uint8_t* buf; size_t currentSize; size_t totalSize; };
+  const int HTTP_POST = 3;
+  struct {
+    HTTPUpload up;
+    template<typename A, typename B> void on(const char*, int, A, B) {}
+    HTTPUpload& upload() { return up; }
+    void sendHeader(const char*, const char*) {}
+    template<typename T> void send(int, const char*, const T&) {}
+    WiFiClient client() { return WiFiClient(); }
+  } server;
+  void routeOn(const char*, void (*)()) {}
+  void webheader(WiFiClient&) {}
+  void webfooter(WiFiClient&) {}
+
+
+#include "../../BasicWebserver/ota.h"
+
+
+// ----------------------------------------------------------------
+//                              -test
+// ----------------------------------------------------------------
+
+int main(int argc, char** argv) {
+
+  if (argc != 3) {
+    printf("usage: otapull_test <port> <firmware file>\n");
+    return 2;
+  }
+  OTAServerPort = atoi(argv[1]);
+  FILE* f = fopen(argv[2], "rb");
+  std::vector<uint8_t> image;
+  for (int c; f && (c = fgetc(f)) != EOF; ) image.push_back(c);
+  if (f) fclose(f);
+  hostRealClock = 1;
+  Serial.shown = 1;
+
+  // run loop until the new firmware is installed (restart) or it takes too long
+    uint32_t start = millis();
+    uint32_t longest = 0;                                      // longest time otaPullLoop() held up loop (ms)
+    bool restarted = 0;
+    try {
+      while ((uint32_t)(millis() - start) < 120000) {
+        uint32_t t = micros();
+        otaPullLoop();
+        t = micros() - t;
+        if (t / 1000 > longest) longest = t / 1000;
+        delay(1);
+      }
+    } catch (Restarted&) {
+      restarted = 1;
+    }
+
+  bool same = (Update.data == image);
+  printf("otapull: %zu bytes in %.1f s, %d requests, longest pass %u ms, installed: %s\n", image.size(),
+         (millis() - start) / 1000.0, WiFiClient::connects, longest, (restarted && same) ? "yes" : "NO");
+  return (restarted && same) ? 0 : 1;
+}
+
+
+// --------------------------- E N D -----------------------------
@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+"""
+   Update server which keeps dropping the connection, for the pull update host test - 18Oct26
+
+   part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+
+   Serves a manifest and a made up firmware image (see the notes at the top of ota.h) and honours
+   range requests like any web server would, but cuts the connection part way through the data on
+   every 'drop'th request so the device has to carry on from where it got to.
+
+   usage:    python3 otaserver.py <firmware file> [--drop 3] [--no-range]
+             prints the port it is listening on, then the number of requests and dropped connections
+             when it is stopped
+
+   --no-range  ignores the range requested and sends the whole file each time (as some servers do)
+"""
+
+import argparse
+import hashlib
+import http.server
+import signal
+import sys
+
+
+def main():
+    parser = argparse.ArgumentParser(usage=__doc__)
+    parser.add_argument("image")
+    parser.add_argument("--drop", type=int, default=3, help="drop every n'th request (0 = never)")
+    parser.add_argument("--no-range", action="store_true")
+    args = parser.parse_args()
+
+    image = open(args.image, "rb").read()
+    manifest = ("version=hosttest\nsize=%d\nmd5=%s\nimage=/firmware.bin\n"
+                % (len(image), hashlib.md5(image).hexdigest())).encode()
+    counts = {"requests": 0, "dropped": 0}
+
+    class Handler(http.server.BaseHTTPRequestHandler):
+        protocol_version = "HTTP/1.1"
+
+        def log_message(self, *a):
+            pass
+
+        def do_GET(self):
+            counts["requests"] += 1
+            if self.path == "/manifest.txt":
+                self.reply(200, manifest)
+                return
+            if self.path != "/firmware.bin":
+                self.reply(404, b"not found\n")
+                return
+            first, last = 0, len(image) - 1
+            header = self.headers.get("Range", "")
+            ranged = header.startswith("bytes=") and not args.no_range
+            if ranged:
+                first, last = (int(n) for n in header[6:].split("-"))
+                last = min(last, len(image) - 1)
+            data = image[first:last + 1]
+            if args.drop and counts["requests"] % args.drop == 0:
+                counts["dropped"] += 1
+                self.reply(206 if ranged else 200, data, len(data) // 3)
+                return
+            self.reply(206 if ranged else 200, data)
+
+        def reply(self, status, data, cut=None):
+            self.send_response(status)
+            self.send_header("Content-Length", str(len(data)))
+            self.send_header("Connection", "close")
+            self.end_headers()
+            self.wfile.write(data if cut is None else data[:cut])
+            self.close_connection = True
+
+    server = http.server.HTTPServer(("127.0.0.1", 0), Handler)
+    print(server.server_address[1], flush=True)
+
+    def stop(*a):
+        print("%d requests, %d dropped" % (counts["requests"], counts["dropped"]), file=sys.stderr, flush=True)
+        sys.exit(0)
+    signal.signal(signal.SIGTERM, stop)
+    server.serve_forever()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,185 @@
+/**************************************************************************************************
+ *
+ *      Host test - compiled page templates (pages.h) - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Reads each template in BasicWebserver/templates, fills it in here (a simple reading of the
+ *      rules in misc/templates.py) and checks the render_xxx() procedures in pages.h send exactly
+ *      the same for each combination of their flags, which also shows pages.h has been rebuilt since
+ *      the templates were last changed.  Then times sending a page and checks it uses no heap, and
+ *      that the root page sent gzipped (gzip.h) unzips to the same page.
+ *
+ **************************************************************************************************/
+
+#include "Arduino.h"
+#include <new>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <zlib.h>
+#include "../../BasicWebserver/gzip.h"
+#include "../../BasicWebserver/pages.h"
+
+
+// ----------------------------------------------------------------
+//                              -test
+// ----------------------------------------------------------------
+
+// count heap allocations
+size_t heapAllocs = 0;
+void* operator new(size_t n) {
+  heapAllocs++;
+  if (void* p = malloc(n ? n : 1)) return p;
+  throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+int failures = 0;
+void check(bool ok, const char* what) {
+  if (ok) return;
+  printf("FAILED: %s\n", what);
+  failures++;
+}
+
+// keeps what is sent
+class Page : public Print {
+  public:
+    using Print::write;
+    size_t write(const uint8_t* buf, size_t len) override { text.append((const char*)buf, len); return len; }
+    std::string text;
+};
+
+// counts what is sent
+class Counter : public Print {
+  public:
+    using Print::write;
+    size_t write(const uint8_t*, size_t len) override { bytes += len; return len; }
+    size_t bytes = 0;
+};
+
+typedef std::map<std::string, std::string> Values;
+
+// unzip a gzip file (empty if it is not valid)
+std::string gunzip(const std::string &gz) {
+  z_stream z = {};
+  if (inflateInit2(&z, 16 + MAX_WBITS) != Z_OK) return "";
+  std::string out(65536, 0);
+  z.next_in = (Bytef*)gz.data();
+  z.avail_in = gz.size();
+  z.next_out = (Bytef*)out.data();
+  z.avail_out = out.size();
+  int r = inflate(&z, Z_FINISH);
+  out.resize(z.total_out);
+  bool whole = (r == Z_STREAM_END && z.avail_in == 0);
+  inflateEnd(&z);
+  return whole ? out : "";
+}
+
+// fill in a template:  {{! comment }} (and the rest of the line), {{@file}}, {{#flag}}...{{/flag}}, {{name}}, {{name:int}}
+std::string expand(const std::string &t, const Values &values) {
+  std::string out;
+  size_t pos = 0;
+  while (1) {
+    size_t open = t.find("{{", pos);
+    if (open == std::string::npos) return out + t.substr(pos);
+    out += t.substr(pos, open - pos);
+    size_t close = t.find("}}", open);
+    std::string token = t.substr(open + 2, close - open - 2);
+    pos = close + 2;
+    if (token[0] == '!') {
+      size_t eol = t.find('\n', pos);
+      pos = (eol == std::string::npos) ? t.size() : eol + 1;
+    } else if (token[0] == '@') {
+      for (const AssetFile &a : assetFiles) {
+        if (token.substr(1) == a.name) out += std::string("/a/") + a.name + "?v=" + std::string(a.etag + 1, strlen(a.etag) - 2);
+      }
+    } else if (token[0] == '#') {
+      std::string end = "{{/" + token.substr(1) + "}}";
+      size_t endAt = t.find(end, pos);
+      if (values.at(token.substr(1)) == "1") out += expand(t.substr(pos, endAt - pos), values);
+      pos = endAt + end.size();
+    } else {
+      out += values.at(token.substr(0, token.find(':')));
+    }
+  }
+}
+
+std::string readTemplate(const char* name) {
+  std::ifstream f(std::string("../../BasicWebserver/templates/") + name + ".html", std::ios::binary);
+  std::stringstream s;
+  s << f.rdbuf();
+  return s.str();
+}
+
+// compare a render procedure with its template
+template<typename F> void compare(const char* name, const Values &values, F render) {
+  Page page;
+  render(page);
+  std::string want = expand(readTemplate(name), values);
+  if (page.text == want) return;
+  size_t at = 0;
+  while (at < want.size() && at < page.text.size() && want[at] == page.text[at]) at++;
+  printf("pages: %s differs from its template at byte %zu\n", name, at);
+  check(0, "render procedure does not match its template");
+}
+
+
+int main() {
+
+  // each render procedure against its template
+    for (int flag=0; flag <= 1; flag++) {
+      compare("header", {{"autoRefresh", flag ? "1" : "0"}, {"refresh", "30"}, {"title", "BasicWebServer"}, {"style", "li{color:red}"}, {"home", "/"}},
+              [&](Print &p) { render_header(p, flag, 30, "BasicWebServer", "li{color:red}", "/"); });
+      compare("data", {{"timeNow", "12:00:00"}, {"ota", flag ? "1" : "0"}}, [&](Print &p) { render_data(p, "12:00:00", flag); });
+    }
+    compare("footer", {{"title", "BasicWebServer"}, {"version", "22Jan21"}, {"memory", "41"}, {"rssi", "-67"}, {"ntp", " | NTP OK"}, {"gsm", ""}},
+            [](Print &p) { render_footer(p, "BasicWebServer", "22Jan21", 41, -67, " | NTP OK", ""); });
+    compare("root", {{"home", "/"}, {"board", "ESP8266"}, {"javaRefresh", "2000"}, {"dataRefresh", "5000"}},
+            [](Print &p) { render_root(p, "/", "ESP8266", "2000", "5000"); });
+
+  // the root page (header, page and footer)
+    auto rootPage = [](Print &p) {
+      render_header(p, 0, 0, "BasicWebServer", " ", "/");
+      render_root(p, "/", "ESP8266", "2000", "5000");
+      render_footer(p, "BasicWebServer", "22Jan21", 41, -67, " | NTP OK", "");
+    };
+    Counter size, c;
+    rootPage(size);
+    size_t before = heapAllocs;
+    for (int i=0; i < 10000; i++) rootPage(c);
+    size_t allocs = heapAllocs - before;
+    double ns = hostTimeNs(1000000, [&](int) { rootPage(c); });
+    printf("pages: root page %zu bytes, %.0f ns to send (on this PC), heap allocations for 10000 %zu\n", size.bytes, ns, allocs);
+    check(allocs == 0, "sending a page used the heap");
+
+  // the root page gzipped
+    Page plain, zipped, empty;
+    rootPage(plain);
+    {
+      GzipWriter gz(zipped);
+      rootPage(gz);
+      gz.finish();
+    }
+    check(gunzip(zipped.text) == plain.text, "gzipped root page does not unzip to the page");
+    {
+      GzipWriter gz(empty);
+      gz.finish();
+    }
+    check(empty.text.size() == 23 && gunzip(empty.text).empty() && pageGzip == nullptr, "gzipped empty page");
+    before = heapAllocs;
+    double gzNs = hostTimeNs(100000, [&](int) {
+      GzipWriter gz(c);
+      rootPage(gz);
+      gz.finish();
+    });
+    printf("pages: root page gzipped %zu bytes (%.0f%%), %.0f ns to send, heap allocations %zu\n",
+           zipped.text.size(), 100.0 * zipped.text.size() / plain.text.size(), gzNs, heapAllocs - before);
+    check(zipped.text.size() < plain.text.size() && heapAllocs == before, "gzipped page is no smaller or used the heap");
+
+  return failures ? 1 : 0;
+}
+
+
+// --------------------------- E N D -----------------------------
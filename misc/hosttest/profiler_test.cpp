@@ -0,0 +1,161 @@
+/**************************************************************************************************
+ *
+ *      Host test - sampling profiler (profiler.h) - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Built as for the esp32 (which records only the tagged scopes, the program counter can not be
+ *      read on a PC).  Requests /profile and runs a made up workload in tagged scopes on the fake
+ *      clock, firing the sample timer at the rate asked for.  Checks the folded stack lines sent
+ *      show each part of the workload in the right proportion, samples are dropped and counted when
+ *      loop does not send them in time, and the seconds / rate limits.  Then times taking a sample.
+ *
+ **************************************************************************************************/
+
+#define ESP32
+#define ENABLE_PROFILER 1
+#include "sketch.h"
+
+
+// ----------------------------------------------------------------
+//                -what profiler.h needs from the sketch
+// ----------------------------------------------------------------
+
+  void log_system_message(const char*, ...) {}
+
+  // esp32 hardware timer (fired by the test)
+  struct hw_timer_t { void (*isr)() = nullptr; uint32_t us = 0; bool enabled = 0; };
+  hw_timer_t hostTimer;
+  hw_timer_t* timerBegin(int, int, bool) { hostTimer = hw_timer_t(); return &hostTimer; }
+  void timerAttachInterrupt(hw_timer_t* t, void (*isr)(), bool) { t->isr = isr; }
+  void timerAlarmWrite(hw_timer_t* t, uint32_t us, bool) { t->us = us; }
+  void timerAlarmEnable(hw_timer_t* t) { t->enabled = 1; }
+  void timerAlarmDisable(hw_timer_t* t) { t->enabled = 0; }
+  void timerEnd(hw_timer_t*) {}
+
+  // request arguments (reqctx.h)
+  #define ENABLE_ADMISSION 0
+  #define ENABLE_ACCESS 0
+  #define TRACE_SCOPE(tag)
+  #include "../../BasicWebserver/admission.h"
+  int8_t metricsRouteAdd(const char*) { return -1; }
+  template<typename F> void metricsRun(int8_t, F &handler) { handler(); }
+  const uint16_t routeMax = 32;           // (a setting in the main sketch)
+  #include "../../BasicWebserver/routes.h"
+  #include "../../BasicWebserver/arena.h"
+  #include "../../BasicWebserver/reqctx.h"
+
+
+#include "../../BasicWebserver/profiler.h"
+
+
+// ----------------------------------------------------------------
+//                              -test
+// ----------------------------------------------------------------
+
+int failures = 0;
+void check(bool ok, const char* what) {
+  if (ok) return;
+  printf("FAILED: %s\n", what);
+  failures++;
+}
+
+// a microsecond of the workload (the sample timer fires when it is due)
+uint64_t nextSample = 0;
+void tick() {
+  hostUs++;
+  if (hostTimer.enabled && hostUs >= nextSample) {
+    nextSample = hostUs + hostTimer.us;
+    hostTimer.isr();
+  }
+}
+void run(uint32_t us) { for (uint32_t i=0; i < us; i++) tick(); }
+
+// a pass of loop: 6ms serving /data (2ms of it in the header), 1ms wifi check, 3ms untagged
+void pass() {
+  {
+    LOOP_SCOPE("web server");
+    LOOP_SCOPE("/data");
+    run(4000);
+    LOOP_SCOPE("webheader");
+    run(2000);
+  }
+  { LOOP_SCOPE("task:wifi"); run(1000); }
+  run(3000);
+}
+
+std::map<std::string, int> stacks;          // folded stack lines received and how many of each
+int badLines = 0;
+
+void readSamples() {
+  size_t body = hostSent.find("\r\n\r\n");
+  size_t pos = (body == std::string::npos) ? 0 : body + 4;
+  while (pos < hostSent.size()) {
+    size_t end = hostSent.find('\n', pos);
+    std::string line = hostSent.substr(pos, end - pos);
+    pos = end + 1;
+    if (line.size() < 3 || line.compare(line.size() - 2, 2, " 1") != 0) badLines++;
+    else stacks[line.substr(0, line.size() - 2)]++;
+  }
+  hostSent.clear();
+}
+
+// start the profiler with the given arguments
+void startProfile(std::vector<std::pair<String, String>> args) {
+  server.hostArgs = args;
+  hostSent.clear();
+  handleProfile();
+}
+
+
+int main() {
+
+  // 4 seconds at 487 samples a second (not a multiple of the passes of loop, which would only see the same parts of them)
+    startProfile({ {"seconds", "4"}, {"rate", "487"} });
+    check(hostSent.rfind("HTTP/1.1 200 OK\r\n", 0) == 0 && profileRunning && hostTimer.us == 1000000 / 487, "profiler not started");
+    nextSample = hostUs + hostTimer.us;
+    while (profileRunning) {
+      pass();
+      profileLoop();
+    }
+    readSamples();
+    int total = 0;
+    for (auto &s : stacks) total += s.second;
+    printf("profiler: %d samples, %u dropped, %d bad lines\n", total, profileDropped, badLines);
+    for (auto &s : stacks) printf("profiler:   %-30s %4.1f%%\n", s.first.c_str(), 100.0 * s.second / total);
+    auto share = [&](const char* stack) { return 100.0 * stacks[stack] / total; };
+    check(badLines == 0 && profileDropped == 0 && abs(total - 4 * 487) < 10, "samples");
+    check(abs(share("web server;/data") - 40) < 2 && abs(share("web server;/data;webheader") - 20) < 2
+          && abs(share("task:wifi") - 10) < 2 && abs(share("loop") - 30) < 2, "proportions");
+
+  // loop not sending the samples in time
+    stacks.clear();
+    startProfile({ {"seconds", "1"}, {"rate", "2000"} });
+    nextSample = hostUs + hostTimer.us;
+    run(150000);                            // (300 samples before loop sends any)
+    hostUs += 1000000;
+    profileLoop();
+    readSamples();
+    printf("profiler: 300 samples before loop sent them, %d sent, %u dropped\n", stacks["loop"], profileDropped);
+    check(stacks["loop"] == profileBufferSize - 1 && profileDropped == 300 - (profileBufferSize - 1u) && !profileRunning, "dropped samples");
+
+  // limits and already running
+    startProfile({ {"seconds", "1000"}, {"rate", "99999"} });
+    check(profileLength == profileMaxSeconds * 1000u && hostTimer.us == 1000000 / profileRateMax, "limits");
+    startProfile({});
+    check(hostSent.find("409") != std::string::npos, "second profile not refused");
+    profileStop();
+
+  // time to take a sample 3 scopes deep (on this PC)
+    profileRunning = 1;
+    LOOP_SCOPE("web server");
+    LOOP_SCOPE("/data");
+    LOOP_SCOPE("webheader");
+    double ns = hostTimeNs(10000000, [](int) { profileISR(); profileTail = profileHead; });
+    printf("profiler: %.1f ns per sample\n", ns);
+
+  return failures ? 1 : 0;
+}
+
+
+// --------------------------- E N D -----------------------------
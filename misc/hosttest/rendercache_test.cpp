@@ -0,0 +1,123 @@
+/**************************************************************************************************
+ *
+ *      Host test - render cache (rendercache.h) - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      50 browsers polling a page like /data every second for a minute, checks what they are sent
+ *      is always the same as creating the page, that pageChanged() and a new stamp create it again,
+ *      that a page too big for its buffer is still sent, that a browser which accepts gzip gets the
+ *      page gzipped with its length, and compares the time per request with creating the page every
+ *      time.
+ *
+ **************************************************************************************************/
+
+#include "sketch.h"
+#include "../../BasicWebserver/gzip.h"
+#include "../../BasicWebserver/rendercache.h"
+#include "../../BasicWebserver/pages.h"
+
+const int pollers = 50;
+int renders = 0;                            // times the page was created
+uint32_t otaEnabled = 0;                    // something shown on the page
+
+// a page like /data (the time to the minute and a few values)
+void dataPage(Print &out) {
+  renders++;
+  uint32_t t = millis() / 1000;
+  out.printf("<p>Time: %02u:%02u</p>\n", (unsigned)(t / 3600 % 24), (unsigned)(t / 60 % 60));
+  for (int i=0; i < 8; i++) out.printf("<p>Sensor %d: %d.%02d volts</p>\n", i, i * 3 % 5, i * 17 % 100);
+  out.printf("<p>OTA: %s</p>\n", otaEnabled ? "enabled" : "disabled");
+}
+
+int failures = 0;
+void check(bool ok, const char* what) {
+  if (ok) return;
+  printf("FAILED: %s\n", what);
+  failures++;
+}
+
+
+int main() {
+
+  char dataCacheBuffer[400];
+  RenderCache dataCache("/data", dataCacheBuffer, sizeof(dataCacheBuffer));
+  HostClient client;
+
+  // each poller asks once a second (spread over the second) for a minute, OTA is enabled part way
+    for (int ms=0; ms < 60000; ms++) {
+      if (ms == 30500) {
+        otaEnabled = 1;
+        pageChanged();
+      }
+      if (ms % (1000 / pollers) == 0) {
+        hostSent.clear();
+        cachedRender(client, dataCache, millis() / 60000, 0, dataPage);
+        std::string sent = hostSent;
+        hostSent.clear();
+        dataPage(client);
+        renders--;
+        if (sent != hostSent) {
+          check(0, "cached page is not the same as creating it");
+          break;
+        }
+      }
+      hostAdvance(1);
+    }
+    uint32_t requests = dataCache.hits + dataCache.misses;
+    printf("rendercache: %u requests from %d pollers, %d pages created, hits %u, misses %u\n",
+           requests, pollers, renders, dataCache.hits, dataCache.misses);
+    check(requests == 60 * pollers, "wrong number of requests");
+    check(renders == 3, "page should be created at the start, the new minute and when OTA was enabled");
+
+  // a page bigger than its buffer is sent directly
+    char smallBuffer[64];
+    RenderCache smallCache("/small", smallBuffer, sizeof(smallBuffer));
+    hostSent.clear();
+    cachedRender(client, smallCache, 0, 0, dataPage);
+    std::string sent = hostSent;
+    hostSent.clear();
+    dataPage(client);
+    check(smallCache.tooBig == 1 && !smallCache.valid && sent == hostSent, "page too big for the buffer was not sent");
+
+  // a browser which accepts gzip: the page header from the templates is sent gzipped (from the cache and
+  // when too big for the buffer) but the data page is not as that would make it bigger
+    auto headerPage = [](Print &out) { render_header(out, 0, 0, "BasicWebServer", " ", "/"); };
+    std::string plain, zipped;
+    hostSent.clear();
+    headerPage(client);
+    plain = hostSent;
+    {
+      hostSent.clear();
+      GzipWriter g(client);
+      headerPage(g);
+      g.finish();
+      zipped = hostSent;
+    }
+    char headerBuffer[600];
+    RenderCache headerCache("/header", headerBuffer, sizeof(headerBuffer));
+    for (RenderCache* cache : { &headerCache, &headerCache, &smallCache }) {
+      hostSent.clear();
+      cachedRender(client, *cache, 0, 1, headerPage);
+      size_t body = hostSent.find("\r\n\r\n") + 4;
+      bool length = (cache == &smallCache) || hostSent.find("Content-Length: " + std::to_string(zipped.size()) + "\r\n") < body;
+      check(hostSent.rfind("HTTP/1.1 200 OK\r\n", 0) == 0 && hostSent.find("Content-Encoding: gzip\r\n") < body && length && hostSent.substr(body) == zipped,
+            "gzipped page not sent with the right headers");
+    }
+    check(headerCache.gz && headerCache.hits == 1 && headerCache.len == zipped.size(), "gzipped page not kept");
+    hostSent.clear();
+    cachedRender(client, dataCache, millis() / 60000, 1, dataPage);
+    check(hostSent == sent && !dataCache.gz && dataCache.forGz, "page which is bigger gzipped was gzipped");
+    printf("rendercache: page header %zu bytes gzipped (%zu plain)\n", zipped.size(), plain.size());
+
+  // time per request on this PC
+    HostClient sink;
+    double cached = hostTimeNs(1000000, [&](int) { cachedRender(sink, dataCache, millis() / 60000, 0, dataPage); hostSent.clear(); });
+    double direct = hostTimeNs(1000000, [&](int) { dataPage(sink); hostSent.clear(); });
+    printf("rendercache: %.0f ns per request from the cache, %.0f ns creating the page each time\n", cached, direct);
+
+  return failures ? 1 : 0;
+}
+
+
+// --------------------------- E N D -----------------------------
@@ -0,0 +1,148 @@
+/**************************************************************************************************
+ *
+ *      Host test - request context (reqctx.h) - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Gathers the arguments of a submitted form the way the pages do and checks the lookups, the
+ *      client ip, that they point in to the server's own copies (as the esp8266 core gives references),
+ *      too many arguments and, where they have to be copied (esp32), too long ones being cut short,
+ *      and that none of it uses the heap.
+ *      Then compares the time with looking each argument up with server.arg(name) and building
+ *      the ip from String(cip[n]) as the pages did before.  (The PC's String keeps up to 15 characters
+ *      without using the heap, the esp's only 11, so the Strings come off better here than on the esp.)
+ *
+ **************************************************************************************************/
+
+#include "sketch.h"
+#include <new>
+
+
+// ----------------------------------------------------------------
+//           -what reqctx.h needs (StrView from routes.h)
+// ----------------------------------------------------------------
+
+  #define ENABLE_ADMISSION 0
+  #define ENABLE_ACCESS 0
+  #define TRACE_SCOPE(tag)
+  #include "../../BasicWebserver/admission.h"
+  void log_system_message(const char*, ...) {}
+  int8_t metricsRouteAdd(const char*) { return -1; }
+  template<typename F> void metricsRun(int8_t, F &handler) { handler(); }
+  const uint16_t routeMax = 32;           // (a setting in the main sketch)
+  #include "../../BasicWebserver/routes.h"
+  #include "../../BasicWebserver/arena.h"
+
+
+#include "../../BasicWebserver/reqctx.h"
+
+
+// ----------------------------------------------------------------
+//                              -test
+// ----------------------------------------------------------------
+
+// count heap allocations
+size_t heapAllocs = 0;
+void* operator new(size_t n) {
+  heapAllocs++;
+  if (void* p = malloc(n ? n : 1)) return p;
+  throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+int sink;                                   // (so the lookups are not optimised away)
+int failures = 0;
+void check(bool ok, const char* what) {
+  if (ok) return;
+  printf("FAILED: %s\n", what);
+  failures++;
+}
+
+// the root page's form being submitted (as the library has decoded it)
+void submitForm() {
+  server.hostArgs = { {"RADIO1", "2"}, {"demobutton", "Demonstration Button"}, {"pwd", "not-a-real-password"},
+                      {"refresh", "5"}, {"comment", "a comment typed in to the form, 40 chars"} };
+}
+
+// a page handler using the request context
+int handlerNow(HostClient &client) {
+  RequestContext &req = requestBegin(client);
+  int n = req.arg("RADIO1").toInt() + req.has("demobutton") + req.arg("refresh").toInt() + req.ip[0];
+  n += req.has("missing") + req.arg("pwd").len;
+  arenaReset();
+  return n;
+}
+
+// the same as the pages did before (a String for each lookup and for the ip)
+String stringArg(const char* name) {
+  for (auto &a : server.hostArgs) if (a.first == name) return a.second;
+  return String();
+}
+bool stringHasArg(const char* name) { return server.hasArg(name); }
+int handlerBefore(HostClient &client) {
+  IPAddress cip = client.remoteIP();
+  String clientIP = String(cip[0]) + "." + String(cip[1]) + "." + String(cip[2]) + "." + String(cip[3]);
+  int n = stringArg("RADIO1").toInt() + stringHasArg("demobutton") + stringArg("refresh").toInt() + clientIP[0];
+  n += stringHasArg("missing") + stringArg("pwd").length();
+  return n;
+}
+
+
+int main() {
+
+  HostClient client;
+  hostClientIP = 0x7b64a8c0;                // 192.168.100.123
+
+  // lookups
+    submitForm();
+    RequestContext &req = requestBegin(client);
+    check(req.count == 5 && !req.truncated && !strcmp(req.ip, "192.168.100.123"), "arguments / ip");
+    check(req.has("demobutton") && !req.has("demo") && req.arg("RADIO1").toInt() == 2 && req.arg("missing").len == 0, "has / arg");
+    check(!strcmp(req.values[4].ptr, "a comment typed in to the form, 40 chars"), "value not zero terminated");
+    check(req.values[4].ptr == server.hostArgs[4].second.c_str() && req.names[4].ptr == server.hostArgs[4].first.c_str() && arenaUsed == 0,
+          "arguments copied");
+    arenaReset();
+
+  // too many arguments and too long a value
+    server.hostArgs.clear();
+    for (int i=0; i < 20; i++) server.hostArgs.push_back({String("a") + String(i), String(i)});
+    requestBegin(client);
+    check(request.count == reqMaxArgs && request.truncated && request.arg("a15").toInt() == 15, "too many arguments");
+    arenaReset();
+    server.hostArgs = { {"short", "1"}, {"big", String(std::string(arenaSize, 'x'))}, {"after", "2"} };
+    requestBegin(client);
+    check(request.count == 3 && !request.truncated && request.arg("big").len == arenaSize, "long value");
+    arenaReset();
+
+  // copied when the server's arg() gives a new String each time (esp32)
+    StrView copied[3];
+    bool stored[3];
+    for (int i=0; i < 3; i++) stored[i] = reqStore(String(server.hostArgs[i].second), copied[i], std::false_type());
+    check(stored[0] && copied[0].equals("1") && copied[0].ptr != server.hostArgs[0].second.c_str() && !stored[1] && stored[2],
+          "value too long to copy");
+    arenaReset();
+
+  // no heap used
+    submitForm();
+    size_t before = heapAllocs;
+    int sum = 0;
+    for (int i=0; i < 100000; i++) sum += handlerNow(client);
+    size_t now = heapAllocs - before;
+    before = heapAllocs;
+    for (int i=0; i < 100000; i++) sum += handlerBefore(client);
+    size_t old = heapAllocs - before;
+    printf("reqctx: heap allocations for 100000 requests %zu, %zu with Strings as before\n", now, old);
+    check(now == 0, "request context used the heap");
+
+  // time for a request's lookups (on this PC)
+    double nowNs = hostTimeNs(1000000, [&](int) { sum += handlerNow(client); });
+    double oldNs = hostTimeNs(1000000, [&](int) { sum += handlerBefore(client); });
+    printf("reqctx: %.0f ns per request, %.0f ns with Strings as before\n", nowNs, oldNs);
+    sink = sum;
+
+  return failures ? 1 : 0;
+}
+
+
+// --------------------------- E N D -----------------------------
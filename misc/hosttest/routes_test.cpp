@@ -0,0 +1,185 @@
+/**************************************************************************************************
+ *
+ *      Host test - route table (routes.h) - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Checks pages are found (with parameters, and the same path listed for two methods) and
+ *      compares the time to find a page with checking every page in turn as the web server
+ *      library does, for the sketch's table and for tables of 10, 100 and 1000 pages.
+ *
+ **************************************************************************************************/
+
+#include "sketch.h"
+
+#define ENABLE_ADMISSION 0
+#define ENABLE_ACCESS 0
+#include "../../BasicWebserver/admission.h"
+
+std::string logged;                         // messages sent to the system log
+void log_system_message(const char* fmt, ...) {
+  char buf[200];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(buf, sizeof(buf), fmt, args);
+  va_end(args);
+  logged += buf;
+  logged += "\n";
+}
+const uint16_t routeMax = 1000;             // (a setting in the main sketch)
+int8_t metricsRouteAdd(const char*) { return -1; }
+template<typename F> void metricsRun(int8_t, F &handler) { handler(); }
+
+#include "../../BasicWebserver/routes.h"
+
+int hit = -1;
+template<int N> void page() { hit = N; }
+
+constexpr RouteDef webPages[] = {
+  ROUTE(HTTP_ANY, "/", page<0>),
+  ROUTE_POLL(HTTP_ANY, "/data", page<1>),
+  ROUTE(HTTP_GET, "/log/{lines}", page<2>),
+  ROUTE(HTTP_GET, "/x/{a}/y/{b}", page<3>),
+  ROUTE(HTTP_GET, "/form", page<4>),
+  ROUTE(HTTP_ANY, "/p5", page<5>),
+  ROUTE_POLL(HTTP_GET, "/a/{name}", page<6>),
+  ROUTE(HTTP_ANY, "/ping", page<7>), ROUTE(HTTP_ANY, "/test", page<8>), ROUTE(HTTP_ANY, "/tasks", page<9>),
+  ROUTE(HTTP_ANY, "/metrics", page<10>), ROUTE(HTTP_ANY, "/stalls", page<11>), ROUTE(HTTP_ANY, "/trace.json", page<12>),
+  ROUTE(HTTP_ANY, "/profile", page<13>), ROUTE(HTTP_ANY, "/access", page<14>), ROUTE(HTTP_ANY, "/healthz", page<15>),
+  ROUTE(HTTP_ANY, "/fetch", page<16>), ROUTE(HTTP_ANY, "/reboot", page<17>), ROUTE(HTTP_ANY, "/ota", page<18>),
+  ROUTE(HTTP_ANY, "/otapull", page<19>), ROUTE(HTTP_ANY, "/p20", page<20>), ROUTE(HTTP_ANY, "/p21", page<21>),
+  ROUTE(HTTP_ANY, "/p22", page<22>), ROUTE(HTTP_ANY, "/p23", page<23>), ROUTE(HTTP_ANY, "/p24", page<24>),
+  ROUTE(HTTP_ANY, "/p25", page<25>), ROUTE(HTTP_ANY, "/p26", page<26>), ROUTE(HTTP_ANY, "/p27", page<27>),
+  ROUTE(HTTP_ANY, "/p28", page<28>), ROUTE(HTTP_ANY, "/p29", page<29>), ROUTE(HTTP_ANY, "/p30", page<30>),
+  ROUTE(HTTP_ANY, "/last", page<31>),
+};
+// the same path for two methods (each has its own slot as the method is part of the hash)
+constexpr RouteDef formPages[] = {
+  ROUTE(HTTP_ANY, "/", page<0>),
+  ROUTE(HTTP_GET, "/form", page<4>),
+  ROUTE(HTTP_POST, "/form", page<5>),
+  ROUTE(HTTP_ANY, "/form", page<6>),
+};
+// the same method and path twice (can never have a slot each so the index falls back to probing)
+constexpr RouteDef twicePages[] = {
+  ROUTE(HTTP_ANY, "/", page<0>),
+  ROUTE(HTTP_GET, "/form", page<4>),
+  ROUTE(HTTP_GET, "/form", page<5>),
+};
+
+static_assert(webPages[2].hash == routeKey(routeHash("/log/{n}"), HTTP_GET), "hash is worked out when compiling");
+static_assert(formPages[1].hash != formPages[2].hash, "method is part of the hash");
+
+int failures = 0;
+void check(HTTPMethod method, const char* path, int page, const char* param = nullptr) {
+  int r = routeFind(method, path);
+  int got = -1;
+  if (r >= 0) {
+    hit = -1;
+    routeTable[r].handler();
+    got = hit;
+  }
+  bool ok = (got == page);
+  if (ok && param) ok = routeParam(0).equals(param);
+  if (ok) return;
+  printf("FAILED: %s %s gave page %d (expected %d)\n", method == HTTP_POST ? "POST" : "GET", path, got, page);
+  failures++;
+}
+
+// what the web server library does - compare with each page in turn
+int linearFind(HTTPMethod method, const char* path) {
+  for (uint16_t i=0; i < routeCount; i++) {
+    if (routeTable[i].method != HTTP_ANY && routeTable[i].method != method) continue;
+    if (routeMatch(routeTable[i], path)) return i;
+  }
+  return -1;
+}
+
+
+int main() {
+
+  routesSetup(webPages);
+  printf("routes: %d pages, index %d slots, seed %u, %d parameter arrangements\n", routeCount, routeSlots, routeSeed, routeMaskCount);
+
+  check(HTTP_GET, "/", 0);
+  check(HTTP_GET, "/data", 1);
+  check(HTTP_GET, "/log/12", 2, "12");
+  check(HTTP_GET, "/log/", -1);                                   // parameter can not be blank
+  check(HTTP_GET, "/log", -1);
+  check(HTTP_GET, "/x/1/y/22", 3, "1");
+  check(HTTP_GET, "/x/1/z/22", -1);
+  check(HTTP_POST, "/x/1/y/22", -1);                              // wrong method
+  check(HTTP_GET, "/form", 4);
+  check(HTTP_POST, "/form", -1);
+  check(HTTP_GET, "/a/style.css", 6, "style.css");
+  check(HTTP_GET, "/last", 31);
+  check(HTTP_GET, "/nothing", -1);
+  routeCurrent = &routeTable[2];
+  routeFind(HTTP_GET, "/log/40");
+  if (routeParam("lines").toInt() != 40) {
+    printf("FAILED: routeParam(\"lines\")\n");
+    failures++;
+  }
+
+  // time to find a page (first, last and a page which does not exist)
+    const char* paths[] = { "/", "/last", "/a/style.css", "/nothing" };
+    for (const char* path : paths) {
+      volatile int r;
+      double table = hostTimeNs(2000000, [&](int) { r = routeFind(HTTP_GET, path); });
+      double linear = hostTimeNs(2000000, [&](int) { r = linearFind(HTTP_GET, path); });
+      printf("routes: %-14s route table %4.0f ns, each page in turn %4.0f ns\n", path, table, linear);
+    }
+
+  logged.clear();
+  routesSetup(formPages);
+  check(HTTP_GET, "/form", 4);
+  check(HTTP_POST, "/form", 5);
+  check(HTTP_HEAD, "/form", 6);                                   // (HTTP_ANY)
+  check(HTTP_GET, "/", 0);
+  if (!logged.empty()) {
+    printf("FAILED: same path for GET and POST needed probing\n");
+    failures++;
+  }
+  printf("routes: same path for GET, POST and any method found with an index of %d slots, seed %u\n", routeSlots, routeSeed);
+
+  logged.clear();
+  routesSetup(twicePages);
+  check(HTTP_GET, "/form", 4);
+  if (logged.find("'/form' is listed twice") == std::string::npos || logged.find("no index without collisions") == std::string::npos) {
+    printf("FAILED: same method and path twice not reported (log: %s)\n", logged.c_str());
+    failures++;
+  }
+
+  // larger tables: one page in ten has a parameter, time to find the first, middle and last pages and one which does not exist
+    static RouteDef bigPages[routeMax];
+    static char bigPaths[routeMax][16];
+    for (uint16_t n : { 10, 100, 1000 }) {
+      for (uint16_t i=0; i < n; i++) {
+        snprintf(bigPaths[i], sizeof(bigPaths[i]), (i % 10 == 5) ? "/p%u/{id}" : "/p%u", i);
+        bigPages[i] = ROUTE(HTTP_GET, bigPaths[i], page<0>);
+      }
+      logged.clear();
+      routesSetup(bigPages, n);
+      char paths[4][16];
+      snprintf(paths[0], sizeof(paths[0]), "/p0");
+      snprintf(paths[1], sizeof(paths[1]), "/p%u/42", n / 2 / 10 * 10 + 5);
+      snprintf(paths[2], sizeof(paths[2]), "/p%u", n - 1);
+      snprintf(paths[3], sizeof(paths[3]), "/nothing");
+      double table = 0, linear = 0;
+      for (int p=0; p < 4; p++) {
+        if ((routeFind(HTTP_GET, paths[p]) >= 0) != (p < 3) || routeFind(HTTP_GET, paths[p]) != linearFind(HTTP_GET, paths[p])) {
+          printf("FAILED: %u pages, %s\n", n, paths[p]);
+          failures++;
+        }
+        volatile int r;
+        table += hostTimeNs(200000, [&](int) { r = routeFind(HTTP_GET, paths[p]); }) / 4;
+        linear += hostTimeNs(n >= 1000 ? 20000 : 200000, [&](int) { r = linearFind(HTTP_GET, paths[p]); }) / 4;
+      }
+      printf("routes: %4u pages (index %4u slots%s)  route table %4.0f ns, each page in turn %6.0f ns\n", n, routeSlots, logged.empty() ? "" : ", probing", table, linear);
+    }
+
+  return failures ? 1 : 0;
+}
+
+
+// --------------------------- E N D -----------------------------
@@ -0,0 +1,90 @@
+#!/bin/sh
+#
+#   Host tests - 18Oct26
+#
+#   part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+#
+#   Builds each xxx_test.cpp in this folder with the sketch's own files (Arduino.h stands in for the
+#   Arduino core) and runs it on the PC.  Each test prints what it measured and fails if the results
+#   are not what they should be.  The figures depend on the PC, they are for comparing before and
+#   after a change rather than showing how fast the esp will be.
+#
+#   usage:    sh misc/hosttest/run.sh                run all the tests
+#             sh misc/hosttest/run.sh otapull        run only the named tests
+#
+#   needs g++ (c++20, with ThreadSanitizer), zlib and python3
+#
+
+cd "$(dirname "$0")" || exit 1
+build=$(mktemp -d)
+trap 'rm -rf "$build"' EXIT
+
+tests="$*"
+[ -z "$tests" ] && tests=$(ls *_test.cpp | sed 's/_test\.cpp$//')
+
+flags="-std=gnu++20 -Wall -Wextra -Werror -pthread -I."     # (the tests and the sketch's files build without warnings)
+
+failed=0
+for t in $tests; do
+  echo "== $t"
+  if ! g++ -O2 $flags -o "$build/$t" "${t}_test.cpp" -lz; then
+    failed=1
+    continue
+  fi
+  case $t in
+    otapull)     # needs the update server, run both with and without range requests
+      head -c 100000 /dev/urandom > "$build/firmware.bin"
+      for opt in "" "--no-range"; do
+        python3 otaserver.py "$build/firmware.bin" --drop 3 $opt > "$build/port" &
+        server=$!
+        sleep 1
+        "$build/$t" "$(cat "$build/port")" "$build/firmware.bin" > "$build/out" || failed=1
+        tail -1 "$build/out"
+        kill $server
+        wait $server 2>/dev/null
+      done
+      ;;
+    delta)       # run again built as for the esp32
+      "$build/$t" || failed=1
+      if g++ -O2 $flags -DESP32 -o "$build/${t}_esp32" "${t}_test.cpp"; then
+        "$build/${t}_esp32" > "$build/out" || failed=1
+        grep -E "FAILED|wrong" "$build/out" | sed 's/^delta:/delta (esp32):/'
+      else
+        failed=1
+      fi
+      ;;
+    log)         # run again built with loop and the web server on separate cores
+      "$build/$t" || failed=1
+      if g++ -O2 $flags -DENABLE_DUALCORE=1 -o "$build/${t}_dual" "${t}_test.cpp"; then
+        "$build/${t}_dual" > "$build/out" || failed=1
+        grep -E "FAILED|from loop" "$build/out"
+      else
+        failed=1
+      fi
+      ;;
+    healthz)     # run again built with the status shared between the cores (seqlock)
+      "$build/$t" || failed=1
+      if g++ -O2 $flags -DENABLE_DUALCORE=1 -o "$build/${t}_dual" "${t}_test.cpp"; then
+        "$build/${t}_dual" || failed=1
+      else
+        failed=1
+      fi
+      ;;
+    dualcore)    # run again built with ThreadSanitizer (fails if the cores share anything without atomics)
+      "$build/$t" || failed=1
+      # (-Wno-tsan: TSan can not follow atomic_thread_fence in <atomic>, nothing in the sketch)
+      if g++ -O1 -g -fsanitize=thread -Wno-tsan $flags -o "$build/${t}_tsan" "${t}_test.cpp"; then
+        "$build/${t}_tsan" > "$build/out" || failed=1
+        tail -3 "$build/out"
+      else
+        failed=1
+      fi
+      ;;
+    *)
+      "$build/$t" || failed=1
+      ;;
+  esac
+done
+
+[ $failed = 0 ] && echo "all passed" || echo "FAILED"
+exit $failed
@@ -0,0 +1,152 @@
+/**************************************************************************************************
+ *
+ *      Host test - task scheduler and timer wheel (scheduler.h) - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Checks periodic tasks run the right number of times (including when setup takes a while
+ *      before the tasks are added), that a task which holds loop up does not cause the others to
+ *      run several times in a row to catch up, and that they carry on as before when millis() wraps
+ *      round.  Then times a pass of the scheduler with 10, 100, 1000 and 4000 tasks against checking
+ *      each task's timer every pass (as loop did before).
+ *
+ **************************************************************************************************/
+
+#include "sketch.h"
+const uint16_t taskMax = 4000;              // (a setting in the main sketch)
+#include "../../BasicWebserver/scheduler.h"
+#include <random>
+
+int runs[8];
+int mostInPass[8];                          // most times each task ran in one schedulerLoop()
+int inPass[8];
+bool slowNow = 0;
+
+template<int N> void counted() {
+  runs[N]++;
+  if (++inPass[N] > mostInPass[N]) mostInPass[N] = inPass[N];
+}
+
+void pass() {
+  for (int &n : inPass) n = 0;
+  schedulerLoop();
+}
+
+// start again with no tasks
+void schedulerReset() {
+  taskCount = 0;
+  taskEveryFirst = taskEveryLast = taskNone;
+  wheelReady = 0;
+  for (int i=0; i < 8; i++) runs[i] = mostInPass[i] = 0;
+}
+
+int failures = 0;
+void check(bool ok, const char* what) {
+  if (ok) return;
+  printf("FAILED: %s\n", what);
+  failures++;
+}
+
+
+// ----------------------------------------------------------------
+//    -checking each task's timer every pass (as loop did before)
+// ----------------------------------------------------------------
+
+uint32_t linearTimer[taskMax];
+
+void linearLoop() {
+  for (uint16_t id=0; id < taskCount; id++) {
+    Task &t = tasks[id];
+    if ((uint32_t)(millis() - linearTimer[id]) >= t.period) {
+      linearTimer[id] = millis();
+      t.function();
+    }
+  }
+}
+
+int benchRuns = 0;
+void benchTask() { benchRuns++; }
+
+// time a pass of each with 'n' tasks of between 100ms and 10s, returns the runs of each in 60s
+void bench(uint16_t n) {
+  schedulerReset();
+  std::mt19937 rng(n);
+  for (uint16_t i=0; i < n; i++) taskAdd("bench", benchTask, 100 + rng() % 9900);
+  benchRuns = 0;
+  double wheelNs = hostTimeNs(60000, [](int) { schedulerLoop(); hostAdvance(1); });
+  int wheelRuns = benchRuns;
+  for (uint16_t i=0; i < n; i++) linearTimer[i] = millis();
+  benchRuns = 0;
+  double linearNs = hostTimeNs(60000, [](int) { linearLoop(); hostAdvance(1); });
+  printf("scheduler: %4u tasks %7.0f ns per pass, %7.0f ns checking every timer (%d / %d runs in 60s)\n",
+         n, wheelNs, linearNs, wheelRuns, benchRuns);
+  check(abs(wheelRuns - benchRuns) <= n, "wheel and timers ran the tasks a different number of times");
+}
+
+
+int main() {
+
+  hostAdvance(5000);                        // setup took 5 seconds before the tasks were added
+
+  taskAdd("1500ms", counted<0>, 1500);
+  taskAdd("30s", counted<1>, 30000);
+  taskAdd("500ms", counted<2>, 500);
+  taskAdd("every pass", counted<3>, 0);
+
+  // five minutes of loop() running every ms
+    for (int ms=0; ms <= 300000; ms++) {
+      pass();
+      hostAdvance(1);
+    }
+    printf("scheduler: in 300s ran 1500ms x%d, 30s x%d, 500ms x%d, most in one pass %d, misses %u %u %u\n",
+           runs[0], runs[1], runs[2], mostInPass[0] > mostInPass[2] ? mostInPass[0] : mostInPass[2],
+           tasks[0].misses, tasks[1].misses, tasks[2].misses);
+    check(runs[0] == 200 && runs[1] == 10 && runs[2] == 600, "periodic tasks ran the wrong number of times");
+    check(runs[3] == 300001, "'every pass' task did not run every pass");
+    check(mostInPass[0] == 1 && mostInPass[1] == 1 && mostInPass[2] == 1, "a task ran more than once in a pass");
+    check(tasks[0].misses + tasks[1].misses + tasks[2].misses == 0, "tasks ran later than their deadline");
+
+  // a task which holds loop up for 2 seconds once (longer than a turn of the wheel)
+    int slow = taskAdd("slow", [](){ if (slowNow) { slowNow = 0; hostAdvance(2000); } }, 1000);
+    taskAdd("50ms", counted<4>, 50);
+    for (int &n : mostInPass) n = 0;
+    for (int ms=0; ms < 10000; ms++) {
+      if (ms == 5000) slowNow = 1;
+      pass();
+      hostAdvance(1);
+    }
+    printf("scheduler: after a 2s stall the 50ms task ran at most %d time(s) in one pass, %d runs in 12s\n",
+           mostInPass[4], runs[4]);
+    check(mostInPass[4] == 1, "tasks burst to catch up after a long task");
+    check(slow >= 0 && runs[4] >= 195 && runs[4] <= 205, "50ms task ran the wrong number of times");
+
+  // millis() wrapping round (20 seconds either side of it)
+    schedulerReset();
+    hostUs = (0x100000000ULL - 20000) * 1000;
+    taskAdd("500ms", counted<0>, 500);
+    taskAdd("10ms", counted<1>, 10);
+    taskAdd("every pass", counted<3>, 0);
+    uint32_t passes = 0;
+    for (int ms=0; ms < 40000; ms++) {
+      pass();
+      passes++;
+      hostAdvance(1);
+    }
+    printf("scheduler: across millis() wrapping round ran 500ms x%d, 10ms x%d in 40s, most in one pass %d\n",
+           runs[0], runs[1], mostInPass[0] > mostInPass[1] ? mostInPass[0] : mostInPass[1]);
+    check(runs[0] == 79 && runs[1] >= 3990 && runs[1] <= 3999 && runs[3] == (int)passes, "tasks ran the wrong number of times across the wrap");
+    check(mostInPass[0] == 1 && mostInPass[1] == 1, "a task ran more than once in a pass across the wrap");
+
+  // no room
+    schedulerReset();
+    while (taskCount < taskMax) taskAdd("filler", benchTask, 1000);
+    check(taskAdd("one too many", benchTask, 1000) == -1, "task added with no room");
+
+  // time for a pass as the number of tasks grows (on this PC)
+    for (uint16_t n : {10, 100, 1000, 4000}) bench(n);
+
+  return failures ? 1 : 0;
+}
+
+
+// --------------------------- E N D -----------------------------
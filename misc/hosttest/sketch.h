@@ -0,0 +1,114 @@
+/**************************************************************************************************
+ *
+ *      Parts of the main sketch most modules need, for the host tests - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      The settings, the sketch's debug output (debug.h) and scopes (scope.h), plus a web server
+ *      whose client keeps what a page sends (in hostSent) and request arguments set by the test.
+ *
+ **************************************************************************************************/
+
+#pragma once
+
+#include "Arduino.h"
+#include <map>
+#include <vector>
+
+
+// settings from the main sketch (a test can set them before including this)
+
+  #ifndef DEBUG_LEVEL
+    #define DEBUG_LEVEL 3
+  #endif
+  #ifndef ENABLE_DUALCORE
+    #define ENABLE_DUALCORE 0
+  #endif
+  #ifndef ENABLE_STALLS
+    #define ENABLE_STALLS 0
+  #endif
+  #ifndef ENABLE_PROFILER
+    #define ENABLE_PROFILER 0
+  #endif
+  const bool serialDebug = 1;
+
+  #include "../../BasicWebserver/scope.h"
+  #include "../../BasicWebserver/debug.h"
+
+
+// web server
+
+  inline std::string hostSent;              // everything the pages have sent
+  inline uint32_t hostClientIP = 0x0100A8C0;   // address of the client making the request (192.168.0.1)
+
+  class HostClient : public Print {
+    public:
+      using Print::write;
+      size_t write(const uint8_t* buf, size_t len) override { hostSent.append((const char*)buf, len); return len; }
+      IPAddress remoteIP() { return IPAddress(hostClientIP); }
+      bool connected() { return 1; }
+      void flush() {}
+      void stop() {}
+  };
+  typedef HostClient WiFiClient;
+  typedef HostClient ServerClient;
+  typedef HostClient MeteredClient;
+
+  enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST };
+
+  inline void (*hostHandleClient)() = nullptr;  // what handleClient() does (set by the test)
+
+  struct HostServer {
+    String hostUri = "/";                   // the current request (set by the test)
+    HTTPMethod hostMethod = HTTP_GET;
+    std::vector<std::pair<String, String>> hostArgs;
+    std::map<std::string, String> hostHeaders;    // request headers (set by the test)
+
+    HostClient client() { return HostClient(); }
+    void handleClient() { if (hostHandleClient) hostHandleClient(); }
+    template<typename H> void addHandler(H*) {}
+    const String& uri() { return hostUri; }
+    HTTPMethod method() { return hostMethod; }
+    int args() { return hostArgs.size(); }
+    const String& argName(int i) { return hostArgs[i].first; }
+    const String& arg(int i) { return hostArgs[i].second; }
+    void collectHeaders(const char**, size_t) {}
+    String header(const char* name) { return hostHeaders.count(name) ? hostHeaders[name] : String(); }
+    bool hasArg(const char* name) {
+      for (auto &a : hostArgs) if (a.first == name) return 1;
+      return 0;
+    }
+    void send(int code, const char* type, const String &text) {
+      HostClient().printf("HTTP/1.1 %d\r\nContent-Type: %s\r\n\r\n%s", code, type, text.c_str());
+    }
+  };
+  typedef HostServer ESP8266WebServer;
+  typedef HostServer WebServer;             // (the esp32 name)
+
+  class RequestHandler {
+    public:
+      virtual ~RequestHandler() {}
+      virtual bool canHandle(HTTPMethod, String) { return 0; }
+      virtual bool canUpload(String) { return 0; }
+      virtual bool handle(ESP8266WebServer&, HTTPMethod, String) { return 0; }
+  };
+  inline HostServer server;
+
+  #ifndef HOST_STANDARD                     // (a test which includes standard.h gets the real ones)
+    inline void webheader(Print&) {}
+    inline void webfooter(Print&) {}
+  #endif
+
+
+// request arguments (in place of reqctx.h)
+
+  struct HostRequest {
+    std::map<std::string, std::string> args;
+    bool has(const char* name) { return args.count(name); }
+    const char* arg(const char* name) { return has(name) ? args[name].c_str() : ""; }
+  };
+  inline HostRequest hostRequest;
+  inline HostRequest& requestBegin(Print&) { return hostRequest; }
+
+
+// --------------------------- E N D -----------------------------
@@ -0,0 +1,140 @@
+/**************************************************************************************************
+ *
+ *      Host test - loop stall detector (stall.h) - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Runs passes of loop with code inside tagged scopes taking various times while the timer
+ *      interrupt is fired every 'stallTick' ms of the fake clock.  Checks short passes are not
+ *      stalls, a stall is put down to the innermost scope with about the right length, only new
+ *      worst cases are logged, the table filling up and the /stalls page.  Then times a pass with
+ *      no stall (what the detector costs all the time).
+ *
+ **************************************************************************************************/
+
+#define ENABLE_STALLS 1
+#include "sketch.h"
+#include <vector>
+
+
+// ----------------------------------------------------------------
+//                -what stall.h needs from the sketch
+// ----------------------------------------------------------------
+
+  const uint16_t stallThreshold = 500;
+
+  enum logLevels { logDebug, logInfo, logWarning, logError };
+  std::vector<std::string> logged;
+  void logMessage(byte, const char* fmt, ...) {
+    char buf[100];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    logged.push_back(buf);
+  }
+
+  // esp8266 timer1 (the interrupt is fired by the test)
+  enum { TIM_DIV256, TIM_EDGE, TIM_LOOP };
+  void (*timerISR)() = nullptr;
+  void timer1_attachInterrupt(void (*isr)()) { timerISR = isr; }
+  void timer1_enable(int, int, int) {}
+  void timer1_write(uint32_t) {}
+
+
+#include "../../BasicWebserver/stall.h"
+
+
+// ----------------------------------------------------------------
+//                              -test
+// ----------------------------------------------------------------
+
+int failures = 0;
+void check(bool ok, const char* what) {
+  if (ok) return;
+  printf("FAILED: %s\n", what);
+  failures++;
+}
+
+// code running for 'ms' (the timer interrupt fires every stallTick ms meanwhile)
+void busy(uint32_t ms) {
+  for (uint32_t i=0; i < ms; i++) {
+    hostAdvance(1);
+    if (millis() % stallTick == 0) timerISR();
+  }
+}
+
+StallSite* site(const char* name) {
+  for (StallSite &s : stallSites) if (s.name && !strcmp(s.name, name)) return &s;
+  return nullptr;
+}
+
+// a pass of loop with the web server, wifi check and a request to another server
+void pass(uint32_t webMs, uint32_t wifiMs, uint32_t requestMs) {
+  stallLoop();
+  { LOOP_SCOPE("web page"); busy(webMs); }
+  {
+    LOOP_SCOPE("task:wifi");
+    busy(wifiMs);
+    LOOP_SCOPE("requestWebPage");
+    busy(requestMs);
+  }
+  busy(1);
+}
+
+
+int main() {
+
+  stallSetup();
+
+  // a minute of normal passes (the longest just under the threshold)
+    for (int i=0; i < 6000; i++) pass(i % 100 ? 5 : 400, 2, i % 500 ? 0 : 90);
+    stallLoop();
+    check(stallTotal == 0 && logged.empty(), "normal passes counted as stalls");
+
+  // a request to another server stalling inside the wifi task
+    pass(5, 2, 2000);
+    stallLoop();
+    StallSite* s = site("requestWebPage");
+    printf("stall: 2s stall recorded in %s, %u ms, log '%s'\n", s ? s->name : "(none)", s ? s->maxMs : 0, logged.empty() ? "" : logged.back().c_str());
+    check(s && s->count == 1 && s->maxMs >= 2000 && s->maxMs <= 2010 && !site("task:wifi"), "stall not put down to the innermost scope");
+    check(logged.size() == 1, "stall not logged");
+
+  // the same stall again (not logged) then a longer one (logged)
+    for (int i=0; i < 5; i++) pass(5, 2, 1000);
+    pass(5, 2, 3000);
+    stallLoop();
+    check(s->count == 7 && logged.size() == 2 && s->maxMs >= 3000, "only new worst cases should be logged");
+
+  // a stall outside any scope
+    stallLoop();
+    busy(700);
+    stallLoop();
+    check(site("loop (untagged)") && site("loop (untagged)")->count == 1, "untagged stall");
+
+  // more places than the table holds
+    static const char* names[] = { "a", "b", "c", "d", "e", "f", "g", "h", "i", "j", "k", "l", "m", "n" };
+    for (const char* n : names) {
+      stallLoop();
+      { LOOP_SCOPE(n); busy(600); }
+    }
+    stallLoop();
+    printf("stall: %u stalls, %u not recorded as the table was full\n", stallTotal, stallDropped);
+    check(stallDropped == 14 - (stallMaxSites - 2u), "table full");
+
+  // the page (worst first)
+    hostSent.clear();
+    handleStalls();
+    size_t first = hostSent.find("<td>requestWebPage</td><td>7</td>");
+    check(first != std::string::npos && first < hostSent.find("<td>loop (untagged)</td>"), "/stalls page");
+
+  // cost of a pass with no stall: stallLoop() and the interrupt (on this PC)
+    double loopNs = hostTimeNs(10000000, [](int) { stallLoop(); });
+    double isrNs = hostTimeNs(10000000, [](int) { stallISR(); stallPassTick = stallTicks; });
+    printf("stall: %.1f ns for stallLoop(), %.1f ns for the timer interrupt\n", loopNs, isrNs);
+
+  return failures ? 1 : 0;
+}
+
+
+// --------------------------- E N D -----------------------------
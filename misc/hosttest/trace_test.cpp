@@ -0,0 +1,118 @@
+/**************************************************************************************************
+ *
+ *      Host test - request tracing (trace.h) - 18Oct26
+ *
+ *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+ *
+ *      Traces requests nested the way the sketch does it (handleClient, the page handler, webheader
+ *      and webfooter) and checks /trace.json is in Chrome trace-event format with each end after its
+ *      begin and times relative to the first event, including after the ring has wrapped round and
+ *      the begin of some events has been overwritten.  Then times recording an event.
+ *
+ **************************************************************************************************/
+
+#define ENABLE_TRACE 1
+#include "sketch.h"
+#include "../../BasicWebserver/trace.h"
+
+
+int failures = 0;
+void check(bool ok, const char* what) {
+  if (ok) return;
+  printf("FAILED: %s\n", what);
+  failures++;
+}
+
+// a request for a page which takes 'us' in the handler
+void request(uint16_t page, uint32_t us) {
+  TRACE_SCOPE(trHandleClient);
+  hostUs += 300;                            // (accepting and reading the request)
+  TRACE_SCOPE(page);
+  { TRACE_SCOPE(trWebheader); hostUs += 200; }
+  hostUs += us;
+  { TRACE_SCOPE(trWebfooter); hostUs += 150; }
+  TRACE_BEGIN(trFlush);
+  TRACE_END(trFlush);
+}
+
+struct Traced { int events = 0, begins = 0, ends = 0, lowest = 0; bool inOrder = 1; uint32_t first = 1, last = 0; };
+
+// read the events sent by /trace.json
+Traced traced() {
+  Traced t;
+  hostSent.clear();
+  handleTrace();
+  const char* start = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  size_t body = hostSent.find("\r\n\r\n");
+  check(hostSent.rfind("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n", 0) == 0 && body != std::string::npos
+        && hostSent.compare(body + 4, strlen(start), start) == 0
+        && hostSent.compare(hostSent.size() - 3, 3, "]}\n") == 0, "not in trace-event format");
+  int depth = 0;
+  for (size_t pos = hostSent.find("{\"name\""); pos != std::string::npos; pos = hostSent.find("{\"name\"", pos + 1)) {
+    char name[32], ph;
+    uint32_t ts;
+    if (sscanf(hostSent.c_str() + pos, "{\"name\":\"%31[^\"]\",\"ph\":\"%c\",\"ts\":%u,\"pid\":1,\"tid\":1}", name, &ph, &ts) != 3) {
+      check(0, "event not in trace-event format");
+      break;
+    }
+    if (t.events == 0) t.first = ts;
+    else if (ts < t.last) t.inOrder = 0;
+    t.last = ts;
+    t.events++;
+    depth += (ph == 'B') ? 1 : -1;
+    if (ph == 'B') t.begins++; else t.ends++;
+    if (depth < t.lowest) t.lowest = depth;
+  }
+  return t;
+}
+
+
+int main() {
+
+  // tags
+    uint16_t data = traceTag("/data");
+    char name[] = "/data";                  // (same name, different pointer)
+    check(traceTag(name) == data && data == trFixedTags, "same name given a different tag");
+
+  // a few requests
+    for (int i=0; i < 5; i++) request(data, 2000);
+    Traced t = traced();
+    printf("trace: 5 requests, %d events sent, first at %u us, last at %u us\n", t.events, t.first, t.last);
+    check(t.events == 5 * 10 && t.begins == t.ends && t.lowest == 0 && t.first == 0 && t.inOrder, "5 requests");
+    check(t.last == 4 * (300 + 200 + 2000 + 150) + 300 + 200 + 2000 + 150, "times not relative to the first event");
+
+  // the ring wrapped round part way through a request (ends whose begin has gone are left out)
+    for (int i=0; i < 1000; i++) request(data, 1000 + i);
+    hostUs += 77;
+    TRACE_BEGIN(trHandleClient);
+    hostUs += 50;
+    TRACE_END(trHandleClient);
+    t = traced();
+    printf("trace: after 1000 more requests %d events sent (%d begin, %d end)\n", t.events, t.begins, t.ends);
+    check(t.events <= traceSize && t.events > traceSize - 10 && t.lowest == 0 && t.inOrder && t.first == 0, "after the ring wrapped");
+
+  // clearing
+    server.hostArgs = { {"clear", "1"} };
+    traced();
+    server.hostArgs.clear();
+    t = traced();
+    check(t.events == 0, "?clear=1 did not clear");
+
+  // more tags than there is room for share the handler tag
+    static char names[traceMaxTags][8];
+    uint16_t last = 0;
+    for (int i=0; i < traceMaxTags; i++) {
+      snprintf(names[i], sizeof(names[i]), "/p%d", i);
+      last = traceTag(names[i]);
+    }
+    check(last == trHandler && traceTagCount == traceMaxTags, "tags beyond the table");
+
+  // time to record an event (on this PC, micros() is the fake clock here)
+    double ns = hostTimeNs(10000000, [](int) { TRACE_SCOPE(trHandler); }) / 2;
+    printf("trace: %.1f ns per event\n", ns);
+
+  return failures ? 1 : 0;
+}
+
+
+// --------------------------- E N D -----------------------------
@@ -0,0 +1,193 @@
+#!/usr/bin/env python3
+"""
+   Create a delta (patch) firmware update for the BasicWebserver sketch - 18Oct26
+
+   part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+
+   The patch is uploaded on the /ota page (delta update) and only works if the device is running
+   exactly the firmware the patch was made from (the device checks its md5), otherwise upload the
+   full firmware image as usual.
+
+   usage:    python3 otadelta.py <old firmware.bin> <new firmware.bin> <patch file>
+             (the .bin files can be found with "Sketch/Export compiled binary" in the Arduino IDE)
+
+   The patch is applied again here afterwards to check it produces the new firmware and the
+   sizes and times taken are displayed.  (This is a copy of the device's decoder, the one in ota.h
+   is tested with patches made by this in misc/hosttest/delta_test.cpp)
+
+   See the notes at the top of ota.h for details of the patch format.
+"""
+
+import hashlib
+import struct
+import sys
+import time
+
+MAGIC = b"BWSDELT1"
+END, COPY, ADD, INSERT, SEEK = range(5)
+
+KEY = 8              # bytes used to look for matching sections of the old firmware
+MIN_MATCH = 24       # shortest matching section worth using
+MAX_CANDIDATES = 8   # number of places in the old firmware stored for each key
+
+
+def varint(n):
+    out = bytearray()
+    while True:
+        b = n & 0x7F
+        n >>= 7
+        if n:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return bytes(out)
+
+
+def zigzag(n):
+    return (n << 1) if n >= 0 else ((-n << 1) - 1)
+
+
+def extend(old, new, o, j):
+    """length of the section starting at old[o] / new[j] which mostly matches
+       (compiled code often only differs by a few bytes where addresses have moved)"""
+    length = best = score = 0
+    limit = min(len(old) - o, len(new) - j)
+    while length < limit:
+        if old[o + length] == new[j + length]:
+            score = min(score + 1, 32)
+            if score > 0:
+                best = length + 1
+        else:
+            score -= 2
+            if score < -16:
+                break
+        length += 1
+    return best
+
+
+def make_patch(old, new):
+    index = {}
+    for i in range(len(old) - KEY):
+        places = index.setdefault(old[i:i + KEY], [])
+        if len(places) < MAX_CANDIDATES:
+            places.append(i)
+
+    ops = bytearray()
+    old_pos = 0          # where the device will be reading in the old firmware
+    lag = 0              # offset between old and new for the previous match
+    insert_start = 0
+    j = 0
+
+    def emit_insert(upto):
+        if upto > insert_start:
+            ops.extend(bytes([INSERT]) + varint(upto - insert_start) + new[insert_start:upto])
+
+    while j < len(new) - KEY:
+        places = index.get(new[j:j + KEY])
+        if not places:
+            j += 1
+            continue
+        # prefer continuing from where the last match was
+        if (j + lag) not in places and 0 <= j + lag < len(old) - KEY and old[j + lag:j + lag + KEY] == new[j:j + KEY]:
+            places = [j + lag] + places
+        o, length = max(((p, extend(old, new, p, j)) for p in places), key=lambda x: x[1])
+        if length < MIN_MATCH:
+            j += 1
+            continue
+
+        emit_insert(j)
+        if o != old_pos:
+            ops.extend(bytes([SEEK]) + varint(zigzag(o - old_pos)))
+
+        # equal bytes are copied, changed ones are sent as differences
+        k = 0
+        while k < length:
+            start = k
+            if old[o + k] == new[j + k]:
+                while k < length and old[o + k] == new[j + k]:
+                    k += 1
+                ops.extend(bytes([COPY]) + varint(k - start))
+            else:
+                while k < length and (old[o + k] != new[j + k] or old[o + k:o + k + 4] != new[j + k:j + k + 4]):
+                    k += 1
+                ops.extend(bytes([ADD]) + varint(k - start))
+                ops.extend(bytes((new[j + i] - old[o + i]) & 0xFF for i in range(start, k)))
+
+        old_pos = o + length
+        lag = o - j
+        j += length
+        insert_start = j
+
+    emit_insert(len(new))
+    ops.append(END)
+
+    header = MAGIC + struct.pack("<II", len(old), len(new)) + hashlib.md5(old).digest() + hashlib.md5(new).digest()
+    return header + bytes(ops)
+
+
+def apply_patch(old, patch):
+    """apply a patch the same way the device does (used to check the patch)"""
+    if patch[:8] != MAGIC:
+        raise ValueError("not a delta patch")
+    old_size, new_size = struct.unpack("<II", patch[8:16])
+    if old_size != len(old) or hashlib.md5(old).digest() != patch[16:32]:
+        raise ValueError("patch was not made from this firmware")
+    out = bytearray()
+    pos, old_pos = 48, 0
+    while True:
+        op = patch[pos]
+        pos += 1
+        if op == END:
+            break
+        value = shift = 0
+        while True:
+            b = patch[pos]
+            pos += 1
+            value |= (b & 0x7F) << shift
+            shift += 7
+            if not b & 0x80:
+                break
+        if op == SEEK:
+            old_pos += (value >> 1) ^ -(value & 1)
+        elif op == COPY:
+            out += old[old_pos:old_pos + value]
+            old_pos += value
+        elif op == ADD:
+            out += bytes((old[old_pos + i] + patch[pos + i]) & 0xFF for i in range(value))
+            old_pos += value
+            pos += value
+        elif op == INSERT:
+            out += patch[pos:pos + value]
+            pos += value
+        else:
+            raise ValueError("invalid operation %d" % op)
+    if len(out) != new_size or hashlib.md5(out).digest() != patch[32:48]:
+        raise ValueError("patch does not produce the new firmware")
+    return bytes(out)
+
+
+def main():
+    if len(sys.argv) != 4:
+        print(__doc__)
+        sys.exit(1)
+    old = open(sys.argv[1], "rb").read()
+    new = open(sys.argv[2], "rb").read()
+
+    t = time.perf_counter()
+    patch = make_patch(old, new)
+    made = time.perf_counter() - t
+
+    t = time.perf_counter()
+    result = apply_patch(old, patch)
+    applied = time.perf_counter() - t
+    assert result == new
+
+    open(sys.argv[3], "wb").write(patch)
+    print("old firmware:  %d bytes" % len(old))
+    print("new firmware:  %d bytes" % len(new))
+    print("patch:         %d bytes (%.1f%% of new firmware)" % (len(patch), 100.0 * len(patch) / max(len(new), 1)))
+    print("created in %.2fs, checked (applied) in %.2fs" % (made, applied))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+"""
+   Convert the output of the BasicWebserver profiler to function names - 18Oct26
+
+   part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+
+   The profiler (http://x.x.x.x/profile?seconds=10) records code addresses, this looks them up in
+   the compiled sketch (.elf file) and adds up the samples so the result can be turned in to a
+   flamegraph with flamegraph.pl (https://github.com/brendangregg/FlameGraph)
+
+   usage:    curl "http://x.x.x.x/profile?seconds=10" > profile.txt
+             python3 profile.py <sketch.elf> profile.txt > folded.txt
+             flamegraph.pl folded.txt > profile.svg
+
+             The .elf file is in the temporary build folder (turn on verbose output when compiling
+             in the Arduino IDE to see where it is).
+             addr2line is the one from the esp toolchain, e.g. xtensa-lx106-elf-addr2line (esp8266)
+             or xtensa-esp32-elf-addr2line (esp32), set with --addr2line if it is not on the path.
+"""
+
+import argparse
+import collections
+import subprocess
+
+
+def main():
+    parser = argparse.ArgumentParser(usage=__doc__)
+    parser.add_argument("elf")
+    parser.add_argument("profile")
+    parser.add_argument("--addr2line", default="xtensa-lx106-elf-addr2line")
+    args = parser.parse_args()
+
+    counts = collections.Counter()
+    for line in open(args.profile):
+        line = line.strip()
+        if not line:
+            continue
+        stack, _, count = line.rpartition(" ")
+        counts[stack] += int(count)
+
+    # look up all the addresses in one go
+    # (the esp32 does not record addresses so its lines end with a scope name)
+    addresses = sorted({a for a in (stack.rpartition(";")[2] for stack in counts) if a.startswith("0x")})
+    names = {}
+    if addresses:
+        out = subprocess.run([args.addr2line, "-f", "-C", "-e", args.elf] + addresses,
+                             capture_output=True, text=True, check=True).stdout.splitlines()
+        for i, address in enumerate(addresses):
+            function = out[i * 2] if i * 2 < len(out) else "??"
+            names[address] = address if function == "??" else function.replace(";", ":")
+
+    result = collections.Counter()
+    for stack, count in counts.items():
+        frames, _, address = stack.rpartition(";")
+        result[(frames + ";" if frames else "") + names.get(address, address)] += count
+
+    for stack, count in sorted(result.items()):
+        print(stack, count)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,296 @@
+#!/usr/bin/env python3
+"""
+   Compile the html templates and static files for the BasicWebserver sketch - 18Oct26
+
+   part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver
+
+   Turns the .html files in BasicWebserver/templates and the files in BasicWebserver/assets in to
+   BasicWebserver/pages.h, run this after changing any of them (pages.h is included with the sketch
+   so this is not needed otherwise).
+
+   usage:    python3 templates.py                 (from the misc folder or the top of the repository)
+
+   Templates
+   ---------
+   Each template becomes a function  render_<name>(Print &out, ...)  which sends the page, the fixed
+   text is stored in flash (PROGMEM) and sent directly so no Strings or memory allocation are needed.
+   The text is sent exactly as it is in the template (including spaces and line feeds).
+   Each piece of fixed text is also stored compressed (a deflate block) so a page can be sent gzipped
+   by sending these as they are with the values filled in between them (see gzip.h).
+
+   In the templates:
+       {{name}}             text (const char*)
+       {{name:int}}         number (int)
+       {{#name}} ... {{/name}}   only included if name is true (bool)
+       {{@file}}            url of a file in the assets folder e.g. {{@style.css}}
+       {{! comment }}       ignored (along with the rest of the line)
+
+   The parameters of the render function are in the order they first appear in the template.
+
+   Assets
+   ------
+   The .css, .js and .html files in the assets folder are minified, gzipped and stored in flash,
+   they are served by assets.h as http://x.x.x.x/a/<file>.  Each has an ETag made from a hash of its
+   contents which is also added to its url ({{@file}} gives e.g. "/a/style.css?v=1a2b3c4d") so when a
+   file changes the browser loads the new version but otherwise uses the copy it already has.
+"""
+
+import gzip
+import hashlib
+import os
+import re
+import sys
+import zlib
+
+TOKEN = re.compile(r"\{\{(?:!.*?\}\}[^\n]*\n?|([#/@]?)([\w.]+)(?::(\w+))?\}\})")
+TYPES = {"str": "const char*", "int": "int", "bool": "bool"}
+MIME = {".css": "text/css", ".js": "application/javascript", ".html": "text/html"}
+
+
+def c_string(text):
+    out = []
+    for ch in text.encode("utf-8") if isinstance(text, str) else text:
+        c = chr(ch)
+        if c == "\\":
+            out.append("\\\\")
+        elif c == '"':
+            out.append('\\"')
+        elif c == "\n":
+            out.append("\\n")
+        elif c == "\t":
+            out.append("\\t")
+        elif 32 <= ch < 127:
+            out.append(c)
+        else:
+            out.append("\\%03o" % ch)
+    return '"' + "".join(out) + '"'
+
+
+def c_bytes(data):
+    lines = []
+    for i in range(0, len(data), 20):
+        lines.append("    " + ",".join("0x%02x" % b for b in data[i:i + 20]) + ",")
+    return "{\n" + "\n".join(lines) + "\n  }"
+
+
+def c_name(name):
+    return re.sub(r"\W", "_", name)
+
+
+def deflate_block(data):
+    """data compressed on its own and ending on a whole byte (not the last block) so blocks can be joined"""
+    z = zlib.compressobj(9, zlib.DEFLATED, -15)
+    return z.compress(data) + z.flush(zlib.Z_SYNC_FLUSH)
+
+
+# ----------------------------------------------------------------
+#                          -assets
+# ----------------------------------------------------------------
+
+def minify(name, text):
+    """simple minifying which is safe for the sort of files used in the sketch"""
+    ext = os.path.splitext(name)[1]
+    if ext == ".css":
+        text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+        text = re.sub(r"\s+", " ", text)
+        text = re.sub(r"\s*([{}:;,>])\s*", r"\1", text)
+        text = text.replace(";}", "}")
+    elif ext == ".js":
+        lines = []
+        for line in text.split("\n"):
+            line = line.strip()
+            if line and not line.startswith("//"):
+                lines.append(line)
+        text = "\n".join(lines)
+    elif ext == ".html":
+        text = re.sub(r"<!--.*?-->", "", text, flags=re.S)
+        text = re.sub(r">\s+<", "><", text)
+        text = re.sub(r"\s+", " ", text)
+    return text.strip()
+
+
+def compile_asset(name, text):
+    """returns (url, declarations, table entry) for a file in the assets folder"""
+    data = minify(name, text).encode("utf-8")
+    etag = hashlib.sha256(data).hexdigest()[:8]
+    packed = gzip.compress(data, 9, mtime=0)
+    var = "asset_" + c_name(name)
+    decl = "  const char %s[] PROGMEM = %s;\n" % (var, c_string(data))
+    if len(packed) < len(data):
+        decl += "  const uint8_t %s_gz[] PROGMEM = %s;\n" % (var, c_bytes(packed))
+        gz = "%s_gz, sizeof(%s_gz)" % (var, var)
+    else:
+        gz = "nullptr, 0"
+    entry = '    { "%s", "%s", "\\"%s\\"", %s, sizeof(%s) - 1, %s },       // %d bytes, %d gzipped\n' % (
+        name, MIME[os.path.splitext(name)[1]], etag, var, var, gz, len(data), len(packed))
+    return "/a/%s?v=%s" % (name, etag), decl, entry
+
+
+# ----------------------------------------------------------------
+#                          -templates
+# ----------------------------------------------------------------
+
+def compile_template(name, text, assets):
+    """returns (flash text declarations, function signature, function) for a template"""
+    params = []            # (name, type)
+    statements = []        # (indent, code)
+    spans = []             # fixed text
+    pending = []           # text not yet stored
+    open_sections = []
+    pos = 0
+
+    def add_param(pname, ptype):
+        for n, t in params:
+            if n == pname:
+                if t != ptype:
+                    sys.exit("%s: '%s' used as both %s and %s" % (name, pname, t, ptype))
+                return
+        params.append((pname, ptype))
+
+    def add_statement(code):
+        text = "".join(pending)
+        pending[:] = []
+        if text:
+            spans.append(text)
+            var = "page_%s_%d" % (name, len(spans) - 1)
+            if len(deflate_block(text.encode("utf-8"))) < len(text.encode("utf-8")):
+                statements.append((len(open_sections), "pageText(out, %s, sizeof(%s) - 1, %s_z, sizeof(%s_z));" % (var, var, var, var)))
+            else:
+                statements.append((len(open_sections), "pageWrite_P(out, %s, sizeof(%s) - 1);" % (var, var)))
+        if code:
+            statements.append((len(open_sections), code))
+
+    for m in TOKEN.finditer(text):
+        pending.append(text[pos:m.start()])
+        pos = m.end()
+        kind, pname, ptype = m.groups()
+        if pname is None:                   # comment
+            continue
+        if kind == "@":
+            if pname not in assets:
+                sys.exit("%s: no file '%s' in the assets folder" % (name, pname))
+            pending.append(assets[pname])
+            continue
+        if not re.match(r"^\w+$", pname):
+            sys.exit("%s: '%s' is not a valid name" % (name, pname))
+        if kind == "#":
+            add_param(pname, "bool")
+            add_statement("if (%s) {" % pname)
+            open_sections.append(pname)
+        elif kind == "/":
+            if not open_sections or open_sections[-1] != pname:
+                sys.exit("%s: {{/%s}} does not match" % (name, pname))
+            add_statement(None)
+            open_sections.pop()
+            statements.append((len(open_sections), "}"))
+        else:
+            ptype = ptype or "str"
+            if ptype not in TYPES:
+                sys.exit("%s: unknown type '%s'" % (name, ptype))
+            add_param(pname, ptype)
+            add_statement("out.print(%s);" % pname)
+    pending.append(text[pos:])
+    add_statement(None)
+    if open_sections:
+        sys.exit("%s: {{#%s}} is not closed" % (name, open_sections[-1]))
+
+    declarations = ""
+    for i, s in enumerate(spans):
+        declarations += "  const char page_%s_%d[] PROGMEM = %s;\n" % (name, i, c_string(s))
+        z = deflate_block(s.encode("utf-8"))
+        if len(z) < len(s.encode("utf-8")):
+            declarations += "  const uint8_t page_%s_%d_z[] PROGMEM = %s;        // %d bytes compressed\n" % (name, i, c_bytes(z), len(z))
+    signature = "void render_%s(Print &out%s)" % (name, "".join(", %s %s" % (TYPES[t], n) for n, t in params))
+    body = "".join("  " + "  " * indent + code + "\n" for indent, code in statements)
+    return declarations, signature, "%s {\n%s}\n" % (signature, body)
+
+
+def section(title):
+    return "\n\n// ----------------------------------------------------------------\n//%s-%s\n// ----------------------------------------------------------------\n\n" % (" " * max(1, 30 - len(title) // 2), title)
+
+
+def main():
+    top = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    sketch = os.path.join(top, "BasicWebserver")
+
+    def read(folder, f):
+        with open(os.path.join(sketch, folder, f), encoding="utf-8", newline="") as fh:
+            return fh.read()
+
+    asset_names = sorted(f for f in os.listdir(os.path.join(sketch, "assets")) if os.path.splitext(f)[1] in MIME)
+    assets = [(f, compile_asset(f, read("assets", f))) for f in asset_names]
+    urls = {f: url for f, (url, decl, entry) in assets}
+
+    compiled = []
+    for f in sorted(f for f in os.listdir(os.path.join(sketch, "templates")) if f.endswith(".html")):
+        name = f[:-5]
+        if not re.match(r"^\w+$", name):
+            sys.exit("template name '%s' must only contain letters, numbers and _" % f)
+        compiled.append((f, compile_template(name, read("templates", f), urls)))
+
+    out = []
+    out.append("/**************************************************************************************************\n")
+    out.append(" *\n")
+    out.append(" *      Web page templates and static files - 18Oct26\n")
+    out.append(" *\n")
+    out.append(" *      part of the BasicWebserver sketch - https://github.com/alanesq/BasicWebserver\n")
+    out.append(" *\n")
+    out.append(" *      Created by misc/templates.py from the files in the templates and assets folders - do not\n")
+    out.append(" *      edit this file, change those files and run  python3 misc/templates.py  instead.\n")
+    out.append(" *\n")
+    out.append(" **************************************************************************************************/\n\n\n")
+
+    out.append("// forward declarations (i.e. details of all functions in this file)\n")
+    for f, (decl, signature, function) in compiled:
+        out.append("  %s;\n" % signature)
+
+    out.append(section("static files (see assets.h)"))
+    out.append("  struct AssetFile {\n")
+    out.append("    const char* name;\n")
+    out.append("    const char* type;                       // content type\n")
+    out.append("    const char* etag;                       // hash of the contents (in quotes)\n")
+    out.append("    PGM_P data;                             // minified file\n")
+    out.append("    size_t len;\n")
+    out.append("    const uint8_t* gz;                      // gzipped (nullptr if it would not be any smaller)\n")
+    out.append("    size_t gzLen;\n")
+    out.append("  };\n\n")
+    for f, (url, decl, entry) in assets:
+        out.append(decl)
+    out.append("\n  const AssetFile assetFiles[] = {\n")
+    for f, (url, decl, entry) in assets:
+        out.append(entry)
+    out.append("  };\n")
+
+    out.append(section("send text stored in flash in small pieces"))
+    out.append("void pageWrite_P(Print &out, PGM_P text, size_t len) {\n")
+    out.append("  char buf[128];\n")
+    out.append("  while (len > 0) {\n")
+    out.append("    size_t n = (len > sizeof(buf)) ? sizeof(buf) : len;\n")
+    out.append("    memcpy_P(buf, text, n);\n")
+    out.append("    out.write((const uint8_t*)buf, n);\n")
+    out.append("    text += n;\n")
+    out.append("    len -= n;\n")
+    out.append("  }\n")
+    out.append("}\n\n")
+    out.append("// fixed text of a page, the compressed copy is sent if the page is being gzipped (see gzip.h)\n")
+    out.append("void pageText(Print &out, PGM_P text, size_t len, const uint8_t* z, size_t zLen) {\n")
+    out.append("  if (&out == pageGzip) pageGzip->writeDeflated(text, len, z, zLen);\n")
+    out.append("  else pageWrite_P(out, text, len);\n")
+    out.append("}\n")
+
+    for f, (decl, signature, function) in compiled:
+        out.append(section(f))
+        out.append(decl)
+        out.append("\n")
+        out.append(function)
+
+    out.append("\n\n// --------------------------- E N D -----------------------------\n")
+
+    target = os.path.join(sketch, "pages.h")
+    with open(target, "w", newline="\n") as fh:
+        fh.write("".join(out))
+    print("created %s from %d templates and %d assets" % (target, len(compiled), len(assets)))
+
+
+if __name__ == "__main__":
+    main()